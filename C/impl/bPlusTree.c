@@ -0,0 +1,448 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * bPlusTree.c
+ *
+ * B+ tree of pointers, see bPlusTree.h.
+ *
+ * Invariant for an internal node with keys k[0..n-1] and children c[0..n]: every element
+ * under c[i] is less than k[i], and every element under c[i+1] is greater than or equal
+ * to k[i]. Separators are always elements currently in the tree (the first element under
+ * c[i+1]), as the caller may free an element as soon as it is removed.
+ */
+#include "sonLibGlobalsInternal.h"
+#include "bPlusTree.h"
+
+#define LEAF_MAX BPLUSTREE_ORDER
+#define LEAF_MIN (BPLUSTREE_ORDER / 2)
+#define INTERNAL_MAX_KEYS (BPLUSTREE_ORDER - 1)
+#define INTERNAL_MIN_KEYS ((BPLUSTREE_ORDER - 1) / 2)
+
+struct bPlusTreeNode {
+    int64_t count; // Elements in a leaf, separator keys in an internal node.
+    bool leaf;
+    struct bPlusTreeNode *next, *prev; // Neighbouring leaves, for leaves only.
+    void *keys[BPLUSTREE_ORDER + 1]; // One spare slot to hold an overflow before splitting.
+    struct bPlusTreeNode *children[]; // Internal nodes only, BPLUSTREE_ORDER + 1 entries.
+};
+
+static struct bPlusTreeNode *constructNode(bool leaf) {
+    size_t size = sizeof(struct bPlusTreeNode);
+    if (!leaf) {
+        size += (BPLUSTREE_ORDER + 1) * sizeof(struct bPlusTreeNode *);
+    }
+    struct bPlusTreeNode *node = st_malloc(size);
+    node->count = 0;
+    node->leaf = leaf;
+    node->next = NULL;
+    node->prev = NULL;
+    return node;
+}
+
+/*
+ * Index of the first key >= item.
+ */
+static int64_t lowerBound(struct bPlusTree *tree, struct bPlusTreeNode *node, const void *item) {
+    int64_t low = 0, high = node->count;
+    while (low < high) {
+        int64_t mid = (low + high) / 2;
+        if (tree->compareFn(node->keys[mid], item) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/*
+ * Index of the first key > item.
+ */
+static int64_t upperBound(struct bPlusTree *tree, struct bPlusTreeNode *node, const void *item) {
+    int64_t low = 0, high = node->count;
+    while (low < high) {
+        int64_t mid = (low + high) / 2;
+        if (tree->compareFn(node->keys[mid], item) <= 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static struct bPlusTreeNode *findLeaf(struct bPlusTree *tree, const void *item) {
+    struct bPlusTreeNode *node = tree->root;
+    while (!node->leaf) {
+        node = node->children[upperBound(tree, node, item)];
+    }
+    return node;
+}
+
+struct bPlusTree *bPlusTree_construct(int (*compareFn)(const void *, const void *)) {
+    struct bPlusTree *tree = st_malloc(sizeof(struct bPlusTree));
+    tree->root = constructNode(1);
+    tree->compareFn = compareFn;
+    tree->count = 0;
+    tree->generation = 0;
+    return tree;
+}
+
+static void destructNode(struct bPlusTreeNode *node, void (*destructElementFn)(void *)) {
+    if (node->leaf) {
+        if (destructElementFn != NULL) {
+            for (int64_t i = 0; i < node->count; i++) {
+                destructElementFn(node->keys[i]);
+            }
+        }
+    } else {
+        for (int64_t i = 0; i <= node->count; i++) {
+            destructNode(node->children[i], destructElementFn);
+        }
+    }
+    free(node);
+}
+
+void bPlusTree_destruct(struct bPlusTree *tree, void (*destructElementFn)(void *)) {
+    destructNode(tree->root, destructElementFn);
+    free(tree);
+}
+
+/*
+ * Splits an overfull node, returning the new right hand node and setting *separator to the key
+ * that divides them.
+ */
+static struct bPlusTreeNode *splitNode(struct bPlusTreeNode *node, void **separator) {
+    struct bPlusTreeNode *right = constructNode(node->leaf);
+    if (node->leaf) {
+        int64_t mid = node->count / 2;
+        right->count = node->count - mid;
+        memcpy(right->keys, node->keys + mid, right->count * sizeof(void *));
+        node->count = mid;
+        right->next = node->next;
+        right->prev = node;
+        if (node->next != NULL) {
+            node->next->prev = right;
+        }
+        node->next = right;
+        *separator = right->keys[0];
+    } else {
+        int64_t mid = node->count / 2;
+        *separator = node->keys[mid];
+        right->count = node->count - mid - 1;
+        memcpy(right->keys, node->keys + mid + 1, right->count * sizeof(void *));
+        memcpy(right->children, node->children + mid + 1, (right->count + 1) * sizeof(struct bPlusTreeNode *));
+        node->count = mid;
+    }
+    return right;
+}
+
+/*
+ * Inserts into the subtree, returning a new right sibling if the node had to be split.
+ */
+static struct bPlusTreeNode *insertP(struct bPlusTree *tree, struct bPlusTreeNode *node, void *item, void **separator) {
+    if (node->leaf) {
+        int64_t i = lowerBound(tree, node, item);
+        if (i < node->count && tree->compareFn(node->keys[i], item) == 0) {
+            node->keys[i] = item;
+            return NULL;
+        }
+        memmove(node->keys + i + 1, node->keys + i, (node->count - i) * sizeof(void *));
+        node->keys[i] = item;
+        node->count++;
+        tree->count++;
+        return node->count > LEAF_MAX ? splitNode(node, separator) : NULL;
+    }
+    int64_t i = upperBound(tree, node, item);
+    if (i > 0 && tree->compareFn(node->keys[i - 1], item) == 0) {
+        node->keys[i - 1] = item; // Replacing an equal element, which may be freed by the caller.
+    }
+    void *childSeparator;
+    struct bPlusTreeNode *newChild = insertP(tree, node->children[i], item, &childSeparator);
+    if (newChild == NULL) {
+        return NULL;
+    }
+    memmove(node->keys + i + 1, node->keys + i, (node->count - i) * sizeof(void *));
+    memmove(node->children + i + 2, node->children + i + 1, (node->count - i) * sizeof(struct bPlusTreeNode *));
+    node->keys[i] = childSeparator;
+    node->children[i + 1] = newChild;
+    node->count++;
+    return node->count > INTERNAL_MAX_KEYS ? splitNode(node, separator) : NULL;
+}
+
+void bPlusTree_insert(struct bPlusTree *tree, void *item) {
+    void *separator;
+    struct bPlusTreeNode *right = insertP(tree, tree->root, item, &separator);
+    if (right != NULL) {
+        struct bPlusTreeNode *root = constructNode(0);
+        root->count = 1;
+        root->keys[0] = separator;
+        root->children[0] = tree->root;
+        root->children[1] = right;
+        tree->root = root;
+    }
+    tree->generation++;
+}
+
+/*
+ * Removes the separator at keys[i] and the child at children[i + 1] from an internal node.
+ */
+static void removeFromInternal(struct bPlusTreeNode *node, int64_t i) {
+    memmove(node->keys + i, node->keys + i + 1, (node->count - i - 1) * sizeof(void *));
+    memmove(node->children + i + 1, node->children + i + 2, (node->count - i - 1) * sizeof(struct bPlusTreeNode *));
+    node->count--;
+}
+
+/*
+ * Appends the contents of right (the child at i + 1) to left (the child at i) and frees it.
+ */
+static void mergeChildren(struct bPlusTreeNode *parent, int64_t i) {
+    struct bPlusTreeNode *left = parent->children[i], *right = parent->children[i + 1];
+    if (left->leaf) {
+        memcpy(left->keys + left->count, right->keys, right->count * sizeof(void *));
+        left->count += right->count;
+        left->next = right->next;
+        if (right->next != NULL) {
+            right->next->prev = left;
+        }
+    } else {
+        left->keys[left->count] = parent->keys[i];
+        memcpy(left->keys + left->count + 1, right->keys, right->count * sizeof(void *));
+        memcpy(left->children + left->count + 1, right->children, (right->count + 1) * sizeof(struct bPlusTreeNode *));
+        left->count += right->count + 1;
+    }
+    removeFromInternal(parent, i);
+    free(right);
+}
+
+/*
+ * Restores the minimum occupancy of the child at i by borrowing from or merging with a sibling.
+ */
+static void rebalanceChild(struct bPlusTreeNode *parent, int64_t i) {
+    struct bPlusTreeNode *child = parent->children[i];
+    int64_t min = child->leaf ? LEAF_MIN : INTERNAL_MIN_KEYS;
+    if (child->count >= min) {
+        return;
+    }
+    struct bPlusTreeNode *left = i > 0 ? parent->children[i - 1] : NULL;
+    struct bPlusTreeNode *right = i < parent->count ? parent->children[i + 1] : NULL;
+    if (left != NULL && left->count > min) { // Borrow the last entry of the left sibling.
+        memmove(child->keys + 1, child->keys, child->count * sizeof(void *));
+        if (child->leaf) {
+            child->keys[0] = left->keys[left->count - 1];
+            parent->keys[i - 1] = child->keys[0];
+        } else {
+            memmove(child->children + 1, child->children, (child->count + 1) * sizeof(struct bPlusTreeNode *));
+            child->keys[0] = parent->keys[i - 1];
+            child->children[0] = left->children[left->count];
+            parent->keys[i - 1] = left->keys[left->count - 1];
+        }
+        child->count++;
+        left->count--;
+    } else if (right != NULL && right->count > min) { // Borrow the first entry of the right sibling.
+        if (child->leaf) {
+            child->keys[child->count] = right->keys[0];
+            memmove(right->keys, right->keys + 1, (right->count - 1) * sizeof(void *));
+            parent->keys[i] = right->keys[0];
+        } else {
+            child->keys[child->count] = parent->keys[i];
+            child->children[child->count + 1] = right->children[0];
+            parent->keys[i] = right->keys[0];
+            memmove(right->keys, right->keys + 1, (right->count - 1) * sizeof(void *));
+            memmove(right->children, right->children + 1, right->count * sizeof(struct bPlusTreeNode *));
+        }
+        child->count++;
+        right->count--;
+    } else if (left != NULL) {
+        mergeChildren(parent, i - 1);
+    } else {
+        assert(right != NULL);
+        mergeChildren(parent, i);
+    }
+}
+
+static void *removeP(struct bPlusTree *tree, struct bPlusTreeNode *node, const void *item) {
+    if (node->leaf) {
+        int64_t i = lowerBound(tree, node, item);
+        if (i == node->count || tree->compareFn(node->keys[i], item) != 0) {
+            return NULL;
+        }
+        void *removed = node->keys[i];
+        memmove(node->keys + i, node->keys + i + 1, (node->count - i - 1) * sizeof(void *));
+        node->count--;
+        tree->count--;
+        return removed;
+    }
+    int64_t i = upperBound(tree, node, item);
+    void *removed = removeP(tree, node->children[i], item);
+    if (removed != NULL) {
+        rebalanceChild(node, i);
+    }
+    return removed;
+}
+
+/*
+ * Replaces the separator that referred to a removed element, if any, with the new first element
+ * of the subtree to its right. Rebalancing may have moved the separator down, but it remains on
+ * the search path for the removed element.
+ */
+static void replaceSeparator(struct bPlusTree *tree, void *removed) {
+    struct bPlusTreeNode *node = tree->root;
+    while (!node->leaf) {
+        int64_t i = upperBound(tree, node, removed);
+        if (i > 0 && node->keys[i - 1] == removed) {
+            struct bPlusTreeNode *child = node->children[i];
+            while (!child->leaf) {
+                child = child->children[0];
+            }
+            node->keys[i - 1] = child->keys[0];
+            return;
+        }
+        node = node->children[i];
+    }
+}
+
+void *bPlusTree_remove(struct bPlusTree *tree, void *item) {
+    void *removed = removeP(tree, tree->root, item);
+    if (removed != NULL) {
+        if (!tree->root->leaf && tree->root->count == 0) {
+            struct bPlusTreeNode *root = tree->root;
+            tree->root = root->children[0];
+            free(root);
+        }
+        replaceSeparator(tree, removed);
+        tree->generation++;
+    }
+    return removed;
+}
+
+void *bPlusTree_find(struct bPlusTree *tree, const void *item) {
+    struct bPlusTreeNode *leaf = findLeaf(tree, item);
+    int64_t i = lowerBound(tree, leaf, item);
+    return i < leaf->count && tree->compareFn(leaf->keys[i], item) == 0 ? leaf->keys[i] : NULL;
+}
+
+/*
+ * Returns the element at index i of the leaf, moving to the neighbouring leaves if i is off
+ * either end. Leaves other than an empty root are never empty.
+ */
+static void *getFromLeaf(struct bPlusTreeNode *leaf, int64_t i) {
+    if (i < 0) {
+        return leaf->prev != NULL ? leaf->prev->keys[leaf->prev->count - 1] : NULL;
+    }
+    if (i >= leaf->count) {
+        return leaf->next != NULL ? leaf->next->keys[0] : NULL;
+    }
+    return leaf->keys[i];
+}
+
+void *bPlusTree_findLessThan(struct bPlusTree *tree, const void *item) {
+    struct bPlusTreeNode *leaf = findLeaf(tree, item);
+    return getFromLeaf(leaf, lowerBound(tree, leaf, item) - 1);
+}
+
+void *bPlusTree_findLessThanOrEqual(struct bPlusTree *tree, const void *item) {
+    struct bPlusTreeNode *leaf = findLeaf(tree, item);
+    return getFromLeaf(leaf, upperBound(tree, leaf, item) - 1);
+}
+
+void *bPlusTree_findGreaterThan(struct bPlusTree *tree, const void *item) {
+    struct bPlusTreeNode *leaf = findLeaf(tree, item);
+    return getFromLeaf(leaf, upperBound(tree, leaf, item));
+}
+
+void *bPlusTree_findGreaterThanOrEqual(struct bPlusTree *tree, const void *item) {
+    struct bPlusTreeNode *leaf = findLeaf(tree, item);
+    return getFromLeaf(leaf, lowerBound(tree, leaf, item));
+}
+
+static struct bPlusTreeNode *firstLeaf(struct bPlusTree *tree) {
+    struct bPlusTreeNode *node = tree->root;
+    while (!node->leaf) {
+        node = node->children[0];
+    }
+    return node;
+}
+
+static struct bPlusTreeNode *lastLeaf(struct bPlusTree *tree) {
+    struct bPlusTreeNode *node = tree->root;
+    while (!node->leaf) {
+        node = node->children[node->count];
+    }
+    return node;
+}
+
+void *bPlusTree_first(struct bPlusTree *tree) {
+    struct bPlusTreeNode *leaf = firstLeaf(tree);
+    return leaf->count > 0 ? leaf->keys[0] : NULL;
+}
+
+void *bPlusTree_last(struct bPlusTree *tree) {
+    struct bPlusTreeNode *leaf = lastLeaf(tree);
+    return leaf->count > 0 ? leaf->keys[leaf->count - 1] : NULL;
+}
+
+void bPlusTree_t_init(struct bPlusTreeTraverser *trav, struct bPlusTree *tree) {
+    trav->tree = tree;
+    trav->item = NULL;
+    trav->leaf = NULL;
+    trav->index = 0;
+    trav->generation = tree->generation;
+}
+
+/*
+ * Sets the traverser to the given leaf position, or to the null position if it is off the end.
+ */
+static void *setPosition(struct bPlusTreeTraverser *trav, struct bPlusTreeNode *leaf, int64_t i) {
+    if (i < 0) {
+        leaf = leaf->prev;
+        i = leaf != NULL ? leaf->count - 1 : 0;
+    } else if (i >= leaf->count) {
+        leaf = leaf->next;
+        i = 0;
+    }
+    trav->generation = trav->tree->generation;
+    trav->leaf = leaf;
+    trav->index = i;
+    trav->item = leaf != NULL ? leaf->keys[i] : NULL;
+    return trav->item;
+}
+
+void *bPlusTree_t_find(struct bPlusTreeTraverser *trav, const void *item) {
+    struct bPlusTreeNode *leaf = findLeaf(trav->tree, item);
+    int64_t i = lowerBound(trav->tree, leaf, item);
+    if (i < leaf->count && trav->tree->compareFn(leaf->keys[i], item) == 0) {
+        return setPosition(trav, leaf, i);
+    }
+    return NULL;
+}
+
+void *bPlusTree_t_next(struct bPlusTreeTraverser *trav) {
+    if (trav->item == NULL) {
+        struct bPlusTreeNode *leaf = firstLeaf(trav->tree);
+        return leaf->count > 0 ? setPosition(trav, leaf, 0) : NULL;
+    }
+    if (trav->generation != trav->tree->generation) {
+        // Re-find the position from the current element, which may have been removed but
+        // must still be alive, as it is passed to the compare function.
+        struct bPlusTreeNode *leaf = findLeaf(trav->tree, trav->item);
+        return setPosition(trav, leaf, upperBound(trav->tree, leaf, trav->item));
+    }
+    return setPosition(trav, trav->leaf, trav->index + 1);
+}
+
+void *bPlusTree_t_prev(struct bPlusTreeTraverser *trav) {
+    if (trav->item == NULL) {
+        struct bPlusTreeNode *leaf = lastLeaf(trav->tree);
+        return leaf->count > 0 ? setPosition(trav, leaf, leaf->count - 1) : NULL;
+    }
+    if (trav->generation != trav->tree->generation) {
+        struct bPlusTreeNode *leaf = findLeaf(trav->tree, trav->item);
+        return setPosition(trav, leaf, lowerBound(trav->tree, leaf, trav->item) - 1);
+    }
+    return setPosition(trav, trav->leaf, trav->index - 1);
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * bPlusTree.h
+ *
+ * In-memory B+ tree of pointers, used as the alternative backend of stSortedSet.
+ *
+ * Elements live only in the leaves, which hold up to BPLUSTREE_ORDER elements in a sorted
+ * array and are linked to their neighbours, so searches touch one node per level and ordered
+ * iteration and range queries walk contiguous arrays instead of chasing a pointer per element.
+ * Internal nodes hold copies of element pointers as separators.
+ *
+ * Traversers remember the last element they returned, together with a cached leaf position
+ * that is used while the tree is unmodified. If the tree is modified the position is
+ * re-found by comparing against that element, so (like the AVL traverser) a traverser
+ * survives insertions and removals of other elements. It also survives removal of the
+ * element it is on, which the AVL traverser does not, but only if that element is not freed
+ * until the traverser has moved past it.
+ */
+
+#ifndef BPLUSTREE_H_
+#define BPLUSTREE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BPLUSTREE_ORDER 64
+
+struct bPlusTreeNode;
+
+struct bPlusTree {
+    struct bPlusTreeNode *root;
+    int (*compareFn)(const void *, const void *);
+    int64_t count;
+    uint64_t generation; // Incremented on every modification, to invalidate traverser positions.
+};
+
+struct bPlusTreeTraverser {
+    struct bPlusTree *tree;
+    void *item; // Last element returned, or NULL for the null position before the first/after the last element.
+    struct bPlusTreeNode *leaf; // Position of item, valid while generation matches the tree.
+    int64_t index;
+    uint64_t generation;
+};
+
+struct bPlusTree *bPlusTree_construct(int (*compareFn)(const void *, const void *));
+
+/*
+ * Frees the tree, calling destructElementFn on each element if it is not null.
+ */
+void bPlusTree_destruct(struct bPlusTree *tree, void (*destructElementFn)(void *));
+
+/*
+ * Inserts the element, replacing an equal element if present. The replaced element is no longer
+ * referenced by the tree, so may be freed.
+ */
+void bPlusTree_insert(struct bPlusTree *tree, void *item);
+
+/*
+ * Removes and returns the element equal to item, or returns NULL if not present.
+ */
+void *bPlusTree_remove(struct bPlusTree *tree, void *item);
+
+void *bPlusTree_find(struct bPlusTree *tree, const void *item);
+void *bPlusTree_findLessThan(struct bPlusTree *tree, const void *item);
+void *bPlusTree_findLessThanOrEqual(struct bPlusTree *tree, const void *item);
+void *bPlusTree_findGreaterThan(struct bPlusTree *tree, const void *item);
+void *bPlusTree_findGreaterThanOrEqual(struct bPlusTree *tree, const void *item);
+
+void *bPlusTree_first(struct bPlusTree *tree);
+void *bPlusTree_last(struct bPlusTree *tree);
+
+/*
+ * Initialises the traverser at the null position.
+ */
+void bPlusTree_t_init(struct bPlusTreeTraverser *trav, struct bPlusTree *tree);
+
+/*
+ * Positions the traverser at the element equal to item, returning it, or returns NULL (leaving
+ * the traverser unchanged) if not present.
+ */
+void *bPlusTree_t_find(struct bPlusTreeTraverser *trav, const void *item);
+
+/*
+ * Moves to and returns the next/previous element. From the null position these return the
+ * first/last element, and moving past the end returns NULL and goes to the null position.
+ */
+void *bPlusTree_t_next(struct bPlusTreeTraverser *trav);
+void *bPlusTree_t_prev(struct bPlusTreeTraverser *trav);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* BPLUSTREE_H_ */
@@ -143,69 +143,125 @@ void fastaWrite(char *sequence, char *header, FILE *file) {
     }
 }
 
-char *addSeqToList(char *seq, int64_t *length, int64_t *maxLength, char *fastaName, void *destination,
+/*
+ * Files are read in blocks of this many bytes, and scanned a line at a time.
+ */
+#define FASTA_BLOCK_SIZE 1048576
+
+/*
+ * The kinds of character, as given by the table built by fastaBuildCharTypes. They are
+ * bits so the kinds in a line can be or-ed together, a line of residues giving zero.
+ */
+#define FASTA_RESIDUE 0
+#define FASTA_SPACE 1
+#define FASTA_START 2
+#define FASTA_INVALID 4
+
+static void fastaBuildCharTypes(unsigned char *charTypes) {
+    for(int64_t i=0; i<256; i++) {
+        //For safety and sanity I only allows roman alphabet characters and gaps in fasta sequences.
+        charTypes[i] = isalpha((int)i) || i == '-' ? FASTA_RESIDUE : FASTA_INVALID;
+    }
+    charTypes['\n'] = charTypes['\r'] = charTypes[' '] = charTypes['\t'] = FASTA_SPACE;
+    charTypes['>'] = FASTA_START;
+}
+
+static void fastaAddSeq(char **header, int64_t headerLength, int64_t *headerMaxLength, char **seq,
+        int64_t seqLength, int64_t *seqMaxLength, void *destination,
         void (*addSeq)(void *destination, const char *name, const char *seq, int64_t length)) {
-    seq = arrayPrepareAppend(seq, maxLength, *length+1, sizeof(char));
-    seq[*length] = '\0';
-    addSeq(destination, fastaName, seq, *length);
-    (*length)  = 0;
-    return seq;
+    if(headerLength > 0 && (*header)[headerLength-1] == '\r') { //windows line ending
+        headerLength--;
+    }
+    *header = arrayPrepareAppend(*header, headerMaxLength, headerLength+1, sizeof(char));
+    (*header)[headerLength] = '\0';
+    *seq = arrayPrepareAppend(*seq, seqMaxLength, seqLength+1, sizeof(char));
+    (*seq)[seqLength] = '\0';
+    addSeq(destination, *header, *seq, seqLength);
 }
 
 void fastaReadToFunction(FILE *fastaFile, void *destination, void (*addSeq)(void *destination, const char *name, const char *seq, int64_t length)) {
-    //reads in group of sequences into lists
-    char j;
-    int64_t k;
-    char *seq = NULL;
-    int64_t seqLength = 0;
-    char cA[STRING_ARRAY_SIZE];
-    int64_t l;
-
-    k=0;
-    while((j = getc(fastaFile)) != EOF) { //initial terminating characters
-        if(j == '>') { //fasta start
-            fastaStart:
-            cA[0] = '\0';
-            l = 0;
-            while(TRUE) {
-                j = getc(fastaFile);
-                if(j == EOF) {
-                    seq = addSeqToList(seq, &k, &seqLength, cA, destination, addSeq); //lax qualification for a sequence
-                    goto cleanup;
-                }
-                if(j == '\n')  {
+    /*
+     * Reads in group of sequences, passing each to addSeq. Anything before the first '>' is
+     * ignored, headers may be any length, and within sequences white space is skipped and a
+     * '>' starts the next sequence.
+     */
+    unsigned char charTypes[256];
+    fastaBuildCharTypes(charTypes);
+    char *block = st_malloc(FASTA_BLOCK_SIZE);
+    char *header = NULL, *seq = NULL;
+    int64_t headerLength = 0, headerMaxLength = 0, seqLength = 0, seqMaxLength = 0;
+    enum { beforeFirst, inHeader, inSeq } state = beforeFirst;
+    size_t blockLength;
+
+    while((blockLength = fread(block, sizeof(char), FASTA_BLOCK_SIZE, fastaFile)) > 0) {
+        const char *c = block, *end = block + blockLength;
+        while(c < end) {
+            if(state == beforeFirst) {
+                c = memchr(c, '>', end - c);
+                if(c == NULL) {
                     break;
                 }
-                //add to name string
-                cA[l++] = j;
-                cA[l] = '\0';
+                c++;
+                state = inHeader;
+                continue;
             }
-            while(TRUE) { //start of sequence
-                j = getc(fastaFile);
-                if(j == EOF) {
-                    seq = addSeqToList(seq, &k, &seqLength, cA, destination, addSeq);
-                    goto cleanup;
+            //lines may run on into the next block
+            const char *lineEnd = memchr(c, '\n', end - c);
+            const char *stop = lineEnd == NULL ? end : lineEnd;
+            int64_t length = stop - c;
+            if(state == inHeader) {
+                header = arrayPrepareAppend(header, &headerMaxLength, headerLength+length+1, sizeof(char));
+                memcpy(header + headerLength, c, length);
+                headerLength += length;
+                if(lineEnd != NULL) {
+                    state = inSeq;
                 }
-                if(j != '\n' && j != ' ' && j != '\t') {
-                    if(j == '>') {
-                        //end of seq
-                        seq = addSeqToList(seq, &k, &seqLength, cA, destination, addSeq);
-                        goto fastaStart;
-                    }
-                    else { //valid char
-                        if(!isalpha(j) && j != '-') {
-                             //For safety and sanity I only allows roman alphabet characters and gaps in fasta sequences.
-                             st_errAbort("!!Got an unexpected character in input fasta sequence: '%c' \n", j);
+            }
+            else {
+                seq = arrayPrepareAppend(seq, &seqMaxLength, seqLength+length+1, sizeof(char));
+                unsigned char lineTypes = FASTA_RESIDUE;
+                for(const char *d = c; d < stop; d++) {
+                    lineTypes |= charTypes[(unsigned char)*d];
+                }
+                if(lineTypes == FASTA_RESIDUE) { //the usual case, a line of residues
+                    memcpy(seq + seqLength, c, length);
+                    seqLength += length;
+                }
+                else {
+                    for(; c < stop && charTypes[(unsigned char)*c] != FASTA_START; c++) {
+                        if(charTypes[(unsigned char)*c] == FASTA_RESIDUE) {
+                            seq[seqLength++] = *c;
+                        }
+                        else if(charTypes[(unsigned char)*c] == FASTA_INVALID) {
+                            st_errAbort("!!Got an unexpected character in input fasta sequence: '%c' \n", *c);
                         }
-                        seq = arrayPrepareAppend(seq, &seqLength, k+1, sizeof(char));
-                        seq[k++] = j;
+                    }
+                    if(c < stop) { //end of seq
+                        fastaAddSeq(&header, headerLength, &headerMaxLength, &seq, seqLength, &seqMaxLength,
+                                destination, addSeq);
+                        headerLength = 0;
+                        seqLength = 0;
+                        state = inHeader;
+                        c++;
+                        continue;
                     }
                 }
             }
+            if(lineEnd == NULL) {
+                break;
+            }
+            c = lineEnd + 1;
         }
     }
-    cleanup:
-    if (seq != NULL) free(seq);
+    if(ferror(fastaFile)) {
+        st_errAbort("Got an error reading a fasta file");
+    }
+    if(state != beforeFirst) { //lax qualification for a sequence
+        fastaAddSeq(&header, headerLength, &headerMaxLength, &seq, seqLength, &seqMaxLength, destination, addSeq);
+    }
+    free(block);
+    free(header);
+    free(seq);
 }
 
 // for programmer clarity when using fastaRead(_functoin)
@@ -327,18 +383,6 @@ int64_t parseString(char **string, char *cA) {
 /////////////////////////////////////////////////////////
 
 
-char* eatString(char *string, char **newString) {
-    char *i;
-
-    i = string;
-    while(*string != '\0' && !isspace(*string)) {
-           string++;
-    }
-    (*newString) = memcpy(st_malloc((string-i + 1)*sizeof(char)), i, (string-i)*sizeof(char));
-    (*newString)[string - i] = '\0';
-    return eatWhiteSpace(string);
-}
-
 char *replaceString(char *oldString, char old, char *new, int64_t newLength) {
     char *i;
     int64_t j;
@@ -376,108 +420,57 @@ char *replaceAndFreeString(char *oldString, char old, char *new, int64_t newLeng
 }
 
 
-char *_parseFloat(char *string, float *f) {
-    float f2;
-
-    f2 = FLT_MIN;
-    int j = sscanf(string, "%g", &f2);
-    (void)j;
-    assert(j == 1);
-    assert(f2 != FLT_MIN);
-    *f = f2;
-    while(*string != '\0' && !isspace(*string)) {
-        string++;
-    }
-    return eatWhiteSpace(string);
-}
-
-char *newickTreeParser_fn(char *newickTreeString, float *distance) {
-    if(*newickTreeString != '\0') {
-        if (*newickTreeString == ':') {
-            newickTreeString++;
-            return _parseFloat(eatWhiteSpace(newickTreeString), distance);
+struct BinaryTree *newickTreeParser(char *newickTreeString, float defaultDistance, int64_t unaryNodes) {
+    struct BinaryTree *binaryTree;
+    stTree *tree, *child;
+    int64_t i, j;
+    //lax newick tree parser, for which the closing ';' is optional
+    char *string = strchr(newickTreeString, ';') == NULL ? stString_print("%s;", newickTreeString)
+                                                          : stString_copy(newickTreeString);
+    stArena *arena = stArena_construct();
+    stTree *root = stTree_parseNewickStringInArena(string, arena);
+    free(string);
+
+    //the nodes in pre-order, so that in reverse each node follows its children
+    stList *nodes = stList_construct();
+    stList *stack = stList_construct();
+    stList_append(stack, root);
+    while(stList_length(stack) > 0) {
+        tree = stList_pop(stack);
+        stList_append(nodes, tree);
+        for(i=0; i<stTree_getChildNumber(tree); i++) {
+            stList_append(stack, stTree_getChild(tree, i));
         }
     }
-    return newickTreeString;
-}
-
-static char *newickTreeParser_getLabel(char *newickTreeString, char **label) {
-    if(*newickTreeString != ':' && *newickTreeString != ',' && *newickTreeString != ';' && *newickTreeString != ')' && *newickTreeString != '\0') {
-        return eatString(newickTreeString, label);
-    }
-    *label = stString_copy("");
-    return newickTreeString;
-}
-
-char *newickTreeParser_fn2(char *newickTreeString, float defaultDistance, struct BinaryTree **binaryTree, int64_t unaryNodes) {
-    struct BinaryTree *temp1;
-    struct BinaryTree *temp2;
-    float f;
-    int64_t leaves;
-
-    temp1 = NULL;
-    temp2 = NULL;
-
-    if(*newickTreeString == '(') {
-        temp1 = NULL;
-        newickTreeString = eatWhiteSpace(++newickTreeString);
-        assert(*newickTreeString != ')');
-        leaves = 0;
-        while(1) {
-            leaves++;
-            newickTreeString = newickTreeParser_fn2(newickTreeString, defaultDistance, &temp2, unaryNodes);
-            if(temp1 != NULL) {
-                //merge node
-                temp1 = constructBinaryTree(0.0f, TRUE, "", temp1, temp2); //default to zero distance for nodes of
-            }
-            else {
-                temp1 = temp2;
-            }
-            if(*newickTreeString == ',') {
-                newickTreeString = eatWhiteSpace(++newickTreeString);
+    stList_destruct(stack);
+
+    //build the binary tree bottom up, merging the children of each node from the left,
+    //with each node's binary tree held as its client data
+    for(i=stList_length(nodes)-1; i>=0; i--) {
+        tree = stList_get(nodes, i);
+        if(stTree_getChildNumber(tree) == 0) {
+            binaryTree = constructBinaryTree(0.0f, FALSE, "", NULL, NULL);
+        }
+        else {
+            binaryTree = stTree_getClientData(stTree_getChild(tree, 0));
+            for(j=1; j<stTree_getChildNumber(tree); j++) {
+                child = stTree_getChild(tree, j);
+                //default to zero distance for nodes of
+                binaryTree = constructBinaryTree(0.0f, TRUE, "", binaryTree, stTree_getClientData(child));
             }
-            else {
-                assert(*newickTreeString == ')');
-                break;
+            if(unaryNodes && stTree_getChildNumber(tree) == 1) { //make a unary node
+                binaryTree = constructBinaryTree(0.0f, TRUE, "", binaryTree, NULL);
             }
         }
-        if(unaryNodes && leaves == 1) { //make a unary node
-            temp1 = constructBinaryTree(0.0f, TRUE, "", temp1, NULL);
-        }
-        else { //eat any label
-            char *cA;
-            newickTreeString = newickTreeParser_getLabel(newickTreeString, &cA);
-            free(cA);
-        }
-        newickTreeString = eatWhiteSpace(++newickTreeString);
+        free(binaryTree->label);
+        binaryTree->label = stString_copy(stTree_getLabel(tree) == NULL ? "" : stTree_getLabel(tree));
+        binaryTree->distance += stTree_getBranchLength(tree) == INFINITY ? defaultDistance : stTree_getBranchLength(tree);
+        stTree_setClientData(tree, binaryTree);
     }
-    else {
-        temp1 = constructBinaryTree(0.0f, FALSE, "", NULL, NULL);
-    }
-    free(temp1->label);
-    newickTreeString = newickTreeParser_getLabel(newickTreeString, &temp1->label);
-    f = defaultDistance;
-    newickTreeString = newickTreeParser_fn(newickTreeString, &f);
-    temp1->distance += f;
-    (*binaryTree) = temp1;
-    assert(*newickTreeString == ',' || *newickTreeString == ';' || *newickTreeString == ')' || *newickTreeString == '\0');
-
-    return newickTreeString;
-}
-
-struct BinaryTree *newickTreeParser(char *newickTreeString, float defaultDistance, int64_t unaryNodes) {
-    struct BinaryTree *binaryTree;
-    char *i;
-    //lax newick tree parser
-    newickTreeString = replaceString(newickTreeString, '(', " ( ", 3);
-    newickTreeString = replaceAndFreeString(newickTreeString, ')', " ) ", 3);
-    newickTreeString = replaceAndFreeString(newickTreeString, ':', " : ", 3);
-    newickTreeString = replaceAndFreeString(newickTreeString, ',', " , ", 3);
-    newickTreeString = replaceAndFreeString(newickTreeString, ';', " ; ", 3);
-    i = newickTreeString;
-    newickTreeString = eatWhiteSpace(newickTreeString);
-    newickTreeParser_fn2(newickTreeString, defaultDistance, &binaryTree, unaryNodes);
-    free(i);
+    binaryTree = stTree_getClientData(root);
+    stList_destruct(nodes);
+    stTree_destruct(root);
+    stArena_destruct(arena);
 
     return binaryTree;
 }
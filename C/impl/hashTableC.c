@@ -62,9 +62,25 @@ create_hashtable(uint64_t minsize, uint64_t(*hashf)(const void*), int(*eqf)(
     //my additions
     h->keyFree = keyFree;
     h->valueFree = valueFree;
+    h->entryPool = NULL;
     return h;
 }
 
+/*****************************************************************************/
+static struct entry *
+allocEntry(struct hashtable *h) {
+    return h->entryPool != NULL ? stPool_malloc(h->entryPool) : st_malloc(sizeof(struct entry));
+}
+
+void
+hashtable_freeEntry(struct hashtable *h, struct entry *e) {
+    if (h->entryPool != NULL) {
+        stPool_free(h->entryPool, e);
+    } else {
+        free(e);
+    }
+}
+
 /*****************************************************************************/
 uint64_t hashP(struct hashtable *h, void *k) {
     /* Aim to protect against poor hash functions by adding logic here
@@ -153,7 +169,7 @@ int64_t hashtable_insert(struct hashtable *h, void *k, void *v) {
             exit(1);
         }
     }
-    e = (struct entry *) st_malloc(sizeof(struct entry));
+    e = allocEntry(h);
     if (NULL == e) {
         --(h->entrycount);
         return 0;
@@ -208,7 +224,7 @@ hashtable_remove(struct hashtable *h, void *k, int64_t freeKey) {
             if (freeKey) {
                 h->keyFree(e->k);
             }
-            free(e);
+            hashtable_freeEntry(h, e);
             return v;
         }
         pE = &(e->next);
@@ -224,51 +240,28 @@ void hashtable_destroy(struct hashtable *h, int64_t free_values,
     uint64_t i;
     struct entry *e, *f;
     struct entry **table = h->table;
-    if (free_keys) {
-        if (free_values) {
-            for (i = 0; i < h->tablelength; i++) {
-                e = table[i];
-                while (NULL != e) {
-                    f = e;
-                    e = e->next;
-                    h->keyFree(f->k);
-                    h->valueFree(f->v);
-                    free(f);
-                }
-            }
-        } else {
-            for (i = 0; i < h->tablelength; i++) {
-                e = table[i];
-                while (NULL != e) {
-                    f = e;
-                    e = e->next;
+    /* Entries from a pool are freed all at once with the pool, so only need visiting to free their keys and values */
+    if (h->entryPool == NULL || free_keys || free_values) {
+        for (i = 0; i < h->tablelength; i++) {
+            e = table[i];
+            while (NULL != e) {
+                f = e;
+                e = e->next;
+                if (free_keys) {
                     h->keyFree(f->k);
-                    free(f);
                 }
-            }
-        }
-    } else {
-        if (free_values) {
-            for (i = 0; i < h->tablelength; i++) {
-                e = table[i];
-                while (NULL != e) {
-                    f = e;
-                    e = e->next;
+                if (free_values) {
                     h->valueFree(f->v);
-                    free(f);
                 }
-            }
-        } else {
-            for (i = 0; i < h->tablelength; i++) {
-                e = table[i];
-                while (NULL != e) {
-                    f = e;
-                    e = e->next;
+                if (h->entryPool == NULL) {
                     free(f);
                 }
             }
         }
     }
+    if (h->entryPool != NULL) {
+        stPool_destruct(h->entryPool);
+    }
     free(h->table);
     free(h);
 }
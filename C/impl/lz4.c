@@ -332,13 +332,15 @@ static inline int LZ4_NbCommonBytes (register U32 val)
 // -----------------
 // Compress 'isize' bytes from 'source' into an output buffer 'dest' of maximum size 'maxOutputSize'.
 // If it cannot achieve it, compression will stop, and result of the function will be zero.
+// 'acceleration' multiplies the step taken while searching for matches (1 is the default).
 // return : the number of bytes written in buffer 'dest', or 0 if the compression fails
 
 static inline int LZ4_compressCtx(void** ctx,
                  const char* source,
                  char* dest,
                  int isize,
-                 int maxOutputSize)
+                 int maxOutputSize,
+                 int acceleration)
 {
 #if HEAPMODE
     struct refTables *srt = (struct refTables *) (*ctx);
@@ -384,7 +386,7 @@ static inline int LZ4_compressCtx(void** ctx,
     // Main Loop
     for ( ; ; )
     {
-        int findMatchAttempts = (1U << skipStrength) + 3;
+        int findMatchAttempts = (acceleration << skipStrength) + 3;
         const BYTE* forwardIp = ip;
         const BYTE* ref;
         BYTE* token;
@@ -518,7 +520,8 @@ static inline int LZ4_compress64kCtx(void** ctx,
                  const char* source,
                  char* dest,
                  int isize,
-                 int maxOutputSize)
+                 int maxOutputSize,
+                 int acceleration)
 {
 #if HEAPMODE
     struct refTables *srt = (struct refTables *) (*ctx);
@@ -563,7 +566,7 @@ static inline int LZ4_compress64kCtx(void** ctx,
     // Main Loop
     for ( ; ; )
     {
-        int findMatchAttempts = (1U << skipStrength) + 3;
+        int findMatchAttempts = (acceleration << skipStrength) + 3;
         const BYTE* forwardIp = ip;
         const BYTE* ref;
         BYTE* token;
@@ -672,26 +675,37 @@ _last_literals:
 }
 
 
-int LZ4_compress_limitedOutput(const char* source, 
-                               char* dest, 
-                               int isize, 
-                               int maxOutputSize)
+int LZ4_compress_fast(const char* source,
+                      char* dest,
+                      int isize,
+                      int maxOutputSize,
+                      int acceleration)
 {
+    if (acceleration < 1) acceleration = 1;
 #if HEAPMODE
     void* ctx = malloc(sizeof(struct refTables));
     int result;
     if (isize < LZ4_64KLIMIT)
-        result = LZ4_compress64kCtx(&ctx, source, dest, isize, maxOutputSize);
-    else result = LZ4_compressCtx(&ctx, source, dest, isize, maxOutputSize);
+        result = LZ4_compress64kCtx(&ctx, source, dest, isize, maxOutputSize, acceleration);
+    else result = LZ4_compressCtx(&ctx, source, dest, isize, maxOutputSize, acceleration);
     free(ctx);
     return result;
 #else
-    if (isize < (int)LZ4_64KLIMIT) return LZ4_compress64kCtx(NULL, source, dest, isize, maxOutputSize);
-    return LZ4_compressCtx(NULL, source, dest, isize, maxOutputSize);
+    if (isize < (int)LZ4_64KLIMIT) return LZ4_compress64kCtx(NULL, source, dest, isize, maxOutputSize, acceleration);
+    return LZ4_compressCtx(NULL, source, dest, isize, maxOutputSize, acceleration);
 #endif
 }
 
 
+int LZ4_compress_limitedOutput(const char* source,
+                               char* dest,
+                               int isize,
+                               int maxOutputSize)
+{
+    return LZ4_compress_fast(source, dest, isize, maxOutputSize, 1);
+}
+
+
 int LZ4_compress(const char* source,
                  char* dest,
                  int isize)
@@ -800,11 +814,16 @@ _output_error:
 }
 
 
-int LZ4_uncompress_unknownOutputSize(
+// LZ4_uncompress_generic :
+// Decodes as LZ4_uncompress_unknownOutputSize(), except that matches may start in the 'dictSize' bytes
+// at 'dictStart', as if they came just before 'dest'.
+static inline int LZ4_uncompress_generic(
                 const char* source,
                 char* dest,
                 int isize,
-                int maxOutputSize)
+                int maxOutputSize,
+                const char* dictStart,
+                int dictSize)
 {
     // Local Variables
     const BYTE* restrict ip = (const BYTE*) source;
@@ -852,7 +871,7 @@ int LZ4_uncompress_unknownOutputSize(
 
         // get offset
         LZ4_READ_LITTLEENDIAN_16(ref,cpy,ip); ip+=2;
-        if unlikely(ref < (BYTE* const)dest) goto _output_error;   // Error : offset outside of destination buffer
+        if unlikely(ref < (BYTE* const)dest - dictSize) goto _output_error;   // Error : offset outside of destination buffer and dictionary
 
         // get matchlength
         if ((length=(token&ML_MASK)) == ML_MASK)    
@@ -866,6 +885,19 @@ int LZ4_uncompress_unknownOutputSize(
             } 
         }
 
+        // copy a match starting in the dictionary, which may run on into the destination
+        if unlikely(ref < (BYTE* const)dest)
+        {
+            size_t matchLength = length + MINMATCH;
+            size_t fromDict = (size_t)((BYTE*)dest - ref);
+            if (op + matchLength > oend-LASTLITERALS) goto _output_error;    // Error : last 5 bytes must be literals
+            if (fromDict > matchLength) fromDict = matchLength;
+            memcpy(op, dictStart + dictSize - ((BYTE*)dest - ref), fromDict);
+            op += fromDict;
+            for (ref = (BYTE*)dest, matchLength -= fromDict; matchLength > 0; matchLength--) *op++ = *ref++;
+            continue;
+        }
+
         // copy repeated sequence
         if unlikely(op-ref<STEPSIZE)
         {
@@ -905,3 +937,241 @@ _output_error:
     return (int) (-(((char*)ip)-source));
 }
 
+
+int LZ4_uncompress_unknownOutputSize(
+                const char* source,
+                char* dest,
+                int isize,
+                int maxOutputSize)
+{
+    return LZ4_uncompress_generic(source, dest, isize, maxOutputSize, NULL, 0);
+}
+
+
+
+//****************************
+// Dictionary functions
+//****************************
+
+struct LZ4_dictionary_s
+{
+    char* content;
+    int size;
+    U32 hashTable[HASHTABLESIZE];   // For each hash, one plus the position of its last occurrence in content, or 0.
+};
+
+
+LZ4_dictionary* LZ4_createDictionary(const char* dictionary, int dictionarySize)
+{
+    LZ4_dictionary* dict = (LZ4_dictionary*) calloc(1, sizeof(LZ4_dictionary));
+    int i;
+    if (dict == NULL) return NULL;
+    if (dictionarySize < 0) dictionarySize = 0;
+    // Only the end of the dictionary can be reached by a match.
+    if (dictionarySize > LZ4_DICTIONARY_MAX_SIZE) { dictionary += dictionarySize - LZ4_DICTIONARY_MAX_SIZE; dictionarySize = LZ4_DICTIONARY_MAX_SIZE; }
+    dict->content = (char*) malloc(dictionarySize + 1);
+    if (dict->content == NULL) { free(dict); return NULL; }
+    memcpy(dict->content, dictionary, dictionarySize);
+    dict->size = dictionarySize;
+    // Only positions with MINMATCH bytes after them in the dictionary are indexed.
+    for (i = 0; i + MINMATCH <= dictionarySize; i++) dict->hashTable[LZ4_HASH_VALUE(dict->content + i)] = i + 1;
+    return dict;
+}
+
+
+void LZ4_freeDictionary(LZ4_dictionary* dictionary)
+{
+    if (dictionary == NULL) return;
+    free(dictionary->content);
+    free(dictionary);
+}
+
+
+const char* LZ4_getDictionaryContent(const LZ4_dictionary* dictionary, int* dictionarySize)
+{
+    *dictionarySize = dictionary->size;
+    return dictionary->content;
+}
+
+
+// Returns the number of bytes from ip and ref that are equal, stopping at limit.
+static inline int LZ4_count(const BYTE* ip, const BYTE* ref, const BYTE* const limit)
+{
+    const BYTE* const start = ip;
+    while likely(ip<limit-(STEPSIZE-1))
+    {
+        UARCH diff = AARCH(ref) ^ AARCH(ip);
+        if (!diff) { ip+=STEPSIZE; ref+=STEPSIZE; continue; }
+        ip += LZ4_NbCommonBytes(diff);
+        return (int)(ip - start);
+    }
+    if (LZ4_ARCH64) if ((ip<(limit-3)) && (A32(ref) == A32(ip))) { ip+=4; ref+=4; }
+    if ((ip<(limit-1)) && (A16(ref) == A16(ip))) { ip+=2; ref+=2; }
+    if ((ip<limit) && (*ref == *ip)) ip++;
+    return (int)(ip - start);
+}
+
+
+// LZ4_compress_fast_usingDict :
+// Positions are indexed as if the dictionary came just before the source, so a match can be found in
+// either, but the dictionary is read where it is rather than copied.
+#define LZ4_EXT_INDEX(p)        (dictSize + (U32)((p) - sourceStart))
+#define LZ4_EXT_POINTER(i)      ((i) < dictSize ? dictStart + (i) : sourceStart + ((i) - dictSize))
+
+int LZ4_compress_fast_usingDict(const LZ4_dictionary* dictionary,
+                                const char* source,
+                                char* dest,
+                                int isize,
+                                int maxOutputSize,
+                                int acceleration)
+{
+    U32 HashTable[HASHTABLESIZE];
+
+    const BYTE* const dictStart = (const BYTE*) dictionary->content;
+    const U32 dictSize = (U32) dictionary->size;
+    const BYTE* const dictEnd = dictStart + dictSize;
+    const BYTE* ip = (const BYTE*) source;
+    const BYTE* const sourceStart = ip;
+    const BYTE* anchor = ip;
+    const BYTE* const iend = ip + isize;
+    const BYTE* const mflimit = iend - MFLIMIT;
+
+    BYTE* op = (BYTE*) dest;
+    BYTE* const oend = op + maxOutputSize;
+
+    int length;
+    const int skipStrength = SKIPSTRENGTH;
+    U32 forwardH, refIndex, distance;
+    const BYTE* ref;
+    BYTE* token;
+
+    if (acceleration < 1) acceleration = 1;
+
+    // Init
+    if (isize<MINLENGTH) goto _last_literals;
+    memcpy(HashTable, dictionary->hashTable, sizeof(HashTable));
+
+    // First Byte
+    HashTable[LZ4_HASH_VALUE(ip)] = LZ4_EXT_INDEX(ip) + 1;
+    ip++; forwardH = LZ4_HASH_VALUE(ip);
+
+    // Main Loop
+    for ( ; ; )
+    {
+        int findMatchAttempts = (acceleration << skipStrength) + 3;
+        const BYTE* forwardIp = ip;
+
+        // Find a match
+        do {
+            U32 h = forwardH;
+            int step = findMatchAttempts++ >> skipStrength;
+            ip = forwardIp;
+            forwardIp = ip + step;
+
+            if unlikely(forwardIp > mflimit) { goto _last_literals; }
+
+            forwardH = LZ4_HASH_VALUE(forwardIp);
+            refIndex = HashTable[h];
+            HashTable[h] = LZ4_EXT_INDEX(ip) + 1;
+            distance = LZ4_EXT_INDEX(ip) + 1 - refIndex;
+            ref = refIndex == 0 ? NULL : LZ4_EXT_POINTER(refIndex - 1);
+
+        } while ((ref == NULL) || (distance > MAX_DISTANCE) || (A32(ref) != A32(ip)));
+
+        // Catch up, within the dictionary or the source
+        {
+            const BYTE* const refStart = refIndex - 1 < dictSize ? dictStart : sourceStart;
+            while ((ip>anchor) && (ref>refStart) && unlikely(ip[-1]==ref[-1])) { ip--; ref--; }
+        }
+
+        // Encode Literal length
+        length = (int)(ip - anchor);
+        token = op++;
+        if unlikely(op + length + (2 + 1 + LASTLITERALS) + (length>>8) > oend) return 0;       // Check output limit
+        if (length>=(int)RUN_MASK)
+        {
+            int len;
+            *token=(RUN_MASK<<ML_BITS);
+            len = length-RUN_MASK;
+            for(; len > 254 ; len-=255) *op++ = 255;
+            *op++ = (BYTE)len;
+        }
+        else *token = (length<<ML_BITS);
+
+        // Copy Literals
+        LZ4_BLINDCOPY(anchor, op, length);
+
+_next_match:
+        // Encode Offset
+        LZ4_WRITE_LITTLEENDIAN_16(op,(U16)distance);
+
+        // Start Counting, a match in the dictionary running on into the source
+        ip+=MINMATCH; ref+=MINMATCH;    // MinMatch already verified
+        anchor = ip;
+        if (refIndex - 1 < dictSize)
+        {
+            const BYTE* limit = ip + (dictEnd - ref);
+            if (limit > matchlimit) limit = matchlimit;
+            ip += LZ4_count(ip, ref, limit);
+            if (ip == limit && limit < matchlimit) ip += LZ4_count(ip, sourceStart, matchlimit);
+        }
+        else ip += LZ4_count(ip, ref, matchlimit);
+
+        // Encode MatchLength
+        length = (int)(ip - anchor);
+        if unlikely(op + (1 + LASTLITERALS) + (length>>8) > oend) return 0;           // Check output limit
+        if (length>=(int)ML_MASK)
+        {
+            *token += ML_MASK;
+            length -= ML_MASK;
+            for (; length > 509 ; length-=510) { *op++ = 255; *op++ = 255; }
+            if (length > 254) { length-=255; *op++ = 255; }
+            *op++ = (BYTE)length;
+        }
+        else *token += length;
+
+        // Test end of chunk
+        if (ip > mflimit) { anchor = ip;  break; }
+
+        // Fill table
+        HashTable[LZ4_HASH_VALUE(ip-2)] = LZ4_EXT_INDEX(ip-2) + 1;
+
+        // Test next position
+        refIndex = HashTable[LZ4_HASH_VALUE(ip)];
+        HashTable[LZ4_HASH_VALUE(ip)] = LZ4_EXT_INDEX(ip) + 1;
+        distance = LZ4_EXT_INDEX(ip) + 1 - refIndex;
+        if ((refIndex != 0) && (distance <= MAX_DISTANCE))
+        {
+            ref = LZ4_EXT_POINTER(refIndex - 1);
+            if (A32(ref) == A32(ip)) { token = op++; *token=0; goto _next_match; }
+        }
+
+        // Prepare next loop
+        anchor = ip++;
+        forwardH = LZ4_HASH_VALUE(ip);
+    }
+
+_last_literals:
+    // Encode Last Literals
+    {
+        int lastRun = (int)(iend - anchor);
+        if (((char*)op - dest) + lastRun + 1 + ((lastRun+255-RUN_MASK)/255) > (U32)maxOutputSize) return 0;
+        if (lastRun>=(int)RUN_MASK) { *op++=(RUN_MASK<<ML_BITS); lastRun-=RUN_MASK; for(; lastRun > 254 ; lastRun-=255) *op++ = 255; *op++ = (BYTE) lastRun; }
+        else *op++ = (lastRun<<ML_BITS);
+        memcpy(op, anchor, iend - anchor);
+        op += iend-anchor;
+    }
+
+    // End
+    return (int) (((char*)op)-dest);
+}
+
+
+int LZ4_uncompress_usingDict(const LZ4_dictionary* dictionary,
+                             const char* source,
+                             char* dest,
+                             int isize,
+                             int maxOutputSize)
+{
+    return LZ4_uncompress_generic(source, dest, isize, maxOutputSize, dictionary->content, dictionary->size);
+}
@@ -123,6 +123,45 @@ LZ4_uncompress_unknownOutputSize() :
 */
 
 
+int LZ4_compress_fast (const char* source, char* dest, int isize, int maxOutputSize, int acceleration);
+
+/*
+LZ4_compress_fast() :
+    As LZ4_compress_limitedOutput(), but the search for matches steps 'acceleration' times as far,
+    trading compression ratio for speed. An acceleration of 1 (or less) is LZ4_compress_limitedOutput().
+    The output is decoded by the usual functions.
+*/
+
+
+//****************************
+// Dictionary Functions
+//****************************
+
+#define LZ4_DICTIONARY_MAX_SIZE 65536
+typedef struct LZ4_dictionary_s LZ4_dictionary;
+
+LZ4_dictionary* LZ4_createDictionary (const char* dictionary, int dictionarySize);
+void            LZ4_freeDictionary   (LZ4_dictionary* dictionary);
+const char*     LZ4_getDictionaryContent (const LZ4_dictionary* dictionary, int* dictionarySize);
+
+int LZ4_compress_fast_usingDict (const LZ4_dictionary* dictionary, const char* source, char* dest, int isize, int maxOutputSize, int acceleration);
+int LZ4_uncompress_usingDict    (const LZ4_dictionary* dictionary, const char* source, char* dest, int isize, int maxOutputSize);
+
+/*
+LZ4_createDictionary() :
+    Copies the dictionary (only its last LZ4_DICTIONARY_MAX_SIZE bytes, as matches can't reach further)
+    and indexes it once, so it can be used to compress many small inputs that share its content.
+    return : the dictionary, or NULL if memory can't be allocated. It is read only, so may be shared by threads.
+
+LZ4_compress_fast_usingDict() :
+    As LZ4_compress_fast(), but matches may reference the dictionary as if it came just before the source.
+    The output can only be decoded with LZ4_uncompress_usingDict() and the same dictionary.
+
+LZ4_uncompress_usingDict() :
+    As LZ4_uncompress_unknownOutputSize(), for data compressed with a dictionary.
+*/
+
+
 #if defined (__cplusplus)
 }
 #endif
@@ -222,6 +222,7 @@ typedef struct
     HTYPE hashTable[HASHTABLESIZE];
     U16 chainTable[MAXD];
     const BYTE* nextToUpdate;
+    int maxAttempts;            // Candidate matches searched at each position.
 } LZ4HC_Data_Structure;
 
 
@@ -312,6 +313,7 @@ inline static int LZ4HC_Init (LZ4HC_Data_Structure* hc4, const BYTE* base)
     MEM_INIT(hc4->chainTable, 0xFF, sizeof(hc4->chainTable));
     hc4->nextToUpdate = base + LZ4_ARCH64;
     hc4->base = base;
+    hc4->maxAttempts = MAX_NB_ATTEMPTS;
     return 1;
 }
 
@@ -376,7 +378,7 @@ forceinline static int LZ4HC_InsertAndFindBestMatch (LZ4HC_Data_Structure* hc4,
     HTYPE* const HashTable = hc4->hashTable;
     const BYTE* ref;
     INITBASE(base,hc4->base);
-    int nbAttempts=MAX_NB_ATTEMPTS;
+    int nbAttempts=hc4->maxAttempts;
     size_t repl=0, ml=0;
     U16 delta;
 
@@ -444,7 +446,7 @@ forceinline static int LZ4HC_InsertAndGetWiderMatch (LZ4HC_Data_Structure* hc4,
     HTYPE* const HashTable = hc4->hashTable;
     INITBASE(base,hc4->base);
     const BYTE*  ref;
-    int nbAttempts = MAX_NB_ATTEMPTS;
+    int nbAttempts = hc4->maxAttempts;
     int delta = (int)(ip-startLimit);
 
     // First Match
@@ -728,3 +730,29 @@ int LZ4_compressHC(const char* source,
 }
 
 
+int LZ4_compressHC2_withPrefix(const char* source,
+                 char* dest,
+                 int isize,
+                 int prefixSize,
+                 int compressionLevel)
+{
+    // Starting the tables at the prefix makes its positions candidates for matches.
+    void* ctx = LZ4HC_Create((const BYTE*)source - prefixSize);
+    int result;
+    if (compressionLevel < 1) compressionLevel = 1;
+    if (compressionLevel > LZ4HC_MAX_LEVEL) compressionLevel = LZ4HC_MAX_LEVEL;
+    ((LZ4HC_Data_Structure*)ctx)->maxAttempts = 1 << (compressionLevel - 1);
+    result = LZ4_compressHCCtx(ctx, source, dest, isize);
+    LZ4HC_Free (&ctx);
+
+    return result;
+}
+
+
+int LZ4_compressHC2(const char* source,
+                 char* dest,
+                 int isize,
+                 int compressionLevel)
+{
+    return LZ4_compressHC2_withPrefix(source, dest, isize, 0, compressionLevel);
+}
@@ -50,6 +50,21 @@ LZ4_compressHC :
 */
 
 
+int LZ4_compressHC2 (const char* source, char* dest, int isize, int compressionLevel);
+int LZ4_compressHC2_withPrefix (const char* source, char* dest, int isize, int prefixSize, int compressionLevel);
+
+/*
+LZ4_compressHC2 :
+	As LZ4_compressHC, but searching at most 2^(compressionLevel-1) candidate matches at each position,
+	for levels from 1 to LZ4HC_MAX_LEVEL. Level 9 is LZ4_compressHC.
+
+LZ4_compressHC2_withPrefix :
+	As LZ4_compressHC2, but matches may reference the 'prefixSize' bytes (at most 64KB) just before source,
+	typically a dictionary. Decode with LZ4_uncompress_usingDict() (see "lz4.h").
+*/
+#define LZ4HC_MAX_LEVEL 12
+
+
 /* Note :
 Decompression functions are provided within regular LZ4 source code (see "lz4.h") (BSD license)
 */
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * openHashControl.h
+ *
+ * Control bytes and probing shared by the open addressing tables, the generic one behind stHash
+ * (openHashTable.c) and the int64 keyed stIntHash (sonLibIntHash.c). Each table keeps its own
+ * slot array and key comparison, and uses these helpers for everything else.
+ *
+ * Every slot has a control byte that is either CONTROL_EMPTY, CONTROL_DELETED (a tombstone) or,
+ * for a full slot, the low seven bits of the key's mixed hash. The remaining bits of the hash
+ * pick the slot where linear probing starts. Capacities are powers of two.
+ */
+
+#ifndef OPEN_HASH_CONTROL_H_
+#define OPEN_HASH_CONTROL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define CONTROL_EMPTY ((uint8_t) 0x80)
+#define CONTROL_DELETED ((uint8_t) 0xFE)
+#define MIN_CAPACITY 16
+
+static inline bool openHash_isFull(uint8_t control) {
+    return (control & 0x80) == 0;
+}
+
+/*
+ * Scrambles a hash so that weak hashes (e.g. raw pointers or small ints) spread over both the
+ * slot index and the control byte.
+ */
+static inline uint64_t openHash_mix(uint64_t h) {
+    h = (h ^ (h >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    h = (h ^ (h >> 27)) * UINT64_C(0x94d049bb133111eb);
+    return h ^ (h >> 31);
+}
+
+static inline uint8_t openHash_control(uint64_t h) {
+    return (uint8_t) (h & 0x7F);
+}
+
+static inline uint64_t openHash_index(uint64_t h, uint64_t capacity) {
+    return (h >> 7) & (capacity - 1);
+}
+
+/*
+ * Maximum number of full plus deleted slots before a rehash is forced.
+ */
+static inline uint64_t openHash_maxLoad(uint64_t capacity) {
+    return capacity - capacity / 8;
+}
+
+static inline uint64_t openHash_capacityFor(uint64_t minSize) {
+    uint64_t capacity = MIN_CAPACITY;
+    // Leave the table at most half full after sizing so that inserts don't immediately rehash.
+    while (capacity / 2 < minSize) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+/*
+ * Returns the capacity to rehash to when an insert would exceed the maximum load. If most of
+ * the load is tombstones a same-size rehash is enough to reclaim them.
+ */
+static inline uint64_t openHash_growCapacity(uint64_t size, uint64_t capacity) {
+    return openHash_capacityFor(size + 1) > capacity ? capacity * 2 : capacity;
+}
+
+static inline void openHash_clearControl(uint8_t *control, uint64_t capacity) {
+    memset(control, CONTROL_EMPTY, capacity * sizeof(uint8_t));
+}
+
+/*
+ * Returns the first slot on the probe sequence of the hash that is not full, in which a key
+ * known not to be present can be placed.
+ */
+static inline uint64_t openHash_findFree(const uint8_t *control, uint64_t capacity, uint64_t h) {
+    uint64_t mask = capacity - 1;
+    uint64_t i = openHash_index(h, capacity);
+    while (openHash_isFull(control[i])) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+#endif /* OPEN_HASH_CONTROL_H_ */
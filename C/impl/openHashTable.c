@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * openHashTable.c
+ *
+ * Linear-probing open-addressing table with one control byte per slot, see openHashTable.h and
+ * openHashControl.h.
+ */
+#include "sonLibGlobalsInternal.h"
+#include "openHashTable.h"
+#include "openHashControl.h"
+
+/*
+ * Mixes the user supplied hash, see openHash_mix.
+ */
+static inline uint64_t mixHash(struct openHashTable *t, const void *key) {
+    return openHash_mix(t->hashfn(key));
+}
+
+static void allocateSlots(struct openHashTable *t, uint64_t capacity) {
+    t->capacity = capacity;
+    t->control = st_malloc(capacity * sizeof(uint8_t));
+    openHash_clearControl(t->control, capacity);
+    t->slots = st_malloc(capacity * sizeof(struct openHashSlot));
+    t->tombstones = 0;
+}
+
+struct openHashTable *openHashTable_construct(uint64_t minSize, uint64_t (*hashfn)(const void *),
+        int (*eqfn)(const void *, const void *), void (*keyFree)(void *), void (*valueFree)(void *)) {
+    struct openHashTable *t = st_malloc(sizeof(struct openHashTable));
+    allocateSlots(t, openHash_capacityFor(minSize));
+    t->size = 0;
+    t->hashfn = hashfn;
+    t->eqfn = eqfn;
+    t->keyFree = keyFree;
+    t->valueFree = valueFree;
+    return t;
+}
+
+void openHashTable_destruct(struct openHashTable *t, bool freeKeys, bool freeValues) {
+    if (freeKeys || freeValues) {
+        for (uint64_t i = 0; i < t->capacity; i++) {
+            if (openHash_isFull(t->control[i])) {
+                if (freeKeys) {
+                    t->keyFree(t->slots[i].key);
+                }
+                if (freeValues) {
+                    t->valueFree(t->slots[i].value);
+                }
+            }
+        }
+    }
+    free(t->control);
+    free(t->slots);
+    free(t);
+}
+
+/*
+ * Returns the slot holding the key, or t->capacity if absent.
+ */
+static uint64_t findSlot(struct openHashTable *t, const void *key, uint64_t h) {
+    uint64_t mask = t->capacity - 1;
+    uint8_t c = openHash_control(h);
+    for (uint64_t i = openHash_index(h, t->capacity);; i = (i + 1) & mask) {
+        uint8_t control = t->control[i];
+        if (control == CONTROL_EMPTY) {
+            return t->capacity;
+        }
+        if (control == c && t->eqfn(key, t->slots[i].key)) {
+            return i;
+        }
+    }
+}
+
+/*
+ * Places a key known not to be present, without checking the load.
+ */
+static void placeNew(struct openHashTable *t, void *key, void *value, uint64_t h) {
+    uint64_t i = openHash_findFree(t->control, t->capacity, h);
+    if (t->control[i] == CONTROL_DELETED) {
+        t->tombstones--;
+    }
+    t->control[i] = openHash_control(h);
+    t->slots[i].key = key;
+    t->slots[i].value = value;
+    t->size++;
+}
+
+static void rehash(struct openHashTable *t, uint64_t newCapacity) {
+    uint8_t *oldControl = t->control;
+    struct openHashSlot *oldSlots = t->slots;
+    uint64_t oldCapacity = t->capacity;
+    allocateSlots(t, newCapacity);
+    t->size = 0;
+    for (uint64_t i = 0; i < oldCapacity; i++) {
+        if (openHash_isFull(oldControl[i])) {
+            placeNew(t, oldSlots[i].key, oldSlots[i].value, mixHash(t, oldSlots[i].key));
+        }
+    }
+    free(oldControl);
+    free(oldSlots);
+}
+
+void openHashTable_reserve(struct openHashTable *t, uint64_t minSize) {
+    uint64_t capacity = openHash_capacityFor(minSize);
+    if (capacity > t->capacity) {
+        rehash(t, capacity);
+    }
+}
+
+void openHashTable_insert(struct openHashTable *t, void *key, void *value) {
+    uint64_t h = mixHash(t, key);
+    uint64_t i = findSlot(t, key, h);
+    if (i != t->capacity) {
+        // Mirror the chained table, which replaces both the stored key and value.
+        t->slots[i].key = key;
+        t->slots[i].value = value;
+        return;
+    }
+    if (t->size + t->tombstones + 1 > openHash_maxLoad(t->capacity)) {
+        rehash(t, openHash_growCapacity(t->size, t->capacity));
+    }
+    placeNew(t, key, value, h);
+}
+
+void *openHashTable_search(struct openHashTable *t, void *key) {
+    uint64_t i = findSlot(t, key, mixHash(t, key));
+    return i != t->capacity ? t->slots[i].value : NULL;
+}
+
+void *openHashTable_remove(struct openHashTable *t, void *key, bool freeKey) {
+    uint64_t i = findSlot(t, key, mixHash(t, key));
+    if (i == t->capacity) {
+        return NULL;
+    }
+    void *value = t->slots[i].value;
+    if (freeKey) {
+        t->keyFree(t->slots[i].key);
+    }
+    t->control[i] = CONTROL_DELETED;
+    t->size--;
+    t->tombstones++;
+    return value;
+}
+
+uint64_t openHashTable_nextOccupied(struct openHashTable *t, uint64_t slot) {
+    while (slot < t->capacity && !openHash_isFull(t->control[slot])) {
+        slot++;
+    }
+    return slot;
+}
+
+void openHashTable_printDiagnostics(struct openHashTable *t) {
+    uint64_t totalProbe = 0, maxProbe = 0;
+    uint64_t mask = t->capacity - 1;
+    for (uint64_t i = 0; i < t->capacity; i++) {
+        if (openHash_isFull(t->control[i])) {
+            uint64_t probe = (i - openHash_index(mixHash(t, t->slots[i].key), t->capacity)) & mask;
+            totalProbe += probe;
+            if (probe > maxProbe) {
+                maxProbe = probe;
+            }
+        }
+    }
+    printf("Load: %" PRIu64 " / %" PRIu64 " (%lf%%)\n", t->size, t->capacity,
+           ((double) t->size) / t->capacity * 100);
+    printf("# deleted slots: %" PRIu64 "\n", t->tombstones);
+    printf("avg probe length: %lf, max probe length: %" PRIu64 "\n",
+           t->size > 0 ? ((double) totalProbe) / t->size : 0.0, maxProbe);
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * openHashTable.h
+ *
+ * Open-addressing hash table used as the alternative backend of stHash.
+ *
+ * Keys and values are stored inline in one flat slot array, with a parallel array of
+ * one-byte control words holding either an empty/deleted marker or seven bits of the
+ * key's hash. Lookups probe linearly and only call the (potentially expensive) equality
+ * function when the control byte matches, so a miss or a hit typically touches one or two
+ * cache lines and no per-entry allocation is ever made.
+ *
+ * Removal leaves a tombstone rather than shifting entries, so removing the key most recently
+ * returned by an iterator does not disturb the rest of the iteration (matching the chained
+ * table). Tombstones are cleared when the table is next rehashed.
+ */
+
+#ifndef OPEN_HASH_TABLE_H_
+#define OPEN_HASH_TABLE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct openHashSlot {
+    void *key;
+    void *value;
+};
+
+struct openHashTable {
+    uint64_t capacity; // Always a power of two.
+    uint64_t size; // Number of live entries.
+    uint64_t tombstones; // Number of deleted slots not yet reclaimed.
+    uint8_t *control;
+    struct openHashSlot *slots;
+    uint64_t (*hashfn)(const void *k);
+    int (*eqfn)(const void *k1, const void *k2);
+    void (*keyFree)(void *);
+    void (*valueFree)(void *);
+};
+
+/*
+ * Creates a table able to hold at least minSize entries without rehashing.
+ */
+struct openHashTable *openHashTable_construct(uint64_t minSize, uint64_t (*hashfn)(const void *),
+        int (*eqfn)(const void *, const void *), void (*keyFree)(void *), void (*valueFree)(void *));
+
+/*
+ * Frees the table, calling the key/value destructors on the remaining entries if requested.
+ */
+void openHashTable_destruct(struct openHashTable *t, bool freeKeys, bool freeValues);
+
+/*
+ * Inserts the key/value, replacing the key and value of an equal key if already present.
+ */
+void openHashTable_insert(struct openHashTable *t, void *key, void *value);
+
+/*
+ * Returns the value associated with the key, or NULL if not present.
+ */
+void *openHashTable_search(struct openHashTable *t, void *key);
+
+/*
+ * Removes the key, returning its value (or NULL if not present). If freeKey is non-zero the
+ * stored key is freed with the key destructor.
+ */
+void *openHashTable_remove(struct openHashTable *t, void *key, bool freeKey);
+
+/*
+ * Ensures the table can hold minSize entries without rehashing.
+ */
+void openHashTable_reserve(struct openHashTable *t, uint64_t minSize);
+
+/*
+ * Returns the index of the first occupied slot at or after slot, or t->capacity if there is
+ * none.
+ */
+uint64_t openHashTable_nextOccupied(struct openHashTable *t, uint64_t slot);
+
+/*
+ * Prints load and probe length statistics for the table.
+ */
+void openHashTable_printDiagnostics(struct openHashTable *t);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* OPEN_HASH_TABLE_H_ */
@@ -11,6 +11,7 @@
 #include "pairwiseAlignment.h"
 #include "commonC.h"
 #include "bioioC.h"
+#include "sonLib.h"
 
 struct AlignmentOperation *constructAlignmentOperation(int64_t type, int64_t length, float score) {
     struct AlignmentOperation *oP;
@@ -28,42 +29,42 @@ void destructAlignmentOperation(struct AlignmentOperation *alignmentOperation) {
     free(alignmentOperation);
 }
 
-void checkPairwiseAlignment(struct PairwiseAlignment *pA) {
-    int64_t i, j, k;
-    struct AlignmentOperation *op;
-
-    assert(pA->start1 >= 0);
-    assert(pA->end1 >= 0);
-    assert(pA->strand1 == 0 || pA->strand1 == 1);
-    if(pA->strand1) {
-        assert(pA->start1 <= pA->end1);
+static void checkCoordinates(int64_t start, int64_t end, int64_t strand) {
+    assert(start >= 0);
+    assert(end >= 0);
+    assert(strand == 0 || strand == 1);
+    if(strand) {
+        assert(start <= end);
     }
     else {
-        assert(pA->end1 <= pA->start1);
+        assert(end <= start);
     }
+}
 
-    assert(pA->start2 >= 0);
-    assert(pA->end2 >= 0);
-    assert(pA->strand2 == 0 || pA->strand2 == 1);
-    if(pA->strand2) {
-        assert(pA->start2 <= pA->end2);
+/*
+ * Moves the positions j and k in the two sequences past the operation.
+ */
+static void checkOperation(struct AlignmentOperation *op, int64_t strand1, int64_t strand2, int64_t *j, int64_t *k) {
+    assert(op->length >= 0);
+    if(op->opType != PAIRWISE_INDEL_Y) {
+        *j += strand1 ? op->length : -op->length;
     }
-    else {
-        assert(pA->end2 <= pA->start2);
+    if(op->opType != PAIRWISE_INDEL_X) {
+        *k += strand2 ? op->length : -op->length;
     }
+}
+
+void checkPairwiseAlignment(struct PairwiseAlignment *pA) {
+    int64_t i, j, k;
+
+    checkCoordinates(pA->start1, pA->end1, pA->strand1);
+    checkCoordinates(pA->start2, pA->end2, pA->strand2);
 
     //does not copy.
     j = pA->start1;
     k = pA->start2;
     for(i=0; i<pA->operationList->length; i++) {
-        op = pA->operationList->list[i];
-        assert(op->length >= 0);
-        if(op->opType != PAIRWISE_INDEL_Y) {
-            j += pA->strand1 ? op->length : -op->length;
-        }
-        if(op->opType != PAIRWISE_INDEL_X) {
-            k += pA->strand2 ? op->length : -op->length;
-        }
+        checkOperation(pA->operationList->list[i], pA->strand1, pA->strand2, &j, &k);
     }
 
     assert(j == pA->end1);
@@ -226,26 +227,166 @@ char cigarWriteFnWProbs(int64_t type) {
     }
 }
 
-void cigarWrite(FILE *fileHandle, struct PairwiseAlignment *pA, int64_t withProbs) {
-    int i;
-    struct AlignmentOperation *oP;
-
+static void cigarWriteHeader(FILE *fileHandle, const char *contig1, int64_t start1, int64_t end1, int64_t strand1,
+                             const char *contig2, int64_t start2, int64_t end2, int64_t strand2, float score) {
     fprintf(fileHandle, "cigar: %s %" PRIi64 " %" PRIi64 " %c %s %" PRIi64 " %" PRIi64 " %c %f",\
-            pA->contig2, pA->start2, pA->end2, pA->strand2 ? '+' : '-',\
-            pA->contig1, pA->start1, pA->end1, pA->strand1 ? '+' : '-',\
-            pA->score);
+            contig2, start2, end2, strand2 ? '+' : '-',\
+            contig1, start1, end1, strand1 ? '+' : '-',\
+            score);
+}
+
+static void cigarWriteOperation(FILE *fileHandle, struct AlignmentOperation *oP, int64_t withProbs) {
     if(withProbs == TRUE) {
-        for(i=0; i<pA->operationList->length; i++) {
-            oP = pA->operationList->list[i];
-            fprintf(fileHandle, " %c %" PRIi64 " %f", cigarWriteFnWProbs(oP->opType), oP->length, oP->score);
-        }
+        fprintf(fileHandle, " %c %" PRIi64 " %f", cigarWriteFnWProbs(oP->opType), oP->length, oP->score);
     }
     else {
-        for(i=0; i<pA->operationList->length; i++) {
-            oP = pA->operationList->list[i];
-            fprintf(fileHandle, " %c %" PRIi64 "", cigarWriteFn(oP->opType), oP->length);
-        }
+        fprintf(fileHandle, " %c %" PRIi64 "", cigarWriteFn(oP->opType), oP->length);
+    }
+}
+
+void cigarWrite(FILE *fileHandle, struct PairwiseAlignment *pA, int64_t withProbs) {
+    int i;
+
+    cigarWriteHeader(fileHandle, pA->contig1, pA->start1, pA->end1, pA->strand1,
+                     pA->contig2, pA->start2, pA->end2, pA->strand2, pA->score);
+    for(i=0; i<pA->operationList->length; i++) {
+        cigarWriteOperation(fileHandle, pA->operationList->list[i], withProbs);
     }
     fprintf(fileHandle, "\n");
 }
 
+struct StringTable {
+    stHash *strings;
+    stArena *arena; // Holds the copies of the strings.
+};
+
+struct StringTable *constructStringTable(void) {
+    struct StringTable *stringTable = st_malloc(sizeof(struct StringTable));
+    stringTable->strings = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, NULL, NULL);
+    stringTable->arena = stArena_construct();
+    return stringTable;
+}
+
+void destructStringTable(struct StringTable *stringTable) {
+    stHash_destruct(stringTable->strings);
+    stArena_destruct(stringTable->arena);
+    free(stringTable);
+}
+
+const char *stringTableIntern(struct StringTable *stringTable, const char *string) {
+    char *copy = stHash_search(stringTable->strings, (void *)string);
+    if(copy == NULL) {
+        copy = stArena_copyString(stringTable->arena, string);
+        stHash_insert(stringTable->strings, copy, copy);
+    }
+    return copy;
+}
+
+int64_t stringTableSize(struct StringTable *stringTable) {
+    return stHash_size(stringTable->strings);
+}
+
+/*
+ * Allocates a flat alignment with room for the operations, which are left for the caller to fill in.
+ */
+static struct FlatPairwiseAlignment *allocateFlatPairwiseAlignment(struct StringTable *contigNames,
+                                                                   const char *contig1, int64_t start1, int64_t end1,
+                                                                   int64_t strand1, const char *contig2,
+                                                                   int64_t start2, int64_t end2, int64_t strand2,
+                                                                   float score, int64_t operationNumber) {
+    struct FlatPairwiseAlignment *fPA;
+    //the operations follow the struct, in the same allocation.
+    fPA = st_malloc(sizeof(struct FlatPairwiseAlignment) + operationNumber * sizeof(struct AlignmentOperation));
+    fPA->operations = (struct AlignmentOperation *)(fPA + 1);
+    fPA->operationNumber = operationNumber;
+
+    fPA->contig1 = stringTableIntern(contigNames, contig1);
+    fPA->start1 = start1;
+    fPA->end1 = end1;
+    fPA->strand1 = strand1;
+
+    fPA->contig2 = stringTableIntern(contigNames, contig2);
+    fPA->start2 = start2;
+    fPA->end2 = end2;
+    fPA->strand2 = strand2;
+
+    fPA->score = score;
+    return fPA;
+}
+
+struct FlatPairwiseAlignment *constructFlatPairwiseAlignment(struct StringTable *contigNames,
+                                                             const char *contig1, int64_t start1, int64_t end1,
+                                                             int64_t strand1, const char *contig2, int64_t start2,
+                                                             int64_t end2, int64_t strand2, float score,
+                                                             int64_t operationNumber,
+                                                             const struct AlignmentOperation *operations) {
+    struct FlatPairwiseAlignment *fPA;
+
+    fPA = allocateFlatPairwiseAlignment(contigNames, contig1, start1, end1, strand1,
+                                        contig2, start2, end2, strand2, score, operationNumber);
+    if(operationNumber > 0) {
+        memcpy(fPA->operations, operations, operationNumber * sizeof(struct AlignmentOperation));
+    }
+    checkFlatPairwiseAlignment(fPA);
+    return fPA;
+}
+
+void destructFlatPairwiseAlignment(struct FlatPairwiseAlignment *fPA) {
+    free(fPA);
+}
+
+struct FlatPairwiseAlignment *flattenPairwiseAlignment(struct PairwiseAlignment *pA, struct StringTable *contigNames) {
+    struct FlatPairwiseAlignment *fPA;
+    int64_t i;
+
+    fPA = allocateFlatPairwiseAlignment(contigNames, pA->contig1, pA->start1, pA->end1, pA->strand1,
+                                        pA->contig2, pA->start2, pA->end2, pA->strand2, pA->score,
+                                        pA->operationList->length);
+    for(i=0; i<fPA->operationNumber; i++) {
+        fPA->operations[i] = *(struct AlignmentOperation *)pA->operationList->list[i];
+    }
+    checkFlatPairwiseAlignment(fPA);
+    return fPA;
+}
+
+struct PairwiseAlignment *unflattenPairwiseAlignment(struct FlatPairwiseAlignment *fPA) {
+    struct List *operationList;
+    struct AlignmentOperation *oP;
+    int64_t i;
+
+    operationList = constructEmptyList(0, (void (*)(void *))destructAlignmentOperation);
+    for(i=0; i<fPA->operationNumber; i++) {
+        oP = &fPA->operations[i];
+        listAppend(operationList, constructAlignmentOperation(oP->opType, oP->length, oP->score));
+    }
+    return constructPairwiseAlignment((char *)fPA->contig1, fPA->start1, fPA->end1, fPA->strand1,
+                                      (char *)fPA->contig2, fPA->start2, fPA->end2, fPA->strand2,
+                                      fPA->score, operationList);
+}
+
+void checkFlatPairwiseAlignment(struct FlatPairwiseAlignment *fPA) {
+    int64_t i, j, k;
+
+    checkCoordinates(fPA->start1, fPA->end1, fPA->strand1);
+    checkCoordinates(fPA->start2, fPA->end2, fPA->strand2);
+
+    j = fPA->start1;
+    k = fPA->start2;
+    for(i=0; i<fPA->operationNumber; i++) {
+        checkOperation(&fPA->operations[i], fPA->strand1, fPA->strand2, &j, &k);
+    }
+
+    assert(j == fPA->end1);
+    assert(k == fPA->end2);
+}
+
+void cigarWriteFlat(FILE *fileHandle, struct FlatPairwiseAlignment *fPA, int64_t withProbs) {
+    int64_t i;
+
+    cigarWriteHeader(fileHandle, fPA->contig1, fPA->start1, fPA->end1, fPA->strand1,
+                     fPA->contig2, fPA->start2, fPA->end2, fPA->strand2, fPA->score);
+    for(i=0; i<fPA->operationNumber; i++) {
+        cigarWriteOperation(fileHandle, &fPA->operations[i], withProbs);
+    }
+    fprintf(fileHandle, "\n");
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * sonLibArena.c
+ *
+ * Block based bump allocator and fixed size pools, see sonLibArena.h.
+ */
+#include "sonLibGlobalsInternal.h"
+
+const char *ST_ARENA_EXCEPTION_ID = "ST_ARENA_EXCEPTION";
+
+#define DEFAULT_BLOCK_SIZE 65536
+#define ALIGNMENT 16 // As glibc malloc, enough for any basic type.
+#define POOL_BATCH 64 // Elements taken from the arena at a time by a pool.
+
+struct arenaBlock {
+    struct arenaBlock *next;
+    int64_t size; // Usable bytes after the header.
+};
+
+// Header rounded up so that block data starts aligned.
+#define BLOCK_HEADER_SIZE ((sizeof(struct arenaBlock) + ALIGNMENT - 1) & ~((size_t) ALIGNMENT - 1))
+
+struct _stArena {
+    struct arenaBlock *blocks; // Most recently allocated first.
+    char *next; // Free space in the current block.
+    char *end;
+    int64_t blockSize;
+    int64_t allocatedBytes;
+};
+
+struct _stPool {
+    stArena *arena;
+    bool ownsArena;
+    int64_t elementSize;
+    void *freeList; // Freed elements, linked through their first word.
+    char *next; // Unused elements in the current batch.
+    char *end;
+};
+
+static struct arenaBlock *constructBlock(stArena *arena, int64_t size) {
+    struct arenaBlock *block = st_malloc(BLOCK_HEADER_SIZE + size);
+    block->size = size;
+    arena->allocatedBytes += BLOCK_HEADER_SIZE + size;
+    return block;
+}
+
+static inline char *blockData(struct arenaBlock *block) {
+    return ((char *) block) + BLOCK_HEADER_SIZE;
+}
+
+stArena *stArena_construct(void) {
+    return stArena_construct2(DEFAULT_BLOCK_SIZE);
+}
+
+stArena *stArena_construct2(int64_t blockSize) {
+    if (blockSize <= 0) {
+        stThrowNew(ST_ARENA_EXCEPTION_ID, "Arena block size must be positive, got %" PRIi64, blockSize);
+    }
+    stArena *arena = st_malloc(sizeof(stArena));
+    arena->blockSize = blockSize;
+    arena->allocatedBytes = 0;
+    arena->blocks = NULL;
+    arena->next = NULL;
+    arena->end = NULL;
+    return arena;
+}
+
+void stArena_destruct(stArena *arena) {
+    struct arenaBlock *block = arena->blocks;
+    while (block != NULL) {
+        struct arenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    free(arena);
+}
+
+void *stArena_malloc(stArena *arena, int64_t size) {
+    size = (size + ALIGNMENT - 1) & ~((int64_t) ALIGNMENT - 1);
+    if (size > arena->end - arena->next) {
+        if (size > arena->blockSize / 4) {
+            // Big requests get their own block, placed behind the current one so the space
+            // left in the current block is not wasted.
+            struct arenaBlock *block = constructBlock(arena, size);
+            if (arena->blocks != NULL) {
+                block->next = arena->blocks->next;
+                arena->blocks->next = block;
+            } else {
+                block->next = NULL;
+                arena->blocks = block;
+            }
+            return blockData(block);
+        }
+        struct arenaBlock *block = constructBlock(arena, arena->blockSize);
+        block->next = arena->blocks;
+        arena->blocks = block;
+        arena->next = blockData(block);
+        arena->end = arena->next + block->size;
+    }
+    void *memory = arena->next;
+    arena->next += size;
+    return memory;
+}
+
+void *stArena_calloc(stArena *arena, int64_t elementNumber, int64_t elementSize) {
+    void *memory = stArena_malloc(arena, elementNumber * elementSize);
+    memset(memory, 0, elementNumber * elementSize);
+    return memory;
+}
+
+char *stArena_copyString(stArena *arena, const char *string) {
+    int64_t length = strlen(string);
+    char *copy = stArena_malloc(arena, length + 1);
+    memcpy(copy, string, length + 1);
+    return copy;
+}
+
+void stArena_reset(stArena *arena) {
+    // Keep the oldest block, which was allocated with the regular block size unless the
+    // very first request was a big one.
+    struct arenaBlock *block = arena->blocks, *kept = NULL;
+    while (block != NULL) {
+        struct arenaBlock *next = block->next;
+        if (next == NULL && block->size == arena->blockSize) {
+            kept = block;
+        } else {
+            free(block);
+        }
+        block = next;
+    }
+    arena->blocks = kept;
+    arena->allocatedBytes = kept != NULL ? BLOCK_HEADER_SIZE + kept->size : 0;
+    arena->next = kept != NULL ? blockData(kept) : NULL;
+    arena->end = kept != NULL ? arena->next + kept->size : NULL;
+    if (kept != NULL) {
+        kept->next = NULL;
+    }
+}
+
+int64_t stArena_getAllocatedBytes(stArena *arena) {
+    return arena->allocatedBytes;
+}
+
+/*
+ * stPool
+ */
+
+stPool *stPool_construct(int64_t elementSize) {
+    stPool *pool = stPool_construct2(elementSize, stArena_construct());
+    pool->ownsArena = 1;
+    return pool;
+}
+
+stPool *stPool_construct2(int64_t elementSize, stArena *arena) {
+    if (elementSize <= 0) {
+        stThrowNew(ST_ARENA_EXCEPTION_ID, "Pool element size must be positive, got %" PRIi64, elementSize);
+    }
+    stPool *pool = st_malloc(sizeof(stPool));
+    pool->arena = arena;
+    pool->ownsArena = 0;
+    pool->elementSize = (elementSize + sizeof(void *) - 1) & ~((int64_t) sizeof(void *) - 1);
+    pool->freeList = NULL;
+    pool->next = NULL;
+    pool->end = NULL;
+    return pool;
+}
+
+void stPool_destruct(stPool *pool) {
+    if (pool->ownsArena) {
+        stArena_destruct(pool->arena);
+    }
+    free(pool);
+}
+
+void *stPool_malloc(stPool *pool) {
+    if (pool->freeList != NULL) {
+        void *element = pool->freeList;
+        pool->freeList = *(void **) element;
+        return element;
+    }
+    if (pool->next == pool->end) {
+        pool->next = stArena_malloc(pool->arena, pool->elementSize * POOL_BATCH);
+        pool->end = pool->next + pool->elementSize * POOL_BATCH;
+    }
+    void *element = pool->next;
+    pool->next += pool->elementSize;
+    return element;
+}
+
+void stPool_free(stPool *pool, void *element) {
+    *(void **) element = pool->freeList;
+    pool->freeList = element;
+}
+
+int64_t stPool_getElementSize(stPool *pool) {
+    return pool->elementSize;
+}
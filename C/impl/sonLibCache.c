@@ -7,6 +7,7 @@
 //Cache functions
 
 #include "sonLibGlobalsInternal.h"
+#include <pthread.h>
 
 struct _lru;
 
@@ -38,6 +39,12 @@ struct stCache {
     // The cache may go over this size if a single record greater than
     // maxSize is inserted.
     size_t maxSize;
+    // For a concurrent cache, the shards that hold the records, each
+    // with its own lock, LRU list and share of maxSize. The fields
+    // above are unused. NULL for a regular cache.
+    struct stCache *shards;
+    pthread_mutex_t *shardLocks;
+    int64_t numShards;
 };
 
 // Free a cache record without touching the LRU list.
@@ -237,9 +244,12 @@ static stCacheRecord *mergeRecords(stCache *cache,
     return record3;
 }
 
+static bool containsRecord(stCache *cache, int64_t key,
+                           int64_t start, int64_t size);
+
 void deleteRecord(stCache *cache, int64_t key,
                   int64_t start, int64_t size) {
-    assert(!stCache_containsRecord(cache, key, start, size)); //Will not delete a record wholly contained in.
+    assert(!containsRecord(cache, key, start, size)); //Will not delete a record wholly contained in.
     stCacheRecord *record = getLessThanOrEqualRecord(cache, key, start,
                                                      size);
     while (record != NULL && recordOverlapsWith(record, key, start, size)) { //could have multiple fragments in there to remove.
@@ -280,44 +290,35 @@ void deleteRecord(stCache *cache, int64_t key,
 }
 
 
-/*
- * Public functions
- */
-
-stCache *stCache_construct2(size_t maxSize) {
-    stCache *cache = st_malloc(sizeof(stCache));
+static void initCache(stCache *cache, size_t maxSize) {
     cache->cache = stSortedSet_construct3(cacheRecord_cmp,
                                           (void(*)(void *)) cacheRecord_destruct);
     cache->lruHead = NULL;
     cache->lruTail = NULL;
     cache->curSize = 0;
     cache->maxSize = maxSize;
-    return cache;
-}
-
-stCache *stCache_construct(void) {
-    return stCache_construct2(SIZE_MAX);
+    cache->shards = NULL;
+    cache->shardLocks = NULL;
+    cache->numShards = 0;
 }
 
-void stCache_destruct(stCache *cache) {
+static void destructCache(stCache *cache) {
     stSortedSet_destruct(cache->cache);
     clearLruList(cache);
-    free(cache);
 }
 
-void stCache_clear(stCache *cache) {
-    stSortedSet_destruct(cache->cache);
-    clearLruList(cache);
+static void clearCache(stCache *cache) {
+    destructCache(cache);
     cache->cache = stSortedSet_construct3(cacheRecord_cmp,
                                           (void(*)(void *)) cacheRecord_destruct);
     cache->curSize = 0;
 }
 
-void stCache_setRecord(stCache *cache, int64_t key,
-                       int64_t start, int64_t size, const void *value) {
+static void setRecord(stCache *cache, int64_t key,
+                      int64_t start, int64_t size, const void *value) {
     //If the record is already contained we update a portion of it.
     assert(value != NULL);
-    if (stCache_containsRecord(cache, key, start, size)) {
+    if (containsRecord(cache, key, start, size)) {
         stCacheRecord *record = getLessThanOrEqualRecord(cache, key,
                                                          start, size);
         assert(record != NULL);
@@ -354,8 +355,8 @@ void stCache_setRecord(stCache *cache, int64_t key,
     }
 }
 
-bool stCache_containsRecord(stCache *cache, int64_t key,
-                            int64_t start, int64_t size) {
+static bool containsRecord(stCache *cache, int64_t key,
+                           int64_t start, int64_t size) {
     assert(start >= 0);
     assert(size >= 0);
     stCacheRecord *record = getLessThanOrEqualRecord(cache, key, start,
@@ -373,9 +374,9 @@ bool stCache_containsRecord(stCache *cache, int64_t key,
     return 1;
 }
 
-void *stCache_getRecord(stCache *cache, int64_t key,
-                        int64_t start, int64_t size, int64_t *sizeRead) {
-    if (stCache_containsRecord(cache, key, start, size)) {
+static void *getRecord(stCache *cache, int64_t key,
+                       int64_t start, int64_t size, int64_t *sizeRead) {
+    if (containsRecord(cache, key, start, size)) {
         stCacheRecord *record = getLessThanOrEqualRecord(cache, key,
                                                          start, size);
         assert(record != NULL);
@@ -396,6 +397,125 @@ void *stCache_getRecord(stCache *cache, int64_t key,
     return NULL;
 }
 
+static void removeRecord(stCache *cache, int64_t key) {
+    stCacheRecord *record;
+    while ((record = getGreaterThanOrEqualRecord(cache, key, 0, 0)) != NULL && record->key == key) {
+        removeRecordFromCache(cache, record);
+    }
+}
+
+/*
+ * Concurrent caches. All the fragments of a record live in the same
+ * shard, so each operation only has to lock one shard.
+ */
+
+static int64_t getShardIndex(stCache *cache, int64_t key) {
+    uint64_t h = (uint64_t) key * 0x9E3779B97F4A7C15ULL; // Spread sequential keys over the shards.
+    return (int64_t) ((h >> 32) % (uint64_t) cache->numShards);
+}
+
+static stCache *lockShard(stCache *cache, int64_t key) {
+    int64_t i = getShardIndex(cache, key);
+    pthread_mutex_lock(&cache->shardLocks[i]);
+    return &cache->shards[i];
+}
+
+static void unlockShard(stCache *cache, stCache *shard) {
+    pthread_mutex_unlock(&cache->shardLocks[shard - cache->shards]);
+}
+
+/*
+ * Public functions
+ */
+
+stCache *stCache_construct2(size_t maxSize) {
+    stCache *cache = st_malloc(sizeof(stCache));
+    initCache(cache, maxSize);
+    return cache;
+}
+
+stCache *stCache_construct(void) {
+    return stCache_construct2(SIZE_MAX);
+}
+
+stCache *stCache_construct3(size_t maxSize, int64_t numShards) {
+    if (numShards < 1) {
+        numShards = 1;
+    }
+    stCache *cache = stCache_construct2(maxSize);
+    cache->numShards = numShards;
+    cache->shards = st_malloc(numShards * sizeof(stCache));
+    cache->shardLocks = st_malloc(numShards * sizeof(pthread_mutex_t));
+    for (int64_t i = 0; i < numShards; i++) {
+        initCache(&cache->shards[i], maxSize == SIZE_MAX ? SIZE_MAX : maxSize / numShards);
+        pthread_mutex_init(&cache->shardLocks[i], NULL);
+    }
+    return cache;
+}
+
+void stCache_destruct(stCache *cache) {
+    for (int64_t i = 0; i < cache->numShards; i++) {
+        destructCache(&cache->shards[i]);
+        pthread_mutex_destroy(&cache->shardLocks[i]);
+    }
+    free(cache->shards);
+    free(cache->shardLocks);
+    destructCache(cache);
+    free(cache);
+}
+
+void stCache_clear(stCache *cache) {
+    for (int64_t i = 0; i < cache->numShards; i++) {
+        pthread_mutex_lock(&cache->shardLocks[i]);
+        clearCache(&cache->shards[i]);
+        pthread_mutex_unlock(&cache->shardLocks[i]);
+    }
+    clearCache(cache);
+}
+
+void stCache_setRecord(stCache *cache, int64_t key,
+                       int64_t start, int64_t size, const void *value) {
+    if (cache->shards == NULL) {
+        setRecord(cache, key, start, size, value);
+        return;
+    }
+    stCache *shard = lockShard(cache, key);
+    setRecord(shard, key, start, size, value);
+    unlockShard(cache, shard);
+}
+
+bool stCache_containsRecord(stCache *cache, int64_t key,
+                            int64_t start, int64_t size) {
+    if (cache->shards == NULL) {
+        return containsRecord(cache, key, start, size);
+    }
+    stCache *shard = lockShard(cache, key);
+    bool ret = containsRecord(shard, key, start, size);
+    unlockShard(cache, shard);
+    return ret;
+}
+
+void *stCache_getRecord(stCache *cache, int64_t key,
+                        int64_t start, int64_t size, int64_t *sizeRead) {
+    if (cache->shards == NULL) {
+        return getRecord(cache, key, start, size, sizeRead);
+    }
+    stCache *shard = lockShard(cache, key);
+    void *ret = getRecord(shard, key, start, size, sizeRead);
+    unlockShard(cache, shard);
+    return ret;
+}
+
+void stCache_removeRecord(stCache *cache, int64_t key) {
+    if (cache->shards == NULL) {
+        removeRecord(cache, key);
+        return;
+    }
+    stCache *shard = lockShard(cache, key);
+    removeRecord(shard, key);
+    unlockShard(cache, shard);
+}
+
 bool stCache_recordsIdentical(const char *value, int64_t sizeOfRecord,
                               const char *updatedValue, int64_t updatedSizeOfRecord) {
     if (sizeOfRecord != updatedSizeOfRecord) {
@@ -410,5 +530,11 @@ bool stCache_recordsIdentical(const char *value, int64_t sizeOfRecord,
 }
 
 size_t stCache_size(stCache *cache) {
-    return cache->curSize;
+    size_t size = cache->curSize;
+    for (int64_t i = 0; i < cache->numShards; i++) {
+        pthread_mutex_lock(&cache->shardLocks[i]);
+        size += cache->shards[i].curSize;
+        pthread_mutex_unlock(&cache->shardLocks[i]);
+    }
+    return size;
 }
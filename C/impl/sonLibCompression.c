@@ -11,6 +11,14 @@
  *      Author: benedictpaten
  */
 
+// fopencookie is a GNU extension, hidden by -std=c99 (macOS has funopen instead).
+#if defined(__linux__) || (defined(__unix__) && !defined(__APPLE__))
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#endif
+
+#include <errno.h>
 #include <zlib.h>
 #include "lz4hc.h"
 #include "lz4.h"
@@ -22,6 +30,40 @@ const char *ST_COMPRESSION_EXCEPTION_ID = "ST_COMPRESSION_EXCEPTION";
 //2^30, should be safe and big enough to find good compression.
 #define ST_LZ4_CHUNK_SIZE 1073741824
 
+struct _stCompressionDictionary {
+    LZ4_dictionary *lz4;
+};
+
+/*
+ * Compresses a block with lz4 at the given level (see stCompression_compress), using the dictionary if it
+ * isn't NULL. Returns the compressed length, or 0 if it would be longer than maxOutputSize.
+ */
+static int64_t lz4_compressBlock(const stCompressionDictionary *dictionary, const char *source, char *dest,
+                                 int64_t sizeInBytes, int64_t maxOutputSize, int64_t level) {
+    if (level <= 0) {
+        int acceleration = level < -1 ? -level : 1;
+        return dictionary == NULL ? LZ4_compress_fast(source, dest, sizeInBytes, maxOutputSize, acceleration)
+                : LZ4_compress_fast_usingDict(dictionary->lz4, source, dest, sizeInBytes, maxOutputSize, acceleration);
+    }
+    // High compression can't limit its output, and needs any dictionary in front of the source.
+    int prefixSize = 0;
+    const char *prefix = dictionary == NULL ? NULL : LZ4_getDictionaryContent(dictionary->lz4, &prefixSize);
+    int64_t bound = LZ4_compressBound(sizeInBytes);
+    if (prefixSize == 0 && maxOutputSize >= bound) {
+        return LZ4_compressHC2(source, dest, sizeInBytes, level);
+    }
+    char *buffer = st_malloc(prefixSize + sizeInBytes + bound);
+    memcpy(buffer, prefix, prefixSize);
+    memcpy(buffer + prefixSize, source, sizeInBytes);
+    char *output = buffer + prefixSize + sizeInBytes;
+    int64_t length = LZ4_compressHC2_withPrefix(buffer + prefixSize, output, sizeInBytes, prefixSize, level);
+    if (length <= maxOutputSize) {
+        memcpy(dest, output, length);
+    }
+    free(buffer);
+    return length <= maxOutputSize ? length : 0;
+}
+
 void *stCompression_compress(void *data, int64_t sizeInBytes, int64_t *compressedSizeInBytes, int64_t level) {
     /*
      * Uses the lz4 algorithm to provide very fast compression.
@@ -34,7 +76,9 @@ void *stCompression_compress(void *data, int64_t sizeInBytes, int64_t *compresse
      */
     for(int64_t inputOffset=0; inputOffset < sizeInBytes; inputOffset += ST_LZ4_CHUNK_SIZE) {
         char subChunk = inputOffset + ST_LZ4_CHUNK_SIZE < sizeInBytes;
-        int64_t bytesWritten = LZ4_compress(((char*)data) + inputOffset, buffer+(outputOffset+1), subChunk ? ST_LZ4_CHUNK_SIZE : sizeInBytes - inputOffset);
+        int64_t chunkSize = subChunk ? ST_LZ4_CHUNK_SIZE : sizeInBytes - inputOffset;
+        int64_t bytesWritten = lz4_compressBlock(NULL, ((char*)data) + inputOffset, buffer+(outputOffset+1), chunkSize,
+                                                 LZ4_compressBound(chunkSize), level);
         *(buffer+outputOffset) = subChunk;
         outputOffset += 1+bytesWritten;
         assert(outputOffset <= bufferSize);
@@ -214,3 +258,1137 @@ void *stCompression_decompressZlib(void *compressedData, int64_t compressedSizeI
     (void)inflateEnd(&strm);
     return st_realloc(buffer, outputOffset);
 }
+
+/*
+ * Frames of independent blocks. A frame is laid out as
+ *
+ *   int64 magic, int64 size, int64 blockSize, int64 blockEnds[numBlocks], blocks...
+ *
+ * where a block's end is its offset from the start of the first block, plus its stored
+ * length. A block is stored uncompressed exactly when its stored length is its size.
+ */
+
+#define ST_FRAME_MAGIC 0x31656d6172467473LL // "stFrame1"
+#define ST_FRAME_HEADER_SIZE ((int64_t) (3 * sizeof(int64_t)))
+#define ST_FRAME_DEFAULT_BLOCK_SIZE 1048576
+
+// The blocks of a frame being compressed.
+typedef struct _frameCompression {
+    const char *data;
+    char *blocks; // The start of the blocks in the frame.
+    int64_t size;
+    int64_t blockSize;
+    int64_t *lengths; // The stored length of each block.
+} FrameCompression;
+
+// The blocks of a frame being decompressed into a range of the data.
+typedef struct _frameDecompression {
+    const char *frame;
+    const char *blocks;
+    int64_t size;
+    int64_t blockSize;
+    int64_t offset;
+    int64_t length;
+    char *destination;
+    int64_t firstBlock;
+    bool *failed; // The blocks that couldn't be decompressed.
+} FrameDecompression;
+
+static int64_t frame_getInt64(const void *frame, int64_t index) {
+    int64_t i; // The frame may not be aligned, so is read with memcpy.
+    memcpy(&i, (const char *) frame + index * sizeof(int64_t), sizeof(int64_t));
+    return i;
+}
+
+static int64_t frame_getNumberOfBlocks(int64_t size, int64_t blockSize) {
+    return (size + blockSize - 1) / blockSize;
+}
+
+static int64_t frame_getIndexSize(int64_t size, int64_t blockSize) {
+    return ST_FRAME_HEADER_SIZE + frame_getNumberOfBlocks(size, blockSize) * (int64_t) sizeof(int64_t);
+}
+
+static int64_t frame_getBlockLength(int64_t size, int64_t blockSize, int64_t block) {
+    return size - block * blockSize < blockSize ? size - block * blockSize : blockSize;
+}
+
+static void frame_compressBlocks(int64_t start, int64_t end, void *ctx) {
+    FrameCompression *compression = ctx;
+    for (int64_t i = start; i < end; i++) {
+        // Each block is first compressed into the space its uncompressed data would take.
+        const char *block = compression->data + i * compression->blockSize;
+        char *compressedBlock = compression->blocks + i * compression->blockSize;
+        int64_t length = frame_getBlockLength(compression->size, compression->blockSize, i);
+        compression->lengths[i] = LZ4_compress_limitedOutput(block, compressedBlock, length, length - 1);
+        if (compression->lengths[i] <= 0) {
+            memcpy(compressedBlock, block, length);
+            compression->lengths[i] = length;
+        }
+    }
+}
+
+void *stCompression_compressFrame(const void *data, int64_t sizeInBytes, int64_t *compressedSizeInBytes,
+                                  int64_t blockSize) {
+    if (blockSize <= 0) {
+        blockSize = ST_FRAME_DEFAULT_BLOCK_SIZE;
+    }
+    if (blockSize > INT32_MAX || sizeInBytes < 0) {
+        stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Invalid block size %" PRIi64 " or data size %" PRIi64,
+                   blockSize, sizeInBytes);
+    }
+    int64_t numBlocks = frame_getNumberOfBlocks(sizeInBytes, blockSize);
+    int64_t indexSize = frame_getIndexSize(sizeInBytes, blockSize);
+    char *frame = st_malloc(indexSize + sizeInBytes);
+    int64_t header[3] = { ST_FRAME_MAGIC, sizeInBytes, blockSize };
+    memcpy(frame, header, sizeof(header));
+    FrameCompression compression = { .data = data, .blocks = frame + indexSize, .size = sizeInBytes,
+            .blockSize = blockSize, .lengths = st_malloc((numBlocks + 1) * sizeof(int64_t)) };
+    stParallel_for(0, numBlocks, 1, frame_compressBlocks, &compression);
+    // Close up the gaps left after the compressed blocks.
+    int64_t end = 0;
+    for (int64_t i = 0; i < numBlocks; i++) {
+        memmove(compression.blocks + end, compression.blocks + i * blockSize, compression.lengths[i]);
+        end += compression.lengths[i];
+        memcpy(frame + ST_FRAME_HEADER_SIZE + i * sizeof(int64_t), &end, sizeof(int64_t));
+    }
+    free(compression.lengths);
+    *compressedSizeInBytes = indexSize + end;
+    return st_realloc(frame, *compressedSizeInBytes);
+}
+
+int64_t stCompression_getFrameDataSize(const void *frame, int64_t frameSizeInBytes) {
+    if (frameSizeInBytes < ST_FRAME_HEADER_SIZE || frame_getInt64(frame, 0) != ST_FRAME_MAGIC) {
+        stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Not a compressed frame");
+    }
+    int64_t size = frame_getInt64(frame, 1), blockSize = frame_getInt64(frame, 2);
+    if (size < 0 || blockSize <= 0 || blockSize > INT32_MAX
+            || (frameSizeInBytes - ST_FRAME_HEADER_SIZE) / (int64_t) sizeof(int64_t)
+                    < frame_getNumberOfBlocks(size, blockSize)) {
+        stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "The frame has an invalid header");
+    }
+    // Every block must be no longer than it is uncompressed, and the last must end at the end of the frame.
+    int64_t numBlocks = frame_getNumberOfBlocks(size, blockSize), end = 0;
+    for (int64_t i = 0; i < numBlocks; i++) {
+        int64_t blockEnd = frame_getInt64(frame, 3 + i);
+        if (blockEnd <= end || blockEnd - end > blockSize) {
+            stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "The frame has an invalid index");
+        }
+        end = blockEnd;
+    }
+    if (frame_getIndexSize(size, blockSize) + end != frameSizeInBytes) {
+        stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "The frame is %" PRIi64 " bytes, but its index says %" PRIi64,
+                   frameSizeInBytes, frame_getIndexSize(size, blockSize) + end);
+    }
+    return size;
+}
+
+static bool frame_decompressBlock(FrameDecompression *decompression, int64_t block, char *destination) {
+    int64_t start = block == 0 ? 0 : frame_getInt64(decompression->frame, 2 + block);
+    int64_t end = frame_getInt64(decompression->frame, 3 + block);
+    int64_t length = frame_getBlockLength(decompression->size, decompression->blockSize, block);
+    if (end - start == length) {
+        memcpy(destination, decompression->blocks + start, length);
+        return 1;
+    }
+    return LZ4_uncompress_unknownOutputSize(decompression->blocks + start, destination, end - start, length)
+            == length;
+}
+
+static void frame_decompressBlocks(int64_t start, int64_t end, void *ctx) {
+    FrameDecompression *decompression = ctx;
+    int64_t offset = decompression->offset, rangeEnd = offset + decompression->length;
+    for (int64_t i = start; i < end; i++) {
+        int64_t block = decompression->firstBlock + i, blockStart = block * decompression->blockSize;
+        int64_t blockEnd = blockStart + frame_getBlockLength(decompression->size, decompression->blockSize, block);
+        if (blockStart >= offset && blockEnd <= rangeEnd) {
+            decompression->failed[i] = !frame_decompressBlock(decompression, block,
+                                                              decompression->destination + blockStart - offset);
+        } else { // Only part of the block is wanted.
+            char *buffer = st_malloc(decompression->blockSize);
+            decompression->failed[i] = !frame_decompressBlock(decompression, block, buffer);
+            int64_t from = offset > blockStart ? offset : blockStart, to = rangeEnd < blockEnd ? rangeEnd : blockEnd;
+            memcpy(decompression->destination + from - offset, buffer + from - blockStart, to - from);
+            free(buffer);
+        }
+    }
+}
+
+void stCompression_decompressFrameRange(const void *frame, int64_t frameSizeInBytes, int64_t offset,
+                                        int64_t sizeInBytes, void *destination) {
+    int64_t size = stCompression_getFrameDataSize(frame, frameSizeInBytes);
+    if (offset < 0 || sizeInBytes < 0 || offset + sizeInBytes > size) {
+        stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Range of %" PRIi64 " bytes from %" PRIi64
+                   " is outside the %" PRIi64 " bytes in the frame", sizeInBytes, offset, size);
+    }
+    if (sizeInBytes == 0) {
+        return;
+    }
+    int64_t blockSize = frame_getInt64(frame, 2);
+    int64_t firstBlock = offset / blockSize, numBlocks = (offset + sizeInBytes - 1) / blockSize - firstBlock + 1;
+    FrameDecompression decompression = { .frame = frame,
+            .blocks = (const char *) frame + frame_getIndexSize(size, blockSize), .size = size,
+            .blockSize = blockSize, .offset = offset, .length = sizeInBytes, .destination = destination,
+            .firstBlock = firstBlock, .failed = st_calloc(numBlocks, sizeof(bool)) };
+    stParallel_for(0, numBlocks, 1, frame_decompressBlocks, &decompression);
+    for (int64_t i = 0; i < numBlocks; i++) {
+        if (decompression.failed[i]) {
+            free(decompression.failed);
+            stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Block %" PRIi64 " of the frame is corrupt", firstBlock + i);
+        }
+    }
+    free(decompression.failed);
+}
+
+void *stCompression_decompressFrame(const void *frame, int64_t frameSizeInBytes, int64_t *sizeInBytes) {
+    *sizeInBytes = stCompression_getFrameDataSize(frame, frameSizeInBytes);
+    void *data = st_malloc(*sizeInBytes > 0 ? *sizeInBytes : 1);
+    stTry {
+        stCompression_decompressFrameRange(frame, frameSizeInBytes, 0, *sizeInBytes, data);
+    } stCatch(except) {
+        free(data);
+        stThrow(except);
+    } stTryEnd;
+    return data;
+}
+
+/*
+ * Compression streams. An lz4 stream is laid out as
+ *
+ *   int64 magic, int64 blockSize, blocks..., int64 0
+ *
+ * where each block is an int64 size and an int64 stored length followed by the stored block, which is
+ * uncompressed exactly when its stored length is its size. A zlib stream is a standard zlib stream.
+ *
+ * A gzip stream is written as bgzip: gzip members each holding at most BGZF_BLOCK_DATA_SIZE bytes, with
+ * the compressed size of the member in a "BC" extra field, ending with an empty member. Members are
+ * compressed, and for bgzip read, BGZF_BATCH_SIZE at a time in parallel.
+ */
+
+#define ST_STREAM_MAGIC 0x316d616572745373LL // "sStream1"
+#define ST_STREAM_BLOCK_SIZE 1048576
+
+#define BGZF_HEADER_SIZE 18
+#define BGZF_FOOTER_SIZE 8
+#define BGZF_MAX_BLOCK_SIZE 65536
+#define BGZF_BLOCK_DATA_SIZE 65280 // Small enough to fit in a block even if it doesn't compress.
+#define BGZF_BATCH_SIZE 64
+
+static const unsigned char bgzf_eofBlock[28] = { 0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0,
+        0x1b, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+// How the data of a gzip reader is laid out: in bgzip blocks, in other gzip members, or not compressed.
+typedef enum {
+    gzipBlocks,
+    gzipMembers,
+    gzipPlain
+} GzipLayout;
+
+// A bgzip block, of a batch being compressed or decompressed.
+typedef struct _bgzfBlock {
+    int64_t offset; // Of the block in the stream's compressed data.
+    int64_t length; // Of the block's compressed data.
+    int64_t dataOffset; // Of the block's data in the stream's uncompressed data.
+    int64_t dataLength;
+    uint32_t crc;
+    bool failed;
+} BgzfBlock;
+
+struct _stCompressionStream {
+    stCompressionType type;
+    int64_t level;
+    bool finished; // For a writer, whether the stream has been finished, for a reader, whether the end was read.
+    void (*write)(const void *, int64_t, void *); // NULL for a reader.
+    int64_t (*read)(void *, int64_t, void *); // NULL for a writer.
+    void *extraArg;
+    void (*destructExtraArg)(void *);
+    // The uncompressed data: for a writer the data not yet compressed, for a reader the data not yet read.
+    char *input;
+    int64_t inputLength;
+    int64_t inputOffset;
+    int64_t blockSize;
+    // The compressed data: for a writer the data not yet written, for a reader the data read but not yet
+    // decompressed.
+    char *output;
+    int64_t outputLength;
+    int64_t outputCapacity;
+    z_stream strm;
+    bool memberEnded; // For a gzip reader, whether the last gzip member read has ended.
+    GzipLayout layout;
+    BgzfBlock *blocks; // For a gzip writer, and a gzip reader of bgzip blocks.
+    // For a reader, the bytes read to find the layout of the data, which are read again.
+    unsigned char peek[BGZF_HEADER_SIZE];
+    int64_t peekLength;
+    int64_t peekOffset;
+};
+
+static void bgzf_putUint16(unsigned char *c, uint32_t i) {
+    c[0] = i & 0xff;
+    c[1] = (i >> 8) & 0xff;
+}
+
+static void bgzf_putUint32(unsigned char *c, uint32_t i) {
+    bgzf_putUint16(c, i);
+    bgzf_putUint16(c + 2, i >> 16);
+}
+
+static uint32_t bgzf_getUint16(const unsigned char *c) {
+    return c[0] | ((uint32_t) c[1] << 8);
+}
+
+static uint32_t bgzf_getUint32(const unsigned char *c) {
+    return bgzf_getUint16(c) | (bgzf_getUint16(c + 2) << 16);
+}
+
+static stCompressionStream *stream_construct(stCompressionType type) {
+    if (type != stCompressionLZ4 && type != stCompressionZlib && type != stCompressionGzip) {
+        stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Unknown compression stream type %i", (int) type);
+    }
+    stCompressionStream *stream = st_calloc(1, sizeof(stCompressionStream));
+    stream->type = type;
+    return stream;
+}
+
+// Passes the compressed data made so far to the writer's sink.
+static void stream_emit(stCompressionStream *stream) {
+    if (stream->outputLength > 0) {
+        stream->write(stream->output, stream->outputLength, stream->extraArg);
+        stream->outputLength = 0;
+    }
+}
+
+static void stream_appendInt64(stCompressionStream *stream, int64_t i) {
+    memcpy(stream->output + stream->outputLength, &i, sizeof(int64_t));
+    stream->outputLength += sizeof(int64_t);
+}
+
+static void lz4Stream_compressBlock(stCompressionStream *stream) {
+    if (stream->inputLength == 0) {
+        return;
+    }
+    char *block = stream->output + stream->outputLength + 2 * sizeof(int64_t);
+    int64_t length = lz4_compressBlock(NULL, stream->input, block, stream->inputLength, stream->inputLength - 1,
+                                       stream->level);
+    if (length <= 0) {
+        memcpy(block, stream->input, stream->inputLength);
+        length = stream->inputLength;
+    }
+    stream_appendInt64(stream, stream->inputLength);
+    stream_appendInt64(stream, length);
+    stream->outputLength += length;
+    stream->inputLength = 0;
+    stream_emit(stream);
+}
+
+// Compresses a bgzip block into its slot of the output buffer, storing it if it doesn't fit compressed.
+static bool bgzf_deflateBlock(stCompressionStream *stream, BgzfBlock *block, int level) {
+    unsigned char *data = (unsigned char *) stream->input + block->dataOffset;
+    unsigned char *c = (unsigned char *) stream->output + block->offset;
+    z_stream strm;
+    memset(&strm, 0, sizeof(z_stream));
+    if (deflateInit2(&strm, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return 0;
+    }
+    strm.next_in = data;
+    strm.avail_in = block->dataLength;
+    strm.next_out = c + BGZF_HEADER_SIZE;
+    strm.avail_out = BGZF_MAX_BLOCK_SIZE - BGZF_HEADER_SIZE - BGZF_FOOTER_SIZE;
+    int ret = deflate(&strm, Z_FINISH);
+    block->length = BGZF_HEADER_SIZE + strm.total_out + BGZF_FOOTER_SIZE;
+    (void) deflateEnd(&strm);
+    if (ret != Z_STREAM_END) {
+        return level != 0 && bgzf_deflateBlock(stream, block, 0);
+    }
+    memcpy(c, bgzf_eofBlock, BGZF_HEADER_SIZE - 2);
+    bgzf_putUint16(c + BGZF_HEADER_SIZE - 2, block->length - 1);
+    bgzf_putUint32(c + block->length - BGZF_FOOTER_SIZE, crc32(crc32(0, NULL, 0), data, block->dataLength));
+    bgzf_putUint32(c + block->length - 4, block->dataLength);
+    return 1;
+}
+
+static void bgzf_deflateBlocks(int64_t start, int64_t end, void *ctx) {
+    stCompressionStream *stream = ctx;
+    for (int64_t i = start; i < end; i++) {
+        stream->blocks[i].failed = !bgzf_deflateBlock(stream, &stream->blocks[i], stream->level);
+    }
+}
+
+// Compresses the data written so far as bgzip blocks, in parallel, and passes them on.
+static void gzipStream_compressBlocks(stCompressionStream *stream) {
+    int64_t blockNumber = (stream->inputLength + BGZF_BLOCK_DATA_SIZE - 1) / BGZF_BLOCK_DATA_SIZE;
+    for (int64_t i = 0; i < blockNumber; i++) {
+        BgzfBlock *block = &stream->blocks[i];
+        block->offset = i * BGZF_MAX_BLOCK_SIZE;
+        block->dataOffset = i * BGZF_BLOCK_DATA_SIZE;
+        block->dataLength = stream->inputLength - block->dataOffset < BGZF_BLOCK_DATA_SIZE
+                ? stream->inputLength - block->dataOffset : BGZF_BLOCK_DATA_SIZE;
+    }
+    stParallel_for(0, blockNumber, 1, bgzf_deflateBlocks, stream);
+    for (int64_t i = 0; i < blockNumber; i++) {
+        if (stream->blocks[i].failed) {
+            stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Couldn't compress a bgzip block at level %" PRIi64,
+                       stream->level);
+        }
+        stream->write(stream->output + stream->blocks[i].offset, stream->blocks[i].length, stream->extraArg);
+    }
+    stream->inputLength = 0;
+}
+
+// Deflates the data into the output buffer, passing the output on whenever it fills.
+static void zlibStream_deflate(stCompressionStream *stream, const void *data, int64_t sizeInBytes, int flush) {
+    do {
+        int64_t chunk = sizeInBytes < Z_CHUNK ? sizeInBytes : Z_CHUNK;
+        stream->strm.next_in = (Bytef *) data;
+        stream->strm.avail_in = chunk;
+        data = (const char *) data + chunk;
+        sizeInBytes -= chunk;
+        int chunkFlush = sizeInBytes > 0 ? Z_NO_FLUSH : flush;
+        do {
+            stream->strm.next_out = (Bytef *) stream->output + stream->outputLength;
+            stream->strm.avail_out = stream->outputCapacity - stream->outputLength;
+            int ret = deflate(&stream->strm, chunkFlush);
+            (void) ret;
+            assert(ret != Z_STREAM_ERROR);
+            stream->outputLength = stream->outputCapacity - stream->strm.avail_out;
+            if (stream->outputLength == stream->outputCapacity) {
+                stream_emit(stream);
+            }
+        } while (stream->strm.avail_in > 0 || stream->strm.avail_out == 0);
+    } while (sizeInBytes > 0);
+    if (flush != Z_NO_FLUSH) {
+        stream_emit(stream);
+    }
+}
+
+stCompressionStream *stCompressionStream_constructWriter(stCompressionType type, int64_t level,
+        void (*write)(const void *data, int64_t sizeInBytes, void *extraArg), void *extraArg) {
+    stCompressionStream *stream = stream_construct(type);
+    stream->level = level;
+    stream->write = write;
+    stream->extraArg = extraArg;
+    if (type == stCompressionLZ4) {
+        stream->blockSize = ST_STREAM_BLOCK_SIZE;
+        stream->input = st_malloc(stream->blockSize);
+        // Room for the stream header, a block header and a block, which never gets bigger.
+        stream->outputCapacity = 4 * sizeof(int64_t) + stream->blockSize;
+        stream->output = st_malloc(stream->outputCapacity);
+        stream_appendInt64(stream, ST_STREAM_MAGIC);
+        stream_appendInt64(stream, stream->blockSize);
+    } else if (type == stCompressionGzip) {
+        if (level < -1 || level > 9) {
+            stCompressionStream_destruct(stream);
+            stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Can't write gzip at level %" PRIi64, level);
+        }
+        stream->blockSize = BGZF_BATCH_SIZE * BGZF_BLOCK_DATA_SIZE;
+        stream->input = st_malloc(stream->blockSize);
+        stream->output = st_malloc(BGZF_BATCH_SIZE * BGZF_MAX_BLOCK_SIZE);
+        stream->blocks = st_calloc(BGZF_BATCH_SIZE, sizeof(BgzfBlock));
+    } else {
+        stream->outputCapacity = Z_CHUNK;
+        stream->output = st_malloc(stream->outputCapacity);
+        if (deflateInit(&stream->strm, level) != Z_OK) {
+            stCompressionStream_destruct(stream);
+            stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Couldn't initialise zlib at level %" PRIi64, level);
+        }
+    }
+    return stream;
+}
+
+static void stream_checkWriter(stCompressionStream *stream) {
+    if (stream->write == NULL) {
+        stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Tried to write to a compression stream being read");
+    }
+    if (stream->finished) {
+        stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Tried to write to a compression stream that is finished");
+    }
+}
+
+void stCompressionStream_write(stCompressionStream *stream, const void *data, int64_t sizeInBytes) {
+    stream_checkWriter(stream);
+    if (stream->type == stCompressionZlib) {
+        zlibStream_deflate(stream, data, sizeInBytes, Z_NO_FLUSH);
+        return;
+    }
+    while (sizeInBytes > 0) {
+        int64_t length = stream->blockSize - stream->inputLength;
+        length = length < sizeInBytes ? length : sizeInBytes;
+        memcpy(stream->input + stream->inputLength, data, length);
+        stream->inputLength += length;
+        data = (const char *) data + length;
+        sizeInBytes -= length;
+        if (stream->inputLength == stream->blockSize) {
+            if (stream->type == stCompressionGzip) {
+                gzipStream_compressBlocks(stream);
+            } else {
+                lz4Stream_compressBlock(stream);
+            }
+        }
+    }
+}
+
+void stCompressionStream_flush(stCompressionStream *stream) {
+    stream_checkWriter(stream);
+    if (stream->type == stCompressionZlib) {
+        zlibStream_deflate(stream, NULL, 0, Z_SYNC_FLUSH);
+    } else if (stream->type == stCompressionGzip) {
+        gzipStream_compressBlocks(stream);
+    } else {
+        lz4Stream_compressBlock(stream);
+        stream_emit(stream); // The header, if nothing has been written.
+    }
+}
+
+void stCompressionStream_finish(stCompressionStream *stream) {
+    stream_checkWriter(stream);
+    if (stream->type == stCompressionZlib) {
+        zlibStream_deflate(stream, NULL, 0, Z_FINISH);
+    } else if (stream->type == stCompressionGzip) {
+        gzipStream_compressBlocks(stream);
+        stream->write(bgzf_eofBlock, sizeof(bgzf_eofBlock), stream->extraArg);
+    } else {
+        lz4Stream_compressBlock(stream);
+        stream_appendInt64(stream, 0);
+        stream_emit(stream);
+    }
+    stream->finished = 1;
+}
+
+// Reads up to sizeInBytes bytes from the reader's source, starting with any bytes peeked at.
+static int64_t stream_readSource(stCompressionStream *stream, void *buffer, int64_t sizeInBytes) {
+    if (stream->peekOffset < stream->peekLength) {
+        int64_t length = stream->peekLength - stream->peekOffset;
+        length = length < sizeInBytes ? length : sizeInBytes;
+        memcpy(buffer, stream->peek + stream->peekOffset, length);
+        stream->peekOffset += length;
+        return length;
+    }
+    return stream->read(buffer, sizeInBytes, stream->extraArg);
+}
+
+// Reads as much as it can of sizeInBytes bytes from the reader's source, returning how many it got.
+static int64_t stream_readAll(stCompressionStream *stream, void *buffer, int64_t sizeInBytes) {
+    int64_t bytesRead = 0;
+    while (bytesRead < sizeInBytes) {
+        int64_t length = stream_readSource(stream, (char *) buffer + bytesRead, sizeInBytes - bytesRead);
+        if (length <= 0) {
+            break;
+        }
+        bytesRead += length;
+    }
+    return bytesRead;
+}
+
+// Reads exactly sizeInBytes bytes from the reader's source, returning false if it ends first.
+static bool stream_readFully(stCompressionStream *stream, void *buffer, int64_t sizeInBytes) {
+    while (sizeInBytes > 0) {
+        int64_t length = stream_readSource(stream, buffer, sizeInBytes);
+        if (length <= 0) {
+            return 0;
+        }
+        buffer = (char *) buffer + length;
+        sizeInBytes -= length;
+    }
+    return 1;
+}
+
+static int64_t lz4Stream_readInt64(stCompressionStream *stream) {
+    int64_t i;
+    if (!stream_readFully(stream, &i, sizeof(int64_t))) {
+        stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "The compressed stream ends before it was finished");
+    }
+    return i;
+}
+
+static void lz4Stream_decompressBlock(stCompressionStream *stream) {
+    int64_t size = lz4Stream_readInt64(stream);
+    if (size == 0) {
+        stream->finished = 1;
+        return;
+    }
+    int64_t length = lz4Stream_readInt64(stream);
+    if (size < 0 || size > stream->blockSize || length <= 0 || length > size) {
+        stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "The compressed stream has an invalid block header");
+    }
+    char *block = length == size ? stream->input : stream->output;
+    if (!stream_readFully(stream, block, length)) {
+        stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "The compressed stream ends before it was finished");
+    }
+    if (length != size && LZ4_uncompress_unknownOutputSize(block, stream->input, length, size) != size) {
+        stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "The compressed stream has a corrupt block");
+    }
+    stream->inputLength = size;
+    stream->inputOffset = 0;
+}
+
+static int64_t lz4Stream_read(stCompressionStream *stream, char *buffer, int64_t sizeInBytes) {
+    int64_t bytesRead = 0;
+    while (bytesRead < sizeInBytes) {
+        if (stream->inputOffset == stream->inputLength) {
+            if (stream->finished) {
+                break;
+            }
+            lz4Stream_decompressBlock(stream);
+            continue;
+        }
+        int64_t length = stream->inputLength - stream->inputOffset;
+        length = length < sizeInBytes - bytesRead ? length : sizeInBytes - bytesRead;
+        memcpy(buffer + bytesRead, stream->input + stream->inputOffset, length);
+        stream->inputOffset += length;
+        bytesRead += length;
+    }
+    return bytesRead;
+}
+
+static int64_t zlibStream_read(stCompressionStream *stream, char *buffer, int64_t sizeInBytes) {
+    int64_t bytesRead = 0;
+    while (bytesRead < sizeInBytes && !stream->finished) {
+        if (stream->strm.avail_in == 0) {
+            stream->outputLength = stream_readSource(stream, stream->output, stream->outputCapacity);
+            if (stream->outputLength <= 0) {
+                if (!stream->memberEnded) {
+                    stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "The compressed stream ends before it was finished");
+                }
+                stream->finished = 1;
+                break;
+            }
+            stream->strm.next_in = (Bytef *) stream->output;
+            stream->strm.avail_in = stream->outputLength;
+        }
+        if (stream->memberEnded) { // A gzip file may be several gzip members, one after another.
+            (void) inflateReset(&stream->strm);
+            stream->memberEnded = 0;
+        }
+        int64_t chunk = sizeInBytes - bytesRead < Z_CHUNK ? sizeInBytes - bytesRead : Z_CHUNK;
+        stream->strm.next_out = (Bytef *) buffer + bytesRead;
+        stream->strm.avail_out = chunk;
+        int ret = inflate(&stream->strm, Z_NO_FLUSH);
+        if (ret == Z_NEED_DICT || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR) {
+            stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Error %i in decompressing a zlib stream", ret);
+        }
+        bytesRead += chunk - stream->strm.avail_out;
+        if (ret == Z_STREAM_END) {
+            stream->memberEnded = stream->type == stCompressionGzip;
+            stream->finished = !stream->memberEnded;
+        }
+    }
+    return bytesRead;
+}
+
+static void bgzf_inflateBlocks(int64_t start, int64_t end, void *ctx) {
+    stCompressionStream *stream = ctx;
+    for (int64_t i = start; i < end; i++) {
+        BgzfBlock *block = &stream->blocks[i];
+        unsigned char *data = (unsigned char *) stream->input + block->dataOffset, empty;
+        z_stream strm;
+        memset(&strm, 0, sizeof(z_stream));
+        if (inflateInit2(&strm, -MAX_WBITS) != Z_OK) {
+            block->failed = 1;
+            continue;
+        }
+        strm.next_in = (Bytef *) stream->output + block->offset;
+        strm.avail_in = block->length;
+        strm.next_out = block->dataLength > 0 ? data : &empty;
+        strm.avail_out = block->dataLength > 0 ? block->dataLength : 1;
+        int ret = inflate(&strm, Z_FINISH);
+        block->failed = ret != Z_STREAM_END || (int64_t) strm.total_out != block->dataLength
+                || crc32(crc32(0, NULL, 0), data, block->dataLength) != block->crc;
+        (void) inflateEnd(&strm);
+    }
+}
+
+// Reads the next batch of bgzip blocks and decompresses them, in parallel.
+static void gzipStream_decompressBlocks(stCompressionStream *stream) {
+    int64_t blockNumber = 0;
+    stream->outputLength = 0;
+    stream->inputLength = 0;
+    stream->inputOffset = 0;
+    while (blockNumber < BGZF_BATCH_SIZE) {
+        unsigned char header[BGZF_HEADER_SIZE];
+        int64_t length = stream_readAll(stream, header, BGZF_HEADER_SIZE);
+        if (length == 0) {
+            stream->finished = 1;
+            break;
+        }
+        uint32_t blockLength = bgzf_getUint16(header + 16) + 1;
+        if (length < BGZF_HEADER_SIZE || memcmp(header, bgzf_eofBlock, 4) != 0
+                || memcmp(header + 10, bgzf_eofBlock + 10, 6) != 0
+                || blockLength < BGZF_HEADER_SIZE + BGZF_FOOTER_SIZE) {
+            stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "The gzip stream has a block that isn't a bgzip block");
+        }
+        BgzfBlock *block = &stream->blocks[blockNumber++];
+        block->offset = stream->outputLength;
+        block->length = blockLength - BGZF_HEADER_SIZE - BGZF_FOOTER_SIZE;
+        if (!stream_readFully(stream, stream->output + block->offset, blockLength - BGZF_HEADER_SIZE)) {
+            stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "The compressed stream ends before it was finished");
+        }
+        const unsigned char *footer = (unsigned char *) stream->output + block->offset + block->length;
+        block->crc = bgzf_getUint32(footer);
+        block->dataOffset = stream->inputLength;
+        block->dataLength = bgzf_getUint32(footer + 4);
+        if (block->dataLength > BGZF_MAX_BLOCK_SIZE) {
+            stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "The gzip stream has a corrupt bgzip block");
+        }
+        stream->outputLength += block->length;
+        stream->inputLength += block->dataLength;
+    }
+    stParallel_for(0, blockNumber, 1, bgzf_inflateBlocks, stream);
+    for (int64_t i = 0; i < blockNumber; i++) {
+        if (stream->blocks[i].failed) {
+            stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "The gzip stream has a corrupt bgzip block");
+        }
+    }
+}
+
+static int64_t gzipStream_read(stCompressionStream *stream, char *buffer, int64_t sizeInBytes) {
+    if (stream->layout == gzipMembers) {
+        return zlibStream_read(stream, buffer, sizeInBytes);
+    }
+    if (stream->layout == gzipPlain) {
+        return stream_readAll(stream, buffer, sizeInBytes);
+    }
+    int64_t bytesRead = 0;
+    while (bytesRead < sizeInBytes) {
+        if (stream->inputOffset == stream->inputLength) {
+            if (stream->finished) {
+                break;
+            }
+            gzipStream_decompressBlocks(stream);
+            continue;
+        }
+        int64_t length = stream->inputLength - stream->inputOffset;
+        length = length < sizeInBytes - bytesRead ? length : sizeInBytes - bytesRead;
+        memcpy(buffer + bytesRead, stream->input + stream->inputOffset, length);
+        stream->inputOffset += length;
+        bytesRead += length;
+    }
+    return bytesRead;
+}
+
+// Finds from its first bytes whether the data is in bgzip blocks, other gzip or not compressed.
+static void gzipStream_constructReader(stCompressionStream *stream) {
+    stream->peekLength = stream_readAll(stream, stream->peek, BGZF_HEADER_SIZE);
+    if (stream->peekLength < 2 || stream->peek[0] != 0x1f || stream->peek[1] != 0x8b) {
+        stream->layout = gzipPlain;
+    } else if (stream->peekLength == BGZF_HEADER_SIZE && memcmp(stream->peek, bgzf_eofBlock, 4) == 0
+            && memcmp(stream->peek + 10, bgzf_eofBlock + 10, 6) == 0) {
+        stream->layout = gzipBlocks;
+        stream->input = st_malloc(BGZF_BATCH_SIZE * BGZF_MAX_BLOCK_SIZE);
+        stream->output = st_malloc(BGZF_BATCH_SIZE * BGZF_MAX_BLOCK_SIZE);
+        stream->blocks = st_calloc(BGZF_BATCH_SIZE, sizeof(BgzfBlock));
+    } else {
+        stream->layout = gzipMembers;
+        stream->outputCapacity = Z_CHUNK;
+        stream->output = st_malloc(stream->outputCapacity);
+        if (inflateInit2(&stream->strm, 16 + MAX_WBITS) != Z_OK) {
+            stCompressionStream_destruct(stream);
+            stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Couldn't initialise zlib");
+        }
+    }
+}
+
+stCompressionStream *stCompressionStream_constructReader(stCompressionType type,
+        int64_t (*read)(void *buffer, int64_t sizeInBytes, void *extraArg), void *extraArg) {
+    stCompressionStream *stream = stream_construct(type);
+    stream->read = read;
+    stream->extraArg = extraArg;
+    if (type == stCompressionZlib) {
+        stream->outputCapacity = Z_CHUNK;
+        stream->output = st_malloc(stream->outputCapacity);
+        if (inflateInit(&stream->strm) != Z_OK) {
+            stCompressionStream_destruct(stream);
+            stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Couldn't initialise zlib");
+        }
+        return stream;
+    }
+    if (type == stCompressionGzip) {
+        gzipStream_constructReader(stream);
+        return stream;
+    }
+    int64_t header[2];
+    if (!stream_readFully(stream, header, sizeof(header)) || header[0] != ST_STREAM_MAGIC || header[1] <= 0
+            || header[1] > INT32_MAX) {
+        free(stream);
+        stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Not an lz4 compression stream");
+    }
+    stream->blockSize = header[1];
+    stream->input = st_malloc(stream->blockSize);
+    stream->output = st_malloc(stream->blockSize);
+    return stream;
+}
+
+int64_t stCompressionStream_read(stCompressionStream *stream, void *buffer, int64_t sizeInBytes) {
+    if (stream->read == NULL) {
+        stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Tried to read from a compression stream being written");
+    }
+    if (stream->type == stCompressionGzip) {
+        return gzipStream_read(stream, buffer, sizeInBytes);
+    }
+    return stream->type == stCompressionLZ4 ? lz4Stream_read(stream, buffer, sizeInBytes)
+            : zlibStream_read(stream, buffer, sizeInBytes);
+}
+
+void stCompressionStream_destruct(stCompressionStream *stream) {
+    if ((stream->type == stCompressionZlib || (stream->type == stCompressionGzip && stream->write == NULL
+            && stream->layout == gzipMembers)) && stream->output != NULL) {
+        if (stream->write != NULL) {
+            (void) deflateEnd(&stream->strm);
+        } else {
+            (void) inflateEnd(&stream->strm);
+        }
+    }
+    if (stream->destructExtraArg != NULL) {
+        stream->destructExtraArg(stream->extraArg);
+    }
+    free(stream->input);
+    free(stream->output);
+    free(stream->blocks);
+    free(stream);
+}
+
+static void file_write(const void *data, int64_t sizeInBytes, void *file) {
+    if (fwrite(data, 1, sizeInBytes, file) != (size_t) sizeInBytes) {
+        stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Couldn't write %" PRIi64 " bytes of a compressed stream",
+                   sizeInBytes);
+    }
+}
+
+static int64_t file_read(void *buffer, int64_t sizeInBytes, void *file) {
+    int64_t length = fread(buffer, 1, sizeInBytes, file);
+    if (length < sizeInBytes && ferror(file)) {
+        stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Couldn't read a compressed stream");
+    }
+    return length;
+}
+
+stCompressionStream *stCompressionStream_constructFileWriter(stCompressionType type, int64_t level, FILE *file) {
+    return stCompressionStream_constructWriter(type, level, file_write, file);
+}
+
+stCompressionStream *stCompressionStream_constructFileReader(stCompressionType type, FILE *file) {
+    return stCompressionStream_constructReader(type, file_read, file);
+}
+
+// Reads from the stream for a file, returning -1 if the stream throws, which sets the file's error indicator.
+static int64_t stream_readForFile(stCompressionStream *stream, char *buffer, int64_t sizeInBytes) {
+    int64_t length = -1;
+    stTry {
+        length = stCompressionStream_read(stream, buffer, sizeInBytes);
+    } stCatch(except) {
+        st_logCritical("Reading a compressed file failed: %s\n", stExcept_getMsg(except));
+        errno = EIO;
+    } stTryEnd;
+    return length;
+}
+
+static int stream_fileClose(void *cookie) {
+    stCompressionStream_destruct(cookie);
+    return 0;
+}
+
+#ifdef __APPLE__
+
+static int stream_fileRead(void *cookie, char *buffer, int sizeInBytes) {
+    return stream_readForFile(cookie, buffer, sizeInBytes);
+}
+
+FILE *stCompressionStream_openAsFile(stCompressionStream *stream) {
+    return funopen(stream, stream_fileRead, NULL, NULL, stream_fileClose);
+}
+
+#else
+
+static ssize_t stream_fileRead(void *cookie, char *buffer, size_t sizeInBytes) {
+    return stream_readForFile(cookie, buffer, sizeInBytes);
+}
+
+FILE *stCompressionStream_openAsFile(stCompressionStream *stream) {
+    cookie_io_functions_t functions = { .read = stream_fileRead, .close = stream_fileClose };
+    return fopencookie(stream, "r", functions);
+}
+
+#endif
+
+static void file_close(void *file) {
+    fclose(file);
+}
+
+FILE *stCompressionStream_openFile(const char *fileName) {
+    FILE *file = fopen(fileName, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+    stCompressionStream *stream = NULL;
+    stTry {
+        stream = stCompressionStream_constructFileReader(stCompressionGzip, file);
+    } stCatch(except) {
+        fclose(file);
+        stThrow(except);
+    } stTryEnd;
+    stream->destructExtraArg = file_close;
+    FILE *streamFile = stCompressionStream_openAsFile(stream);
+    if (streamFile == NULL) {
+        stCompressionStream_destruct(stream);
+    }
+    return streamFile;
+}
+
+// The records of a stream stored in a database, and for a reader the record being read.
+typedef struct _kvStream {
+    stKVDatabase *database;
+    int64_t key; // The key of the next record.
+    char *record;
+    int64_t recordSize;
+    int64_t recordOffset;
+} KVStream;
+
+static void kvStream_destruct(void *extraArg) {
+    KVStream *kvStream = extraArg;
+    free(kvStream->record);
+    free(kvStream);
+}
+
+static void kvStream_write(const void *data, int64_t sizeInBytes, void *extraArg) {
+    KVStream *kvStream = extraArg;
+    stKVDatabase_setRecord(kvStream->database, kvStream->key++, data, sizeInBytes);
+}
+
+static int64_t kvStream_read(void *buffer, int64_t sizeInBytes, void *extraArg) {
+    KVStream *kvStream = extraArg;
+    if (kvStream->recordOffset == kvStream->recordSize) {
+        free(kvStream->record);
+        kvStream->record = stKVDatabase_getRecord2(kvStream->database, kvStream->key++, &kvStream->recordSize);
+        kvStream->recordOffset = 0;
+        if (kvStream->record == NULL) {
+            kvStream->recordSize = 0;
+            return 0;
+        }
+    }
+    int64_t length = kvStream->recordSize - kvStream->recordOffset;
+    length = length < sizeInBytes ? length : sizeInBytes;
+    memcpy(buffer, kvStream->record + kvStream->recordOffset, length);
+    kvStream->recordOffset += length;
+    return length;
+}
+
+static KVStream *kvStream_construct(stKVDatabase *database, int64_t firstKey) {
+    KVStream *kvStream = st_calloc(1, sizeof(KVStream));
+    kvStream->database = database;
+    kvStream->key = firstKey;
+    return kvStream;
+}
+
+stCompressionStream *stCompressionStream_constructKVWriter(stCompressionType type, int64_t level,
+                                                           stKVDatabase *database, int64_t firstKey) {
+    KVStream *kvStream = kvStream_construct(database, firstKey);
+    stCompressionStream *stream = NULL;
+    stTry {
+        stream = stCompressionStream_constructWriter(type, level, kvStream_write, kvStream);
+    } stCatch(except) {
+        kvStream_destruct(kvStream);
+        stThrow(except);
+    } stTryEnd;
+    stream->destructExtraArg = kvStream_destruct;
+    return stream;
+}
+
+stCompressionStream *stCompressionStream_constructKVReader(stCompressionType type, stKVDatabase *database,
+                                                           int64_t firstKey) {
+    KVStream *kvStream = kvStream_construct(database, firstKey);
+    stCompressionStream *stream = NULL;
+    stTry {
+        stream = stCompressionStream_constructReader(type, kvStream_read, kvStream);
+    } stCatch(except) {
+        kvStream_destruct(kvStream);
+        stThrow(except);
+    } stTryEnd;
+    stream->destructExtraArg = kvStream_destruct;
+    return stream;
+}
+
+/*
+ * Dictionaries.
+ */
+
+stCompressionDictionary *stCompressionDictionary_construct(const void *data, int64_t sizeInBytes) {
+    if (sizeInBytes > ST_COMPRESSION_DICTIONARY_MAX_SIZE) { // Only the end of the data is used.
+        data = (const char *) data + sizeInBytes - ST_COMPRESSION_DICTIONARY_MAX_SIZE;
+        sizeInBytes = ST_COMPRESSION_DICTIONARY_MAX_SIZE;
+    }
+    stCompressionDictionary *dictionary = st_malloc(sizeof(stCompressionDictionary));
+    dictionary->lz4 = LZ4_createDictionary(data, sizeInBytes);
+    if (dictionary->lz4 == NULL) {
+        st_errAbort("Could not allocate memory for a compression dictionary");
+    }
+    return dictionary;
+}
+
+void stCompressionDictionary_destruct(stCompressionDictionary *dictionary) {
+    LZ4_freeDictionary(dictionary->lz4);
+    free(dictionary);
+}
+
+const void *stCompressionDictionary_getData(const stCompressionDictionary *dictionary, int64_t *sizeInBytes) {
+    int size;
+    const char *data = LZ4_getDictionaryContent(dictionary->lz4, &size);
+    *sizeInBytes = size;
+    return data;
+}
+
+#define ST_DICTIONARY_KMER 8 // The length of the substrings counted in the samples.
+#define ST_DICTIONARY_SEGMENT 1024 // The length of the pieces of the samples the dictionary is made from.
+#define ST_DICTIONARY_TABLE_BITS 20
+
+typedef struct _dictionarySegment {
+    const char *start;
+    int64_t length;
+    int64_t score;
+} DictionarySegment;
+
+static uint32_t dictionary_hashKmer(const char *kmer) {
+    uint64_t i;
+    memcpy(&i, kmer, sizeof(uint64_t));
+    return (uint32_t) ((i * 0x9E3779B97F4A7C15ULL) >> (64 - ST_DICTIONARY_TABLE_BITS));
+}
+
+// The number of samples that share each substring of the segment, summed over its substrings.
+static int64_t dictionary_scoreSegment(const DictionarySegment *segment, const uint32_t *counts) {
+    int64_t score = 0;
+    for (int64_t i = 0; i + ST_DICTIONARY_KMER <= segment->length; i++) {
+        uint32_t count = counts[dictionary_hashKmer(segment->start + i)];
+        score += count > 1 ? count : 0;
+    }
+    return score;
+}
+
+static int dictionary_cmpSegments(const void *a, const void *b) {
+    int64_t i = ((const DictionarySegment *) a)->score, j = ((const DictionarySegment *) b)->score;
+    return i > j ? -1 : (i < j ? 1 : 0);
+}
+
+stCompressionDictionary *stCompressionDictionary_train(const void **samples, const int64_t *sampleSizes,
+                                                       int64_t numberOfSamples, int64_t maxSizeInBytes) {
+    if (maxSizeInBytes <= 0 || maxSizeInBytes > ST_COMPRESSION_DICTIONARY_MAX_SIZE) {
+        maxSizeInBytes = ST_COMPRESSION_DICTIONARY_MAX_SIZE;
+    }
+    // Count the samples each substring occurs in, up to collisions in the table.
+    int64_t tableSize = (int64_t) 1 << ST_DICTIONARY_TABLE_BITS;
+    uint32_t *counts = st_calloc(tableSize, sizeof(uint32_t));
+    uint32_t *lastSample = st_calloc(tableSize, sizeof(uint32_t));
+    int64_t numberOfSegments = 0;
+    for (int64_t i = 0; i < numberOfSamples; i++) {
+        for (int64_t j = 0; j + ST_DICTIONARY_KMER <= sampleSizes[i]; j++) {
+            uint32_t h = dictionary_hashKmer((const char *) samples[i] + j);
+            if (lastSample[h] != i + 1) {
+                lastSample[h] = i + 1;
+                counts[h]++;
+            }
+        }
+        numberOfSegments += (sampleSizes[i] + ST_DICTIONARY_SEGMENT - 1) / ST_DICTIONARY_SEGMENT;
+    }
+    free(lastSample);
+
+    // Split the samples into segments, and take those with the most shared content first. Once a
+    // segment is taken its substrings no longer count, so the same content isn't taken twice. As
+    // scores only go down, a segment is taken if its current score is still the best, otherwise it
+    // is moved back to its new place in the order.
+    DictionarySegment *segments = st_malloc((numberOfSegments + 1) * sizeof(DictionarySegment));
+    int64_t k = 0;
+    for (int64_t i = 0; i < numberOfSamples; i++) {
+        for (int64_t j = 0; j < sampleSizes[i]; j += ST_DICTIONARY_SEGMENT) {
+            DictionarySegment *segment = &segments[k++];
+            segment->start = (const char *) samples[i] + j;
+            segment->length = sampleSizes[i] - j < ST_DICTIONARY_SEGMENT ? sampleSizes[i] - j : ST_DICTIONARY_SEGMENT;
+            segment->score = dictionary_scoreSegment(segment, counts);
+        }
+    }
+    qsort(segments, numberOfSegments, sizeof(DictionarySegment), dictionary_cmpSegments);
+    char *data = st_malloc(maxSizeInBytes);
+    int64_t size = 0;
+    for (int64_t i = 0; i < numberOfSegments && size < maxSizeInBytes;) {
+        DictionarySegment *segment = &segments[i];
+        int64_t score = segment->score == 0 ? 0 : dictionary_scoreSegment(segment, counts);
+        if (score == 0) {
+            i++;
+            continue;
+        }
+        if (i + 1 < numberOfSegments && score < segments[i + 1].score) {
+            DictionarySegment moved = *segment;
+            moved.score = score;
+            int64_t j = i + 1;
+            while (j < numberOfSegments && segments[j].score > score) {
+                j++;
+            }
+            memmove(segment, segment + 1, (j - i - 1) * sizeof(DictionarySegment));
+            segments[j - 1] = moved;
+            continue;
+        }
+        i++;
+        for (int64_t j = 0; j + ST_DICTIONARY_KMER <= segment->length; j++) {
+            counts[dictionary_hashKmer(segment->start + j)] = 0;
+        }
+        // The best segments go at the end, nearest the data being compressed.
+        int64_t length = segment->length < maxSizeInBytes - size ? segment->length : maxSizeInBytes - size;
+        size += length;
+        memcpy(data + maxSizeInBytes - size, segment->start, length);
+    }
+    stCompressionDictionary *dictionary = stCompressionDictionary_construct(data + maxSizeInBytes - size, size);
+    free(data);
+    free(segments);
+    free(counts);
+    return dictionary;
+}
+
+/*
+ * A record compressed with a dictionary is a varint holding its size shifted left by one, with the
+ * lowest bit set if the record is stored uncompressed, followed by the stored record.
+ */
+
+void *stCompression_compressWithDictionary(const stCompressionDictionary *dictionary, const void *data,
+                                           int64_t sizeInBytes, int64_t *compressedSizeInBytes, int64_t level) {
+    if (sizeInBytes < 0 || sizeInBytes > ST_LZ4_CHUNK_SIZE) {
+        stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "Can't compress %" PRIi64 " bytes with a dictionary", sizeInBytes);
+    }
+    char *compressed = st_malloc(10 + sizeInBytes);
+    int64_t headerSize = 0;
+    int64_t length = sizeInBytes == 0 ? 0 : lz4_compressBlock(dictionary, data, compressed + 10, sizeInBytes,
+                                                               sizeInBytes - 1, level);
+    uint64_t header = ((uint64_t) sizeInBytes << 1) | (length <= 0);
+    do {
+        compressed[headerSize++] = (char) ((header & 0x7f) | (header >= 0x80 ? 0x80 : 0));
+        header >>= 7;
+    } while (header > 0);
+    if (length <= 0) {
+        memcpy(compressed + headerSize, data, sizeInBytes);
+        length = sizeInBytes;
+    } else {
+        memmove(compressed + headerSize, compressed + 10, length);
+    }
+    *compressedSizeInBytes = headerSize + length;
+    return st_realloc(compressed, *compressedSizeInBytes);
+}
+
+void *stCompression_decompressWithDictionary(const stCompressionDictionary *dictionary, const void *compressedData,
+                                             int64_t compressedSizeInBytes, int64_t *sizeInBytes) {
+    const unsigned char *compressed = compressedData;
+    uint64_t header = 0;
+    int64_t headerSize = 0;
+    do {
+        if (headerSize == compressedSizeInBytes || headerSize == 10) {
+            stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "The dictionary compressed data has an invalid header");
+        }
+        header |= (uint64_t) (compressed[headerSize] & 0x7f) << (7 * headerSize);
+    } while (compressed[headerSize++] & 0x80);
+    int64_t size = header >> 1, length = compressedSizeInBytes - headerSize;
+    if (size > ST_LZ4_CHUNK_SIZE || ((header & 1) && length != size)) {
+        stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "The dictionary compressed data has an invalid header");
+    }
+    char *data = st_malloc(size > 0 ? size : 1);
+    if (header & 1) {
+        memcpy(data, compressed + headerSize, size);
+    } else if (LZ4_uncompress_usingDict(dictionary->lz4, (const char *) compressed + headerSize, data, length, size)
+            != size) {
+        free(data);
+        stThrowNew(ST_COMPRESSION_EXCEPTION_ID, "The dictionary compressed data is corrupt");
+    }
+    *sizeInBytes = size;
+    return data;
+}
@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * sonLibFastaIndex.c
+ *
+ * The index gives, for each sequence, its length, the offset of its first base in the file,
+ * the number of bases in each line and the number of bytes in each line, including its line
+ * ending. As every line of a sequence but the last is full, the offset of any base follows
+ * from these, and a subsequence is copied from the mapped file a line at a time.
+ */
+
+// mmap is POSIX, hidden by -std=c99.
+#if defined(__linux__) || (defined(__unix__) && !defined(__APPLE__))
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#endif
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "sonLibGlobalsInternal.h"
+
+const char *ST_FASTA_INDEX_EXCEPTION_ID = "ST_FASTA_INDEX_EXCEPTION";
+
+typedef struct _fastaIndexEntry {
+    char *name;
+    int64_t length;
+    int64_t offset;
+    int64_t lineBases;
+    int64_t lineWidth;
+} FastaIndexEntry;
+
+struct _stFastaIndex {
+    char *fastaFile;
+    char *map;
+    int64_t mapLength;
+    stList *entries; // In the order of the file.
+    stHash *entriesByName;
+};
+
+static void fastaIndexEntry_destruct(FastaIndexEntry *entry) {
+    free(entry->name);
+    free(entry);
+}
+
+static void addEntry(stFastaIndex *index, char *name, int64_t length, int64_t offset, int64_t lineBases,
+                     int64_t lineWidth) {
+    if (stHash_search(index->entriesByName, name) != NULL) {
+        stExcept *except = stExcept_new(ST_FASTA_INDEX_EXCEPTION_ID, "The sequence name %s is used twice in %s",
+                                        name, index->fastaFile);
+        free(name);
+        stThrow(except);
+    }
+    FastaIndexEntry *entry = st_malloc(sizeof(FastaIndexEntry));
+    entry->name = name;
+    entry->length = length;
+    entry->offset = offset;
+    entry->lineBases = lineBases;
+    entry->lineWidth = lineWidth;
+    stList_append(index->entries, entry);
+    stHash_insert(index->entriesByName, entry->name, entry);
+}
+
+/*
+ * Builds the index in one pass over the mapped file.
+ */
+static void buildIndex(stFastaIndex *index) {
+    const char *c = index->map, *end = index->map + index->mapLength;
+    while (c < end && *c != '>') { // Anything before the first header is ignored.
+        const char *lineEnd = memchr(c, '\n', end - c);
+        c = lineEnd == NULL ? end : lineEnd + 1;
+    }
+    while (c < end) {
+        const char *nameEnd = ++c;
+        while (nameEnd < end && !isspace((unsigned char) *nameEnd)) {
+            nameEnd++;
+        }
+        char *name = stString_getSubString(c, 0, nameEnd - c);
+        const char *lineEnd = memchr(nameEnd, '\n', end - nameEnd);
+        c = lineEnd == NULL ? end : lineEnd + 1;
+        int64_t offset = c - index->map, length = 0, lineBases = 0, lineWidth = 0;
+        bool ended = false, consistent = true; // Ended by a short or blank line, which only blank lines may follow.
+        while (c < end && *c != '>') {
+            lineEnd = memchr(c, '\n', end - c);
+            int64_t width = lineEnd == NULL ? end - c : lineEnd + 1 - c;
+            int64_t bases = lineEnd == NULL ? width : width - 1;
+            if (bases > 0 && c[bases - 1] == '\r') {
+                bases--;
+            }
+            if (bases > 0 && lineBases == 0 && !ended) {
+                lineBases = bases;
+                lineWidth = width;
+            } else if (bases > 0 && (ended || bases > lineBases
+                                     || (bases == lineBases && lineEnd != NULL && width != lineWidth))) {
+                consistent = false;
+            }
+            ended = ended || bases < lineBases || bases == 0;
+            length += bases;
+            c += width;
+        }
+        if (!consistent) {
+            stExcept *except = stExcept_new(ST_FASTA_INDEX_EXCEPTION_ID,
+                                            "The lines of sequence %s in %s differ in length", name, index->fastaFile);
+            free(name);
+            stThrow(except);
+        }
+        addEntry(index, name, length, offset, lineBases, lineWidth);
+    }
+}
+
+static void writeIndex(stFastaIndex *index, const char *indexFile) {
+    FILE *file = fopen(indexFile, "w");
+    if (file == NULL) { // The index is only kept in memory if it can't be written.
+        return;
+    }
+    for (int64_t i = 0; i < stList_length(index->entries); i++) {
+        FastaIndexEntry *entry = stList_get(index->entries, i);
+        fprintf(file, "%s\t%" PRIi64 "\t%" PRIi64 "\t%" PRIi64 "\t%" PRIi64 "\n", entry->name, entry->length,
+                entry->offset, entry->lineBases, entry->lineWidth);
+    }
+    fclose(file);
+}
+
+static void readIndex(stFastaIndex *index, const char *indexFile) {
+    FILE *file = st_fopen(indexFile, "r");
+    char *line;
+    while ((line = stFile_getLineFromFile(file)) != NULL) {
+        char *tab = strchr(line, '\t');
+        int64_t length, offset, lineBases, lineWidth;
+        if (tab == NULL || sscanf(tab + 1, "%" SCNi64 "\t%" SCNi64 "\t%" SCNi64 "\t%" SCNi64, &length, &offset,
+                                  &lineBases, &lineWidth) != 4) {
+            free(line);
+            fclose(file);
+            stThrowNew(ST_FASTA_INDEX_EXCEPTION_ID, "Got a malformed line in the fasta index %s", indexFile);
+        }
+        // Check the sequence lies within the file, so reading it can't stray out of the mapping.
+        if (length < 0 || (length > 0 && (offset < 0 || lineBases <= 0 || lineWidth < lineBases
+                || offset + ((length - 1) / lineBases) * lineWidth + (length - 1) % lineBases >= index->mapLength))) {
+            free(line);
+            fclose(file);
+            stThrowNew(ST_FASTA_INDEX_EXCEPTION_ID, "The fasta index %s doesn't match %s", indexFile, index->fastaFile);
+        }
+        addEntry(index, stString_getSubString(line, 0, tab - line), length, offset, lineBases, lineWidth);
+        free(line);
+    }
+    fclose(file);
+}
+
+static void mapFile(stFastaIndex *index, struct stat *fileStat) {
+    int fd = open(index->fastaFile, O_RDONLY);
+    if (fd < 0 || fstat(fd, fileStat) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        stThrowNew(ST_FASTA_INDEX_EXCEPTION_ID, "Opening fasta file %s failed: %s", index->fastaFile, strerror(errno));
+    }
+    index->mapLength = fileStat->st_size;
+    if (index->mapLength > 0) { // Empty files can't be mapped.
+        index->map = mmap(NULL, index->mapLength, PROT_READ, MAP_SHARED, fd, 0);
+        if (index->map == MAP_FAILED) {
+            index->map = NULL;
+            close(fd);
+            stThrowNew(ST_FASTA_INDEX_EXCEPTION_ID, "Mapping fasta file %s failed: %s", index->fastaFile,
+                       strerror(errno));
+        }
+    }
+    close(fd); // The mapping holds its own reference to the file.
+}
+
+stFastaIndex *stFastaIndex_construct(const char *fastaFile) {
+    stFastaIndex *index = st_calloc(1, sizeof(stFastaIndex));
+    index->fastaFile = stString_copy(fastaFile);
+    index->entries = stList_construct3(0, (void (*)(void *)) fastaIndexEntry_destruct);
+    index->entriesByName = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, NULL, NULL);
+    char *indexFile = stString_print("%s.fai", fastaFile);
+    stTry {
+        struct stat fastaStat, indexStat;
+        mapFile(index, &fastaStat);
+        if (stat(indexFile, &indexStat) == 0 && indexStat.st_mtime >= fastaStat.st_mtime) {
+            readIndex(index, indexFile);
+        } else {
+            buildIndex(index);
+            writeIndex(index, indexFile);
+        }
+    } stCatch(except) {
+        free(indexFile);
+        stFastaIndex_destruct(index);
+        stThrow(except);
+    } stTryEnd;
+    free(indexFile);
+    return index;
+}
+
+void stFastaIndex_destruct(stFastaIndex *index) {
+    if (index->map != NULL) {
+        munmap(index->map, index->mapLength);
+    }
+    stHash_destruct(index->entriesByName);
+    stList_destruct(index->entries);
+    free(index->fastaFile);
+    free(index);
+}
+
+int64_t stFastaIndex_getNumberOfSequences(stFastaIndex *index) {
+    return stList_length(index->entries);
+}
+
+const char *stFastaIndex_getName(stFastaIndex *index, int64_t i) {
+    return ((FastaIndexEntry *) stList_get(index->entries, i))->name;
+}
+
+bool stFastaIndex_containsSequence(stFastaIndex *index, const char *name) {
+    return stHash_search(index->entriesByName, (void *) name) != NULL;
+}
+
+static FastaIndexEntry *getEntry(stFastaIndex *index, const char *name) {
+    FastaIndexEntry *entry = stHash_search(index->entriesByName, (void *) name);
+    if (entry == NULL) {
+        stThrowNew(ST_FASTA_INDEX_EXCEPTION_ID, "There is no sequence %s in %s", name, index->fastaFile);
+    }
+    return entry;
+}
+
+int64_t stFastaIndex_getLength(stFastaIndex *index, const char *name) {
+    return getEntry(index, name)->length;
+}
+
+/*
+ * Returns the entry of the named sequence, checking that the range is within it.
+ */
+static FastaIndexEntry *getEntryForRange(stFastaIndex *index, const char *name, int64_t start, int64_t length) {
+    FastaIndexEntry *entry = getEntry(index, name);
+    // Compared without adding, so that a huge length can't overflow.
+    if (start < 0 || length < 0 || start > entry->length || length > entry->length - start) {
+        stThrowNew(ST_FASTA_INDEX_EXCEPTION_ID, "The range %" PRIi64 " of length %" PRIi64 " is outside sequence %s, "
+                   "of length %" PRIi64, start, length, name, entry->length);
+    }
+    return entry;
+}
+
+static void copyRange(stFastaIndex *index, FastaIndexEntry *entry, int64_t start, int64_t length, char *buffer) {
+    while (length > 0) {
+        int64_t column = start % entry->lineBases;
+        int64_t bases = entry->lineBases - column < length ? entry->lineBases - column : length;
+        memcpy(buffer, index->map + entry->offset + (start / entry->lineBases) * entry->lineWidth + column, bases);
+        buffer += bases;
+        start += bases;
+        length -= bases;
+    }
+}
+
+void stFastaIndex_copySubsequence(stFastaIndex *index, const char *name, int64_t start, int64_t length,
+                                  char *buffer) {
+    copyRange(index, getEntryForRange(index, name, start, length), start, length, buffer);
+}
+
+char *stFastaIndex_getSubsequence(stFastaIndex *index, const char *name, int64_t start, int64_t length) {
+    // Checked before allocating, so a bad range throws rather than failing in the allocator.
+    FastaIndexEntry *entry = getEntryForRange(index, name, start, length);
+    char *subsequence = st_malloc(length + 1);
+    copyRange(index, entry, start, length, subsequence);
+    subsequence[length] = '\0';
+    return subsequence;
+}
+
+char *stFastaIndex_getSequence(stFastaIndex *index, const char *name) {
+    return stFastaIndex_getSubsequence(index, name, 0, stFastaIndex_getLength(index, name));
+}
@@ -0,0 +1,306 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * sonLibFrozenTree.c
+ *
+ * Each property of the nodes is an array indexed by the preorder number of the node, so a
+ * query over a subtree reads consecutive elements of the arrays it needs and nothing else.
+ *
+ * The LCA index uses that for nodes i < j the lowest common ancestor is the parent of the
+ * shallowest node numbered i + 1 to j: that node is the child of the LCA whose subtree holds j.
+ * A sparse table gives, for each k and level l, the shallowest node numbered k to k + 2^l - 1,
+ * and any range is covered by two of these, overlapping.
+ */
+
+#include "sonLibGlobalsInternal.h"
+
+struct _stFrozenTree {
+    int64_t nodeNumber;
+    int64_t *parents;
+    int64_t *firstChildren;
+    int64_t *nextSiblings;
+    int64_t *depths;
+    int64_t *subtreeSizes;
+    int64_t *subtreeLeafNumbers;
+    int64_t *labelOffsets; // -1 for a node without a label.
+    double *branchLengths;
+    double *rootDistances; // The sum of the branch lengths from the root, used with the index.
+    char *labels; // The labels, each terminated by '\0'.
+    stTree **stTrees;
+    stIntHash *stTreeToIndex; // Keyed by the node pointer, with values of index + 1 so 0 (NULL) is absent.
+    int64_t levelNumber; // The number of levels in the sparse table, 0 if there is no LCA index.
+    int64_t **shallowest; // shallowest[l][k] is the shallowest of nodes k to k + 2^l - 1.
+    int8_t *floorLog2s; // floorLog2s[k] = floor(log2(k)), for k from 1 to n.
+};
+
+static void buildLCAIndex(stFrozenTree *tree) {
+    int64_t n = tree->nodeNumber;
+    tree->floorLog2s = st_malloc((n + 1) * sizeof(int8_t));
+    tree->floorLog2s[0] = 0;
+    tree->floorLog2s[1] = 0;
+    for (int64_t k = 2; k <= n; k++) {
+        tree->floorLog2s[k] = tree->floorLog2s[k / 2] + 1;
+    }
+    tree->levelNumber = tree->floorLog2s[n] + 1;
+    tree->shallowest = st_malloc(tree->levelNumber * sizeof(int64_t *));
+    tree->shallowest[0] = st_malloc(n * sizeof(int64_t));
+    for (int64_t k = 0; k < n; k++) {
+        tree->shallowest[0][k] = k;
+    }
+    for (int64_t l = 1; l < tree->levelNumber; l++) {
+        int64_t half = ((int64_t) 1) << (l - 1), length = n - 2 * half + 1;
+        int64_t *previous = tree->shallowest[l - 1], *level = st_malloc(length * sizeof(int64_t));
+        for (int64_t k = 0; k < length; k++) {
+            int64_t a = previous[k], b = previous[k + half];
+            level[k] = tree->depths[a] <= tree->depths[b] ? a : b;
+        }
+        tree->shallowest[l] = level;
+    }
+}
+
+stFrozenTree *stFrozenTree_construct(stTree *tree) {
+    return stFrozenTree_construct2(tree, false);
+}
+
+stFrozenTree *stFrozenTree_construct2(stTree *tree, bool indexLCAs) {
+    stFrozenTree *frozenTree = st_malloc(sizeof(stFrozenTree));
+
+    // Number the nodes in preorder, pushing the children in reverse so the first is popped first.
+    stList *nodes = stList_construct();
+    stList *stack = stList_construct();
+    stList_append(stack, tree);
+    int64_t labelsLength = 0;
+    while (stList_length(stack) > 0) {
+        stTree *node = stList_pop(stack);
+        stList_append(nodes, node);
+        if (stTree_getLabel(node) != NULL) {
+            labelsLength += strlen(stTree_getLabel(node)) + 1;
+        }
+        for (int64_t i = stTree_getChildNumber(node) - 1; i >= 0; i--) {
+            stList_append(stack, stTree_getChild(node, i));
+        }
+    }
+    stList_destruct(stack);
+
+    int64_t n = stList_length(nodes);
+    frozenTree->nodeNumber = n;
+    frozenTree->parents = st_malloc(n * sizeof(int64_t));
+    frozenTree->firstChildren = st_malloc(n * sizeof(int64_t));
+    frozenTree->nextSiblings = st_malloc(n * sizeof(int64_t));
+    frozenTree->depths = st_malloc(n * sizeof(int64_t));
+    frozenTree->subtreeSizes = st_malloc(n * sizeof(int64_t));
+    frozenTree->subtreeLeafNumbers = st_malloc(n * sizeof(int64_t));
+    frozenTree->labelOffsets = st_malloc(n * sizeof(int64_t));
+    frozenTree->branchLengths = st_malloc(n * sizeof(double));
+    frozenTree->rootDistances = st_malloc(n * sizeof(double));
+    frozenTree->labels = st_malloc(labelsLength > 0 ? labelsLength : 1);
+    frozenTree->stTrees = st_malloc(n * sizeof(stTree *));
+    frozenTree->stTreeToIndex = stIntHash_construct();
+    stIntHash_reserve(frozenTree->stTreeToIndex, n);
+
+    int64_t labelOffset = 0;
+    for (int64_t i = 0; i < n; i++) {
+        stTree *node = stList_get(nodes, i);
+        frozenTree->stTrees[i] = node;
+        stIntHash_insert(frozenTree->stTreeToIndex, (int64_t) (intptr_t) node, (void *) (intptr_t) (i + 1));
+        frozenTree->firstChildren[i] = -1;
+        frozenTree->nextSiblings[i] = -1;
+        frozenTree->branchLengths[i] = stTree_getBranchLength(node);
+        const char *label = stTree_getLabel(node);
+        if (label != NULL) {
+            int64_t length = strlen(label) + 1;
+            memcpy(frozenTree->labels + labelOffset, label, length);
+            frozenTree->labelOffsets[i] = labelOffset;
+            labelOffset += length;
+        } else {
+            frozenTree->labelOffsets[i] = -1;
+        }
+        // A parent comes before its children, so its number is already known.
+        if (i == 0) {
+            frozenTree->parents[i] = -1;
+            frozenTree->depths[i] = 0;
+            frozenTree->rootDistances[i] = 0.0;
+        } else {
+            int64_t parent = stFrozenTree_getIndex(frozenTree, stTree_getParent(node));
+            frozenTree->parents[i] = parent;
+            frozenTree->depths[i] = frozenTree->depths[parent] + 1;
+            frozenTree->rootDistances[i] = frozenTree->rootDistances[parent] + frozenTree->branchLengths[i];
+        }
+    }
+    stList_destruct(nodes);
+
+    // Link the children, and sum the subtrees from the bottom up. Going down from n - 1 each
+    // node's children are seen last to first, so each is put in front of the ones after it.
+    for (int64_t i = 0; i < n; i++) {
+        frozenTree->subtreeSizes[i] = 1;
+        frozenTree->subtreeLeafNumbers[i] = 0;
+    }
+    for (int64_t i = n - 1; i >= 0; i--) {
+        if (frozenTree->firstChildren[i] == -1) {
+            frozenTree->subtreeLeafNumbers[i] = 1;
+        }
+        int64_t parent = frozenTree->parents[i];
+        if (parent != -1) {
+            frozenTree->nextSiblings[i] = frozenTree->firstChildren[parent];
+            frozenTree->firstChildren[parent] = i;
+            frozenTree->subtreeSizes[parent] += frozenTree->subtreeSizes[i];
+            frozenTree->subtreeLeafNumbers[parent] += frozenTree->subtreeLeafNumbers[i];
+        }
+    }
+
+    frozenTree->levelNumber = 0;
+    frozenTree->shallowest = NULL;
+    frozenTree->floorLog2s = NULL;
+    if (indexLCAs) {
+        buildLCAIndex(frozenTree);
+    }
+    return frozenTree;
+}
+
+void stFrozenTree_destruct(stFrozenTree *tree) {
+    free(tree->parents);
+    free(tree->firstChildren);
+    free(tree->nextSiblings);
+    free(tree->depths);
+    free(tree->subtreeSizes);
+    free(tree->subtreeLeafNumbers);
+    free(tree->labelOffsets);
+    free(tree->branchLengths);
+    free(tree->rootDistances);
+    for (int64_t l = 0; l < tree->levelNumber; l++) {
+        free(tree->shallowest[l]);
+    }
+    free(tree->shallowest);
+    free(tree->floorLog2s);
+    free(tree->labels);
+    free(tree->stTrees);
+    stIntHash_destruct(tree->stTreeToIndex);
+    free(tree);
+}
+
+int64_t stFrozenTree_getNodeNumber(stFrozenTree *tree) {
+    return tree->nodeNumber;
+}
+
+int64_t stFrozenTree_getLeafNumber(stFrozenTree *tree) {
+    return tree->subtreeLeafNumbers[0];
+}
+
+stTree *stFrozenTree_getStTree(stFrozenTree *tree, int64_t i) {
+    assert(i >= 0 && i < tree->nodeNumber);
+    return tree->stTrees[i];
+}
+
+int64_t stFrozenTree_getIndex(stFrozenTree *tree, stTree *node) {
+    return (intptr_t) stIntHash_search(tree->stTreeToIndex, (int64_t) (intptr_t) node) - 1;
+}
+
+int64_t stFrozenTree_getParent(stFrozenTree *tree, int64_t i) {
+    assert(i >= 0 && i < tree->nodeNumber);
+    return tree->parents[i];
+}
+
+int64_t stFrozenTree_getFirstChild(stFrozenTree *tree, int64_t i) {
+    assert(i >= 0 && i < tree->nodeNumber);
+    return tree->firstChildren[i];
+}
+
+int64_t stFrozenTree_getNextSibling(stFrozenTree *tree, int64_t i) {
+    assert(i >= 0 && i < tree->nodeNumber);
+    return tree->nextSiblings[i];
+}
+
+int64_t stFrozenTree_getChildNumber(stFrozenTree *tree, int64_t i) {
+    int64_t childNumber = 0;
+    for (int64_t child = stFrozenTree_getFirstChild(tree, i); child != -1; child = tree->nextSiblings[child]) {
+        childNumber++;
+    }
+    return childNumber;
+}
+
+bool stFrozenTree_isLeaf(stFrozenTree *tree, int64_t i) {
+    return stFrozenTree_getFirstChild(tree, i) == -1;
+}
+
+const char *stFrozenTree_getLabel(stFrozenTree *tree, int64_t i) {
+    assert(i >= 0 && i < tree->nodeNumber);
+    return tree->labelOffsets[i] == -1 ? NULL : tree->labels + tree->labelOffsets[i];
+}
+
+double stFrozenTree_getBranchLength(stFrozenTree *tree, int64_t i) {
+    assert(i >= 0 && i < tree->nodeNumber);
+    return tree->branchLengths[i];
+}
+
+int64_t stFrozenTree_getDepth(stFrozenTree *tree, int64_t i) {
+    assert(i >= 0 && i < tree->nodeNumber);
+    return tree->depths[i];
+}
+
+int64_t stFrozenTree_getSubtreeSize(stFrozenTree *tree, int64_t i) {
+    assert(i >= 0 && i < tree->nodeNumber);
+    return tree->subtreeSizes[i];
+}
+
+int64_t stFrozenTree_getSubtreeLeafNumber(stFrozenTree *tree, int64_t i) {
+    assert(i >= 0 && i < tree->nodeNumber);
+    return tree->subtreeLeafNumbers[i];
+}
+
+bool stFrozenTree_isAncestor(stFrozenTree *tree, int64_t i, int64_t j) {
+    assert(i >= 0 && i < tree->nodeNumber);
+    assert(j >= 0 && j < tree->nodeNumber);
+    return i <= j && j < i + tree->subtreeSizes[i];
+}
+
+bool stFrozenTree_hasLCAIndex(stFrozenTree *tree) {
+    return tree->levelNumber > 0;
+}
+
+int64_t stFrozenTree_getLCA(stFrozenTree *tree, int64_t i, int64_t j) {
+    assert(i >= 0 && i < tree->nodeNumber);
+    assert(j >= 0 && j < tree->nodeNumber);
+    if (stFrozenTree_hasLCAIndex(tree)) {
+        if (i == j) {
+            return i;
+        }
+        if (i > j) {
+            int64_t k = i;
+            i = j;
+            j = k;
+        }
+        // The shallowest of nodes i + 1 to j, from the two blocks of 2^l nodes covering them.
+        int64_t l = tree->floorLog2s[j - i];
+        int64_t a = tree->shallowest[l][i + 1], b = tree->shallowest[l][j - (((int64_t) 1) << l) + 1];
+        return tree->parents[tree->depths[a] <= tree->depths[b] ? a : b];
+    }
+    if (tree->depths[i] < tree->depths[j]) {
+        int64_t k = i;
+        i = j;
+        j = k;
+    }
+    // i is the deeper, so climb from it until j is below it.
+    while (!stFrozenTree_isAncestor(tree, i, j)) {
+        i = tree->parents[i];
+    }
+    return i;
+}
+
+double stFrozenTree_getDistance(stFrozenTree *tree, int64_t i, int64_t j) {
+    int64_t lca = stFrozenTree_getLCA(tree, i, j);
+    if (stFrozenTree_hasLCAIndex(tree)) {
+        return tree->rootDistances[i] + tree->rootDistances[j] - 2 * tree->rootDistances[lca];
+    }
+    double distance = 0.0;
+    for (; i != lca; i = tree->parents[i]) {
+        distance += tree->branchLengths[i];
+    }
+    for (; j != lca; j = tree->parents[j]) {
+        distance += tree->branchLengths[j];
+    }
+    return distance;
+}
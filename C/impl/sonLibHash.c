@@ -13,12 +13,25 @@
 #include "sonLibGlobalsInternal.h"
 #include "hashTableC.h"
 #include "hashTableC_itr.h"
+#include "hashTablePrivateC.h"
+#include "openHashTable.h"
 
+/*
+ * Exactly one of hash (the chained table) and openHash is non-null, depending on the type the
+ * hash was constructed with.
+ */
 struct _stHash {
     struct hashtable *hash;
+    struct openHashTable *openHash;
     bool destructKeys, destructValues;
 };
 
+struct _stHashIterator {
+    stHash *hash;
+    struct hashtable_itr chainedIterator;
+    uint64_t slot;
+};
+
 uint64_t stHash_pointer(const void *k) {
     // Size doesn't matter; just promote to 64 bits
     uint64_t key = (uint64_t) k;
@@ -30,7 +43,7 @@ uint64_t stHash_pointer(const void *k) {
     return key ^ (key >> 31);
 }
 
-static int stHash_equalKey(const void *key1, const void *key2) {
+int stHash_equalKey(const void *key1, const void *key2) {
     return key1 == key2;
 }
 
@@ -43,59 +56,138 @@ stHash *stHash_construct2(void(*destructKeys)(void *), void(*destructValues)(voi
 }
 
 stHash *stHash_construct3(uint64_t(*hashKey)(const void *), int(*hashEqualsKey)(const void *, const void *), void(*destructKeys)(void *), void(*destructValues)(void *)) {
+    return stHash_construct4(hashKey, hashEqualsKey, destructKeys, destructValues, stHashTypeChained);
+}
+
+stHash *stHash_construct4(uint64_t(*hashKey)(const void *), int(*hashEqualsKey)(const void *, const void *),
+                          void(*destructKeys)(void *), void(*destructValues)(void *), stHashType type) {
     stHash *hash = st_malloc(sizeof(stHash));
-    hash->hash = create_hashtable(0, hashKey, hashEqualsKey, destructKeys, destructValues);
+    if (type == stHashTypeOpenAddressing) {
+        hash->hash = NULL;
+        hash->openHash = openHashTable_construct(0, hashKey, hashEqualsKey, destructKeys, destructValues);
+    } else {
+        hash->hash = create_hashtable(0, hashKey, hashEqualsKey, destructKeys, destructValues);
+        hash->openHash = NULL;
+    }
     hash->destructKeys = destructKeys != NULL;
     hash->destructValues = destructValues != NULL;
     return hash;
 }
 
+stHash *stHash_constructOpenAddressing(void) {
+    return stHash_construct4(stHash_pointer, stHash_equalKey, NULL, NULL, stHashTypeOpenAddressing);
+}
+
+stHash *stHash_constructInArena(uint64_t(*hashKey)(const void *), int(*hashEqualsKey)(const void *, const void *),
+                                void(*destructKeys)(void *), void(*destructValues)(void *), stArena *arena) {
+    stHash *hash = stHash_construct4(hashKey, hashEqualsKey, destructKeys, destructValues, stHashTypeChained);
+    hash->hash->entryPool = stPool_construct2(sizeof(struct entry), arena);
+    return hash;
+}
+
+stHashType stHash_getType(stHash *hash) {
+    return hash->openHash != NULL ? stHashTypeOpenAddressing : stHashTypeChained;
+}
+
 void stHash_destruct(stHash *hash) {
-    hashtable_destroy(hash->hash, hash->destructValues, hash->destructKeys);
+    if (hash->openHash != NULL) {
+        openHashTable_destruct(hash->openHash, hash->destructKeys, hash->destructValues);
+    } else {
+        hashtable_destroy(hash->hash, hash->destructValues, hash->destructKeys);
+    }
     free(hash);
 }
 
 void stHash_setDestructKeys(stHash *hash, void(*destructor)(void *)) {
     hash->destructKeys = destructor != NULL;
-    hash->hash->keyFree = destructor;
+    if (hash->openHash != NULL) {
+        hash->openHash->keyFree = destructor;
+    } else {
+        hash->hash->keyFree = destructor;
+    }
 }
 
 void stHash_setDestructValues(stHash *hash, void(*destructor)(void *)) {
     hash->destructValues = destructor != NULL;
-    hash->hash->valueFree = destructor;
+    if (hash->openHash != NULL) {
+        hash->openHash->valueFree = destructor;
+    } else {
+        hash->hash->valueFree = destructor;
+    }
 }
 
 void stHash_insert(stHash *hash, void *key, void *value) {
+    if (hash->openHash != NULL) { // Replaces any existing key in place.
+        openHashTable_insert(hash->openHash, key, value);
+        return;
+    }
     if (stHash_search(hash, key) != NULL) { //This will ensure we don't end up with duplicate keys..
         stHash_remove(hash, key);
     }
     hashtable_insert(hash->hash, key, value);
 }
 
+void stHash_reserve(stHash *hash, int64_t size) {
+    // The chained table grows through its prime table on demand; there is nothing to do for it.
+    if (hash->openHash != NULL && size > 0) {
+        openHashTable_reserve(hash->openHash, size);
+    }
+}
+
 void *stHash_search(stHash *hash, void *key) {
+    if (hash->openHash != NULL) {
+        return openHashTable_search(hash->openHash, key);
+    }
     return hashtable_search(hash->hash, key);
 }
 
 void *stHash_remove(stHash *hash, void *key) {
+    if (hash->openHash != NULL) {
+        return openHashTable_remove(hash->openHash, key, 0);
+    }
     return hashtable_remove(hash->hash, key, 0);
 }
 
 void *stHash_removeAndFreeKey(stHash *hash, void *key) {
+    if (hash->openHash != NULL) {
+        return openHashTable_remove(hash->openHash, key, 1);
+    }
     return hashtable_remove(hash->hash, key, 1);
 }
 
 int64_t stHash_size(stHash *hash) {
+    if (hash->openHash != NULL) {
+        return hash->openHash->size;
+    }
     return hashtable_count(hash->hash);
 }
 
 stHashIterator *stHash_getIterator(stHash *hash) {
-    return hashtable_iterator(hash->hash);
+    stHashIterator *iterator = st_malloc(sizeof(stHashIterator));
+    iterator->hash = hash;
+    iterator->slot = 0;
+    if (hash->hash != NULL) {
+        struct hashtable_itr *chainedIterator = hashtable_iterator(hash->hash);
+        iterator->chainedIterator = *chainedIterator;
+        free(chainedIterator);
+    }
+    return iterator;
 }
 
 void *stHash_getNext(stHashIterator *iterator) {
-    if (iterator->e != NULL) {
-        void *o = hashtable_iterator_key(iterator);
-        hashtable_iterator_advance(iterator);
+    struct openHashTable *openHash = iterator->hash->openHash;
+    if (openHash != NULL) {
+        // The slot is only advanced past the returned key, so removing that key (which just
+        // leaves a tombstone) does not disturb the iteration.
+        iterator->slot = openHashTable_nextOccupied(openHash, iterator->slot);
+        if (iterator->slot < openHash->capacity) {
+            return openHash->slots[iterator->slot++].key;
+        }
+        return NULL;
+    }
+    if (iterator->chainedIterator.e != NULL) {
+        void *o = hashtable_iterator_key(&iterator->chainedIterator);
+        hashtable_iterator_advance(&iterator->chainedIterator);
         return o;
     }
     return NULL;
@@ -103,10 +195,7 @@ void *stHash_getNext(stHashIterator *iterator) {
 
 stHashIterator *stHash_copyIterator(stHashIterator *iterator) {
     stHashIterator *iterator2 = st_malloc(sizeof(stHashIterator));
-    iterator2->h = iterator->h;
-    iterator2->e = iterator->e;
-    iterator2->parent = iterator->parent;
-    iterator2->index = iterator->index;
+    *iterator2 = *iterator;
     return iterator2;
 }
 
@@ -180,16 +269,16 @@ stHash *stHash_invert(stHash *hash, uint64_t(*hashKey)(const void *), int(*equal
 }
 // interface to underlying functions
 uint64_t (*stHash_getHashFunction(stHash *hash))(const void *) {
-    return hash->hash->hashfn;
+    return hash->openHash != NULL ? hash->openHash->hashfn : hash->hash->hashfn;
 }
 int (*stHash_getEqualityFunction(stHash *hash))(const void *, const void *) {
-    return hash->hash->eqfn;
+    return hash->openHash != NULL ? hash->openHash->eqfn : hash->hash->eqfn;
 }
 void (*stHash_getKeyDestructorFunction(stHash *hash))(void *) {
-    return hash->hash->keyFree;
+    return hash->openHash != NULL ? hash->openHash->keyFree : hash->hash->keyFree;
 }
 void (*stHash_getValueDestructorFunction(stHash *hash))(void *) {
-    return hash->hash->valueFree;
+    return hash->openHash != NULL ? hash->openHash->valueFree : hash->hash->valueFree;
 }
 
 static int unsigned_cmp(const unsigned *x, const unsigned *y) {
@@ -203,6 +292,10 @@ static int unsigned_cmp(const unsigned *x, const unsigned *y) {
 }
 
 void stHash_printDiagnostics(stHash *hash) {
+    if (hash->openHash != NULL) {
+        openHashTable_printDiagnostics(hash->openHash);
+        return;
+    }
     struct hashtable *h = hash->hash;
     unsigned *bucketLoad = st_malloc(h->tablelength * sizeof(unsigned));
     unsigned *occupiedBucketLoad = st_malloc(h->entrycount * sizeof(unsigned));
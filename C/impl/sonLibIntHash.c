@@ -0,0 +1,290 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * sonLibIntHash.c
+ *
+ * Linear probing open addressing table with int64 keys stored inline. Shares its control bytes
+ * and probing with the open addressing stHash table, see openHashControl.h.
+ */
+#include "sonLibGlobalsInternal.h"
+#include "openHashControl.h"
+
+struct intHashSlot {
+    int64_t key;
+    void *value;
+};
+
+struct _stIntHash {
+    uint64_t capacity; // Always a power of two.
+    uint64_t size;
+    uint64_t tombstones;
+    uint8_t *control;
+    struct intHashSlot *slots;
+    void (*destructValues)(void *);
+};
+
+struct _stIntHashIterator {
+    stIntHash *hash;
+    uint64_t slot;
+};
+
+struct _stIntSet {
+    stIntHash *hash;
+};
+
+struct _stIntSetIterator {
+    stIntHashIterator *hashIterator;
+};
+
+static inline uint64_t hashKey(int64_t key) {
+    return openHash_mix((uint64_t) key);
+}
+
+static void allocateSlots(stIntHash *hash, uint64_t capacity) {
+    hash->capacity = capacity;
+    hash->control = st_malloc(capacity * sizeof(uint8_t));
+    openHash_clearControl(hash->control, capacity);
+    hash->slots = st_malloc(capacity * sizeof(struct intHashSlot));
+    hash->tombstones = 0;
+}
+
+/*
+ * Returns the slot holding the key, or hash->capacity if absent.
+ */
+static uint64_t findSlot(stIntHash *hash, int64_t key, uint64_t h) {
+    uint64_t mask = hash->capacity - 1;
+    uint8_t c = openHash_control(h);
+    for (uint64_t i = openHash_index(h, hash->capacity);; i = (i + 1) & mask) {
+        uint8_t control = hash->control[i];
+        if (control == CONTROL_EMPTY) {
+            return hash->capacity;
+        }
+        if (control == c && hash->slots[i].key == key) {
+            return i;
+        }
+    }
+}
+
+/*
+ * Places a key known not to be present, without checking the load.
+ */
+static void placeNew(stIntHash *hash, int64_t key, void *value, uint64_t h) {
+    uint64_t i = openHash_findFree(hash->control, hash->capacity, h);
+    if (hash->control[i] == CONTROL_DELETED) {
+        hash->tombstones--;
+    }
+    hash->control[i] = openHash_control(h);
+    hash->slots[i].key = key;
+    hash->slots[i].value = value;
+    hash->size++;
+}
+
+static void rehash(stIntHash *hash, uint64_t newCapacity) {
+    uint8_t *oldControl = hash->control;
+    struct intHashSlot *oldSlots = hash->slots;
+    uint64_t oldCapacity = hash->capacity;
+    allocateSlots(hash, newCapacity);
+    hash->size = 0;
+    for (uint64_t i = 0; i < oldCapacity; i++) {
+        if (openHash_isFull(oldControl[i])) {
+            placeNew(hash, oldSlots[i].key, oldSlots[i].value, hashKey(oldSlots[i].key));
+        }
+    }
+    free(oldControl);
+    free(oldSlots);
+}
+
+stIntHash *stIntHash_construct(void) {
+    return stIntHash_construct2(NULL);
+}
+
+stIntHash *stIntHash_construct2(void (*destructValues)(void *)) {
+    stIntHash *hash = st_malloc(sizeof(stIntHash));
+    allocateSlots(hash, MIN_CAPACITY);
+    hash->size = 0;
+    hash->destructValues = destructValues;
+    return hash;
+}
+
+void stIntHash_destruct(stIntHash *hash) {
+    if (hash->destructValues != NULL) {
+        for (uint64_t i = 0; i < hash->capacity; i++) {
+            if (openHash_isFull(hash->control[i])) {
+                hash->destructValues(hash->slots[i].value);
+            }
+        }
+    }
+    free(hash->control);
+    free(hash->slots);
+    free(hash);
+}
+
+void stIntHash_setDestructValues(stIntHash *hash, void (*destructor)(void *)) {
+    hash->destructValues = destructor;
+}
+
+void stIntHash_insert(stIntHash *hash, int64_t key, void *value) {
+    uint64_t h = hashKey(key);
+    uint64_t i = findSlot(hash, key, h);
+    if (i != hash->capacity) {
+        hash->slots[i].value = value;
+        return;
+    }
+    if (hash->size + hash->tombstones + 1 > openHash_maxLoad(hash->capacity)) {
+        rehash(hash, openHash_growCapacity(hash->size, hash->capacity));
+    }
+    placeNew(hash, key, value, h);
+}
+
+void stIntHash_insertAll(stIntHash *hash, const int64_t *keys, void **values, int64_t length) {
+    stIntHash_reserve(hash, hash->size + length);
+    for (int64_t i = 0; i < length; i++) {
+        stIntHash_insert(hash, keys[i], values[i]);
+    }
+}
+
+void *stIntHash_search(stIntHash *hash, int64_t key) {
+    uint64_t i = findSlot(hash, key, hashKey(key));
+    return i != hash->capacity ? hash->slots[i].value : NULL;
+}
+
+bool stIntHash_contains(stIntHash *hash, int64_t key) {
+    return findSlot(hash, key, hashKey(key)) != hash->capacity;
+}
+
+void *stIntHash_remove(stIntHash *hash, int64_t key) {
+    uint64_t i = findSlot(hash, key, hashKey(key));
+    if (i == hash->capacity) {
+        return NULL;
+    }
+    hash->control[i] = CONTROL_DELETED;
+    hash->size--;
+    hash->tombstones++;
+    return hash->slots[i].value;
+}
+
+int64_t stIntHash_size(stIntHash *hash) {
+    return hash->size;
+}
+
+void stIntHash_reserve(stIntHash *hash, int64_t size) {
+    if (size > 0 && openHash_capacityFor(size) > hash->capacity) {
+        rehash(hash, openHash_capacityFor(size));
+    }
+}
+
+stIntHashIterator *stIntHash_getIterator(stIntHash *hash) {
+    stIntHashIterator *iterator = st_malloc(sizeof(stIntHashIterator));
+    iterator->hash = hash;
+    iterator->slot = 0;
+    return iterator;
+}
+
+bool stIntHash_getNext(stIntHashIterator *iterator, int64_t *key, void **value) {
+    stIntHash *hash = iterator->hash;
+    while (iterator->slot < hash->capacity) {
+        uint64_t i = iterator->slot++;
+        if (openHash_isFull(hash->control[i])) {
+            if (key != NULL) {
+                *key = hash->slots[i].key;
+            }
+            if (value != NULL) {
+                *value = hash->slots[i].value;
+            }
+            return 1;
+        }
+    }
+    return 0;
+}
+
+stIntHashIterator *stIntHash_copyIterator(stIntHashIterator *iterator) {
+    stIntHashIterator *iterator2 = st_malloc(sizeof(stIntHashIterator));
+    *iterator2 = *iterator;
+    return iterator2;
+}
+
+void stIntHash_destructIterator(stIntHashIterator *iterator) {
+    free(iterator);
+}
+
+stList *stIntHash_getValues(stIntHash *hash) {
+    stList *list = stList_construct();
+    stIntHashIterator *iterator = stIntHash_getIterator(hash);
+    void *value;
+    while (stIntHash_getNext(iterator, NULL, &value)) {
+        stList_append(list, value);
+    }
+    stIntHash_destructIterator(iterator);
+    return list;
+}
+
+/*
+ * stIntSet, a thin wrapper around stIntHash in the same way stSet wraps stHash.
+ */
+
+stIntSet *stIntSet_construct(void) {
+    stIntSet *set = st_malloc(sizeof(stIntSet));
+    set->hash = stIntHash_construct();
+    return set;
+}
+
+void stIntSet_destruct(stIntSet *set) {
+    stIntHash_destruct(set->hash);
+    free(set);
+}
+
+void stIntSet_insert(stIntSet *set, int64_t key) {
+    stIntHash_insert(set->hash, key, NULL);
+}
+
+void stIntSet_insertAll(stIntSet *set, const int64_t *keys, int64_t length) {
+    stIntHash_reserve(set->hash, stIntHash_size(set->hash) + length);
+    for (int64_t i = 0; i < length; i++) {
+        stIntHash_insert(set->hash, keys[i], NULL);
+    }
+}
+
+bool stIntSet_contains(stIntSet *set, int64_t key) {
+    return stIntHash_contains(set->hash, key);
+}
+
+bool stIntSet_remove(stIntSet *set, int64_t key) {
+    if (!stIntHash_contains(set->hash, key)) {
+        return 0;
+    }
+    stIntHash_remove(set->hash, key);
+    return 1;
+}
+
+int64_t stIntSet_size(stIntSet *set) {
+    return stIntHash_size(set->hash);
+}
+
+void stIntSet_reserve(stIntSet *set, int64_t size) {
+    stIntHash_reserve(set->hash, size);
+}
+
+stIntSetIterator *stIntSet_getIterator(stIntSet *set) {
+    stIntSetIterator *iterator = st_malloc(sizeof(stIntSetIterator));
+    iterator->hashIterator = stIntHash_getIterator(set->hash);
+    return iterator;
+}
+
+bool stIntSet_getNext(stIntSetIterator *iterator, int64_t *key) {
+    return stIntHash_getNext(iterator->hashIterator, key, NULL);
+}
+
+stIntSetIterator *stIntSet_copyIterator(stIntSetIterator *iterator) {
+    stIntSetIterator *iterator2 = st_malloc(sizeof(stIntSetIterator));
+    iterator2->hashIterator = stIntHash_copyIterator(iterator->hashIterator);
+    return iterator2;
+}
+
+void stIntSet_destructIterator(stIntSetIterator *iterator) {
+    stIntHash_destructIterator(iterator->hashIterator);
+    free(iterator);
+}
@@ -63,10 +63,23 @@ stKVDatabase *stKVDatabase_construct(stKVDatabaseConf *conf, bool create) {
                     "requested Redis database, however sonlib is not compiled with Redis support");
 #endif
             break;
+        case stKVDatabaseTypeLogFile:
+            stKVDatabase_initialise_logFile(database, conf, create);
+            break;
+        case stKVDatabaseTypeSharded:
+            stKVDatabase_initialise_sharded(database, conf, create);
+            break;
         default:
             stThrowNew(ST_KV_DATABASE_EXCEPTION_ID,
                     "BUG: unrecognized database type");
     }
+    if (stKVDatabaseConf_getCompressionChunkSize(conf) > 0) {
+        stKVDatabase_initialise_compression(database, stKVDatabaseConf_getCompressionChunkSize(conf));
+    }
+    if (stKVDatabaseConf_getCacheSize(conf) > 0) {
+        stKVDatabase_initialise_cache(database, stKVDatabaseConf_getCacheSize(conf),
+                stKVDatabaseConf_getCacheWriteBackSize(conf));
+    }
     return database;
 }
 
@@ -435,6 +448,41 @@ void *stKVDatabase_getRecord2(stKVDatabase *database, int64_t key,
     return data;
 }
 
+const void *stKVDatabase_borrowRecord(stKVDatabase *database, int64_t key, int64_t *recordSize) {
+    if (database->borrowRecord == NULL) {
+        return stKVDatabase_getRecord2(database, key, recordSize); // Released by freeing the copy.
+    }
+    if (database->deleted) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID,
+                "Trying to borrow a record from a database that has already been deleted");
+    }
+    const void *record = NULL;
+    stTry {
+            record = database->borrowRecord(database, key, recordSize);
+        }stCatch(ex)
+            {
+                if (isRetryExcept(ex)) {
+                    stThrow(ex);
+                } else {
+                    stThrowNewCause(ex, ST_KV_DATABASE_EXCEPTION_ID,
+                            "stKVDatabase_borrowRecord key %lld failed",
+                            (long long) key);
+                }
+            }stTryEnd;
+    return record;
+}
+
+void stKVDatabase_releaseRecord(stKVDatabase *database, const void *record) {
+    if (record == NULL) {
+        return;
+    }
+    if (database->releaseRecord == NULL) {
+        free((void *) record);
+    } else {
+        database->releaseRecord(database, record);
+    }
+}
+
 void *stKVDatabase_getPartialRecord(stKVDatabase *database, int64_t key,
         int64_t zeroBasedByteOffset, int64_t sizeInBytes, int64_t recordSize) {
     if (database->deleted) {
@@ -559,6 +607,47 @@ void stKVDatabase_removeRecord(stKVDatabase *database, int64_t key) {
             }stTryEnd;
 }
 
+void stKVDatabase_flush(stKVDatabase *database) {
+    if (database->deleted) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID,
+                "Trying to flush a database that has already been deleted");
+    }
+    if (database->flush == NULL) {
+        return;
+    }
+    stTry {
+            database->flush(database);
+        }stCatch(ex)
+            {
+                if (isRetryExcept(ex)) {
+                    stThrow(ex);
+                } else {
+                    stThrowNewCause(ex, ST_KV_DATABASE_EXCEPTION_ID,
+                            "stKVDatabase_flush failed");
+                }
+            }stTryEnd;
+}
+
+void stKVDatabase_getCacheStats(stKVDatabase *database, int64_t *hits, int64_t *misses) {
+    *hits = 0;
+    *misses = 0;
+    if (database->getCacheStats != NULL) {
+        database->getCacheStats(database, hits, misses);
+    }
+}
+
+void stKVDatabase_getCompressionStats(stKVDatabase *database, int64_t *uncompressedBytes, int64_t *compressedBytes,
+                                      double *compressSeconds, double *decompressSeconds) {
+    *uncompressedBytes = 0;
+    *compressedBytes = 0;
+    *compressSeconds = 0.0;
+    *decompressSeconds = 0.0;
+    if (database->getCompressionStats != NULL) {
+        database->getCompressionStats(database, uncompressedBytes, compressedBytes, compressSeconds,
+                                      decompressSeconds);
+    }
+}
+
 stKVDatabaseConf *stKVDatabase_getConf(stKVDatabase *database) {
     return database->conf;
 }
@@ -34,6 +34,10 @@ struct stKVDatabaseConf {
     char *password;
     char *databaseName;
     char *tableName;
+    int64_t cacheSize;
+    int64_t cacheWriteBackSize;
+    int64_t compressionChunkSize;
+    stList *shards; // Confs of the shards of a sharded database.
 };
 
 stKVDatabaseConf *stKVDatabaseConf_constructTokyoCabinet(const char *databaseDir) {
@@ -43,6 +47,31 @@ stKVDatabaseConf *stKVDatabaseConf_constructTokyoCabinet(const char *databaseDir
     return conf;
 }
 
+stKVDatabaseConf *stKVDatabaseConf_constructLogFile(const char *databaseDir) {
+    stKVDatabaseConf *conf = stSafeCCalloc(sizeof(stKVDatabaseConf));
+    conf->type = stKVDatabaseTypeLogFile;
+    conf->databaseDir = stString_copy(databaseDir);
+    return conf;
+}
+
+static stList *cloneShards(stList *shardConfs) {
+    stList *shards = stList_construct3(0, (void (*)(void *)) stKVDatabaseConf_destruct);
+    for (int64_t i = 0; i < stList_length(shardConfs); i++) {
+        stList_append(shards, stKVDatabaseConf_constructClone(stList_get(shardConfs, i)));
+    }
+    return shards;
+}
+
+stKVDatabaseConf *stKVDatabaseConf_constructSharded(stList *shardConfs) {
+    if (stList_length(shardConfs) == 0) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "a sharded database needs at least one shard");
+    }
+    stKVDatabaseConf *conf = stSafeCCalloc(sizeof(stKVDatabaseConf));
+    conf->type = stKVDatabaseTypeSharded;
+    conf->shards = cloneShards(shardConfs);
+    return conf;
+}
+
 stKVDatabaseConf *stKVDatabaseConf_constructKyotoTycoon(const char *host, unsigned port, int timeout,
                                                         int64_t maxRecordSize, int64_t maxBulkSetSize,
                                                         int64_t maxBulkSetNumRecords,
@@ -232,16 +261,66 @@ static int64_t getXMLMaxRedisBulkSetSize(stHash *hash) {
     }
 }
 
+/* The cache attributes are optional for all database types, and default to
+ * no caching.
+ */
+static int64_t getXMLInt64(stHash *hash, const char *key) {
+    const char *value = stHash_search(hash, (char *) key);
+    return value == NULL ? 0 : stSafeStrToInt64(value);
+}
+
+/* Cuts the nested st_kv_database_conf elements (the shards of a sharded
+ * database) out of the XML string, returning their XML strings and leaving
+ * the rest, with the sharded tag's attributes, in a form hackParseXmlString
+ * can read.
+ */
+static stList *cutOutShards(const char *xmlString, char **remainder) {
+    const char *openTag = "<st_kv_database_conf", *closeTag = "</st_kv_database_conf>";
+    int64_t openLength = strlen(openTag), closeLength = strlen(closeTag);
+    stList *shards = stList_construct3(0, free);
+    char *cA = st_malloc(strlen(xmlString) + 1);
+    int64_t depth = 0, shardStart = 0, j = 0;
+    for (int64_t i = 0; xmlString[i] != '\0';) {
+        if (strncmp(xmlString + i, openTag, openLength) == 0) {
+            if (depth++ == 1) {
+                shardStart = i;
+            }
+        } else if (strncmp(xmlString + i, closeTag, closeLength) == 0 && --depth == 1) {
+            stList_append(shards, stString_getSubString(xmlString, shardStart, i + closeLength - shardStart));
+            i += closeLength;
+            continue;
+        }
+        if (depth <= 1) {
+            cA[j++] = xmlString[i];
+        }
+        i++;
+    }
+    cA[j] = '\0';
+    *remainder = stString_replace(cA, "</sharded>", "");
+    free(cA);
+    return shards;
+}
+
 static stKVDatabaseConf *constructFromString(const char *xmlString) {
-    stHash *hash = hackParseXmlString(xmlString);
+    char *remainder;
+    stList *shardStrings = cutOutShards(xmlString, &remainder);
+    stHash *hash = hackParseXmlString(remainder);
+    free(remainder);
     stKVDatabaseConf *databaseConf = NULL;
     const char *type = getXmlValueRequired(hash, "conf_type");
     const char *dbTag = getXmlValueRequired(hash, "db_tag");
     if (!stString_eq(type, dbTag)) {
         stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Database XML tag \"%s\" did not match st_kv_database_conf type attribute", dbTag, type);
     }
+    if (stList_length(shardStrings) > 0 && !stString_eq(type, "sharded")) {
+        stList_destruct(shardStrings);
+        stHash_destruct(hash);
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "only a sharded database can contain nested database confs");
+    }
     if (stString_eq(type, "tokyo_cabinet")) {
         databaseConf = stKVDatabaseConf_constructTokyoCabinet(getXmlValueRequired(hash, "database_dir"));
+    } else if (stString_eq(type, "log_file")) {
+        databaseConf = stKVDatabaseConf_constructLogFile(getXmlValueRequired(hash, "database_dir"));
     } else if (stString_eq(type, "kyoto_tycoon")) {
         databaseConf = stKVDatabaseConf_constructKyotoTycoon(getXmlValueRequired(hash, "host"), 
                                                         getXmlPort(hash), 
@@ -258,10 +337,21 @@ static stKVDatabaseConf *constructFromString(const char *xmlString) {
     } else if (stString_eq(type, "redis")) {
         databaseConf = stKVDatabaseConf_constructRedis(getXmlValueRequired(hash, "host"), getXmlPort(hash),
 						       getXMLMaxRedisBulkSetSize(hash));
+    } else if (stString_eq(type, "sharded")) {
+        stList *shards = stList_construct3(0, (void (*)(void *)) stKVDatabaseConf_destruct);
+        for (int64_t i = 0; i < stList_length(shardStrings); i++) {
+            stList_append(shards, constructFromString(stList_get(shardStrings, i)));
+        }
+        databaseConf = stKVDatabaseConf_constructSharded(shards);
+        stList_destruct(shards);
     } else {
         stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "invalid database type \"%s\"", type);
     }
+    stKVDatabaseConf_setCache(databaseConf, getXMLInt64(hash, "cache_size"),
+                              getXMLInt64(hash, "cache_write_back_size"));
+    stKVDatabaseConf_setCompression(databaseConf, getXMLInt64(hash, "compression_chunk_size"));
     stHash_destruct(hash);
+    stList_destruct(shardStrings);
     return databaseConf;
 }
 
@@ -291,6 +381,12 @@ stKVDatabaseConf *stKVDatabaseConf_constructClone(stKVDatabaseConf *srcConf) {
     conf->password = stString_copy(srcConf->password);
     conf->databaseName = stString_copy(srcConf->databaseName);
     conf->tableName = stString_copy(srcConf->tableName);
+    conf->cacheSize = srcConf->cacheSize;
+    conf->cacheWriteBackSize = srcConf->cacheWriteBackSize;
+    conf->compressionChunkSize = srcConf->compressionChunkSize;
+    if (srcConf->shards != NULL) {
+        conf->shards = cloneShards(srcConf->shards);
+    }
     return conf;
 }
 
@@ -302,6 +398,9 @@ void stKVDatabaseConf_destruct(stKVDatabaseConf *conf) {
         stSafeCFree(conf->password);
         stSafeCFree(conf->databaseName);
         stSafeCFree(conf->tableName);
+        if (conf->shards != NULL) {
+            stList_destruct(conf->shards);
+        }
         stSafeCFree(conf);
     }
 }
@@ -363,3 +462,38 @@ const char *stKVDatabaseConf_getTableName(stKVDatabaseConf *conf) {
     return conf->tableName;
 }
 
+int64_t stKVDatabaseConf_getNumberOfShards(stKVDatabaseConf *conf) {
+    return conf->shards == NULL ? 0 : stList_length(conf->shards);
+}
+
+stKVDatabaseConf *stKVDatabaseConf_getShard(stKVDatabaseConf *conf, int64_t shard) {
+    return stList_get(conf->shards, shard);
+}
+
+void stKVDatabaseConf_setCache(stKVDatabaseConf *conf, int64_t cacheSize, int64_t writeBackSize) {
+    if (cacheSize < 0 || writeBackSize < 0) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "invalid cache size %" PRIi64 " or write back size %" PRIi64,
+                   cacheSize, writeBackSize);
+    }
+    conf->cacheSize = cacheSize;
+    conf->cacheWriteBackSize = writeBackSize;
+}
+
+int64_t stKVDatabaseConf_getCacheSize(stKVDatabaseConf *conf) {
+    return conf->cacheSize;
+}
+
+int64_t stKVDatabaseConf_getCacheWriteBackSize(stKVDatabaseConf *conf) {
+    return conf->cacheWriteBackSize;
+}
+
+void stKVDatabaseConf_setCompression(stKVDatabaseConf *conf, int64_t chunkSize) {
+    if (chunkSize < 0 || chunkSize > INT32_MAX) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "invalid compression chunk size %" PRIi64, chunkSize);
+    }
+    conf->compressionChunkSize = chunkSize;
+}
+
+int64_t stKVDatabaseConf_getCompressionChunkSize(stKVDatabaseConf *conf) {
+    return conf->compressionChunkSize;
+}
@@ -0,0 +1,330 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * sonLibKVDatabasePipeline.c
+ *
+ * Asynchronous requests to a database, see stKVDatabasePipeline_construct.
+ *
+ * Requests are queued and a single thread, which owns the database while the
+ * pipeline exists, sends them in batches. Runs of requests of the same kind
+ * in a batch go to the database as one bulk get, set or remove, which the
+ * server backends send as a single round trip (Redis pipelines the commands
+ * of a bulk request). While one batch is in flight the next is queued, so the
+ * batches grow to match the latency of the database.
+ */
+
+#include <pthread.h>
+#include "sonLibGlobalsInternal.h"
+#include "sonLibKVDatabasePrivate.h"
+
+#define atomicLoad(x) __atomic_load_n(x, __ATOMIC_SEQ_CST)
+#define atomicStore(x, v) __atomic_store_n(x, v, __ATOMIC_SEQ_CST)
+
+enum requestType {
+    PIPELINE_GET, PIPELINE_SET, PIPELINE_REMOVE
+};
+
+struct stKVDatabaseRequest {
+    stKVDatabasePipeline *pipeline;
+    enum requestType type;
+    int64_t key;
+    void *value; // The value to set, or the record got.
+    int64_t size;
+    stExcept *except; // Set if the request failed.
+    int done;
+    struct stKVDatabaseRequest *next; // In the queue.
+};
+
+struct stKVDatabasePipeline {
+    stKVDatabase *database;
+    int64_t maxBatchSize;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t queuedCond;
+    pthread_cond_t completedCond;
+    stKVDatabaseRequest *head, *tail; // Requests not yet sent.
+    int64_t outstanding; // Requests not yet complete.
+    bool kill;
+};
+
+/*
+ * Sending requests.
+ */
+
+// Keeps a copy of the failure, as the caught exception is freed at the end of
+// the catch block.
+static void setFailed(stKVDatabaseRequest *request, stExcept *except) {
+    request->except = stExcept_new(stExcept_getId(except), "%s", stExcept_getMsg(except));
+}
+
+// Sends a request on its own, after the bulk request it was part of failed,
+// so the failure is attributed to the right requests.
+static void sendOne(stKVDatabase *database, stKVDatabaseRequest *request) {
+    stTry {
+        if (request->type == PIPELINE_GET) {
+            request->value = stKVDatabase_getRecord2(database, request->key, &request->size);
+        } else if (request->type == PIPELINE_SET) {
+            stKVDatabase_setRecord(database, request->key, request->value, request->size);
+        } else {
+            stKVDatabase_removeRecord(database, request->key);
+        }
+    } stCatch(except) {
+        setFailed(request, except);
+    } stTryEnd;
+}
+
+static void sendGets(stKVDatabase *database, stKVDatabaseRequest **requests, int64_t length) {
+    stList *keys = stList_construct();
+    for (int64_t i = 0; i < length; i++) {
+        stList_append(keys, &requests[i]->key);
+    }
+    stList *volatile results = NULL;
+    stTry {
+        results = stKVDatabase_bulkGetRecords(database, keys);
+    } stCatch(except) {
+        st_logDebug("Pipelined bulk get failed, sending gets one at a time: %s\n", stExcept_getMsg(except));
+        results = NULL;
+    } stTryEnd;
+    stList_destruct(keys);
+    if (results == NULL) {
+        for (int64_t i = 0; i < length; i++) {
+            sendOne(database, requests[i]);
+        }
+        return;
+    }
+    for (int64_t i = 0; i < length; i++) {
+        stKVDatabaseBulkResult *result = stList_get(results, i);
+        requests[i]->value = result->value;
+        requests[i]->size = result->size;
+        result->value = NULL; // Ownership passes to the request.
+    }
+    stList_destruct(results);
+}
+
+static void sendSets(stKVDatabase *database, stKVDatabaseRequest **requests, int64_t length) {
+    // The bulk requests borrow the values of the requests rather than copying them.
+    stList *bulkRequests = stList_construct3(0, free);
+    for (int64_t i = 0; i < length; i++) {
+        stKVDatabaseBulkRequest *bulkRequest = st_malloc(sizeof(stKVDatabaseBulkRequest));
+        bulkRequest->key = requests[i]->key;
+        bulkRequest->value = requests[i]->value;
+        bulkRequest->size = requests[i]->size;
+        bulkRequest->type = SET;
+        stList_append(bulkRequests, bulkRequest);
+    }
+    volatile bool failed = 0;
+    stTry {
+        stKVDatabase_bulkSetRecords(database, bulkRequests);
+    } stCatch(except) {
+        st_logDebug("Pipelined bulk set failed, sending sets one at a time: %s\n", stExcept_getMsg(except));
+        failed = 1;
+    } stTryEnd;
+    stList_destruct(bulkRequests);
+    for (int64_t i = 0; i < length; i++) {
+        if (failed) {
+            sendOne(database, requests[i]);
+        }
+        free(requests[i]->value);
+        requests[i]->value = NULL;
+    }
+}
+
+static void sendRemoves(stKVDatabase *database, stKVDatabaseRequest **requests, int64_t length) {
+    stList *keys = stList_construct3(0, (void (*)(void *)) stIntTuple_destruct);
+    for (int64_t i = 0; i < length; i++) {
+        stList_append(keys, stIntTuple_construct1(requests[i]->key));
+    }
+    volatile bool failed = 0;
+    stTry {
+        stKVDatabase_bulkRemoveRecords(database, keys);
+    } stCatch(except) {
+        st_logDebug("Pipelined bulk remove failed, sending removes one at a time: %s\n", stExcept_getMsg(except));
+        failed = 1;
+    } stTryEnd;
+    stList_destruct(keys);
+    for (int64_t i = 0; failed && i < length; i++) {
+        sendOne(database, requests[i]);
+    }
+}
+
+// Sends the batch in order, as runs of requests of the same kind.
+static void sendBatch(stKVDatabase *database, stKVDatabaseRequest **requests, int64_t length) {
+    int64_t i = 0;
+    while (i < length) {
+        int64_t j = i + 1;
+        while (j < length && requests[j]->type == requests[i]->type) {
+            j++;
+        }
+        if (requests[i]->type == PIPELINE_GET) {
+            sendGets(database, requests + i, j - i);
+        } else if (requests[i]->type == PIPELINE_SET) {
+            sendSets(database, requests + i, j - i);
+        } else {
+            sendRemoves(database, requests + i, j - i);
+        }
+        i = j;
+    }
+}
+
+static void *sendRequests(void *arg) {
+    stKVDatabasePipeline *pipeline = arg;
+    stKVDatabaseRequest **batch = st_malloc(pipeline->maxBatchSize * sizeof(stKVDatabaseRequest *));
+    pthread_mutex_lock(&pipeline->lock);
+    while (1) {
+        while (pipeline->head == NULL && !pipeline->kill) {
+            pthread_cond_wait(&pipeline->queuedCond, &pipeline->lock);
+        }
+        if (pipeline->head == NULL) {
+            break;
+        }
+        int64_t length = 0;
+        while (pipeline->head != NULL && length < pipeline->maxBatchSize) {
+            batch[length++] = pipeline->head;
+            pipeline->head = pipeline->head->next;
+        }
+        if (pipeline->head == NULL) {
+            pipeline->tail = NULL;
+        }
+        pthread_mutex_unlock(&pipeline->lock);
+
+        sendBatch(pipeline->database, batch, length);
+
+        pthread_mutex_lock(&pipeline->lock);
+        for (int64_t i = 0; i < length; i++) {
+            atomicStore(&batch[i]->done, 1);
+        }
+        pipeline->outstanding -= length;
+        pthread_cond_broadcast(&pipeline->completedCond);
+    }
+    pthread_mutex_unlock(&pipeline->lock);
+    free(batch);
+    return NULL;
+}
+
+static stKVDatabaseRequest *submit(stKVDatabasePipeline *pipeline, enum requestType type, int64_t key,
+                                   const void *value, int64_t size) {
+    stKVDatabaseRequest *request = st_calloc(1, sizeof(stKVDatabaseRequest));
+    request->pipeline = pipeline;
+    request->type = type;
+    request->key = key;
+    if (value != NULL) {
+        request->value = memcpy(st_malloc(size), value, size);
+        request->size = size;
+    }
+    pthread_mutex_lock(&pipeline->lock);
+    if (pipeline->tail == NULL) {
+        pipeline->head = request;
+    } else {
+        pipeline->tail->next = request;
+    }
+    pipeline->tail = request;
+    pipeline->outstanding++;
+    pthread_cond_signal(&pipeline->queuedCond);
+    pthread_mutex_unlock(&pipeline->lock);
+    return request;
+}
+
+// Waits for the request without raising its failure.
+static void waitForRequest(stKVDatabaseRequest *request) {
+    if (atomicLoad(&request->done)) {
+        return; // The pipeline may have been destructed.
+    }
+    stKVDatabasePipeline *pipeline = request->pipeline;
+    pthread_mutex_lock(&pipeline->lock);
+    while (!request->done) {
+        pthread_cond_wait(&pipeline->completedCond, &pipeline->lock);
+    }
+    pthread_mutex_unlock(&pipeline->lock);
+}
+
+/*
+ * Public functions
+ */
+
+stKVDatabasePipeline *stKVDatabasePipeline_construct(stKVDatabase *database, int64_t maxBatchSize) {
+    if (maxBatchSize <= 0) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Pipeline batch size must be positive, got %" PRIi64, maxBatchSize);
+    }
+    stKVDatabasePipeline *pipeline = st_calloc(1, sizeof(stKVDatabasePipeline));
+    pipeline->database = database;
+    pipeline->maxBatchSize = maxBatchSize;
+    pthread_mutex_init(&pipeline->lock, NULL);
+    pthread_cond_init(&pipeline->queuedCond, NULL);
+    pthread_cond_init(&pipeline->completedCond, NULL);
+    if (pthread_create(&pipeline->thread, NULL, sendRequests, pipeline) != 0) {
+        st_errnoAbort("Failed to start the database pipeline thread");
+    }
+    return pipeline;
+}
+
+void stKVDatabasePipeline_destruct(stKVDatabasePipeline *pipeline) {
+    pthread_mutex_lock(&pipeline->lock);
+    pipeline->kill = 1;
+    pthread_cond_signal(&pipeline->queuedCond);
+    pthread_mutex_unlock(&pipeline->lock);
+    pthread_join(pipeline->thread, NULL); // The thread sends everything queued before it exits.
+    pthread_mutex_destroy(&pipeline->lock);
+    pthread_cond_destroy(&pipeline->queuedCond);
+    pthread_cond_destroy(&pipeline->completedCond);
+    free(pipeline);
+}
+
+void stKVDatabasePipeline_wait(stKVDatabasePipeline *pipeline) {
+    pthread_mutex_lock(&pipeline->lock);
+    while (pipeline->outstanding > 0) {
+        pthread_cond_wait(&pipeline->completedCond, &pipeline->lock);
+    }
+    pthread_mutex_unlock(&pipeline->lock);
+}
+
+stKVDatabaseRequest *stKVDatabasePipeline_getRecord(stKVDatabasePipeline *pipeline, int64_t key) {
+    return submit(pipeline, PIPELINE_GET, key, NULL, 0);
+}
+
+stKVDatabaseRequest *stKVDatabasePipeline_setRecord(stKVDatabasePipeline *pipeline, int64_t key,
+                                                    const void *value, int64_t sizeOfRecord) {
+    if (value == NULL) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Trying to insert a null record into a database");
+    }
+    return submit(pipeline, PIPELINE_SET, key, value, sizeOfRecord);
+}
+
+stKVDatabaseRequest *stKVDatabasePipeline_removeRecord(stKVDatabasePipeline *pipeline, int64_t key) {
+    return submit(pipeline, PIPELINE_REMOVE, key, NULL, 0);
+}
+
+bool stKVDatabaseRequest_done(stKVDatabaseRequest *request) {
+    return atomicLoad(&request->done);
+}
+
+void stKVDatabaseRequest_wait(stKVDatabaseRequest *request) {
+    waitForRequest(request);
+    if (request->except != NULL) {
+        stExcept *except = request->except;
+        request->except = NULL;
+        stThrowNewCause(except, ST_KV_DATABASE_EXCEPTION_ID, "Pipelined request for key %" PRIi64 " failed",
+                        request->key);
+    }
+}
+
+void *stKVDatabaseRequest_getRecord(stKVDatabaseRequest *request, int64_t *recordSize) {
+    stKVDatabaseRequest_wait(request);
+    if (request->type != PIPELINE_GET) {
+        return NULL;
+    }
+    void *record = request->value;
+    request->value = NULL;
+    *recordSize = request->size;
+    return record;
+}
+
+void stKVDatabaseRequest_destruct(stKVDatabaseRequest *request) {
+    waitForRequest(request);
+    stExcept_free(request->except);
+    free(request->value);
+    free(request);
+}
@@ -38,6 +38,14 @@ struct stKVDatabase {
     stList *(*bulkGetRecords)(stKVDatabase *database, stList* keys);
     stList *(*bulkGetRecordsRange)(stKVDatabase *database, int64_t firstKey, int64_t numRecords);
     void (*removeRecord)(stKVDatabase *, int64_t key);
+    // Optional, NULL for databases that write immediately and keep no statistics.
+    void (*flush)(stKVDatabase *);
+    void (*getCacheStats)(stKVDatabase *, int64_t *hits, int64_t *misses);
+    void (*getCompressionStats)(stKVDatabase *, int64_t *uncompressedBytes, int64_t *compressedBytes,
+                                double *compressSeconds, double *decompressSeconds);
+    // Optional, NULL for databases that can only return copies of records.
+    const void *(*borrowRecord)(stKVDatabase *, int64_t key, int64_t *recordSize);
+    void (*releaseRecord)(stKVDatabase *, const void *record);
 };
 
 enum stKVDatabaseBulkRequestType {
@@ -61,6 +69,18 @@ struct stKVDatabaseBulkResult {
  */
 void stKVDatabase_initialise_tokyoCabinet(stKVDatabase *database, stKVDatabaseConf *conf, bool create);
 
+/*
+ * Function initialises the pointers of the stKVDatabase object with functions for the
+ * embedded log file database.
+ */
+void stKVDatabase_initialise_logFile(stKVDatabase *database, stKVDatabaseConf *conf, bool create);
+
+/*
+ * Function initialises the pointers of the stKVDatabase object with functions for a database
+ * sharded over the databases given by the conf's shard confs.
+ */
+void stKVDatabase_initialise_sharded(stKVDatabase *database, stKVDatabaseConf *conf, bool create);
+
 /*
  * Function initialises the pointers of the stKVDatabase object with functions for MySql.
  */
@@ -81,4 +101,16 @@ void stKVDatabase_initialise_bigRecordFile(stKVDatabase *database, stKVDatabaseC
 
 void stKVDatabase_initialise_Redis(stKVDatabase *database, stKVDatabaseConf *conf, bool create);
 
+/*
+ * Wraps an initialised database in a cache, moving the database's functions
+ * into a private copy of the object that the cache reads from and writes to.
+ */
+void stKVDatabase_initialise_cache(stKVDatabase *database, int64_t cacheSize, int64_t writeBackSize);
+
+/*
+ * Wraps an initialised database in a layer compressing records in chunks of chunkSize bytes,
+ * in the same way as stKVDatabase_initialise_cache.
+ */
+void stKVDatabase_initialise_compression(stKVDatabase *database, int64_t chunkSize);
+
 #endif /* SONLIBKVDATABASEPRIVATE_H_ */
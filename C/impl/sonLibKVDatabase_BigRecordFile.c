@@ -21,7 +21,7 @@
 #include <limits.h>
 #include "sonLibGlobalsInternal.h"
 #include "sonLibKVDatabasePrivate.h"
-#include "sonLibSortedSet.h"
+#include "sonLibIntHash.h"
 #include "stSafeC.h"
 #include "sonLibTuples.h"
 
@@ -91,17 +91,17 @@ static size_t visitRecords(const char* basePath,
 }
 
 /*
- * add a path to a sorted set
+ * add a path to a set of keys
  */
-static void add_to_sortedSet(const char* recordPath, void* arg)
+static void add_to_keySet(const char* recordPath, void* arg)
 {
-	stSortedSet* sortedSet = (stSortedSet*)arg;
+	stIntSet* keySet = (stIntSet*)arg;
 	const char* fileName = strstr(recordPath, RECORD_FILE_TAG);
 	assert (fileName != NULL);
 	const char* keyString = fileName + strlen(RECORD_FILE_TAG);
 	assert (keyString != NULL);
 	int64_t key = atol(keyString);
-	stSortedSet_insert(sortedSet, stIntTuple_construct1( key));
+	stIntSet_insert(keySet, key);
 }
 
 /* get around complicated casting
@@ -112,35 +112,33 @@ static void remove_with_arg(const char* path, void* arg)
 }
 
 /*
- * build a sorted set of records in the given directory
+ * build a set of the keys of the records in the given directory
  */
-static stSortedSet* constructDB(stKVDatabaseConf *conf, bool create)
+static stIntSet* constructDB(stKVDatabaseConf *conf, bool create)
 {
 	const char *basePath = stKVDatabaseConf_getDir(conf);
     mkdir(basePath, S_IRWXU);
-    stSortedSet* sortedSet = stSortedSet_construct3(
-    		(int (*)(const void *, const void *))stIntTuple_cmpFn,
-    		(void (*)(void *))stIntTuple_destruct);
+    stIntSet* keySet = stIntSet_construct();
     if (create == true)
     {
     	visitRecords(basePath, remove_with_arg, NULL);
     }
     else
     {
-    	visitRecords(basePath, add_to_sortedSet, sortedSet);
+    	visitRecords(basePath, add_to_keySet, keySet);
     }
-    return sortedSet;
+    return keySet;
 }
 
 /*
- * database in memory is just a sorted set, so we destroy that.
+ * database in memory is just a set of keys, so we destroy that.
  */
 static void destructDB(stKVDatabase *database)
 {
-	stSortedSet* sortedSet  = (stSortedSet*)database->dbImpl;
-    if (sortedSet != NULL)
+	stIntSet* keySet  = (stIntSet*)database->dbImpl;
+    if (keySet != NULL)
     {
-    	stSortedSet_destruct(sortedSet);
+    	stIntSet_destruct(keySet);
     }
     database->dbImpl = NULL;
 }
@@ -160,21 +158,18 @@ static void deleteDB(stKVDatabase *database)
 /* check if a record already exists */
 static bool containsRecord(stKVDatabase *database, int64_t key)
 {
-	stSortedSet* sortedSet  = (stSortedSet*)database->dbImpl;
-	stIntTuple* tuple = stIntTuple_construct1( key);
-	void* found = stSortedSet_search(sortedSet, tuple);
-	stIntTuple_destruct(tuple);
-	return found != NULL;
+	stIntSet* keySet  = (stIntSet*)database->dbImpl;
+	return stIntSet_contains(keySet, key);
 }
 
 /* write the record as a file in the directory, and add the key
- * to the in-memory sorted set.
+ * to the in-memory set of keys.
  */
 static void insertRecord(stKVDatabase *database, int64_t key, const void *value,
 		int64_t sizeOfRecord)
 {
-	stSortedSet* sortedSet  = (stSortedSet*)database->dbImpl;
-	if (stSortedSet_size(sortedSet) >= MAX_NUMBER_ENTRIES)
+	stIntSet* keySet  = (stIntSet*)database->dbImpl;
+	if (stIntSet_size(keySet) >= MAX_NUMBER_ENTRIES)
 	{
 		stThrowNew(ST_KV_DATABASE_EXCEPTION_ID,
 				"Database capacity reached: %lld", (int64_t)MAX_NUMBER_ENTRIES);
@@ -190,7 +185,7 @@ static void insertRecord(stKVDatabase *database, int64_t key, const void *value,
 	{
 		stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Write file: %s", recordPath);
 	}
-	stSortedSet_insert(sortedSet, stIntTuple_construct1( key));
+	stIntSet_insert(keySet, key);
 	fclose(recHandle);
 	free(recordPath);
 }
@@ -210,8 +205,8 @@ static void setRecord(stKVDatabase *database, int64_t key, const void *value,
 
 static int64_t numberOfRecords(stKVDatabase *database)
 {
-	stSortedSet* sortedSet  = (stSortedSet*)database->dbImpl;
-	return (int64_t)stSortedSet_size(sortedSet);
+	stIntSet* keySet  = (stIntSet*)database->dbImpl;
+	return stIntSet_size(keySet);
 }
 
 /*
@@ -287,10 +282,8 @@ static void removeRecord(stKVDatabase *database, int64_t key)
 		stThrowNew(ST_KV_DATABASE_EXCEPTION_ID,
 				"Removing key not found: %lld", key);
 	}
-	stSortedSet* sortedSet  = (stSortedSet*)database->dbImpl;
-	stIntTuple* tuple = stIntTuple_construct1( key);
-	stSortedSet_remove(sortedSet, tuple);
-	stIntTuple_destruct(tuple);
+	stIntSet* keySet  = (stIntSet*)database->dbImpl;
+	stIntSet_remove(keySet, key);
 	char* recordPath = createRecordPath(stKVDatabase_getConf(database), key);
 	int retVal = remove(recordPath);
 	if (retVal != 0)
@@ -0,0 +1,353 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * sonLibKVDatabase_Cache.c
+ *
+ * A caching layer that sits in front of any other database. Whole records
+ * are cached as they are read or written, so repeated reads are answered
+ * without going to the database. With write back enabled, set and update
+ * requests are also held until enough bytes are waiting, then sent with a
+ * single bulk set.
+ *
+ * Only whole records are put in the cache, so a cached record with key k is
+ * always the fragment of k starting at offset 0. Partial reads are answered
+ * from cached records when possible, but are not themselves cached. Int64
+ * records are never cached, as the backends store them in their own format.
+ */
+
+#include "sonLibGlobalsInternal.h"
+#include "sonLibKVDatabasePrivate.h"
+
+typedef struct _cachedDatabase {
+    stKVDatabase *backend; // The wrapped database.
+    stCache *cache;
+    stIntHash *pending; // Held back writes, keys to stKVDatabaseBulkRequests.
+    int64_t pendingSize;
+    int64_t writeBackSize;
+    int64_t hits;
+    int64_t misses;
+} CachedDatabase;
+
+static CachedDatabase *getCached(stKVDatabase *database) {
+    return database->dbImpl;
+}
+
+static void flush(stKVDatabase *database) {
+    CachedDatabase *cached = getCached(database);
+    if (stIntHash_size(cached->pending) == 0) {
+        return;
+    }
+    stList *requests = stIntHash_getValues(cached->pending);
+    stList_setDestructor(requests, (void (*)(void *)) stKVDatabaseBulkRequest_destruct);
+    stIntHash_setDestructValues(cached->pending, NULL);
+    stIntHash_destruct(cached->pending);
+    cached->pending = stIntHash_construct2((void (*)(void *)) stKVDatabaseBulkRequest_destruct);
+    cached->pendingSize = 0;
+    stTry {
+        cached->backend->bulkSetRecords(cached->backend, requests);
+    } stCatch(ex) {
+        stList_destruct(requests);
+        stThrow(ex);
+    } stTryEnd;
+    stList_destruct(requests);
+}
+
+// Writes the held back requests, then any the backend holds itself.
+static void flushAll(stKVDatabase *database) {
+    CachedDatabase *cached = getCached(database);
+    flush(database);
+    if (cached->backend->flush != NULL) {
+        cached->backend->flush(cached->backend);
+    }
+}
+
+// Writes any held back request for the key, so the backend can be asked about it.
+static void flushKey(stKVDatabase *database, int64_t key) {
+    if (stIntHash_contains(getCached(database)->pending, key)) {
+        flush(database);
+    }
+}
+
+// Caches a copy of the whole record, replacing any older version.
+static void cacheRecord(CachedDatabase *cached, int64_t key, const void *value, int64_t size) {
+    stCache_removeRecord(cached->cache, key);
+    stCache_setRecord(cached->cache, key, 0, size, value);
+}
+
+static void holdBack(stKVDatabase *database, int64_t key, const void *value, int64_t size,
+                     enum stKVDatabaseBulkRequestType type) {
+    CachedDatabase *cached = getCached(database);
+    stKVDatabaseBulkRequest *request = stIntHash_remove(cached->pending, key);
+    if (request != NULL) {
+        // An update of a record that is held back to be set must still be a set.
+        if (request->type == SET) {
+            type = SET;
+        }
+        cached->pendingSize -= request->size;
+        stKVDatabaseBulkRequest_destruct(request);
+    }
+    request = type == SET ? stKVDatabaseBulkRequest_constructSetRequest(key, value, size)
+            : stKVDatabaseBulkRequest_constructUpdateRequest(key, value, size);
+    stIntHash_insert(cached->pending, key, request);
+    cached->pendingSize += size;
+    cacheRecord(cached, key, value, size);
+    if (cached->pendingSize >= cached->writeBackSize) {
+        flush(database);
+    }
+}
+
+static void destructDB(stKVDatabase *database) {
+    CachedDatabase *cached = getCached(database);
+    flush(database);
+    cached->backend->destruct(cached->backend);
+    free(cached->backend);
+    stCache_destruct(cached->cache);
+    stIntHash_destruct(cached->pending);
+    free(cached);
+}
+
+static void deleteDB(stKVDatabase *database) {
+    CachedDatabase *cached = getCached(database);
+    cached->backend->deleteDatabase(cached->backend);
+    free(cached->backend);
+    stCache_destruct(cached->cache);
+    stIntHash_destruct(cached->pending);
+    free(cached);
+}
+
+static bool containsRecord(stKVDatabase *database, int64_t key) {
+    CachedDatabase *cached = getCached(database);
+    if (stIntHash_contains(cached->pending, key) || stCache_containsRecord(cached->cache, key, 0, 0)) {
+        return 1;
+    }
+    return cached->backend->containsRecord(cached->backend, key);
+}
+
+static void insertRecord(stKVDatabase *database, int64_t key, const void *value, int64_t sizeOfRecord) {
+    CachedDatabase *cached = getCached(database);
+    flushKey(database, key);
+    cached->backend->insertRecord(cached->backend, key, value, sizeOfRecord);
+    cacheRecord(cached, key, value, sizeOfRecord);
+}
+
+static void updateRecord(stKVDatabase *database, int64_t key, const void *value, int64_t sizeOfRecord) {
+    CachedDatabase *cached = getCached(database);
+    if (cached->writeBackSize > 0) {
+        if (!containsRecord(database, key)) {
+            stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Trying to update a record that is not in the database: %" PRIi64, key);
+        }
+        holdBack(database, key, value, sizeOfRecord, UPDATE);
+        return;
+    }
+    cached->backend->updateRecord(cached->backend, key, value, sizeOfRecord);
+    cacheRecord(cached, key, value, sizeOfRecord);
+}
+
+static void setRecord(stKVDatabase *database, int64_t key, const void *value, int64_t sizeOfRecord) {
+    CachedDatabase *cached = getCached(database);
+    if (cached->writeBackSize > 0) {
+        holdBack(database, key, value, sizeOfRecord, SET);
+        return;
+    }
+    cached->backend->setRecord(cached->backend, key, value, sizeOfRecord);
+    cacheRecord(cached, key, value, sizeOfRecord);
+}
+
+static void insertInt64(stKVDatabase *database, int64_t key, int64_t value) {
+    CachedDatabase *cached = getCached(database);
+    flushKey(database, key);
+    stCache_removeRecord(cached->cache, key);
+    cached->backend->insertInt64(cached->backend, key, value);
+}
+
+static void updateInt64(stKVDatabase *database, int64_t key, int64_t value) {
+    CachedDatabase *cached = getCached(database);
+    flushKey(database, key);
+    stCache_removeRecord(cached->cache, key);
+    cached->backend->updateInt64(cached->backend, key, value);
+}
+
+static int64_t incrementInt64(stKVDatabase *database, int64_t key, int64_t incrementAmount) {
+    CachedDatabase *cached = getCached(database);
+    flushKey(database, key);
+    stCache_removeRecord(cached->cache, key);
+    return cached->backend->incrementInt64(cached->backend, key, incrementAmount);
+}
+
+static int64_t getInt64(stKVDatabase *database, int64_t key) {
+    CachedDatabase *cached = getCached(database);
+    flushKey(database, key);
+    return cached->backend->getInt64(cached->backend, key);
+}
+
+static void bulkSetRecords(stKVDatabase *database, stList *records) {
+    CachedDatabase *cached = getCached(database);
+    flush(database);
+    cached->backend->bulkSetRecords(cached->backend, records);
+    for (int64_t i = 0; i < stList_length(records); i++) {
+        stKVDatabaseBulkRequest *request = stList_get(records, i);
+        cacheRecord(cached, request->key, request->value, request->size);
+    }
+}
+
+static void bulkRemoveRecords(stKVDatabase *database, stList *records) {
+    CachedDatabase *cached = getCached(database);
+    flush(database);
+    for (int64_t i = 0; i < stList_length(records); i++) {
+        stCache_removeRecord(cached->cache, stIntTuple_get(stList_get(records, i), 0));
+    }
+    cached->backend->bulkRemoveRecords(cached->backend, records);
+}
+
+static int64_t numberOfRecords(stKVDatabase *database) {
+    CachedDatabase *cached = getCached(database);
+    flush(database);
+    return cached->backend->numberOfRecords(cached->backend);
+}
+
+static void *getRecord2(stKVDatabase *database, int64_t key, int64_t *recordSize) {
+    CachedDatabase *cached = getCached(database);
+    void *record = stCache_getRecord(cached->cache, key, 0, INT64_MAX, recordSize);
+    if (record != NULL) {
+        cached->hits++;
+        return record;
+    }
+    cached->misses++;
+    flushKey(database, key); // Held back records are always cached, unless evicted.
+    record = cached->backend->getRecord2(cached->backend, key, recordSize);
+    if (record != NULL) {
+        stCache_setRecord(cached->cache, key, 0, *recordSize, record);
+    }
+    return record;
+}
+
+static void *getRecord(stKVDatabase *database, int64_t key) {
+    int64_t recordSize;
+    return getRecord2(database, key, &recordSize);
+}
+
+static void *getPartialRecord(stKVDatabase *database, int64_t key, int64_t zeroBasedByteOffset, int64_t sizeInBytes,
+                              int64_t recordSize) {
+    CachedDatabase *cached = getCached(database);
+    int64_t sizeRead;
+    void *record = stCache_getRecord(cached->cache, key, zeroBasedByteOffset, sizeInBytes, &sizeRead);
+    if (record != NULL) {
+        cached->hits++;
+        return record;
+    }
+    cached->misses++;
+    flushKey(database, key);
+    return cached->backend->getPartialRecord(cached->backend, key, zeroBasedByteOffset, sizeInBytes, recordSize);
+}
+
+static stList *bulkGetRecords(stKVDatabase *database, stList *keys) {
+    CachedDatabase *cached = getCached(database);
+    stList *results = stList_construct3(stList_length(keys), (void (*)(void *)) stKVDatabaseBulkResult_destruct);
+    stList *missingKeys = stList_construct();
+    stList *missingIndices = stList_construct();
+    for (int64_t i = 0; i < stList_length(keys); i++) {
+        int64_t *key = stList_get(keys, i);
+        int64_t recordSize = 0;
+        void *record = stCache_getRecord(cached->cache, *key, 0, INT64_MAX, &recordSize);
+        if (record != NULL) {
+            cached->hits++;
+            stList_set(results, i, stKVDatabaseBulkResult_construct(record, recordSize));
+        } else {
+            cached->misses++;
+            flushKey(database, *key);
+            stList_append(missingKeys, key);
+            stList_append(missingIndices, (void *) (intptr_t) i);
+        }
+    }
+    if (stList_length(missingKeys) > 0) {
+        // Only the records that missed the cache are fetched, with one request.
+        stList *missingResults = cached->backend->bulkGetRecords(cached->backend, missingKeys);
+        for (int64_t i = 0; i < stList_length(missingResults); i++) {
+            stKVDatabaseBulkResult *result = stList_get(missingResults, i);
+            if (result->value != NULL) {
+                stCache_setRecord(cached->cache, *(int64_t *) stList_get(missingKeys, i), 0, result->size,
+                                  result->value);
+            }
+            stList_set(results, (intptr_t) stList_get(missingIndices, i), result);
+        }
+        stList_setDestructor(missingResults, NULL);
+        stList_destruct(missingResults);
+    }
+    stList_destruct(missingKeys);
+    stList_destruct(missingIndices);
+    return results;
+}
+
+static stList *bulkGetRecordsRange(stKVDatabase *database, int64_t firstKey, int64_t numRecords) {
+    stList *keys = stList_construct3(numRecords, free);
+    for (int64_t i = 0; i < numRecords; i++) {
+        int64_t *key = st_malloc(sizeof(int64_t));
+        *key = firstKey + i;
+        stList_set(keys, i, key);
+    }
+    stList *results = bulkGetRecords(database, keys);
+    stList_destruct(keys);
+    return results;
+}
+
+static void removeRecord(stKVDatabase *database, int64_t key) {
+    CachedDatabase *cached = getCached(database);
+    flushKey(database, key);
+    stCache_removeRecord(cached->cache, key);
+    cached->backend->removeRecord(cached->backend, key);
+}
+
+static void getCacheStats(stKVDatabase *database, int64_t *hits, int64_t *misses) {
+    CachedDatabase *cached = getCached(database);
+    *hits = cached->hits;
+    *misses = cached->misses;
+}
+
+static void getCompressionStats(stKVDatabase *database, int64_t *uncompressedBytes, int64_t *compressedBytes,
+                                double *compressSeconds, double *decompressSeconds) {
+    stKVDatabase_getCompressionStats(getCached(database)->backend, uncompressedBytes, compressedBytes,
+                                     compressSeconds, decompressSeconds);
+}
+
+//initialisation function
+
+void stKVDatabase_initialise_cache(stKVDatabase *database, int64_t cacheSize, int64_t writeBackSize) {
+    CachedDatabase *cached = st_malloc(sizeof(CachedDatabase));
+    cached->backend = memcpy(st_malloc(sizeof(stKVDatabase)), database, sizeof(stKVDatabase));
+    cached->cache = stCache_construct2(cacheSize);
+    cached->pending = stIntHash_construct2((void (*)(void *)) stKVDatabaseBulkRequest_destruct);
+    cached->pendingSize = 0;
+    cached->writeBackSize = writeBackSize;
+    cached->hits = 0;
+    cached->misses = 0;
+    database->dbImpl = cached;
+    database->secondaryDB = NULL;
+    database->destruct = destructDB;
+    database->deleteDatabase = deleteDB;
+    database->containsRecord = containsRecord;
+    database->insertRecord = insertRecord;
+    database->insertInt64 = insertInt64;
+    database->updateRecord = updateRecord;
+    database->updateInt64 = updateInt64;
+    database->setRecord = setRecord;
+    database->incrementInt64 = incrementInt64;
+    database->bulkSetRecords = bulkSetRecords;
+    database->bulkRemoveRecords = bulkRemoveRecords;
+    database->numberOfRecords = numberOfRecords;
+    database->getRecord = getRecord;
+    database->getInt64 = getInt64;
+    database->getRecord2 = getRecord2;
+    database->getPartialRecord = getPartialRecord;
+    database->bulkGetRecords = bulkGetRecords;
+    database->bulkGetRecordsRange = bulkGetRecordsRange;
+    database->removeRecord = removeRecord;
+    database->flush = flushAll;
+    database->getCacheStats = getCacheStats;
+    database->getCompressionStats = getCompressionStats;
+    database->borrowRecord = NULL; // The cache only hands out copies.
+    database->releaseRecord = NULL;
+}
@@ -0,0 +1,347 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * sonLibKVDatabase_Compressed.c
+ *
+ * A layer in front of any other database that compresses records with LZ4
+ * as they are written and decompresses them as they are read.
+ *
+ * A record is stored as a frame (see stCompression_compressFrame) whose
+ * blocks are chunks of a fixed size, compressed independently and in
+ * parallel, so a partial read only decompresses the chunks covering the
+ * bytes asked for.
+ *
+ * Int64 records are passed through uncompressed, as the backends store them
+ * in their own format.
+ */
+
+#define _POSIX_C_SOURCE 199309L // needed for clock_gettime()
+
+#include <time.h>
+#include "sonLibGlobalsInternal.h"
+#include "sonLibKVDatabasePrivate.h"
+
+typedef struct _compressedDatabase {
+    stKVDatabase *backend; // The wrapped database.
+    int64_t chunkSize;
+    int64_t uncompressedBytes; // The sizes of the records written, before and after compression.
+    int64_t compressedBytes;
+    double compressSeconds;
+    double decompressSeconds;
+} CompressedDatabase;
+
+static CompressedDatabase *getCompressed(stKVDatabase *database) {
+    return database->dbImpl;
+}
+
+static double getTime(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void *compressRecord(CompressedDatabase *compressed, const void *value, int64_t size, int64_t *storedSize) {
+    double start = getTime();
+    void *stored = stCompression_compressFrame(value, size, storedSize, compressed->chunkSize);
+    compressed->uncompressedBytes += size;
+    compressed->compressedBytes += *storedSize;
+    compressed->compressSeconds += getTime() - start;
+    return stored;
+}
+
+// Checks the stored record is a valid frame, returning the record's size.
+static int64_t checkStored(int64_t key, const char *stored, int64_t storedSize) {
+    int64_t size = 0;
+    stTry {
+        size = stCompression_getFrameDataSize(stored, storedSize);
+    } stCatch(ex) {
+        stThrowNewCause(ex, ST_KV_DATABASE_EXCEPTION_ID, "Compressed record %" PRIi64 " is invalid", key);
+    } stTryEnd;
+    return size;
+}
+
+// Decompresses length bytes of the record from the offset, decompressing only the chunks needed.
+static void *decompressRange(CompressedDatabase *compressed, int64_t key, const char *stored, int64_t storedSize,
+                             int64_t offset, int64_t length) {
+    double start = getTime();
+    char *record = st_malloc(length > 0 ? length : 1);
+    stTry {
+        stCompression_decompressFrameRange(stored, storedSize, offset, length, record);
+    } stCatch(ex) {
+        free(record);
+        stThrowNewCause(ex, ST_KV_DATABASE_EXCEPTION_ID, "Compressed record %" PRIi64 " is corrupt", key);
+    } stTryEnd;
+    compressed->decompressSeconds += getTime() - start;
+    return record;
+}
+
+static void *decompressRecord(CompressedDatabase *compressed, int64_t key, const char *stored, int64_t storedSize,
+                              int64_t *size) {
+    *size = checkStored(key, stored, storedSize);
+    return decompressRange(compressed, key, stored, storedSize, 0, *size);
+}
+
+static void destructDB(stKVDatabase *database) {
+    CompressedDatabase *compressed = getCompressed(database);
+    compressed->backend->destruct(compressed->backend);
+    free(compressed->backend);
+    free(compressed);
+}
+
+static void deleteDB(stKVDatabase *database) {
+    CompressedDatabase *compressed = getCompressed(database);
+    compressed->backend->deleteDatabase(compressed->backend);
+    free(compressed->backend);
+    free(compressed);
+}
+
+static bool containsRecord(stKVDatabase *database, int64_t key) {
+    CompressedDatabase *compressed = getCompressed(database);
+    return compressed->backend->containsRecord(compressed->backend, key);
+}
+
+static void insertRecord(stKVDatabase *database, int64_t key, const void *value, int64_t sizeOfRecord) {
+    CompressedDatabase *compressed = getCompressed(database);
+    int64_t storedSize;
+    void *stored = compressRecord(compressed, value, sizeOfRecord, &storedSize);
+    stTry {
+        compressed->backend->insertRecord(compressed->backend, key, stored, storedSize);
+    } stCatch(ex) {
+        free(stored);
+        stThrow(ex);
+    } stTryEnd;
+    free(stored);
+}
+
+static void updateRecord(stKVDatabase *database, int64_t key, const void *value, int64_t sizeOfRecord) {
+    CompressedDatabase *compressed = getCompressed(database);
+    int64_t storedSize;
+    void *stored = compressRecord(compressed, value, sizeOfRecord, &storedSize);
+    stTry {
+        compressed->backend->updateRecord(compressed->backend, key, stored, storedSize);
+    } stCatch(ex) {
+        free(stored);
+        stThrow(ex);
+    } stTryEnd;
+    free(stored);
+}
+
+static void setRecord(stKVDatabase *database, int64_t key, const void *value, int64_t sizeOfRecord) {
+    CompressedDatabase *compressed = getCompressed(database);
+    int64_t storedSize;
+    void *stored = compressRecord(compressed, value, sizeOfRecord, &storedSize);
+    stTry {
+        compressed->backend->setRecord(compressed->backend, key, stored, storedSize);
+    } stCatch(ex) {
+        free(stored);
+        stThrow(ex);
+    } stTryEnd;
+    free(stored);
+}
+
+static void insertInt64(stKVDatabase *database, int64_t key, int64_t value) {
+    CompressedDatabase *compressed = getCompressed(database);
+    compressed->backend->insertInt64(compressed->backend, key, value);
+}
+
+static void updateInt64(stKVDatabase *database, int64_t key, int64_t value) {
+    CompressedDatabase *compressed = getCompressed(database);
+    compressed->backend->updateInt64(compressed->backend, key, value);
+}
+
+static int64_t incrementInt64(stKVDatabase *database, int64_t key, int64_t incrementAmount) {
+    CompressedDatabase *compressed = getCompressed(database);
+    return compressed->backend->incrementInt64(compressed->backend, key, incrementAmount);
+}
+
+static int64_t getInt64(stKVDatabase *database, int64_t key) {
+    CompressedDatabase *compressed = getCompressed(database);
+    return compressed->backend->getInt64(compressed->backend, key);
+}
+
+static void bulkSetRecords(stKVDatabase *database, stList *records) {
+    CompressedDatabase *compressed = getCompressed(database);
+    stList *storedRecords = stList_construct3(stList_length(records),
+                                              (void (*)(void *)) stKVDatabaseBulkRequest_destruct);
+    for (int64_t i = 0; i < stList_length(records); i++) {
+        stKVDatabaseBulkRequest *request = stList_get(records, i);
+        stKVDatabaseBulkRequest *storedRequest = st_malloc(sizeof(stKVDatabaseBulkRequest));
+        storedRequest->key = request->key;
+        storedRequest->value = compressRecord(compressed, request->value, request->size, &storedRequest->size);
+        storedRequest->type = request->type;
+        stList_set(storedRecords, i, storedRequest);
+    }
+    stTry {
+        compressed->backend->bulkSetRecords(compressed->backend, storedRecords);
+    } stCatch(ex) {
+        stList_destruct(storedRecords);
+        stThrow(ex);
+    } stTryEnd;
+    stList_destruct(storedRecords);
+}
+
+static void bulkRemoveRecords(stKVDatabase *database, stList *records) {
+    CompressedDatabase *compressed = getCompressed(database);
+    compressed->backend->bulkRemoveRecords(compressed->backend, records);
+}
+
+static int64_t numberOfRecords(stKVDatabase *database) {
+    CompressedDatabase *compressed = getCompressed(database);
+    return compressed->backend->numberOfRecords(compressed->backend);
+}
+
+static void *getRecord2(stKVDatabase *database, int64_t key, int64_t *recordSize) {
+    CompressedDatabase *compressed = getCompressed(database);
+    int64_t storedSize;
+    char *stored = compressed->backend->getRecord2(compressed->backend, key, &storedSize);
+    if (stored == NULL) {
+        return NULL;
+    }
+    void *record = NULL;
+    stTry {
+        record = decompressRecord(compressed, key, stored, storedSize, recordSize);
+    } stCatch(ex) {
+        free(stored);
+        stThrow(ex);
+    } stTryEnd;
+    free(stored);
+    return record;
+}
+
+static void *getRecord(stKVDatabase *database, int64_t key) {
+    int64_t recordSize;
+    return getRecord2(database, key, &recordSize);
+}
+
+static void releaseStored(stKVDatabase *backend, const char *stored) {
+    if (backend->borrowRecord != NULL) {
+        backend->releaseRecord(backend, stored);
+    } else {
+        free((void *) stored);
+    }
+}
+
+static void *getPartialRecord(stKVDatabase *database, int64_t key, int64_t zeroBasedByteOffset, int64_t sizeInBytes,
+                              int64_t recordSize) {
+    CompressedDatabase *compressed = getCompressed(database);
+    stKVDatabase *backend = compressed->backend;
+    // Where the backend can lend the stored record nothing is copied, otherwise the whole stored record is read.
+    int64_t storedSize;
+    const char *stored = backend->borrowRecord != NULL ? backend->borrowRecord(backend, key, &storedSize)
+            : backend->getRecord2(backend, key, &storedSize);
+    if (stored == NULL) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "The record does not exist: %" PRIi64 " for partial retrieval", key);
+    }
+    void *record = NULL;
+    stTry {
+        int64_t size = checkStored(key, stored, storedSize);
+        if (size != recordSize) {
+            stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "The given record size is incorrect: %" PRIi64
+                       ", should be %" PRIi64, recordSize, size);
+        }
+        record = decompressRange(compressed, key, stored, storedSize, zeroBasedByteOffset, sizeInBytes);
+    } stCatch(ex) {
+        releaseStored(backend, stored);
+        stThrow(ex);
+    } stTryEnd;
+    releaseStored(backend, stored);
+    return record;
+}
+
+static stList *decompressResults(stKVDatabase *database, stList *keys, stList *results) {
+    CompressedDatabase *compressed = getCompressed(database);
+    stTry {
+        for (int64_t i = 0; i < stList_length(results); i++) {
+            stKVDatabaseBulkResult *result = stList_get(results, i);
+            if (result->value != NULL) {
+                int64_t size;
+                void *record = decompressRecord(compressed, *(int64_t *) stList_get(keys, i), result->value,
+                                                result->size, &size);
+                free(result->value);
+                result->value = record;
+                result->size = size;
+            }
+        }
+    } stCatch(ex) {
+        stList_destruct(results);
+        stThrow(ex);
+    } stTryEnd;
+    return results;
+}
+
+static stList *bulkGetRecords(stKVDatabase *database, stList *keys) {
+    CompressedDatabase *compressed = getCompressed(database);
+    return decompressResults(database, keys, compressed->backend->bulkGetRecords(compressed->backend, keys));
+}
+
+static stList *bulkGetRecordsRange(stKVDatabase *database, int64_t firstKey, int64_t numRecords) {
+    stList *keys = stList_construct3(numRecords, free);
+    for (int64_t i = 0; i < numRecords; i++) {
+        int64_t *key = st_malloc(sizeof(int64_t));
+        *key = firstKey + i;
+        stList_set(keys, i, key);
+    }
+    stList *results = bulkGetRecords(database, keys);
+    stList_destruct(keys);
+    return results;
+}
+
+static void removeRecord(stKVDatabase *database, int64_t key) {
+    CompressedDatabase *compressed = getCompressed(database);
+    compressed->backend->removeRecord(compressed->backend, key);
+}
+
+static void flush(stKVDatabase *database) {
+    stKVDatabase_flush(getCompressed(database)->backend);
+}
+
+static void getCacheStats(stKVDatabase *database, int64_t *hits, int64_t *misses) {
+    stKVDatabase_getCacheStats(getCompressed(database)->backend, hits, misses);
+}
+
+static void getCompressionStats(stKVDatabase *database, int64_t *uncompressedBytes, int64_t *compressedBytes,
+                                double *compressSeconds, double *decompressSeconds) {
+    CompressedDatabase *compressed = getCompressed(database);
+    *uncompressedBytes = compressed->uncompressedBytes;
+    *compressedBytes = compressed->compressedBytes;
+    *compressSeconds = compressed->compressSeconds;
+    *decompressSeconds = compressed->decompressSeconds;
+}
+
+//initialisation function
+
+void stKVDatabase_initialise_compression(stKVDatabase *database, int64_t chunkSize) {
+    CompressedDatabase *compressed = st_calloc(1, sizeof(CompressedDatabase));
+    compressed->backend = memcpy(st_malloc(sizeof(stKVDatabase)), database, sizeof(stKVDatabase));
+    compressed->chunkSize = chunkSize;
+    database->dbImpl = compressed;
+    database->secondaryDB = NULL;
+    database->destruct = destructDB;
+    database->deleteDatabase = deleteDB;
+    database->containsRecord = containsRecord;
+    database->insertRecord = insertRecord;
+    database->insertInt64 = insertInt64;
+    database->updateRecord = updateRecord;
+    database->updateInt64 = updateInt64;
+    database->setRecord = setRecord;
+    database->incrementInt64 = incrementInt64;
+    database->bulkSetRecords = bulkSetRecords;
+    database->bulkRemoveRecords = bulkRemoveRecords;
+    database->numberOfRecords = numberOfRecords;
+    database->getRecord = getRecord;
+    database->getInt64 = getInt64;
+    database->getRecord2 = getRecord2;
+    database->getPartialRecord = getPartialRecord;
+    database->bulkGetRecords = bulkGetRecords;
+    database->bulkGetRecordsRange = bulkGetRecordsRange;
+    database->removeRecord = removeRecord;
+    database->flush = flush;
+    database->getCacheStats = getCacheStats;
+    database->getCompressionStats = getCompressionStats;
+    database->borrowRecord = NULL; // Records are decompressed into copies.
+    database->releaseRecord = NULL;
+}
@@ -0,0 +1,655 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * sonLibKVDatabase_LogFile.c
+ *
+ * An embedded database kept in a single append only log file, needing no
+ * server or external library.
+ *
+ * Every change is appended to the log as an entry (a record or a removal),
+ * and every operation, including a whole bulk set or remove, ends with a
+ * commit entry. Entries carry a checksum, so when the database is opened the
+ * log is replayed up to the last intact commit and anything after it (an
+ * operation only partly written when the process or machine crashed) is cut
+ * off. Each operation is therefore applied completely or not at all.
+ *
+ * An in memory hash maps each key to the offset of its latest entry, and
+ * records are read straight from a read only mapping of the file. When most
+ * of the log is superseded entries it is compacted, by writing the current
+ * records to a new file and renaming it over the old one.
+ *
+ * Borrowed records point into the mapping. As the log is only appended to,
+ * they stay valid until the mapping is replaced (when the file outgrows it,
+ * or is compacted), so replaced mappings are kept until nothing is borrowed.
+ */
+
+// pwrite, fdatasync and mmap are POSIX, hidden by -std=c99.
+#if defined(__linux__) || (defined(__unix__) && !defined(__APPLE__))
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#endif
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <zlib.h>
+#include "sonLibGlobalsInternal.h"
+#include "sonLibKVDatabasePrivate.h"
+
+#define LOG_FILE_NAME "data.log"
+#define LOG_FILE_MAGIC "stKVLog1" // Starts the file, followed by the entries.
+#define LOG_FILE_MAGIC_LENGTH 8
+
+#define MIN_MAP_LENGTH (1 << 20)
+#define MIN_COMPACTION_LENGTH (1 << 24) // Smaller logs are never compacted.
+#define MAX_BUFFER_LENGTH (1 << 24) // Compaction writes in chunks of about this size.
+
+enum entryType {
+    ENTRY_RECORD = 0x52454331, ENTRY_REMOVE = 0x52454d31, ENTRY_COMMIT = 0x434f4d31
+};
+
+// Entries are aligned to eight bytes, so int64 records can be read in place.
+typedef struct _entryHeader {
+    uint32_t type;
+    uint32_t checksum; // Of the rest of the header and the value.
+    int64_t key;
+    int64_t size; // Of the value, which follows the header.
+} EntryHeader;
+
+typedef struct _logFile {
+    char *path;
+    int fd;
+    int64_t length; // Of the committed log, always the size of the file between operations.
+    char *map;
+    int64_t mapLength;
+    stIntHash *index; // Keys to the offsets of their record entries.
+    int64_t liveLength; // Total length of the entries in the index.
+    char *buffer; // Entries of the operation being written.
+    int64_t bufferLength;
+    int64_t bufferCapacity;
+    stList *staged; // Pairs of key and offset (or -1 for a removal) to index on commit.
+    int64_t borrowed; // Number of records borrowed and not yet released.
+    stList *retiredMaps; // Replaced mappings kept for borrowed records.
+} LogFile;
+
+typedef struct _mapping {
+    char *map;
+    int64_t length;
+} Mapping;
+
+static LogFile *getLog(stKVDatabase *database) {
+    return database->dbImpl;
+}
+
+static int64_t entryLength(int64_t size) {
+    return sizeof(EntryHeader) + ((size + 7) & ~(int64_t) 7);
+}
+
+static uint32_t checksum(const EntryHeader *header, const void *value) {
+    uLong crc = crc32(0L, (const Bytef *) &header->type, sizeof(uint32_t));
+    crc = crc32(crc, (const Bytef *) &header->key, 2 * sizeof(int64_t));
+    const Bytef *bytes = value;
+    for (int64_t i = 0; i < header->size; i += 1 << 30) { // crc32 takes a 32 bit length.
+        crc = crc32(crc, bytes + i, header->size - i < (1 << 30) ? header->size - i : (1 << 30));
+    }
+    return crc;
+}
+
+static EntryHeader *getEntry(LogFile *log, int64_t offset) {
+    return (EntryHeader *) (log->map + offset);
+}
+
+/*
+ * File handling.
+ */
+
+static void writeAll(LogFile *log, int fd, const char *bytes, int64_t length, int64_t offset) {
+    while (length > 0) {
+        ssize_t i = pwrite(fd, bytes, length, offset);
+        if (i < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Writing to database log %s failed: %s", log->path, strerror(errno));
+        }
+        bytes += i;
+        length -= i;
+        offset += i;
+    }
+}
+
+static void syncFile(LogFile *log, int fd) {
+    if (fdatasync(fd) != 0) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Syncing database log %s failed: %s", log->path, strerror(errno));
+    }
+}
+
+static void unmapRetired(LogFile *log) {
+    while (stList_length(log->retiredMaps) > 0) {
+        Mapping *mapping = stList_pop(log->retiredMaps);
+        munmap(mapping->map, mapping->length);
+        free(mapping);
+    }
+}
+
+// Maps the file, with room to grow, so the mapping is rarely replaced.
+static void mapFile(LogFile *log) {
+    if (log->map != NULL) {
+        if (log->borrowed > 0) {
+            Mapping *mapping = st_malloc(sizeof(Mapping));
+            mapping->map = log->map;
+            mapping->length = log->mapLength;
+            stList_append(log->retiredMaps, mapping);
+        } else {
+            munmap(log->map, log->mapLength);
+        }
+    }
+    log->mapLength = log->length * 2 > MIN_MAP_LENGTH ? log->length * 2 : MIN_MAP_LENGTH;
+    log->map = mmap(NULL, log->mapLength, PROT_READ, MAP_SHARED, log->fd, 0);
+    if (log->map == MAP_FAILED) {
+        log->map = NULL;
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Mapping database log %s failed: %s", log->path, strerror(errno));
+    }
+}
+
+static int openFile(LogFile *log, const char *path, bool truncate) {
+    int fd = open(path, O_RDWR | O_CREAT | (truncate ? O_TRUNC : 0), S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Opening database log %s failed: %s", path, strerror(errno));
+    }
+    return fd;
+}
+
+/*
+ * Writing operations.
+ */
+
+static void appendBytes(LogFile *log, const void *bytes, int64_t length) {
+    if (length == 0) {
+        return;
+    }
+    if (log->bufferLength + length > log->bufferCapacity) {
+        log->bufferCapacity = (log->bufferLength + length) * 2;
+        log->buffer = st_realloc(log->buffer, log->bufferCapacity);
+    }
+    memcpy(log->buffer + log->bufferLength, bytes, length);
+    log->bufferLength += length;
+}
+
+// Adds an entry to the operation being written, returning its offset in the file.
+static int64_t appendEntry(LogFile *log, enum entryType type, int64_t key, const void *value, int64_t size) {
+    EntryHeader header = { type, 0, key, size };
+    header.checksum = checksum(&header, value);
+    int64_t offset = log->length + log->bufferLength;
+    appendBytes(log, &header, sizeof(EntryHeader));
+    appendBytes(log, value, size);
+    static const char padding[8] = { 0 };
+    appendBytes(log, padding, entryLength(size) - sizeof(EntryHeader) - size);
+    return offset;
+}
+
+static void stage(LogFile *log, int64_t key, int64_t offset) {
+    stList_append(log->staged, stIntTuple_construct2(key, offset));
+}
+
+static void resetStaged(LogFile *log) {
+    while (stList_length(log->staged) > 0) {
+        stIntTuple_destruct(stList_pop(log->staged));
+    }
+}
+
+// Points the keys at their new entries, once they are safely in the log.
+static void applyStaged(LogFile *log) {
+    for (int64_t i = 0; i < stList_length(log->staged); i++) {
+        stIntTuple *change = stList_get(log->staged, i);
+        int64_t key = stIntTuple_get(change, 0), offset = stIntTuple_get(change, 1);
+        if (stIntHash_contains(log->index, key)) {
+            int64_t oldOffset = (int64_t) (intptr_t) stIntHash_remove(log->index, key);
+            log->liveLength -= entryLength(getEntry(log, oldOffset)->size);
+        }
+        if (offset >= 0) {
+            stIntHash_insert(log->index, key, (void *) (intptr_t) offset);
+            log->liveLength += entryLength(getEntry(log, offset)->size);
+        }
+    }
+    resetStaged(log);
+}
+
+static void abortOperation(LogFile *log) {
+    log->bufferLength = 0;
+    resetStaged(log);
+}
+
+static void compact(LogFile *log);
+
+// Writes the operation's entries and its commit entry to the log in one go.
+static void commit(LogFile *log) {
+    appendEntry(log, ENTRY_COMMIT, 0, NULL, 0);
+    stTry {
+        writeAll(log, log->fd, log->buffer, log->bufferLength, log->length);
+    } stCatch(except) {
+        // Cut off whatever was written, so the next operation follows the last commit.
+        if (ftruncate(log->fd, log->length) != 0) {
+            st_logCritical("Failed to truncate database log %s after a failed write\n", log->path);
+        }
+        abortOperation(log);
+        stThrowNewCause(except, ST_KV_DATABASE_EXCEPTION_ID, "Committing to database log failed");
+    } stTryEnd;
+    log->length += log->bufferLength;
+    log->bufferLength = 0;
+    if (log->length > log->mapLength) {
+        mapFile(log);
+    }
+    applyStaged(log);
+    if (log->length > MIN_COMPACTION_LENGTH && log->liveLength < log->length / 4) {
+        compact(log);
+    }
+}
+
+// Writes the current records to a new file, returning its length and building its index.
+static int64_t writeCompacted(LogFile *log, int fd, stIntHash *index) {
+    int64_t length = 0; // Written to the file so far.
+    appendBytes(log, LOG_FILE_MAGIC, LOG_FILE_MAGIC_LENGTH);
+    stIntHashIterator *it = stIntHash_getIterator(log->index);
+    int64_t key;
+    void *value;
+    while (stIntHash_getNext(it, &key, &value)) {
+        EntryHeader *entry = getEntry(log, (int64_t) (intptr_t) value);
+        int64_t offset = appendEntry(log, ENTRY_RECORD, key, entry + 1, entry->size) - log->length;
+        stIntHash_insert(index, key, (void *) (intptr_t) (length + offset));
+        if (log->bufferLength > MAX_BUFFER_LENGTH) {
+            writeAll(log, fd, log->buffer, log->bufferLength, length);
+            length += log->bufferLength;
+            log->bufferLength = 0;
+        }
+    }
+    stIntHash_destructIterator(it);
+    appendEntry(log, ENTRY_COMMIT, 0, NULL, 0);
+    writeAll(log, fd, log->buffer, log->bufferLength, length);
+    length += log->bufferLength;
+    log->bufferLength = 0;
+    syncFile(log, fd);
+    return length;
+}
+
+// Replaces the log with a copy holding only the current records. The copy is
+// renamed over the log once complete, so a crash leaves one or the other. A
+// failure leaves the log as it was.
+static void compact(LogFile *log) {
+    char *path = stString_print("%s.compact", log->path);
+    stIntHash *index = stIntHash_construct();
+    volatile int fd = -1;
+    volatile int64_t length = 0;
+    stTry {
+        fd = openFile(log, path, 1);
+        length = writeCompacted(log, fd, index);
+        if (rename(path, log->path) != 0) {
+            stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Renaming %s failed: %s", path, strerror(errno));
+        }
+    } stCatch(except) {
+        st_logInfo("Compacting database log %s failed, carrying on with it uncompacted: %s\n", log->path,
+                   stExcept_getMsg(except));
+        log->bufferLength = 0;
+        if (fd >= 0) {
+            close(fd);
+            unlink(path);
+        }
+        stIntHash_destruct(index);
+        index = NULL;
+    } stTryEnd;
+    free(path);
+    if (index == NULL) {
+        return;
+    }
+    close(log->fd);
+    log->fd = fd;
+    log->length = length;
+    stIntHash_destruct(log->index);
+    log->index = index;
+    log->liveLength = length - LOG_FILE_MAGIC_LENGTH - entryLength(0);
+    mapFile(log);
+}
+
+/*
+ * Opening the log.
+ */
+
+static bool validEntry(LogFile *log, int64_t offset, int64_t fileLength) {
+    if (offset + (int64_t) sizeof(EntryHeader) > fileLength) {
+        return 0;
+    }
+    EntryHeader *entry = getEntry(log, offset);
+    if (entry->type != ENTRY_RECORD && entry->type != ENTRY_REMOVE && entry->type != ENTRY_COMMIT) {
+        return 0;
+    }
+    if (entry->size < 0 || entry->size > fileLength - offset - (int64_t) sizeof(EntryHeader)) {
+        return 0;
+    }
+    return entry->checksum == checksum(entry, entry + 1);
+}
+
+// Rebuilds the index from the committed operations, cutting off any incomplete one at the end.
+static void replay(LogFile *log) {
+    struct stat info;
+    if (fstat(log->fd, &info) != 0) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Reading database log %s failed: %s", log->path, strerror(errno));
+    }
+    int64_t fileLength = info.st_size;
+    if (fileLength < LOG_FILE_MAGIC_LENGTH) {
+        // A new log, or one that crashed before its first commit.
+        writeAll(log, log->fd, LOG_FILE_MAGIC, LOG_FILE_MAGIC_LENGTH, 0);
+        fileLength = LOG_FILE_MAGIC_LENGTH;
+    }
+    log->length = fileLength;
+    mapFile(log);
+    if (memcmp(log->map, LOG_FILE_MAGIC, LOG_FILE_MAGIC_LENGTH) != 0) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "The file %s is not a database log", log->path);
+    }
+    int64_t offset = LOG_FILE_MAGIC_LENGTH, committedLength = offset;
+    while (validEntry(log, offset, fileLength)) {
+        EntryHeader *entry = getEntry(log, offset);
+        if (entry->type == ENTRY_COMMIT) {
+            applyStaged(log);
+            committedLength = offset + entryLength(0);
+        } else {
+            stage(log, entry->key, entry->type == ENTRY_RECORD ? offset : -1);
+        }
+        offset += entryLength(entry->size);
+    }
+    abortOperation(log);
+    if (committedLength < fileLength) {
+        st_logInfo("Discarding %" PRIi64 " bytes of incomplete operations from the end of database log %s\n",
+                   fileLength - committedLength, log->path);
+        if (ftruncate(log->fd, committedLength) != 0) {
+            stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Truncating database log %s failed: %s", log->path,
+                       strerror(errno));
+        }
+    }
+    log->length = committedLength;
+}
+
+static LogFile *constructDB(stKVDatabaseConf *conf, bool create) {
+    const char *dbDir = stKVDatabaseConf_getDir(conf);
+    mkdir(dbDir, S_IRWXU); // An existing directory is fine, and other failures show up opening the log.
+    LogFile *log = st_calloc(1, sizeof(LogFile));
+    log->path = stString_print("%s/%s", dbDir, LOG_FILE_NAME);
+    log->index = stIntHash_construct();
+    log->staged = stList_construct3(0, (void (*)(void *)) stIntTuple_destruct);
+    log->retiredMaps = stList_construct();
+    stTry {
+        log->fd = openFile(log, log->path, create);
+        replay(log);
+    } stCatch(except) {
+        stIntHash_destruct(log->index);
+        stList_destruct(log->staged);
+        stList_destruct(log->retiredMaps);
+        free(log->path);
+        free(log);
+        stThrow(except);
+    } stTryEnd;
+    return log;
+}
+
+static void closeLog(LogFile *log) {
+    if (log->map != NULL) {
+        munmap(log->map, log->mapLength);
+    }
+    unmapRetired(log);
+    stList_destruct(log->retiredMaps);
+    close(log->fd);
+    stIntHash_destruct(log->index);
+    stList_destruct(log->staged);
+    free(log->buffer);
+    free(log->path);
+    free(log);
+}
+
+static void destructDB(stKVDatabase *database) {
+    LogFile *log = getLog(database);
+    if (log != NULL) {
+        syncFile(log, log->fd);
+        closeLog(log);
+        database->dbImpl = NULL;
+    }
+}
+
+static void deleteDB(stKVDatabase *database) {
+    LogFile *log = getLog(database);
+    if (unlink(log->path) != 0) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Deleting database log %s failed: %s", log->path, strerror(errno));
+    }
+    closeLog(log);
+    database->dbImpl = NULL;
+    rmdir(stKVDatabaseConf_getDir(stKVDatabase_getConf(database))); // Only if nothing else is in it.
+}
+
+static void flush(stKVDatabase *database) {
+    syncFile(getLog(database), getLog(database)->fd);
+}
+
+/*
+ * Database functions.
+ */
+
+static bool containsRecord(stKVDatabase *database, int64_t key) {
+    return stIntHash_contains(getLog(database)->index, key);
+}
+
+// Returns the entry for the key, or NULL if it has no record.
+static EntryHeader *getRecordEntry(LogFile *log, int64_t key) {
+    if (!stIntHash_contains(log->index, key)) {
+        return NULL;
+    }
+    return getEntry(log, (int64_t) (intptr_t) stIntHash_search(log->index, key));
+}
+
+static void setRecord(stKVDatabase *database, int64_t key, const void *value, int64_t sizeOfRecord) {
+    LogFile *log = getLog(database);
+    stage(log, key, appendEntry(log, ENTRY_RECORD, key, value, sizeOfRecord));
+    commit(log);
+}
+
+static void insertRecord(stKVDatabase *database, int64_t key, const void *value, int64_t sizeOfRecord) {
+    if (containsRecord(database, key)) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Attempt to insert a key in the database that already exists: %" PRIi64, key);
+    }
+    setRecord(database, key, value, sizeOfRecord);
+}
+
+static void updateRecord(stKVDatabase *database, int64_t key, const void *value, int64_t sizeOfRecord) {
+    if (!containsRecord(database, key)) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Attempt to update a key in the database that doesn't exists: %" PRIi64, key);
+    }
+    setRecord(database, key, value, sizeOfRecord);
+}
+
+static void insertInt64(stKVDatabase *database, int64_t key, int64_t value) {
+    insertRecord(database, key, &value, sizeof(int64_t));
+}
+
+static void updateInt64(stKVDatabase *database, int64_t key, int64_t value) {
+    updateRecord(database, key, &value, sizeof(int64_t));
+}
+
+static void bulkSetRecords(stKVDatabase *database, stList *records) {
+    LogFile *log = getLog(database);
+    stIntHash *setKeys = stIntHash_construct(); // Keys set earlier in the operation.
+    for (int64_t i = 0; i < stList_length(records); i++) {
+        stKVDatabaseBulkRequest *request = stList_get(records, i);
+        bool exists = containsRecord(database, request->key) || stIntHash_contains(setKeys, request->key);
+        if ((request->type == INSERT && exists) || (request->type == UPDATE && !exists)) {
+            stIntHash_destruct(setKeys);
+            abortOperation(log);
+            stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Bulk %s of key %" PRIi64 " failed, as the key %s",
+                       request->type == INSERT ? "insert" : "update", request->key,
+                       exists ? "already exists" : "doesn't exist");
+        }
+        stIntHash_insert(setKeys, request->key, request);
+        stage(log, request->key, appendEntry(log, ENTRY_RECORD, request->key, request->value, request->size));
+    }
+    stIntHash_destruct(setKeys);
+    commit(log);
+}
+
+static void removeRecord(stKVDatabase *database, int64_t key) {
+    LogFile *log = getLog(database);
+    if (!containsRecord(database, key)) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Attempt to remove a key from the database that doesn't exist: %" PRIi64, key);
+    }
+    stage(log, key, -1);
+    appendEntry(log, ENTRY_REMOVE, key, NULL, 0);
+    commit(log);
+}
+
+static void bulkRemoveRecords(stKVDatabase *database, stList *records) {
+    LogFile *log = getLog(database);
+    stIntHash *removedKeys = stIntHash_construct();
+    for (int64_t i = 0; i < stList_length(records); i++) {
+        int64_t key = stIntTuple_get(stList_get(records, i), 0);
+        if (!containsRecord(database, key) || stIntHash_contains(removedKeys, key)) {
+            stIntHash_destruct(removedKeys);
+            abortOperation(log);
+            stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Bulk remove of key %" PRIi64 " failed, as the key doesn't exist", key);
+        }
+        stIntHash_insert(removedKeys, key, log);
+        stage(log, key, -1);
+        appendEntry(log, ENTRY_REMOVE, key, NULL, 0);
+    }
+    stIntHash_destruct(removedKeys);
+    commit(log);
+}
+
+static int64_t numberOfRecords(stKVDatabase *database) {
+    return stIntHash_size(getLog(database)->index);
+}
+
+static void *getRecord2(stKVDatabase *database, int64_t key, int64_t *recordSize) {
+    EntryHeader *entry = getRecordEntry(getLog(database), key);
+    if (entry == NULL) {
+        *recordSize = 0;
+        return NULL;
+    }
+    *recordSize = entry->size;
+    return memcpy(st_malloc(entry->size), entry + 1, entry->size);
+}
+
+static void *getRecord(stKVDatabase *database, int64_t key) {
+    int64_t i;
+    return getRecord2(database, key, &i);
+}
+
+static const void *borrowRecord(stKVDatabase *database, int64_t key, int64_t *recordSize) {
+    LogFile *log = getLog(database);
+    EntryHeader *entry = getRecordEntry(log, key);
+    if (entry == NULL) {
+        *recordSize = 0;
+        return NULL;
+    }
+    log->borrowed++;
+    *recordSize = entry->size;
+    return entry + 1;
+}
+
+static void releaseRecord(stKVDatabase *database, const void *record) {
+    LogFile *log = getLog(database);
+    assert(log->borrowed > 0);
+    if (--log->borrowed == 0) {
+        unmapRetired(log);
+    }
+}
+
+static int64_t getInt64(stKVDatabase *database, int64_t key) {
+    EntryHeader *entry = getRecordEntry(getLog(database), key);
+    return entry == NULL ? -1 : *(int64_t *) (entry + 1);
+}
+
+static int64_t incrementInt64(stKVDatabase *database, int64_t key, int64_t incrementAmount) {
+    EntryHeader *entry = getRecordEntry(getLog(database), key);
+    if (entry == NULL || entry->size < (int64_t) sizeof(int64_t)) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Attempt to increment a key that isn't an int64 record: %" PRIi64, key);
+    }
+    int64_t recordSize = entry->size;
+    int64_t *record = memcpy(st_malloc(recordSize), entry + 1, recordSize);
+    int64_t returnValue = record[0] += incrementAmount;
+    stTry {
+        setRecord(database, key, record, recordSize);
+    } stCatch(except) {
+        free(record);
+        stThrow(except);
+    } stTryEnd;
+    free(record);
+    return returnValue;
+}
+
+// Copies just the requested bytes from the mapping.
+static void *getPartialRecord(stKVDatabase *database, int64_t key, int64_t zeroBasedByteOffset, int64_t sizeInBytes,
+                              int64_t recordSize) {
+    EntryHeader *entry = getRecordEntry(getLog(database), key);
+    if (entry == NULL) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "The record does not exist: %" PRIi64 " for partial retrieval", key);
+    }
+    if (entry->size != recordSize) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "The given record size is incorrect: %" PRIi64 ", should be %" PRIi64,
+                   recordSize, entry->size);
+    }
+    if (zeroBasedByteOffset < 0 || sizeInBytes < 0 || zeroBasedByteOffset + sizeInBytes > recordSize) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID,
+                   "Partial record retrieval to out of bounds memory, record size: %" PRIi64 ", requested start: %" PRIi64
+                   ", requested size: %" PRIi64, recordSize, zeroBasedByteOffset, sizeInBytes);
+    }
+    return memcpy(st_malloc(sizeInBytes), (char *) (entry + 1) + zeroBasedByteOffset, sizeInBytes);
+}
+
+static stList *bulkGetRecords(stKVDatabase *database, stList *keys) {
+    stList *results = stList_construct3(stList_length(keys), (void (*)(void *)) stKVDatabaseBulkResult_destruct);
+    for (int64_t i = 0; i < stList_length(keys); i++) {
+        int64_t recordSize;
+        void *record = getRecord2(database, *(int64_t *) stList_get(keys, i), &recordSize);
+        stList_set(results, i, stKVDatabaseBulkResult_construct(record, recordSize));
+    }
+    return results;
+}
+
+static stList *bulkGetRecordsRange(stKVDatabase *database, int64_t firstKey, int64_t numRecords) {
+    stList *results = stList_construct3(numRecords, (void (*)(void *)) stKVDatabaseBulkResult_destruct);
+    for (int64_t i = 0; i < numRecords; i++) {
+        int64_t recordSize;
+        void *record = getRecord2(database, firstKey + i, &recordSize);
+        stList_set(results, i, stKVDatabaseBulkResult_construct(record, recordSize));
+    }
+    return results;
+}
+
+//initialisation function
+
+void stKVDatabase_initialise_logFile(stKVDatabase *database, stKVDatabaseConf *conf, bool create) {
+    database->dbImpl = constructDB(stKVDatabase_getConf(database), create);
+    database->destruct = destructDB;
+    database->deleteDatabase = deleteDB;
+    database->containsRecord = containsRecord;
+    database->insertRecord = insertRecord;
+    database->insertInt64 = insertInt64;
+    database->updateRecord = updateRecord;
+    database->updateInt64 = updateInt64;
+    database->setRecord = setRecord;
+    database->incrementInt64 = incrementInt64;
+    database->bulkSetRecords = bulkSetRecords;
+    database->bulkRemoveRecords = bulkRemoveRecords;
+    database->numberOfRecords = numberOfRecords;
+    database->getRecord = getRecord;
+    database->getInt64 = getInt64;
+    database->getRecord2 = getRecord2;
+    database->getPartialRecord = getPartialRecord;
+    database->bulkGetRecords = bulkGetRecords;
+    database->bulkGetRecordsRange = bulkGetRecordsRange;
+    database->removeRecord = removeRecord;
+    database->flush = flush;
+    database->borrowRecord = borrowRecord;
+    database->releaseRecord = releaseRecord;
+}
@@ -8,6 +8,7 @@
 // something like auth, using a different DB number, etc.
 typedef struct {
     redisContext *ctxt;
+    stHash *borrowed; // Borrowed records to the replies holding them.
 } RedisDB;
 
 static redisReply *stRedisCommand(RedisDB *db, const char *string, ...) {
@@ -63,12 +64,14 @@ static RedisDB *connect(stKVDatabaseConf *conf) {
         free(db);
         stThrow(except);
     }
+    db->borrowed = stHash_construct2(NULL, (void (*)(void *)) freeReplyObject);
     return db;
 }
 
 static void destructDB(stKVDatabase *database) {
     RedisDB *db = database->dbImpl;
     redisFree(db->ctxt);
+    stHash_destruct(db->borrowed);
     free(db);
     database->dbImpl = NULL;
 }
@@ -129,6 +132,25 @@ static void *getRecord2(stKVDatabase *database, int64_t key, int64_t *sizeOfReco
     }
 }
 
+// Returns the record in the reply's buffer, keeping the reply until the record is released.
+static const void *borrowRecord(stKVDatabase *database, int64_t key, int64_t *sizeOfRecord) {
+    RedisDB *db = database->dbImpl;
+    redisReply *reply = stRedisCommand(db, "GET %" PRIi64, key);
+    if (reply->type == REDIS_REPLY_NIL) {
+        freeReplyObject(reply);
+        return NULL;
+    }
+    assert(reply->type == REDIS_REPLY_STRING);
+    *sizeOfRecord = reply->len;
+    stHash_insert(db->borrowed, reply->str, reply);
+    return reply->str;
+}
+
+static void releaseRecord(stKVDatabase *database, const void *record) {
+    RedisDB *db = database->dbImpl;
+    freeReplyObject(stHash_remove(db->borrowed, (void *) record));
+}
+
 static int64_t getInt64(stKVDatabase *database, int64_t key) {
     int64_t len = 0;
     void *record = getRecord2(database, key, &len);
@@ -321,6 +343,8 @@ void stKVDatabase_initialise_Redis(stKVDatabase *database, stKVDatabaseConf *con
     database->bulkGetRecords = bulkGetRecords;
     database->bulkGetRecordsRange = bulkGetRecordsRange;
     database->removeRecord = removeRecord;
+    database->borrowRecord = borrowRecord;
+    database->releaseRecord = releaseRecord;
 }
 
 #endif // HAVE_REDIS
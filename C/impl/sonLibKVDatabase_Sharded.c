@@ -0,0 +1,475 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * sonLibKVDatabase_Sharded.c
+ *
+ * A database spread over several other databases (shards). Each key lives
+ * on one shard, chosen by consistent hashing: every shard is given a number
+ * of points on a ring of 64 bit hashes, and a key belongs to the shard with
+ * the first point at or after the key's hash. Adding a shard only takes the
+ * keys that fall just before its points, about 1/n of them, from the other
+ * shards, so most records are still found where they were.
+ *
+ * Single record requests go straight to the key's shard. Bulk requests are
+ * split by shard and the parts sent at the same time, from a pool with a
+ * thread per shard, as the time is mostly spent waiting on the shards.
+ */
+
+#include "sonLibGlobalsInternal.h"
+#include "sonLibKVDatabasePrivate.h"
+
+// Points on the ring per shard, enough to spread keys evenly over the shards.
+#define POINTS_PER_SHARD 160
+
+typedef struct _shardedDB {
+    int64_t numShards;
+    stKVDatabase **shards;
+    uint64_t *points; // Sorted points on the ring.
+    int64_t *pointShards; // The shard owning each point.
+    stThreadPool *threadPool;
+    stHash *borrowed; // Borrowed records to BorrowedRecords.
+} ShardedDB;
+
+/*
+ * A shard may return the same view each time a key is borrowed, so views are counted, and
+ * forgotten when every borrow of them has been released.
+ */
+typedef struct _borrowedRecord {
+    stKVDatabase *shard;
+    int64_t count;
+} BorrowedRecord;
+
+// The splitmix64 finaliser, which spreads similar integers over the whole range.
+static uint64_t hash(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+static ShardedDB *getSharded(stKVDatabase *database) {
+    return database->dbImpl;
+}
+
+typedef struct _point {
+    uint64_t point;
+    int64_t shard;
+} Point;
+
+static int comparePoints(const void *a, const void *b) {
+    uint64_t i = ((const Point *) a)->point, j = ((const Point *) b)->point;
+    return i < j ? -1 : (i > j ? 1 : 0);
+}
+
+static void buildRing(ShardedDB *sharded) {
+    int64_t numPoints = sharded->numShards * POINTS_PER_SHARD;
+    Point *points = st_malloc(numPoints * sizeof(Point));
+    for (int64_t i = 0; i < sharded->numShards; i++) {
+        for (int64_t j = 0; j < POINTS_PER_SHARD; j++) {
+            points[i * POINTS_PER_SHARD + j].point = hash(hash(i) + j);
+            points[i * POINTS_PER_SHARD + j].shard = i;
+        }
+    }
+    qsort(points, numPoints, sizeof(Point), comparePoints);
+    sharded->points = st_malloc(numPoints * sizeof(uint64_t));
+    sharded->pointShards = st_malloc(numPoints * sizeof(int64_t));
+    for (int64_t i = 0; i < numPoints; i++) {
+        sharded->points[i] = points[i].point;
+        sharded->pointShards[i] = points[i].shard;
+    }
+    free(points);
+}
+
+static int64_t getShardIndex(ShardedDB *sharded, int64_t key) {
+    uint64_t h = hash((uint64_t) key);
+    // Binary search for the first point >= h, wrapping round to the first point.
+    int64_t low = 0, high = sharded->numShards * POINTS_PER_SHARD;
+    while (low < high) {
+        int64_t mid = low + (high - low) / 2;
+        if (sharded->points[mid] < h) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return sharded->pointShards[low == sharded->numShards * POINTS_PER_SHARD ? 0 : low];
+}
+
+static stKVDatabase *getShard(stKVDatabase *database, int64_t key) {
+    ShardedDB *sharded = getSharded(database);
+    return sharded->shards[getShardIndex(sharded, key)];
+}
+
+static void destructShards(ShardedDB *sharded) {
+    for (int64_t i = 0; i < sharded->numShards; i++) {
+        if (sharded->shards[i] != NULL) {
+            stKVDatabase_destruct(sharded->shards[i]);
+        }
+    }
+    if (sharded->threadPool != NULL) {
+        stThreadPool_destruct(sharded->threadPool);
+    }
+    if (sharded->borrowed != NULL) {
+        stHash_destruct(sharded->borrowed);
+    }
+    free(sharded->shards);
+    free(sharded->points);
+    free(sharded->pointShards);
+    free(sharded);
+}
+
+static void destructDB(stKVDatabase *database) {
+    destructShards(getSharded(database));
+}
+
+static void deleteDB(stKVDatabase *database) {
+    ShardedDB *sharded = getSharded(database);
+    for (int64_t i = 0; i < sharded->numShards; i++) {
+        stKVDatabase_deleteFromDisk(sharded->shards[i]);
+    }
+    destructShards(sharded);
+}
+
+/*
+ * Bulk requests.
+ */
+
+// The part of a bulk request going to one shard.
+typedef struct _shardBatch {
+    stKVDatabase *shard;
+    stList *items; // Keys, bulk requests or key tuples from the caller's list.
+    stList *indices; // The positions of the items in the caller's list.
+    stList *results;
+    void (*send)(struct _shardBatch *);
+    stExcept *except; // Set if the batch failed.
+} ShardBatch;
+
+static void sendGets(ShardBatch *batch) {
+    batch->results = stKVDatabase_bulkGetRecords(batch->shard, batch->items);
+}
+
+static void sendSets(ShardBatch *batch) {
+    stKVDatabase_bulkSetRecords(batch->shard, batch->items);
+}
+
+static void sendRemoves(ShardBatch *batch) {
+    stKVDatabase_bulkRemoveRecords(batch->shard, batch->items);
+}
+
+static void *sendBatch(void *arg) {
+    ShardBatch *batch = arg;
+    stTry {
+        batch->send(batch);
+    } stCatch(except) {
+        batch->except = stExcept_new(stExcept_getId(except), "%s", stExcept_getMsg(except));
+    } stTryEnd;
+    return NULL;
+}
+
+// Splits the items of a bulk request into a batch per shard, using getKey to find each item's key.
+static ShardBatch *splitByShard(stKVDatabase *database, stList *items, int64_t (*getKey)(void *),
+                                void (*send)(ShardBatch *)) {
+    ShardedDB *sharded = getSharded(database);
+    ShardBatch *batches = st_calloc(sharded->numShards, sizeof(ShardBatch));
+    for (int64_t i = 0; i < sharded->numShards; i++) {
+        batches[i].shard = sharded->shards[i];
+        batches[i].items = stList_construct();
+        batches[i].indices = stList_construct();
+        batches[i].send = send;
+    }
+    for (int64_t i = 0; i < stList_length(items); i++) {
+        ShardBatch *batch = &batches[getShardIndex(sharded, getKey(stList_get(items, i)))];
+        stList_append(batch->items, stList_get(items, i));
+        stList_append(batch->indices, (void *) (intptr_t) i);
+    }
+    return batches;
+}
+
+// Sends the non-empty batches in parallel, the last one from this thread.
+static void sendBatches(stKVDatabase *database, ShardBatch *batches) {
+    ShardedDB *sharded = getSharded(database);
+    stThreadPoolTask **tasks = st_calloc(sharded->numShards, sizeof(stThreadPoolTask *));
+    int64_t last = -1;
+    for (int64_t i = 0; i < sharded->numShards; i++) {
+        if (stList_length(batches[i].items) > 0) {
+            if (last != -1) {
+                tasks[last] = stThreadPool_submit(sharded->threadPool, sendBatch, &batches[last]);
+            }
+            last = i;
+        }
+    }
+    if (last != -1) {
+        sendBatch(&batches[last]);
+    }
+    for (int64_t i = 0; i < sharded->numShards; i++) {
+        if (tasks[i] != NULL) {
+            stThreadPoolTask_destruct(tasks[i]);
+        }
+    }
+    free(tasks);
+}
+
+// Frees the batches, throwing the first failure if any batch failed.
+static void destructBatches(stKVDatabase *database, ShardBatch *batches) {
+    ShardedDB *sharded = getSharded(database);
+    stExcept *except = NULL;
+    int64_t failedShard = 0;
+    for (int64_t i = 0; i < sharded->numShards; i++) {
+        if (batches[i].except != NULL) {
+            if (except == NULL) {
+                except = batches[i].except;
+                failedShard = i;
+            } else {
+                stExcept_free(batches[i].except);
+            }
+        }
+        stList_destruct(batches[i].items);
+        stList_destruct(batches[i].indices);
+        if (batches[i].results != NULL) {
+            stList_destruct(batches[i].results);
+        }
+    }
+    free(batches);
+    if (except != NULL) {
+        stThrowNewCause(except, ST_KV_DATABASE_EXCEPTION_ID, "Bulk request to shard %" PRIi64 " failed",
+                        failedShard);
+    }
+}
+
+static int64_t getKey(void *key) {
+    return *(int64_t *) key;
+}
+
+static int64_t getRequestKey(void *request) {
+    return ((stKVDatabaseBulkRequest *) request)->key;
+}
+
+static int64_t getTupleKey(void *tuple) {
+    return stIntTuple_get(tuple, 0);
+}
+
+static stList *bulkGetRecords(stKVDatabase *database, stList *keys) {
+    ShardedDB *sharded = getSharded(database);
+    ShardBatch *batches = splitByShard(database, keys, getKey, sendGets);
+    sendBatches(database, batches);
+    stList *results = stList_construct3(stList_length(keys), (void (*)(void *)) stKVDatabaseBulkResult_destruct);
+    for (int64_t i = 0; i < sharded->numShards; i++) {
+        if (batches[i].results != NULL) {
+            // Put each shard's results back in the order of the keys.
+            for (int64_t j = 0; j < stList_length(batches[i].results); j++) {
+                stList_set(results, (intptr_t) stList_get(batches[i].indices, j), stList_get(batches[i].results, j));
+            }
+            stList_setDestructor(batches[i].results, NULL);
+        }
+    }
+    stTry {
+        destructBatches(database, batches);
+    } stCatch(except) {
+        stList_destruct(results);
+        stThrow(except);
+    } stTryEnd;
+    return results;
+}
+
+static stList *bulkGetRecordsRange(stKVDatabase *database, int64_t firstKey, int64_t numRecords) {
+    stList *keys = stList_construct3(numRecords, free);
+    for (int64_t i = 0; i < numRecords; i++) {
+        int64_t *key = st_malloc(sizeof(int64_t));
+        *key = firstKey + i;
+        stList_set(keys, i, key);
+    }
+    stList *results = bulkGetRecords(database, keys);
+    stList_destruct(keys);
+    return results;
+}
+
+static void bulkSetRecords(stKVDatabase *database, stList *records) {
+    ShardBatch *batches = splitByShard(database, records, getRequestKey, sendSets);
+    sendBatches(database, batches);
+    destructBatches(database, batches);
+}
+
+static void bulkRemoveRecords(stKVDatabase *database, stList *records) {
+    ShardBatch *batches = splitByShard(database, records, getTupleKey, sendRemoves);
+    sendBatches(database, batches);
+    destructBatches(database, batches);
+}
+
+/*
+ * Single record requests.
+ */
+
+static bool containsRecord(stKVDatabase *database, int64_t key) {
+    return stKVDatabase_containsRecord(getShard(database, key), key);
+}
+
+static void insertRecord(stKVDatabase *database, int64_t key, const void *value, int64_t sizeOfRecord) {
+    stKVDatabase_insertRecord(getShard(database, key), key, value, sizeOfRecord);
+}
+
+static void insertInt64(stKVDatabase *database, int64_t key, int64_t value) {
+    stKVDatabase_insertInt64(getShard(database, key), key, value);
+}
+
+static void updateRecord(stKVDatabase *database, int64_t key, const void *value, int64_t sizeOfRecord) {
+    stKVDatabase_updateRecord(getShard(database, key), key, value, sizeOfRecord);
+}
+
+static void updateInt64(stKVDatabase *database, int64_t key, int64_t value) {
+    stKVDatabase_updateInt64(getShard(database, key), key, value);
+}
+
+static void setRecord(stKVDatabase *database, int64_t key, const void *value, int64_t sizeOfRecord) {
+    stKVDatabase_setRecord(getShard(database, key), key, value, sizeOfRecord);
+}
+
+static int64_t incrementInt64(stKVDatabase *database, int64_t key, int64_t incrementAmount) {
+    return stKVDatabase_incrementInt64(getShard(database, key), key, incrementAmount);
+}
+
+static int64_t numberOfRecords(stKVDatabase *database) {
+    ShardedDB *sharded = getSharded(database);
+    int64_t numRecords = 0;
+    for (int64_t i = 0; i < sharded->numShards; i++) {
+        numRecords += stKVDatabase_getNumberOfRecords(sharded->shards[i]);
+    }
+    return numRecords;
+}
+
+static void *getRecord(stKVDatabase *database, int64_t key) {
+    return stKVDatabase_getRecord(getShard(database, key), key);
+}
+
+static int64_t getInt64(stKVDatabase *database, int64_t key) {
+    return stKVDatabase_getInt64(getShard(database, key), key);
+}
+
+static void *getRecord2(stKVDatabase *database, int64_t key, int64_t *recordSize) {
+    return stKVDatabase_getRecord2(getShard(database, key), key, recordSize);
+}
+
+static void *getPartialRecord(stKVDatabase *database, int64_t key, int64_t zeroBasedByteOffset,
+                              int64_t sizeInBytes, int64_t recordSize) {
+    return stKVDatabase_getPartialRecord(getShard(database, key), key, zeroBasedByteOffset, sizeInBytes,
+                                         recordSize);
+}
+
+static void removeRecord(stKVDatabase *database, int64_t key) {
+    stKVDatabase_removeRecord(getShard(database, key), key);
+}
+
+static void flush(stKVDatabase *database) {
+    ShardedDB *sharded = getSharded(database);
+    for (int64_t i = 0; i < sharded->numShards; i++) {
+        stKVDatabase_flush(sharded->shards[i]);
+    }
+}
+
+static void getCacheStats(stKVDatabase *database, int64_t *hits, int64_t *misses) {
+    ShardedDB *sharded = getSharded(database);
+    *hits = 0;
+    *misses = 0;
+    for (int64_t i = 0; i < sharded->numShards; i++) {
+        int64_t shardHits, shardMisses;
+        stKVDatabase_getCacheStats(sharded->shards[i], &shardHits, &shardMisses);
+        *hits += shardHits;
+        *misses += shardMisses;
+    }
+}
+
+static void getCompressionStats(stKVDatabase *database, int64_t *uncompressedBytes, int64_t *compressedBytes,
+                                double *compressSeconds, double *decompressSeconds) {
+    ShardedDB *sharded = getSharded(database);
+    *uncompressedBytes = *compressedBytes = 0;
+    *compressSeconds = *decompressSeconds = 0.0;
+    for (int64_t i = 0; i < sharded->numShards; i++) {
+        int64_t shardUncompressedBytes, shardCompressedBytes;
+        double shardCompressSeconds, shardDecompressSeconds;
+        stKVDatabase_getCompressionStats(sharded->shards[i], &shardUncompressedBytes, &shardCompressedBytes,
+                                         &shardCompressSeconds, &shardDecompressSeconds);
+        *uncompressedBytes += shardUncompressedBytes;
+        *compressedBytes += shardCompressedBytes;
+        *compressSeconds += shardCompressSeconds;
+        *decompressSeconds += shardDecompressSeconds;
+    }
+}
+
+static const void *borrowRecord(stKVDatabase *database, int64_t key, int64_t *recordSize) {
+    stKVDatabase *shard = getShard(database, key);
+    const void *record = stKVDatabase_borrowRecord(shard, key, recordSize);
+    if (record != NULL) {
+        stHash *borrowed = getSharded(database)->borrowed;
+        BorrowedRecord *borrowedRecord = stHash_search(borrowed, (void *) record);
+        if (borrowedRecord == NULL) {
+            borrowedRecord = st_malloc(sizeof(BorrowedRecord));
+            borrowedRecord->shard = shard;
+            borrowedRecord->count = 0;
+            stHash_insert(borrowed, (void *) record, borrowedRecord);
+        }
+        borrowedRecord->count++;
+    }
+    return record;
+}
+
+static void releaseRecord(stKVDatabase *database, const void *record) {
+    stHash *borrowed = getSharded(database)->borrowed;
+    BorrowedRecord *borrowedRecord = stHash_search(borrowed, (void *) record);
+    if (borrowedRecord == NULL) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "Released a record that was not borrowed from the database");
+    }
+    stKVDatabase *shard = borrowedRecord->shard;
+    if (--borrowedRecord->count == 0) {
+        stHash_remove(borrowed, (void *) record);
+        free(borrowedRecord);
+    }
+    stKVDatabase_releaseRecord(shard, record);
+}
+
+//initialisation function
+
+void stKVDatabase_initialise_sharded(stKVDatabase *database, stKVDatabaseConf *conf, bool create) {
+    ShardedDB *sharded = st_calloc(1, sizeof(ShardedDB));
+    sharded->numShards = stKVDatabaseConf_getNumberOfShards(conf);
+    sharded->shards = st_calloc(sharded->numShards, sizeof(stKVDatabase *));
+    stTry {
+        for (int64_t i = 0; i < sharded->numShards; i++) {
+            sharded->shards[i] = stKVDatabase_construct(stKVDatabaseConf_getShard(conf, i), create);
+        }
+    } stCatch(except) {
+        destructShards(sharded);
+        stThrow(except);
+    } stTryEnd;
+    buildRing(sharded);
+    sharded->threadPool = stThreadPool_construct2(sharded->numShards, NULL, NULL, stThreadPoolFIFO);
+    sharded->borrowed = stHash_construct2(NULL, free);
+    database->dbImpl = sharded;
+    database->secondaryDB = NULL;
+    database->destruct = destructDB;
+    database->deleteDatabase = deleteDB;
+    database->containsRecord = containsRecord;
+    database->insertRecord = insertRecord;
+    database->insertInt64 = insertInt64;
+    database->updateRecord = updateRecord;
+    database->updateInt64 = updateInt64;
+    database->setRecord = setRecord;
+    database->incrementInt64 = incrementInt64;
+    database->bulkSetRecords = bulkSetRecords;
+    database->bulkRemoveRecords = bulkRemoveRecords;
+    database->numberOfRecords = numberOfRecords;
+    database->getRecord = getRecord;
+    database->getInt64 = getInt64;
+    database->getRecord2 = getRecord2;
+    database->getPartialRecord = getPartialRecord;
+    database->bulkGetRecords = bulkGetRecords;
+    database->bulkGetRecordsRange = bulkGetRecordsRange;
+    database->removeRecord = removeRecord;
+    database->flush = flush;
+    database->getCacheStats = getCacheStats;
+    database->getCompressionStats = getCompressionStats;
+    database->borrowRecord = borrowRecord;
+    database->releaseRecord = releaseRecord;
+}
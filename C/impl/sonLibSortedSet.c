@@ -6,6 +6,7 @@
 
 #include "sonLibGlobalsInternal.h"
 #include "avl.h"
+#include "bPlusTree.h"
 
 const char *SORTED_SET_EXCEPTION_ID = "SORTED_SET_EXCEPTION";
 
@@ -17,8 +18,42 @@ const char *SORTED_SET_EXCEPTION_ID = "SORTED_SET_EXCEPTION";
 ////////////////////////////////////////////////
 ////////////////////////////////////////////////
 
+/*
+ * Allocator for the AVL tree of a set constructed in an arena. The tree itself comes straight
+ * from the arena, and nodes come from a pool so that removed nodes are reused. libavl allocates
+ * the tree and its nodes through the same function, so the function is switched from
+ * arenaAllocator_mallocTable to arenaAllocator_mallocNode once the tree has been created.
+ */
+struct arenaAllocator {
+    struct libavl_allocator allocator; // Must be first, libavl passes this back to us.
+    stPool *nodePool;
+    stArena *arena;
+};
+
+static void *arenaAllocator_mallocTable(struct libavl_allocator *allocator, size_t size) {
+    return stArena_malloc(((struct arenaAllocator *)allocator)->arena, size);
+}
+
+static void *arenaAllocator_mallocNode(struct libavl_allocator *allocator, size_t size) {
+    assert(size == sizeof(struct avl_node));
+    (void)size;
+    return stPool_malloc(((struct arenaAllocator *)allocator)->nodePool);
+}
+
+static void arenaAllocator_free(struct libavl_allocator *allocator, void *block) {
+    // Only nodes are freed individually, the tree is never freed through the allocator.
+    stPool_free(((struct arenaAllocator *)allocator)->nodePool, block);
+}
+
+/*
+ * Exactly one of sortedSet (the AVL tree) and bTree is non-null, depending on the type the
+ * set was constructed with.
+ */
 struct _stSortedSet {
     struct avl_table *sortedSet;
+    struct bPlusTree *bTree;
+    struct arenaAllocator *arenaAllocator; // Non-null if the AVL tree is allocated in an arena.
+    int (*compareFn)(const void *, const void *);
     void (*destructElementFn)(void *);
     //int numberOfLiveIterators;  // number of currently allocated iterators
 };
@@ -26,6 +61,7 @@ struct _stSortedSet {
 struct _stSortedSetIterator {
     stSortedSet *sortedSet;
     struct avl_traverser traverser;
+    struct bPlusTreeTraverser bTreeTraverser;
 };
 
 static int st_sortedSet_cmpFn( const void *key1, const void *key2 ) {
@@ -58,25 +94,58 @@ static int st_sortedSet_construct3P(const void *a, const void *b, struct _stSort
 
 stSortedSet *stSortedSet_construct3(int (*compareFn)(const void *, const void *),
                                       void (*destructElementFn)(void *)) {
+    return stSortedSet_construct4(compareFn, destructElementFn, stSortedSetTypeAVL);
+}
+
+stSortedSet *stSortedSet_construct4(int (*compareFn)(const void *, const void *),
+                                      void (*destructElementFn)(void *), stSortedSetType type) {
     stSortedSet *sortedSet = st_malloc(sizeof(stSortedSet));
-    struct _stSortedSet_construct3Fn *i = st_malloc(sizeof(struct _stSortedSet_construct3Fn));
-    i->compareFn = compareFn == NULL ? st_sortedSet_cmpFn : compareFn; //this is a total hack to make the function pass ISO C compatible.
-    sortedSet->sortedSet = avl_create((int (*)(const void *, const void *, void *))st_sortedSet_construct3P, i, NULL);
+    sortedSet->compareFn = compareFn == NULL ? st_sortedSet_cmpFn : compareFn;
+    if (type == stSortedSetTypeBTree) {
+        sortedSet->sortedSet = NULL;
+        sortedSet->bTree = bPlusTree_construct(sortedSet->compareFn);
+    } else {
+        struct _stSortedSet_construct3Fn *i = st_malloc(sizeof(struct _stSortedSet_construct3Fn));
+        i->compareFn = sortedSet->compareFn; //this is a total hack to make the function pass ISO C compatible.
+        sortedSet->sortedSet = avl_create((int (*)(const void *, const void *, void *))st_sortedSet_construct3P, i, NULL);
+        sortedSet->bTree = NULL;
+    }
+    sortedSet->arenaAllocator = NULL;
     sortedSet->destructElementFn = destructElementFn;
     //sortedSet->numberOfLiveIterators = 0;
     return sortedSet;
 }
 
-void stSortedSet_setDestructor(stSortedSet *set, void (*destructElement)(void *)) {
-    set->destructElementFn = destructElement;
+stSortedSet *stSortedSet_constructInArena(int (*compareFn)(const void *, const void *),
+                                      void (*destructElementFn)(void *), stArena *arena) {
+    stSortedSet *sortedSet = st_malloc(sizeof(stSortedSet));
+    sortedSet->compareFn = compareFn == NULL ? st_sortedSet_cmpFn : compareFn;
+    struct arenaAllocator *arenaAllocator = st_malloc(sizeof(struct arenaAllocator));
+    arenaAllocator->allocator.libavl_malloc = arenaAllocator_mallocTable;
+    arenaAllocator->allocator.libavl_free = arenaAllocator_free;
+    arenaAllocator->nodePool = stPool_construct2(sizeof(struct avl_node), arena);
+    arenaAllocator->arena = arena;
+    struct _stSortedSet_construct3Fn *i = st_malloc(sizeof(struct _stSortedSet_construct3Fn));
+    i->compareFn = sortedSet->compareFn;
+    sortedSet->sortedSet = avl_create((int (*)(const void *, const void *, void *))st_sortedSet_construct3P, i,
+            &arenaAllocator->allocator);
+    arenaAllocator->allocator.libavl_malloc = arenaAllocator_mallocNode; // All later allocations are nodes.
+    sortedSet->bTree = NULL;
+    sortedSet->arenaAllocator = arenaAllocator;
+    sortedSet->destructElementFn = destructElementFn;
+    return sortedSet;
+}
+
+stSortedSetType stSortedSet_getType(stSortedSet *sortedSet) {
+    return sortedSet->bTree != NULL ? stSortedSetTypeBTree : stSortedSetTypeAVL;
 }
 
-static struct _stSortedSet_construct3Fn *stSortedSet_getComparator(stSortedSet *sortedSet) {
-    return (struct _stSortedSet_construct3Fn *)sortedSet->sortedSet->avl_param;
+void stSortedSet_setDestructor(stSortedSet *set, void (*destructElement)(void *)) {
+    set->destructElementFn = destructElement;
 }
 
 stSortedSet *stSortedSet_copyConstruct(stSortedSet *sortedSet, void (*destructElementFn)(void *)) {
-    stSortedSet *sortedSet2 = stSortedSet_construct3(stSortedSet_getComparator(sortedSet)->compareFn, destructElementFn);
+    stSortedSet *sortedSet2 = stSortedSet_construct4(sortedSet->compareFn, destructElementFn, stSortedSet_getType(sortedSet));
     stSortedSetIterator *it = stSortedSet_getIterator(sortedSet);
     void *o;
     while((o = stSortedSet_getNext(it)) != NULL) {
@@ -92,8 +161,25 @@ static void st_sortedSet_destructP(void *a, void *b, void (*extraArg)(void*)) {
 }
 
 void stSortedSet_destruct(stSortedSet *sortedSet) {
+    if (sortedSet->bTree != NULL) {
+        bPlusTree_destruct(sortedSet->bTree, sortedSet->destructElementFn);
+        free(sortedSet);
+        return;
+    }
     void *a = sortedSet->sortedSet->avl_param;
-    if(sortedSet->destructElementFn != NULL) {
+    if (sortedSet->arenaAllocator != NULL) { // The nodes are freed with the arena, so only visit the elements if needed.
+        if (sortedSet->destructElementFn != NULL) {
+            struct avl_traverser traverser;
+            avl_t_init(&traverser, sortedSet->sortedSet);
+            void *o;
+            while ((o = avl_t_next(&traverser)) != NULL) {
+                sortedSet->destructElementFn(o);
+            }
+        }
+        stPool_destruct(sortedSet->arenaAllocator->nodePool);
+        free(sortedSet->arenaAllocator);
+    }
+    else if(sortedSet->destructElementFn != NULL) {
         avl_destroy2(sortedSet->sortedSet, st_sortedSet_destructP, sortedSet->destructElementFn);
     }
     else {
@@ -105,6 +191,10 @@ void stSortedSet_destruct(stSortedSet *sortedSet) {
 
 void stSortedSet_insert(stSortedSet *sortedSet, void *object) {
     checkModifiable(sortedSet);
+    if (sortedSet->bTree != NULL) { // Replaces any equal object in a single pass.
+        bPlusTree_insert(sortedSet->bTree, object);
+        return;
+    }
     // FIXME: two passes, modify avl code.
     if(stSortedSet_search(sortedSet, object) != NULL) {
         avl_replace(sortedSet->sortedSet, object);
@@ -115,41 +205,68 @@ void stSortedSet_insert(stSortedSet *sortedSet, void *object) {
 }
 
 void *stSortedSet_search(stSortedSet *sortedSet, void *object) {
+    if (sortedSet->bTree != NULL) {
+        return bPlusTree_find(sortedSet->bTree, object);
+    }
     return avl_find(sortedSet->sortedSet, object);
 }
 
 void *stSortedSet_searchLessThanOrEqual(stSortedSet *sortedSet, void *object) {
+    if (sortedSet->bTree != NULL) {
+        return bPlusTree_findLessThanOrEqual(sortedSet->bTree, object);
+    }
     return avl_find_lessThanOrEqual(sortedSet->sortedSet, object);
 }
 
 void *stSortedSet_searchLessThan(stSortedSet *sortedSet, void *object) {
+    if (sortedSet->bTree != NULL) {
+        return bPlusTree_findLessThan(sortedSet->bTree, object);
+    }
     return avl_find_lessThan(sortedSet->sortedSet, object);
 }
 
 void *stSortedSet_searchGreaterThanOrEqual(stSortedSet *sortedSet, void *object) {
+    if (sortedSet->bTree != NULL) {
+        return bPlusTree_findGreaterThanOrEqual(sortedSet->bTree, object);
+    }
     return avl_find_greaterThanOrEqual(sortedSet->sortedSet, object);
 }
 
 void *stSortedSet_searchGreaterThan(stSortedSet *sortedSet, void *object) {
+    if (sortedSet->bTree != NULL) {
+        return bPlusTree_findGreaterThan(sortedSet->bTree, object);
+    }
     return avl_find_greaterThan(sortedSet->sortedSet, object);
 }
 
 void *stSortedSet_remove(stSortedSet *sortedSet, void *object) {
     checkModifiable(sortedSet);
+    if (sortedSet->bTree != NULL) {
+        return bPlusTree_remove(sortedSet->bTree, object);
+    }
     return avl_delete(sortedSet->sortedSet, object);
 }
 
 int64_t stSortedSet_size(stSortedSet *sortedSet) {
+    if (sortedSet->bTree != NULL) {
+        return sortedSet->bTree->count;
+    }
     return avl_count(sortedSet->sortedSet);
 }
 
 void *stSortedSet_getFirst(stSortedSet *items) {
+    if (items->bTree != NULL) {
+        return bPlusTree_first(items->bTree);
+    }
     struct avl_traverser traverser;
     avl_t_init(&traverser, items->sortedSet);
     return avl_t_first(&traverser, items->sortedSet);
 }
 
 void *stSortedSet_getLast(stSortedSet *items) {
+    if (items->bTree != NULL) {
+        return bPlusTree_last(items->bTree);
+    }
     struct avl_traverser traverser;
     avl_t_init(&traverser, items->sortedSet);
     return avl_t_last(&traverser, items->sortedSet);
@@ -159,14 +276,20 @@ stSortedSetIterator *stSortedSet_getIterator(stSortedSet *items) {
     stSortedSetIterator *iterator;
     iterator = st_malloc(sizeof(stSortedSetIterator));
     iterator->sortedSet = items;
-    avl_t_init(&iterator->traverser, items->sortedSet);
+    if (items->bTree != NULL) {
+        bPlusTree_t_init(&iterator->bTreeTraverser, items->bTree);
+    } else {
+        avl_t_init(&iterator->traverser, items->sortedSet);
+    }
     //items->numberOfLiveIterators++;
     return iterator;
 }
 
 stSortedSetIterator *stSortedSet_getIteratorFrom(stSortedSet *items, void *item) {
     stSortedSetIterator *iterator = stSortedSet_getIterator(items);
-    if(avl_t_find(&iterator->traverser, items->sortedSet, item) == NULL) {
+    void *found = items->bTree != NULL ? bPlusTree_t_find(&iterator->bTreeTraverser, item)
+                                       : avl_t_find(&iterator->traverser, items->sortedSet, item);
+    if(found == NULL) {
         stSortedSet_destructIterator(iterator);
         stThrowNew(SORTED_SET_EXCEPTION_ID, "Tried to create an iterator with an item that is not in the list of items");
     }
@@ -188,6 +311,9 @@ void stSortedSet_destructIterator(stSortedSetIterator *iterator) {
 }
 
 void *stSortedSet_getNext(stSortedSetIterator *iterator) {
+    if (iterator->sortedSet->bTree != NULL) {
+        return bPlusTree_t_next(&iterator->bTreeTraverser);
+    }
     return avl_t_next(&iterator->traverser);
 }
 
@@ -196,16 +322,23 @@ stSortedSetIterator *stSortedSet_copyIterator(stSortedSetIterator *iterator) {
     copyIterator = st_malloc(sizeof(stSortedSetIterator));
     copyIterator->sortedSet = iterator->sortedSet;
     //copyIterator->sortedSet->numberOfLiveIterators++;
-    avl_t_copy(&copyIterator->traverser, &iterator->traverser);
+    if (iterator->sortedSet->bTree != NULL) {
+        copyIterator->bTreeTraverser = iterator->bTreeTraverser;
+    } else {
+        avl_t_copy(&copyIterator->traverser, &iterator->traverser);
+    }
     return copyIterator;
 }
 
 void *stSortedSet_getPrevious(stSortedSetIterator *iterator) {
+    if (iterator->sortedSet->bTree != NULL) {
+        return bPlusTree_t_prev(&iterator->bTreeTraverser);
+    }
     return avl_t_prev(&iterator->traverser);
 }
 
 static int stSortedSet_comparatorsEqual(stSortedSet *sortedSet1, stSortedSet *sortedSet2) {
-    return stSortedSet_getComparator(sortedSet1)->compareFn == stSortedSet_getComparator(sortedSet2)->compareFn;
+    return sortedSet1->compareFn == sortedSet2->compareFn;
 }
 
 int stSortedSet_equals(stSortedSet *sortedSet1, stSortedSet *sortedSet2) {
@@ -215,7 +348,7 @@ int stSortedSet_equals(stSortedSet *sortedSet1, stSortedSet *sortedSet2) {
     if(!stSortedSet_comparatorsEqual(sortedSet1, sortedSet2)) {
         return 0;
     }
-    int (*cmpFn)(const void *, const void *) = stSortedSet_getComparator(sortedSet1)->compareFn;
+    int (*cmpFn)(const void *, const void *) = sortedSet1->compareFn;
 
     stSortedSetIterator *it1 = stSortedSet_getIterator(sortedSet1);
     stSortedSetIterator *it2 = stSortedSet_getIterator(sortedSet2);
@@ -251,7 +384,7 @@ stSortedSet *stSortedSet_getUnion(stSortedSet *sortedSet1, stSortedSet *sortedSe
     if(!stSortedSet_comparatorsEqual(sortedSet1, sortedSet2)) {
         stThrowNew(SORTED_SET_EXCEPTION_ID, "Comparators are not equal for creating the union of two sorted sets");
     }
-    stSortedSet *sortedSet3 = stSortedSet_construct3(stSortedSet_getComparator(sortedSet1)->compareFn, NULL);
+    stSortedSet *sortedSet3 = stSortedSet_construct4(sortedSet1->compareFn, NULL, stSortedSet_getType(sortedSet1));
 
     //Add those from sortedSet1
     stSortedSetIterator *it= stSortedSet_getIterator(sortedSet1);
@@ -275,7 +408,7 @@ stSortedSet *stSortedSet_getIntersection(stSortedSet *sortedSet1, stSortedSet *s
     if(!stSortedSet_comparatorsEqual(sortedSet1, sortedSet2)) {
         stThrowNew(SORTED_SET_EXCEPTION_ID, "Comparators are not equal for creating an intersection of two sorted sets");
     }
-    stSortedSet *sortedSet3 = stSortedSet_construct3(stSortedSet_getComparator(sortedSet1)->compareFn, NULL);
+    stSortedSet *sortedSet3 = stSortedSet_construct4(sortedSet1->compareFn, NULL, stSortedSet_getType(sortedSet1));
 
     //Add those from sortedSet1 only if they are also in sortedSet2
     stSortedSetIterator *it= stSortedSet_getIterator(sortedSet1);
@@ -294,7 +427,7 @@ stSortedSet *stSortedSet_getDifference(stSortedSet *sortedSet1, stSortedSet *sor
     if(!stSortedSet_comparatorsEqual(sortedSet1, sortedSet2)) {
         stThrowNew(SORTED_SET_EXCEPTION_ID, "Comparators are not equal for creating the sorted set difference");
     }
-    stSortedSet *sortedSet3 = stSortedSet_construct3(stSortedSet_getComparator(sortedSet1)->compareFn, NULL);
+    stSortedSet *sortedSet3 = stSortedSet_construct4(sortedSet1->compareFn, NULL, stSortedSet_getType(sortedSet1));
 
     //Add those from sortedSet1 only if they are not in sortedSet2
     stSortedSetIterator *it= stSortedSet_getIterator(sortedSet1);
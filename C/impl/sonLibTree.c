@@ -21,32 +21,52 @@
 
 struct _stTree {
     double branchLength;
-    stList *nodes;
+    stList *nodes; // The children, or NULL until the first is added.
     char *label;
     void *clientData;
     stTree *parent;
+    stArena *arena; // If not NULL, the node and its label are allocated in this arena.
 };
 
 /*
  * The functions..
  */
 
-stTree *stTree_construct(void) {
-    stTree *tree = st_malloc(sizeof(stTree));
+static stTree *tree_construct(stArena *arena) {
+    stTree *tree = arena == NULL ? st_malloc(sizeof(stTree)) : stArena_malloc(arena, sizeof(stTree));
     tree->branchLength = INFINITY;
-    tree->nodes = stList_construct3(0, (void (*)(void *))stTree_destruct);
+    tree->nodes = NULL;
     tree->label = NULL;
     tree->parent = NULL;
     tree->clientData = NULL;
+    tree->arena = arena;
     return tree;
 }
 
+stTree *stTree_construct(void) {
+    return tree_construct(NULL);
+}
+
+stTree *stTree_constructInArena(stArena *arena) {
+    return tree_construct(arena);
+}
+
 void stTree_destruct(stTree *tree) {
-    stList_destruct(tree->nodes);
-    if(tree->label != NULL) {
-        free(tree->label);
+    // Iterative, so that deep trees can't overflow the stack.
+    stList *stack = stList_construct();
+    stList_append(stack, tree);
+    while(stList_length(stack) > 0) {
+        tree = stList_pop(stack);
+        if(tree->nodes != NULL) {
+            stList_appendAll(stack, tree->nodes);
+            stList_destruct(tree->nodes);
+        }
+        if(tree->arena == NULL) {
+            free(tree->label);
+            free(tree);
+        }
     }
-    free(tree);
+    stList_destruct(stack);
 }
 
 /* clone a node */
@@ -166,12 +186,15 @@ void stTree_setParent(stTree *tree, stTree *parent) {
     }
     tree->parent = parent;
     if(parent != NULL) {
+        if(parent->nodes == NULL) {
+            parent->nodes = stList_construct();
+        }
         stList_append(parent->nodes, tree);
     }
 }
 
 int64_t stTree_getChildNumber(stTree *tree) {
-    return stList_length(tree->nodes);
+    return tree->nodes == NULL ? 0 : stList_length(tree->nodes);
 }
 
 stTree *stTree_getChild(stTree *tree, int64_t i) {
@@ -182,8 +205,8 @@ stTree *stTree_findChild(stTree *tree, const char *label) {
     if (tree->label != NULL && strcmp(tree->label, label) == 0) {
         return tree;
     }
-    for (int i = 0; i < stList_length(tree->nodes); i++) {
-        stTree *node = (stTree *)stList_get(tree->nodes, i);
+    for (int i = 0; i < stTree_getChildNumber(tree); i++) {
+        stTree *node = stTree_getChild(tree, i);
         if ((node->label != NULL) && (strcmp(node->label, label) == 0)) {
             return node;
         }
@@ -217,6 +240,10 @@ const char *stTree_getLabel(stTree *tree) {
 }
 
 void stTree_setLabel(stTree *tree, const char *label) {
+    if(tree->arena != NULL) { // The old label stays in the arena.
+        tree->label = label == NULL ? NULL : stArena_copyString(tree->arena, label);
+        return;
+    }
     if(tree->label != NULL) {
         free(tree->label);
     }
@@ -258,143 +285,176 @@ double stTree_getLongestPathLength(stTree *node) {
 /////////////////////////////
 
 /*
- * Gets the next token from the list.
+ * The parser makes one pass over the string, keeping the nodes whose children are being read
+ * on an explicit stack rather than recursing, so the depth of the tree is not limited by the
+ * call stack.
  */
-static void tree_parseNewickTreeString_getNextToken(char **token, char **newickTreeString) {
-    assert(*token != NULL);
-    free(*token);
-    *token = stString_getNextWord(newickTreeString);
-    if (*token == NULL) {
-        st_errAbort("invalid Newick tree, doesn't end with ';': %s", **newickTreeString);
-    }
+
+static bool tree_isNewickDelimiter(char c) {
+    return c == '(' || c == ')' || c == ',' || c == ':' || c == ';' || c == '\0' || isspace((unsigned char)c);
 }
 
-/*
- * Sets the label, if the token is a label and updates the token.
- */
-static void tree_parseNewickString_getLabel(char **token, char **newickTreeString, stTree *tree) {
-    if(**token != ':' && **token != ',' && **token != ';' && **token != ')') {
-        stTree_setLabel(tree, *token);
-        tree_parseNewickTreeString_getNextToken(token, newickTreeString);
+static const char *tree_eatWhiteSpace(const char *c) {
+    while(isspace((unsigned char)*c)) {
+        c++;
     }
+    return c;
 }
 
 /*
- * Parses any available branch length and updates the token.
+ * Parses any label and branch length of the node, returning the position after them.
  */
-static void tree_parseNewickString_getBranchLength(char **token, char **newickTreeString, stTree *tree) {
-    if (**token == ':') {
-        tree_parseNewickTreeString_getNextToken(token, newickTreeString);
-        double distance;
-        int j = sscanf(*token, "%lf", &distance);
-        if (j != 1) {
-            st_errAbort("Invalid Newick tree");
+static const char *tree_parseNewickLabelAndBranchLength(const char *c, stTree *tree, const char *string) {
+    c = tree_eatWhiteSpace(c);
+    const char *labelEnd = c;
+    while(!tree_isNewickDelimiter(*labelEnd)) {
+        labelEnd++;
+    }
+    if(labelEnd > c) {
+        int64_t length = labelEnd - c;
+        tree->label = tree->arena == NULL ? st_malloc(length + 1) : stArena_malloc(tree->arena, length + 1);
+        memcpy(tree->label, c, length);
+        tree->label[length] = '\0';
+        c = tree_eatWhiteSpace(labelEnd);
+    }
+    if(*c == ':') {
+        char *end;
+        tree->branchLength = strtod(c + 1, &end);
+        if(end == c + 1) {
+            st_errAbort("Invalid Newick tree, expected a branch length: %s", string);
         }
-        stTree_setBranchLength(tree, distance);
-        tree_parseNewickTreeString_getNextToken(token, newickTreeString);
+        c = tree_eatWhiteSpace(end);
     }
+    return c;
 }
 
-static stTree *tree_parseNewickStringP(char **token, char **newickTreeString) {
-    stTree *tree = stTree_construct();
-    if((*token)[0] == '(') {
-        if (strlen(*token) != 1) {
-            st_errAbort("invalid Newick tree");
+/*
+ * Parses the tree, with its nodes in the arena if it is not NULL.
+ */
+static stTree *tree_parseNewickString(const char *string, stArena *arena) {
+    stList *stack = stList_construct(); // The ancestors of the current node.
+    stTree *root = tree_construct(arena), *tree = root;
+    const char *c = string;
+    while(1) {
+        c = tree_eatWhiteSpace(c);
+        if(*c == '(') { // The first child of a new internal node.
+            stList_append(stack, tree);
+            tree = tree_construct(arena);
+            stTree_setParent(tree, stList_peek(stack));
+            c++;
+            continue;
         }
-        tree_parseNewickTreeString_getNextToken(token, newickTreeString);
         while(1) {
-            stTree_setParent(tree_parseNewickStringP(token, newickTreeString), tree);
-            if (strlen(*token) != 1) {
-                st_errAbort("invalid Newick tree");
-            }
-            if ((*token)[0] == ',') {
-                tree_parseNewickTreeString_getNextToken(token, newickTreeString);
-            } else {
+            c = tree_parseNewickLabelAndBranchLength(c, tree, string);
+            if(*c != ')') {
                 break;
             }
+            if(stList_length(stack) == 0) {
+                st_errAbort("Invalid Newick tree, unbalanced parenthesis: %s", string);
+            }
+            tree = stList_pop(stack);
+            c++;
         }
-        if ((*token)[0] != ')') {
-            st_errAbort("Invalid Newick tree, unbalanced parenthesis");
+        if(*c == ',') {
+            if(stList_length(stack) == 0) {
+                st_errAbort("Invalid Newick tree, ',' outside parentheses: %s", string);
+            }
+            tree = tree_construct(arena);
+            stTree_setParent(tree, stList_peek(stack));
+            c++;
+        }
+        else if(*c == ';') {
+            if(stList_length(stack) > 0) {
+                st_errAbort("Invalid Newick tree, unbalanced parenthesis: %s", string);
+            }
+            break;
+        }
+        else if(*c == '\0') {
+            st_errAbort("Invalid Newick tree, doesn't end with ';': %s", string);
+        }
+        else {
+            st_errAbort("Invalid Newick tree, missing ',', ';', or ')': %s", string);
         }
-        tree_parseNewickTreeString_getNextToken(token, newickTreeString);
-    }
-    tree_parseNewickString_getLabel(token, newickTreeString, tree);
-    tree_parseNewickString_getBranchLength(token, newickTreeString, tree);
-    if (!((**token == ',') || (**token == ';') || (**token == ')'))) {
-        st_errAbort("Invalid Newick tree, missing ',', ';', or ')'");
     }
-    return tree;
+    stList_destruct(stack);
+    return root;
 }
 
 stTree *stTree_parseNewickString(const char *string) {
-    //lax newick tree parser
-    char *cA = stString_replace(string, "(", " ( ");
-    char *cA2 = stString_replace(cA, ")", " ) ");
-    free(cA);
-    cA = cA2;
-    cA2 = stString_replace(cA, ":", " : ");
-    free(cA);
-    cA = cA2;
-    cA2 = stString_replace(cA, ",", " , ");
-    free(cA);
-    cA = cA2;
-    cA2 = stString_replace(cA, ";", " ; ");
-    free(cA);
-    cA = cA2;
-    char *token = stString_getNextWord(&cA);
-    if (token == NULL) {
-        st_errAbort("Invalid Newick tree");
-    }
-    stTree *tree = tree_parseNewickStringP(&token, &cA);
-    if (*token != ';') {
-        st_errAbort("Invalid Newick tree, missing ';'");
-    }
-    free(cA2);
-    free(token);
-    return tree;
+    return tree_parseNewickString(string, NULL);
+}
+
+stTree *stTree_parseNewickStringInArena(const char *string, stArena *arena) {
+    return tree_parseNewickString(string, arena);
 }
 
 /////////////////////////////
 //Newick tree writer
 /////////////////////////////
 
-static char *tree_getNewickTreeStringP(stTree *tree) {
-    char *cA, *cA2;
-    if(stTree_getChildNumber(tree) > 0) {
-        int64_t i;
-        cA = stString_copy("(");
-        for(i=0; i<stTree_getChildNumber(tree); i++) {
-            cA2 = tree_getNewickTreeStringP(stTree_getChild(tree, i));
-            char *cA3 = stString_print((i+1 < stTree_getChildNumber(tree) ? "%s%s," : "%s%s"), cA, cA2);
-            free(cA);
-            free(cA2);
-            cA = cA3;
-        }
-        cA2 = stString_print("%s)", cA);
-        free(cA);
-        cA = cA2;
-    }
-    else {
-        cA = stString_copy("");
+/*
+ * A growable buffer for the string being written.
+ */
+typedef struct _newickBuffer {
+    char *string;
+    int64_t length;
+    int64_t capacity;
+} NewickBuffer;
+
+static void newickBuffer_append(NewickBuffer *buffer, const char *string, int64_t length) {
+    if(buffer->length + length + 1 > buffer->capacity) {
+        buffer->capacity = 2 * (buffer->length + length + 1);
+        buffer->string = st_realloc(buffer->string, buffer->capacity);
     }
-    if(stTree_getLabel(tree) != NULL) {
-        cA2 = stString_print("%s%s", cA, stTree_getLabel(tree));
-        free(cA);
-        cA = cA2;
+    memcpy(buffer->string + buffer->length, string, length);
+    buffer->length += length;
+}
+
+static void tree_writeNewickLabelAndBranchLength(NewickBuffer *buffer, stTree *tree) {
+    if(tree->label != NULL) {
+        newickBuffer_append(buffer, tree->label, strlen(tree->label));
     }
-    if(stTree_getBranchLength(tree) != INFINITY) {
-        char *cA2 = stString_print("%s:%g", cA, stTree_getBranchLength(tree));
-        free(cA);
-        cA = cA2;
+    if(tree->branchLength != INFINITY) {
+        char branchLength[64];
+        int64_t length = snprintf(branchLength, sizeof(branchLength), ":%g", tree->branchLength);
+        newickBuffer_append(buffer, branchLength, length);
     }
-    return cA;
 }
 
 char *stTree_getNewickTreeString(stTree *tree) {
-    char *cA = tree_getNewickTreeStringP(tree), *cA2;
-    cA2 = stString_print("%s;", cA);
-    free(cA);
-    return cA2;
+    NewickBuffer buffer = { st_malloc(256), 0, 256 };
+    // Each node on the stack is paired with the number of its children written so far.
+    int64_t stackLength = 0, stackCapacity = 64;
+    stTree **nodes = st_malloc(stackCapacity * sizeof(stTree *));
+    int64_t *childrenWritten = st_malloc(stackCapacity * sizeof(int64_t));
+    nodes[stackLength] = tree;
+    childrenWritten[stackLength++] = 0;
+    while(stackLength > 0) {
+        stTree *node = nodes[stackLength - 1];
+        int64_t i = childrenWritten[stackLength - 1]++, childNumber = stTree_getChildNumber(node);
+        if(i < childNumber) {
+            newickBuffer_append(&buffer, i == 0 ? "(" : ",", 1);
+            if(stackLength == stackCapacity) {
+                stackCapacity *= 2;
+                nodes = st_realloc(nodes, stackCapacity * sizeof(stTree *));
+                childrenWritten = st_realloc(childrenWritten, stackCapacity * sizeof(int64_t));
+            }
+            nodes[stackLength] = stTree_getChild(node, i);
+            childrenWritten[stackLength++] = 0;
+        }
+        else {
+            if(childNumber > 0) {
+                newickBuffer_append(&buffer, ")", 1);
+            }
+            tree_writeNewickLabelAndBranchLength(&buffer, node);
+            stackLength--;
+        }
+    }
+    newickBuffer_append(&buffer, ";", 1);
+    buffer.string[buffer.length] = '\0';
+    free(nodes);
+    free(childrenWritten);
+    return buffer.string;
 }
 
 bool stTree_equals(stTree *tree1, stTree *tree2) {
@@ -428,6 +488,9 @@ static int sortChildrenListCmpFn(const void *a, const void *b, void* args) {
 
 void stTree_sortChildren(stTree *root, int (*cmpFn)(stTree *a, stTree *b)) {
     struct sortFuncArgs args = {cmpFn};
+    if (root->nodes == NULL) {
+        return;
+    }
     stList_sort2(root->nodes, sortChildrenListCmpFn, &args);
     for (int i = 0; i < stTree_getChildNumber(root); i++) {
         stTree_sortChildren(stTree_getChild(root, i), cmpFn);
@@ -74,6 +74,16 @@ stIntTuple *stIntTuple_constructN(int64_t length, const int64_t iA[]) {
     return intTuple;
 }
 
+stIntTuple *stIntTuple_constructNInArena(int64_t length, const int64_t iA[], stArena *arena) {
+    assert(length >= 0);
+    stIntTuple *intTuple = stArena_malloc(arena, sizeof(int64_t) * (length + 1));
+    intTuple[0] = length;
+    for(int64_t i=0; i<length; i++) {
+        intTuple[i+1] = iA[i];
+    }
+    return intTuple;
+}
+
 void stIntTuple_destruct(stIntTuple *intTuple) {
     free(intTuple);
 }
@@ -0,0 +1,624 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * stCigarStream.c
+ *
+ * Both formats are read from and written to a buffer of at least ST_CIGAR_BUFFER_SIZE bytes,
+ * which the reader grows to hold the longest text line and the writer to hold the largest
+ * single item it writes.
+ */
+
+#include "sonLibGlobalsInternal.h"
+#include "stCigarStream.h"
+
+const char *ST_CIGAR_EXCEPTION_ID = "ST_CIGAR_EXCEPTION";
+
+#define ST_CIGAR_BUFFER_SIZE 1048576
+#define ST_CIGAR_MAGIC "stCigar1"
+#define ST_CIGAR_MAGIC_LENGTH 8
+#define ST_CIGAR_MAX_VARINT_LENGTH 10
+
+struct _stCigarReader {
+    FILE *file;
+    stCigarFormat format;
+    char *buffer;
+    int64_t bufferCapacity;
+    int64_t bufferStart; // The unread bytes are bufferStart to bufferEnd.
+    int64_t bufferEnd;
+    bool endOfFile;
+    stCigar cigar;
+    int64_t operationCapacity;
+    struct StringTable *contigNames;
+    stList *names; // For binary, the distinct contig names in the order they were read.
+};
+
+struct _stCigarWriter {
+    FILE *file;
+    stCigarFormat format;
+    char *buffer;
+    int64_t bufferCapacity;
+    int64_t bufferLength;
+    stHash *nameIndices; // For binary, each name written so far to one more than its index.
+    struct AlignmentOperation *operations; // For converting PairwiseAlignments.
+    int64_t operationCapacity;
+};
+
+////////////////////////////////////////////////
+//Reading
+////////////////////////////////////////////////
+
+/*
+ * Reads until at least length bytes are buffered or the file ends, returning the number of
+ * bytes buffered. One byte more than is read is kept spare, to terminate a text line.
+ */
+static int64_t fillBuffer(stCigarReader *reader, int64_t length) {
+    int64_t available = reader->bufferEnd - reader->bufferStart;
+    if (available >= length || reader->endOfFile) {
+        return available;
+    }
+    memmove(reader->buffer, reader->buffer + reader->bufferStart, available);
+    reader->bufferStart = 0;
+    reader->bufferEnd = available;
+    if (length + 1 > reader->bufferCapacity) {
+        reader->bufferCapacity = 2 * length + 1;
+        reader->buffer = st_realloc(reader->buffer, reader->bufferCapacity);
+    }
+    while (reader->bufferEnd < length && !reader->endOfFile) {
+        size_t bytes = fread(reader->buffer + reader->bufferEnd, 1, reader->bufferCapacity - 1 - reader->bufferEnd,
+                             reader->file);
+        if (bytes == 0) {
+            if (ferror(reader->file)) {
+                stThrowNew(ST_CIGAR_EXCEPTION_ID, "Reading alignments failed");
+            }
+            reader->endOfFile = true;
+        }
+        reader->bufferEnd += bytes;
+    }
+    return reader->bufferEnd - reader->bufferStart;
+}
+
+static void addOperation(stCigarReader *reader, int64_t type, int64_t length, float score) {
+    if (reader->cigar.operationNumber == reader->operationCapacity) {
+        reader->operationCapacity = reader->operationCapacity * 2 + 16;
+        reader->cigar.operations = st_realloc(reader->cigar.operations,
+                                              reader->operationCapacity * sizeof(struct AlignmentOperation));
+    }
+    struct AlignmentOperation *op = &reader->cigar.operations[reader->cigar.operationNumber++];
+    op->opType = type;
+    op->length = length;
+    op->score = score;
+}
+
+static uint64_t readVarint(stCigarReader *reader) {
+    if (reader->bufferEnd - reader->bufferStart < ST_CIGAR_MAX_VARINT_LENGTH) {
+        fillBuffer(reader, ST_CIGAR_MAX_VARINT_LENGTH);
+    }
+    const unsigned char *c = (unsigned char *) reader->buffer + reader->bufferStart;
+    const unsigned char *end = (unsigned char *) reader->buffer + reader->bufferEnd;
+    uint64_t value = 0;
+    for (int64_t shift = 0; shift < 64 && c < end; shift += 7) {
+        uint64_t byte = *c++;
+        value |= (byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            reader->bufferStart = (char *) c - reader->buffer;
+            return value;
+        }
+    }
+    stThrowNew(ST_CIGAR_EXCEPTION_ID, c == end ? "The alignments are truncated" : "Got a malformed varint");
+    return 0;
+}
+
+static int64_t readInt(stCigarReader *reader) {
+    uint64_t value = readVarint(reader);
+    if (value > INT64_MAX) {
+        stThrowNew(ST_CIGAR_EXCEPTION_ID, "Got an integer out of range");
+    }
+    return (int64_t) value;
+}
+
+static int64_t readZigzag(stCigarReader *reader) {
+    uint64_t value = readVarint(reader);
+    return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+}
+
+static float readFloat(stCigarReader *reader) {
+    if (fillBuffer(reader, 4) < 4) {
+        stThrowNew(ST_CIGAR_EXCEPTION_ID, "The alignments are truncated");
+    }
+    const unsigned char *c = (unsigned char *) reader->buffer + reader->bufferStart;
+    uint32_t bits = (uint32_t) c[0] | ((uint32_t) c[1] << 8) | ((uint32_t) c[2] << 16) | ((uint32_t) c[3] << 24);
+    float value;
+    memcpy(&value, &bits, sizeof(float));
+    reader->bufferStart += 4;
+    return value;
+}
+
+static const char *readName(stCigarReader *reader) {
+    int64_t index = readInt(reader);
+    if (index < stList_length(reader->names)) {
+        return stList_get(reader->names, index);
+    }
+    if (index > stList_length(reader->names)) {
+        stThrowNew(ST_CIGAR_EXCEPTION_ID, "Got the name %" PRIi64 " before name %" PRIi64, index,
+                   stList_length(reader->names));
+    }
+    int64_t length = readInt(reader);
+    if (fillBuffer(reader, length) < length) {
+        stThrowNew(ST_CIGAR_EXCEPTION_ID, "The alignments are truncated");
+    }
+    char *c = reader->buffer + reader->bufferStart, end = c[length];
+    c[length] = '\0'; // There is always a spare byte at the end of the buffer.
+    const char *name = stringTableIntern(reader->contigNames, c);
+    c[length] = end;
+    reader->bufferStart += length;
+    stList_append(reader->names, (void *) name);
+    return name;
+}
+
+static bool readBinary(stCigarReader *reader) {
+    if (fillBuffer(reader, 1) == 0) {
+        return false;
+    }
+    stCigar *cigar = &reader->cigar;
+    uint64_t flags = readVarint(reader);
+    if (flags > 7) {
+        stThrowNew(ST_CIGAR_EXCEPTION_ID, "Got the unknown alignment flags %" PRIu64, flags);
+    }
+    cigar->strand1 = flags & 1;
+    cigar->strand2 = (flags >> 1) & 1;
+    cigar->hasScores = (flags >> 2) & 1;
+    cigar->contig1 = readName(reader);
+    cigar->start1 = readInt(reader);
+    cigar->end1 = cigar->start1 + readZigzag(reader);
+    cigar->contig2 = readName(reader);
+    cigar->start2 = readInt(reader);
+    cigar->end2 = cigar->start2 + readZigzag(reader);
+    cigar->score = readFloat(reader);
+    // The operations are added one at a time, so a corrupt count can't make a huge allocation.
+    int64_t operationNumber = readInt(reader);
+    cigar->operationNumber = 0;
+    for (int64_t i = 0; i < operationNumber; i++) {
+        uint64_t op = readVarint(reader);
+        if ((op & 3) > PAIRWISE_INDEL_Y) {
+            stThrowNew(ST_CIGAR_EXCEPTION_ID, "Got the unknown operation type %" PRIu64, op & 3);
+        }
+        addOperation(reader, op & 3, op >> 2, 0.0);
+    }
+    if (cigar->hasScores) {
+        for (int64_t i = 0; i < operationNumber; i++) {
+            cigar->operations[i].score = readFloat(reader);
+        }
+    }
+    return true;
+}
+
+/*
+ * Returns the next line, terminated in place, or NULL at the end of the file.
+ */
+static char *readLine(stCigarReader *reader) {
+    int64_t scanned = 0; // Bytes already searched for the end of the line.
+    while (true) {
+        char *line = reader->buffer + reader->bufferStart;
+        int64_t available = reader->bufferEnd - reader->bufferStart;
+        char *lineEnd = memchr(line + scanned, '\n', available - scanned);
+        if (lineEnd != NULL) {
+            *lineEnd = '\0';
+            reader->bufferStart += lineEnd + 1 - line;
+            return line;
+        }
+        scanned = available;
+        if (fillBuffer(reader, available + 1) == available) { // The last line has no line ending.
+            if (available == 0) {
+                return NULL;
+            }
+            line = reader->buffer + reader->bufferStart;
+            line[available] = '\0';
+            reader->bufferStart = reader->bufferEnd;
+            return line;
+        }
+    }
+}
+
+static void skipSpace(char **c) {
+    while (isspace((unsigned char) **c)) {
+        (*c)++;
+    }
+}
+
+static const char *parseName(stCigarReader *reader, char **c) {
+    skipSpace(c);
+    char *name = *c;
+    while (**c != '\0' && !isspace((unsigned char) **c)) {
+        (*c)++;
+    }
+    if (*c == name) {
+        stThrowNew(ST_CIGAR_EXCEPTION_ID, "Got a cigar line without a contig name");
+    }
+    char end = **c;
+    **c = '\0';
+    const char *internedName = stringTableIntern(reader->contigNames, name);
+    **c = end;
+    return internedName;
+}
+
+static int64_t parseInt(char **c) {
+    skipSpace(c);
+    bool negative = **c == '-';
+    if (negative || **c == '+') {
+        (*c)++;
+    }
+    if (!isdigit((unsigned char) **c)) {
+        stThrowNew(ST_CIGAR_EXCEPTION_ID, "Expected an integer in a cigar line, got: %s", *c);
+    }
+    int64_t value = 0;
+    while (isdigit((unsigned char) **c)) {
+        value = value * 10 + (*(*c)++ - '0');
+    }
+    return negative ? -value : value;
+}
+
+static float parseFloat(char **c) {
+    char *end;
+    float value = strtof(*c, &end);
+    if (end == *c) {
+        stThrowNew(ST_CIGAR_EXCEPTION_ID, "Expected a number in a cigar line, got: %s", *c);
+    }
+    *c = end;
+    return value;
+}
+
+static int64_t parseStrand(char **c) {
+    skipSpace(c);
+    if (**c != '+' && **c != '-') {
+        stThrowNew(ST_CIGAR_EXCEPTION_ID, "Expected a strand in a cigar line, got: %s", *c);
+    }
+    return *(*c)++ == '+';
+}
+
+static bool readText(stCigarReader *reader) {
+    char *c;
+    do { // Blank lines are skipped.
+        if ((c = readLine(reader)) == NULL) {
+            return false;
+        }
+        skipSpace(&c);
+    } while (*c == '\0');
+    if (strncmp(c, "cigar:", 6) != 0) {
+        stThrowNew(ST_CIGAR_EXCEPTION_ID, "Expected a cigar line, got: %s", c);
+    }
+    c += 6;
+    stCigar *cigar = &reader->cigar;
+    cigar->contig2 = parseName(reader, &c);
+    cigar->start2 = parseInt(&c);
+    cigar->end2 = parseInt(&c);
+    cigar->strand2 = parseStrand(&c);
+    cigar->contig1 = parseName(reader, &c);
+    cigar->start1 = parseInt(&c);
+    cigar->end1 = parseInt(&c);
+    cigar->strand1 = parseStrand(&c);
+    cigar->score = parseFloat(&c);
+    cigar->hasScores = false;
+    cigar->operationNumber = 0;
+    while (skipSpace(&c), *c != '\0') {
+        int64_t type;
+        bool withScore = false;
+        switch (*c) {
+            case 'X':
+                withScore = true;
+                // fall through
+            case 'M':
+                type = PAIRWISE_MATCH;
+                break;
+            case 'Y':
+                withScore = true;
+                // fall through
+            case 'D':
+                type = PAIRWISE_INDEL_X;
+                break;
+            case 'Z':
+                withScore = true;
+                // fall through
+            case 'I':
+                type = PAIRWISE_INDEL_Y;
+                break;
+            default:
+                stThrowNew(ST_CIGAR_EXCEPTION_ID, "Got the unknown cigar operation: %s", c);
+                return false;
+        }
+        c++;
+        int64_t length = parseInt(&c);
+        addOperation(reader, type, length, withScore ? parseFloat(&c) : 0.0);
+        cigar->hasScores = cigar->hasScores || withScore;
+    }
+    return true;
+}
+
+stCigarReader *stCigarReader_construct(FILE *file) {
+    stCigarReader *reader = st_calloc(1, sizeof(stCigarReader));
+    reader->file = file;
+    reader->bufferCapacity = ST_CIGAR_BUFFER_SIZE;
+    reader->buffer = st_malloc(reader->bufferCapacity);
+    reader->contigNames = constructStringTable();
+    reader->names = stList_construct();
+    stTry {
+        if (fillBuffer(reader, ST_CIGAR_MAGIC_LENGTH) >= ST_CIGAR_MAGIC_LENGTH
+                && memcmp(reader->buffer, ST_CIGAR_MAGIC, ST_CIGAR_MAGIC_LENGTH) == 0) {
+            reader->format = stCigarBinary;
+            reader->bufferStart += ST_CIGAR_MAGIC_LENGTH;
+        } else {
+            reader->format = stCigarText;
+        }
+    } stCatch(except) {
+        stCigarReader_destruct(reader);
+        stThrow(except);
+    } stTryEnd;
+    return reader;
+}
+
+void stCigarReader_destruct(stCigarReader *reader) {
+    destructStringTable(reader->contigNames);
+    stList_destruct(reader->names);
+    free(reader->cigar.operations);
+    free(reader->buffer);
+    free(reader);
+}
+
+stCigarFormat stCigarReader_getFormat(stCigarReader *reader) {
+    return reader->format;
+}
+
+const stCigar *stCigarReader_next(stCigarReader *reader) {
+    bool read = reader->format == stCigarBinary ? readBinary(reader) : readText(reader);
+    return read ? &reader->cigar : NULL;
+}
+
+struct PairwiseAlignment *stCigarReader_nextPairwiseAlignment(stCigarReader *reader) {
+    const stCigar *cigar = stCigarReader_next(reader);
+    if (cigar == NULL) {
+        return NULL;
+    }
+    struct List *operationList = constructEmptyList(0, (void (*)(void *)) destructAlignmentOperation);
+    for (int64_t i = 0; i < cigar->operationNumber; i++) {
+        struct AlignmentOperation *op = &cigar->operations[i];
+        listAppend(operationList, constructAlignmentOperation(op->opType, op->length, op->score));
+    }
+    return constructPairwiseAlignment((char *) cigar->contig1, cigar->start1, cigar->end1, cigar->strand1,
+                                      (char *) cigar->contig2, cigar->start2, cigar->end2, cigar->strand2,
+                                      cigar->score, operationList);
+}
+
+struct FlatPairwiseAlignment *stCigarReader_nextFlatPairwiseAlignment(stCigarReader *reader,
+                                                                      struct StringTable *contigNames) {
+    const stCigar *cigar = stCigarReader_next(reader);
+    if (cigar == NULL) {
+        return NULL;
+    }
+    return constructFlatPairwiseAlignment(contigNames, cigar->contig1, cigar->start1, cigar->end1, cigar->strand1,
+                                          cigar->contig2, cigar->start2, cigar->end2, cigar->strand2, cigar->score,
+                                          cigar->operationNumber, cigar->operations);
+}
+
+////////////////////////////////////////////////
+//Writing
+////////////////////////////////////////////////
+
+static void writeBuffer(stCigarWriter *writer) {
+    if (writer->bufferLength > 0 && fwrite(writer->buffer, 1, writer->bufferLength, writer->file)
+            != (size_t) writer->bufferLength) {
+        writer->bufferLength = 0;
+        stThrowNew(ST_CIGAR_EXCEPTION_ID, "Writing alignments failed");
+    }
+    writer->bufferLength = 0;
+}
+
+/*
+ * Makes room in the buffer for length more bytes.
+ */
+static void reserve(stCigarWriter *writer, int64_t length) {
+    if (writer->bufferLength + length > writer->bufferCapacity) {
+        writeBuffer(writer);
+        if (length > writer->bufferCapacity) {
+            writer->bufferCapacity = length;
+            writer->buffer = st_realloc(writer->buffer, writer->bufferCapacity);
+        }
+    }
+}
+
+static void writeBytes(stCigarWriter *writer, const char *bytes, int64_t length) {
+    reserve(writer, length);
+    memcpy(writer->buffer + writer->bufferLength, bytes, length);
+    writer->bufferLength += length;
+}
+
+static void writeVarint(stCigarWriter *writer, uint64_t value) {
+    reserve(writer, ST_CIGAR_MAX_VARINT_LENGTH);
+    unsigned char *c = (unsigned char *) writer->buffer + writer->bufferLength;
+    while (value >= 0x80) {
+        *c++ = (unsigned char) (value | 0x80);
+        value >>= 7;
+    }
+    *c++ = (unsigned char) value;
+    writer->bufferLength = (char *) c - writer->buffer;
+}
+
+static void writeInt(stCigarWriter *writer, int64_t value) {
+    if (value < 0) {
+        stThrowNew(ST_CIGAR_EXCEPTION_ID, "Can't write the negative value %" PRIi64, value);
+    }
+    writeVarint(writer, value);
+}
+
+static void writeZigzag(stCigarWriter *writer, int64_t value) {
+    writeVarint(writer, ((uint64_t) value << 1) ^ (uint64_t) (value >> 63));
+}
+
+static void writeFloat(stCigarWriter *writer, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(float));
+    char bytes[4] = { (char) bits, (char) (bits >> 8), (char) (bits >> 16), (char) (bits >> 24) };
+    writeBytes(writer, bytes, 4);
+}
+
+static void writeName(stCigarWriter *writer, const char *name) {
+    int64_t index = (intptr_t) stHash_search(writer->nameIndices, (void *) name);
+    if (index > 0) {
+        writeVarint(writer, index - 1);
+        return;
+    }
+    index = stHash_size(writer->nameIndices);
+    stHash_insert(writer->nameIndices, stString_copy(name), (void *) (intptr_t) (index + 1));
+    writeVarint(writer, index);
+    int64_t length = strlen(name);
+    writeVarint(writer, length);
+    writeBytes(writer, name, length);
+}
+
+static void writeBinary(stCigarWriter *writer, const stCigar *cigar) {
+    writeVarint(writer, (cigar->strand1 ? 1 : 0) | (cigar->strand2 ? 2 : 0) | (cigar->hasScores ? 4 : 0));
+    writeName(writer, cigar->contig1);
+    writeInt(writer, cigar->start1);
+    writeZigzag(writer, cigar->end1 - cigar->start1);
+    writeName(writer, cigar->contig2);
+    writeInt(writer, cigar->start2);
+    writeZigzag(writer, cigar->end2 - cigar->start2);
+    writeFloat(writer, cigar->score);
+    writeVarint(writer, cigar->operationNumber);
+    for (int64_t i = 0; i < cigar->operationNumber; i++) {
+        struct AlignmentOperation *op = &cigar->operations[i];
+        if (op->opType < 0 || op->opType > PAIRWISE_INDEL_Y || op->length < 0) {
+            stThrowNew(ST_CIGAR_EXCEPTION_ID, "Can't write an operation of type %" PRIi64 " and length %" PRIi64,
+                       op->opType, op->length);
+        }
+        writeVarint(writer, ((uint64_t) op->length << 2) | op->opType);
+    }
+    if (cigar->hasScores) {
+        for (int64_t i = 0; i < cigar->operationNumber; i++) {
+            writeFloat(writer, cigar->operations[i].score);
+        }
+    }
+}
+
+static void writeTextInt(stCigarWriter *writer, int64_t value) {
+    reserve(writer, 21);
+    char digits[20], *c = writer->buffer + writer->bufferLength;
+    uint64_t magnitude = value < 0 ? -(uint64_t) value : (uint64_t) value;
+    int64_t length = 0;
+    do {
+        digits[length++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0) {
+        *c++ = '-';
+    }
+    while (length > 0) {
+        *c++ = digits[--length];
+    }
+    writer->bufferLength = c - writer->buffer;
+}
+
+static void writeTextFloat(stCigarWriter *writer, float value) {
+    char number[64];
+    int64_t length = snprintf(number, sizeof(number), "%f", value);
+    writeBytes(writer, number, length < (int64_t) sizeof(number) ? length : (int64_t) sizeof(number) - 1);
+}
+
+static void writeText(stCigarWriter *writer, const stCigar *cigar) {
+    static const char *typeCodes = "MDI", *typeCodesWithScores = "XYZ";
+    writeBytes(writer, "cigar: ", 7);
+    writeBytes(writer, cigar->contig2, strlen(cigar->contig2));
+    writeBytes(writer, " ", 1);
+    writeTextInt(writer, cigar->start2);
+    writeBytes(writer, " ", 1);
+    writeTextInt(writer, cigar->end2);
+    writeBytes(writer, cigar->strand2 ? " + " : " - ", 3);
+    writeBytes(writer, cigar->contig1, strlen(cigar->contig1));
+    writeBytes(writer, " ", 1);
+    writeTextInt(writer, cigar->start1);
+    writeBytes(writer, " ", 1);
+    writeTextInt(writer, cigar->end1);
+    writeBytes(writer, cigar->strand1 ? " + " : " - ", 3);
+    writeTextFloat(writer, cigar->score);
+    for (int64_t i = 0; i < cigar->operationNumber; i++) {
+        struct AlignmentOperation *op = &cigar->operations[i];
+        if (op->opType < 0 || op->opType > PAIRWISE_INDEL_Y) {
+            stThrowNew(ST_CIGAR_EXCEPTION_ID, "Can't write an operation of type %" PRIi64, op->opType);
+        }
+        char code[3] = { ' ', (cigar->hasScores ? typeCodesWithScores : typeCodes)[op->opType], ' ' };
+        writeBytes(writer, code, 3);
+        writeTextInt(writer, op->length);
+        if (cigar->hasScores) {
+            writeBytes(writer, " ", 1);
+            writeTextFloat(writer, op->score);
+        }
+    }
+    writeBytes(writer, "\n", 1);
+}
+
+stCigarWriter *stCigarWriter_construct(FILE *file, stCigarFormat format) {
+    stCigarWriter *writer = st_calloc(1, sizeof(stCigarWriter));
+    writer->file = file;
+    writer->format = format;
+    writer->bufferCapacity = ST_CIGAR_BUFFER_SIZE;
+    writer->buffer = st_malloc(writer->bufferCapacity);
+    writer->nameIndices = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, NULL);
+    if (format == stCigarBinary) {
+        writeBytes(writer, ST_CIGAR_MAGIC, ST_CIGAR_MAGIC_LENGTH);
+    }
+    return writer;
+}
+
+void stCigarWriter_destruct(stCigarWriter *writer) {
+    stExcept *except = NULL;
+    stTry {
+        writeBuffer(writer);
+    } stCatch(e) {
+        except = stExcept_new(stExcept_getId(e), "%s", stExcept_getMsg(e));
+    } stTryEnd;
+    stHash_destruct(writer->nameIndices);
+    free(writer->operations);
+    free(writer->buffer);
+    free(writer);
+    if (except != NULL) {
+        stThrow(except);
+    }
+}
+
+void stCigarWriter_write(stCigarWriter *writer, const stCigar *cigar) {
+    if (writer->format == stCigarBinary) {
+        writeBinary(writer, cigar);
+    } else {
+        writeText(writer, cigar);
+    }
+}
+
+void stCigarWriter_writePairwiseAlignment(stCigarWriter *writer, struct PairwiseAlignment *pA, bool writeScores) {
+    int64_t operationNumber = pA->operationList->length;
+    if (operationNumber > writer->operationCapacity) {
+        writer->operationCapacity = operationNumber;
+        writer->operations = st_realloc(writer->operations, operationNumber * sizeof(struct AlignmentOperation));
+    }
+    for (int64_t i = 0; i < operationNumber; i++) {
+        writer->operations[i] = *(struct AlignmentOperation *) pA->operationList->list[i];
+    }
+    stCigar cigar = { pA->contig1, pA->start1, pA->end1, pA->strand1, pA->contig2, pA->start2, pA->end2,
+                      pA->strand2, pA->score, writeScores, operationNumber, writer->operations };
+    stCigarWriter_write(writer, &cigar);
+}
+
+void stCigarWriter_writeFlatPairwiseAlignment(stCigarWriter *writer, struct FlatPairwiseAlignment *fPA,
+                                               bool writeScores) {
+    stCigar cigar = { fPA->contig1, fPA->start1, fPA->end1, fPA->strand1, fPA->contig2, fPA->start2, fPA->end2,
+                      fPA->strand2, fPA->score, writeScores, fPA->operationNumber, fPA->operations };
+    stCigarWriter_write(writer, &cigar);
+}
+
+void stCigarWriter_flush(stCigarWriter *writer) {
+    writeBuffer(writer);
+    if (fflush(writer->file) != 0) {
+        stThrowNew(ST_CIGAR_EXCEPTION_ID, "Writing alignments failed");
+    }
+}
@@ -331,28 +331,56 @@ stTree *stPhylogeny_scoreFromBootstrap(stTree *tree, stTree *bootstrap)
     return ret;
 }
 
-// Return a new tree which has its partitions scored by how often they
-// appear in the bootstraps. This fills in the numBootstraps and
-// bootstrapSupport fields of each node. All trees must have valid
-// stPhylogenyInfo.
-stTree *stPhylogeny_scoreFromBootstraps(stTree *tree, stList *bootstraps)
+// Clone the tree, appending each cloned node and the node it was
+// cloned from to the list.
+static stTree *cloneForScoring(stTree *tree, stList *nodePairs)
 {
-    int64_t i;
     stTree *ret = stTree_cloneNode(tree);
-    stPhylogenyInfo *info = stPhylogenyInfo_clone(stTree_getClientData(tree));
-    stTree_setClientData(ret, info);
-    // Update child partitions (if any)
-    for(i = 0; i < stTree_getChildNumber(tree); i++) {
-        stTree_setParent(stPhylogeny_scoreFromBootstraps(stTree_getChild(tree, i), bootstraps), ret);
+    stTree_setClientData(ret, stPhylogenyInfo_clone(stTree_getClientData(tree)));
+    for(int64_t i = 0; i < stTree_getChildNumber(tree); i++) {
+        stTree_setParent(cloneForScoring(stTree_getChild(tree, i), nodePairs), ret);
     }
+    stList_append(nodePairs, ret);
+    stList_append(nodePairs, tree);
+    return ret;
+}
 
-    // Check the current partition against all bootstraps
-    for(i = 0; i < stList_length(bootstraps); i++) {
-        updateSupportFromTree(ret, tree, stList_get(bootstraps, i),
-                              updatePartitionSupportFromPartition);
+struct scoreFromBootstrapsArgs {
+    stList *nodePairs;
+    stList *bootstraps;
+};
+
+// Check a range of the cloned partitions against all bootstraps. The
+// bootstraps are only read, and each partition only updates its own
+// support, so ranges can be scored in parallel.
+static void scorePartitionsFromBootstraps(int64_t start, int64_t end, struct scoreFromBootstrapsArgs *args)
+{
+    for(int64_t i = start; i < end; i++) {
+        stTree *partition = stList_get(args->nodePairs, 2 * i);
+        stTree *original = stList_get(args->nodePairs, 2 * i + 1);
+        for(int64_t j = 0; j < stList_length(args->bootstraps); j++) {
+            updateSupportFromTree(partition, original, stList_get(args->bootstraps, j),
+                                  updatePartitionSupportFromPartition);
+        }
+        stPhylogenyInfo *info = stTree_getClientData(partition);
+        info->index->bootstrapSupport = ((double) info->index->numBootstraps) / stList_length(args->bootstraps);
     }
+}
 
-    info->index->bootstrapSupport = ((double) info->index->numBootstraps) / stList_length(bootstraps);
+// Return a new tree which has its partitions scored by how often they
+// appear in the bootstraps. This fills in the numBootstraps and
+// bootstrapSupport fields of each node. All trees must have valid
+// stPhylogenyInfo. The partitions are scored in parallel on the
+// default thread pool.
+stTree *stPhylogeny_scoreFromBootstraps(stTree *tree, stList *bootstraps)
+{
+    struct scoreFromBootstrapsArgs args;
+    args.nodePairs = stList_construct();
+    args.bootstraps = bootstraps;
+    stTree *ret = cloneForScoring(tree, args.nodePairs);
+    stParallel_for(0, stList_length(args.nodePairs) / 2, 0,
+                   (void (*)(int64_t, int64_t, void *)) scorePartitionsFromBootstraps, &args);
+    stList_destruct(args.nodePairs);
     return ret;
 }
 
@@ -505,54 +533,6 @@ static double stPhylogeny_distToLeaf(stTree *tree, int64_t leafIndex) {
     return 0.0/0.0;
 }
 
-// Get the distance to a node from an internal node above it. Will
-// fail if the target node is not below.
-static double stPhylogeny_distToChild(stTree *tree, stTree *target) {
-    int64_t i, j;
-    stPhylogenyInfo *treeInfo, *targetInfo;
-    treeInfo = stTree_getClientData(tree);
-    targetInfo = stTree_getClientData(target);
-    assert(treeInfo != NULL);
-    assert(targetInfo != NULL);
-    stIndexedTreeInfo *treeIndex = treeInfo->index;
-    stIndexedTreeInfo *targetIndex = targetInfo->index;
-    assert(treeIndex != NULL);
-    assert(targetIndex != NULL);
-    assert(treeIndex->totalNumLeaves == targetIndex->totalNumLeaves);
-    if(memcmp(treeIndex->leavesBelow, targetIndex->leavesBelow,
-              treeIndex->totalNumLeaves) == 0) {
-        // This node is the target node
-        return 0.0;
-    }
-    for(i = 0; i < stTree_getChildNumber(tree); i++) {
-        stTree *child = stTree_getChild(tree, i);
-        stPhylogenyInfo *childInfo = stTree_getClientData(child);
-        assert(childInfo != NULL);
-        stIndexedTreeInfo *childIndex = childInfo->index;
-        assert(childIndex != NULL);
-        bool childIsSuperset = true;
-        // Go through all the children and find one which is above (or
-        // is) the target node. (Any node above the target will have a
-        // leaf set that is a superset of the target's leaf set.)
-        assert(childIndex->totalNumLeaves == treeIndex->totalNumLeaves);
-        for(j = 0; j < childIndex->totalNumLeaves; j++) {
-            if(targetIndex->leavesBelow[j] && !childIndex->leavesBelow[j]) {
-                childIsSuperset = false;
-                break;
-            }
-        }
-        if(childIsSuperset) {
-            return stPhylogeny_distToChild(child, target) + stTree_getBranchLength(child);
-            break;
-        }
-    }
-    // We shouldn't've gotten here--none of the children have the
-    // target under them, but this node claims to have the target under it!
-    assert(false);
-    return 0.0/0.0;
-}
-
-
 // Return the MRCA of the given leaves.
 stTree *stPhylogeny_getMRCA(stTree *tree, int64_t leaf1, int64_t leaf2) {
     for (int64_t i = 0; i < stTree_getChildNumber(tree); i++) {
@@ -579,69 +559,33 @@ double stPhylogeny_distanceBetweenLeaves(stTree *tree, int64_t leaf1,
 }
 
 // Find the distance between two arbitrary nodes (which must be in the
-// same tree, with stPhylogenyInfo attached properly).
+// same tree). Climbs from the deeper node until the paths to the root
+// meet; to answer many queries on one tree in constant time each, freeze
+// it with an LCA index and use stFrozenTree_getDistance.
 double stPhylogeny_distanceBetweenNodes(stTree *node1, stTree *node2) {
-    stPhylogenyInfo *info1, *info2;
-    if(node1 == node2) {
-        return 0.0;
+    int64_t depth1 = 0, depth2 = 0;
+    for (stTree *node = node1; stTree_getParent(node) != NULL; node = stTree_getParent(node)) {
+        depth1++;
     }
-    info1 = stTree_getClientData(node1);
-    info2 = stTree_getClientData(node2);
-    stIndexedTreeInfo *index1 = info1->index;
-    stIndexedTreeInfo *index2 = info2->index;
-    assert(index1->totalNumLeaves == index2->totalNumLeaves);
-    // Check if node1 is under node2, vice versa, or if they aren't on
-    // the same path to the root
-    bool oneAboveTwo = false, twoAboveOne = false, differentSubsets = true;
-    for(int64_t i = 0; i < index1->totalNumLeaves; i++) {
-        if(index1->leavesBelow[i] && index2->leavesBelow[i]) {
-            differentSubsets = false;
-        } else if(index2->leavesBelow[i] && !index1->leavesBelow[i]) {
-            twoAboveOne = true;
-            // Technically we can break here, but it's cheap to
-            // double-check that everything is correct.
-            assert(differentSubsets || oneAboveTwo == false);
-        } else if(index1->leavesBelow[i] && !index2->leavesBelow[i]) {
-            oneAboveTwo = true;
-            assert(differentSubsets || twoAboveOne == false);
-        }
+    for (stTree *node = node2; stTree_getParent(node) != NULL; node = stTree_getParent(node)) {
+        depth2++;
     }
-    // If differentSubsets is true, then the values of oneAboveTwo and
-    // twoAboveOne don't matter; if differentSubsets is false, exactly
-    // one should be true.
-    (void) twoAboveOne; // stop gcc complaining about this value,
-                        // which is used in asserts
-    assert(differentSubsets || (oneAboveTwo ^ twoAboveOne));
-
-    if(differentSubsets) {
-        stTree *parent = node1;
-        for(;;) {
-            parent = stTree_getParent(parent);
-            assert(parent != NULL);
-            stPhylogenyInfo *parentInfo = stTree_getClientData(parent);
-            assert(parentInfo != NULL && parentInfo->index != NULL);
-            stIndexedTreeInfo *parentIndex = parentInfo->index;
-            assert(parentIndex->totalNumLeaves == index1->totalNumLeaves);
-            bool isCommonAncestor = true;
-            for(int64_t i = 0; i < parentIndex->totalNumLeaves; i++) {
-                if((index1->leavesBelow[i] || index2->leavesBelow[i]) &&
-                   !parentIndex->leavesBelow[i]) {
-                    isCommonAncestor = false;
-                }
-            }
-            if(isCommonAncestor) {
-                // Found the MRCA of both nodes
-                break;
-            }
-        }
-        return stPhylogeny_distToChild(parent, node1) +
-            stPhylogeny_distToChild(parent, node2);
-    } else if(oneAboveTwo) {
-        return stPhylogeny_distToChild(node1, node2);
-    } else {
-        assert(twoAboveOne);
-        return stPhylogeny_distToChild(node2, node1);
+    double distance = 0.0;
+    for (; depth1 > depth2; depth1--) {
+        distance += stTree_getBranchLength(node1);
+        node1 = stTree_getParent(node1);
+    }
+    for (; depth2 > depth1; depth2--) {
+        distance += stTree_getBranchLength(node2);
+        node2 = stTree_getParent(node2);
+    }
+    while (node1 != node2) {
+        assert(stTree_getParent(node1) != NULL && stTree_getParent(node2) != NULL);
+        distance += stTree_getBranchLength(node1) + stTree_getBranchLength(node2);
+        node1 = stTree_getParent(node1);
+        node2 = stTree_getParent(node2);
     }
+    return distance;
 }
 
 // Gets the (leaf) node corresponding to an index in the distance matrix.
@@ -686,40 +630,110 @@ static void populateSpeciesToIndex(stTree *speciesTree, stHash *speciesToIndex)
     stList_destruct(bfQueue);
 }
 
+// An LCA index of a species tree, which answers the MRCA and loss
+// queries of reconciliation in constant time.
+struct _stSpeciesIndex {
+    stFrozenTree *tree; // Frozen with its LCA index.
+    int64_t *branchingAncestors; // For each node, the number of nodes from
+                                 // the root to it, inclusive, without
+                                 // exactly one child.
+};
+
+stSpeciesIndex *stSpeciesIndex_construct(stTree *speciesTree) {
+    stSpeciesIndex *index = st_malloc(sizeof(stSpeciesIndex));
+    index->tree = stFrozenTree_construct2(speciesTree, true);
+    int64_t n = stFrozenTree_getNodeNumber(index->tree);
+    index->branchingAncestors = st_malloc(n * sizeof(int64_t));
+    for (int64_t i = 0; i < n; i++) {
+        int64_t parent = stFrozenTree_getParent(index->tree, i);
+        index->branchingAncestors[i] = (parent == -1 ? 0 : index->branchingAncestors[parent]) +
+            (stFrozenTree_getChildNumber(index->tree, i) != 1);
+    }
+    return index;
+}
+
+// Builds the index for the whole species tree containing the given node.
+static stSpeciesIndex *speciesIndex_constructForRoot(stTree *species) {
+    while (stTree_getParent(species) != NULL) {
+        species = stTree_getParent(species);
+    }
+    return stSpeciesIndex_construct(species);
+}
+
+// Builds the index for the species tree the leaves of a gene tree map to.
+static stSpeciesIndex *speciesIndex_constructFromGeneTree(stTree *geneTree, stHash *leafToSpecies) {
+    while (stTree_getChildNumber(geneTree) != 0) {
+        geneTree = stTree_getChild(geneTree, 0);
+    }
+    stTree *species = stHash_search(leafToSpecies, geneTree);
+    assert(species != NULL);
+    return speciesIndex_constructForRoot(species);
+}
+
+void stSpeciesIndex_destruct(stSpeciesIndex *index) {
+    stFrozenTree_destruct(index->tree);
+    free(index->branchingAncestors);
+    free(index);
+}
+
+static int64_t speciesIndex_getIndex(stSpeciesIndex *index, stTree *species) {
+    int64_t i = stFrozenTree_getIndex(index->tree, species);
+    assert(i != -1);
+    return i;
+}
+
+static stTree *speciesIndex_getMRCA(stSpeciesIndex *index, stTree *species1, stTree *species2) {
+    int64_t mrca = stFrozenTree_getLCA(index->tree, speciesIndex_getIndex(index, species1),
+                                       speciesIndex_getIndex(index, species2));
+    return stFrozenTree_getStTree(index->tree, mrca);
+}
+
+// Maps the matrix indices in the speciesToIndex hash filled in by
+// populateSpeciesToIndex to the numbers of the species in the index.
+static int64_t *getFrozenIndices(stSpeciesIndex *index, stHash *speciesToIndex) {
+    int64_t *frozenIndices = st_malloc(stHash_size(speciesToIndex) * sizeof(int64_t));
+    stHashIterator *it = stHash_getIterator(speciesToIndex);
+    stTree *species;
+    while ((species = stHash_getNext(it)) != NULL) {
+        stIntTuple *matrixIndex = stHash_search(speciesToIndex, species);
+        frozenIndices[stIntTuple_get(matrixIndex, 0)] = speciesIndex_getIndex(index, species);
+    }
+    stHash_destructIterator(it);
+    return frozenIndices;
+}
+
 // Get the number of nodes between a descendant and its ancestor that
 // could cause losses, i.e. that have more than one child. (Exclusive
 // of both the ancestor and its descendant, so if the descendant is a
-// direct child of the ancestor, that counts as 0.)
-static int64_t numSkipsToAncestor(stTree *descendant, stTree *ancestor) {
+// direct child of the ancestor, that counts as 0.) Takes the numbers
+// of the nodes in the index.
+static int64_t numSkipsToAncestor(stSpeciesIndex *index, int64_t descendant, int64_t ancestor) {
     if (descendant == ancestor) {
         return 0;
     }
-    stTree *curNode = descendant;
-    int64_t ret = 0;
-    while ((curNode = stTree_getParent(curNode)) != NULL) {
-        if (curNode == ancestor) {
-            return ret;
-        }
-        if (stTree_getChildNumber(curNode) != 1) {
-            ret++;
-        }
-    }
-
-    // Shouldn't get here.
-    assert(false);
-    return -INT64_MAX;
+    assert(stFrozenTree_isAncestor(index->tree, ancestor, descendant));
+    return index->branchingAncestors[stFrozenTree_getParent(index->tree, descendant)] -
+        index->branchingAncestors[ancestor];
 }
 
-// Get the number of losses in a (left,right)parent; subtree
-static int64_t lossesInSubtree(stTree *parent, stTree *left, stTree *right) {
+// Get the number of losses in a (left,right)parent; subtree, given the
+// numbers of the nodes in the index.
+static int64_t lossesInSubtreeByIndex(stSpeciesIndex *index, int64_t parent, int64_t left, int64_t right) {
     int64_t ret = 0;
-    ret += numSkipsToAncestor(left, parent) + numSkipsToAncestor(right, parent);
+    ret += numSkipsToAncestor(index, left, parent) + numSkipsToAncestor(index, right, parent);
     if ((left == parent || right == parent) && (left != right)) {
         ret++;
     }
     return ret;
 }
 
+// Get the number of losses in a (left,right)parent; subtree
+static int64_t lossesInSubtree(stSpeciesIndex *index, stTree *parent, stTree *left, stTree *right) {
+    return lossesInSubtreeByIndex(index, speciesIndex_getIndex(index, parent),
+                                  speciesIndex_getIndex(index, left),
+                                  speciesIndex_getIndex(index, right));
+}
+
 // Compute join costs for a species tree for use in guided
 // neighbor-joining. These costs are calculated by penalizing
 // according to the number of dups and losses implied by the
@@ -739,23 +753,15 @@ stMatrix *stPhylogeny_computeJoinCosts(stTree *speciesTree, stHash *speciesToInd
 
     // Fill in the join cost matrix.
     stMatrix *ret = stMatrix_construct(numSpecies, numSpecies);
-    stHash *indexToSpecies = stHash_invert(speciesToIndex, (uint64_t (*)(const void *)) stIntTuple_hashKey,
-                                           (int (*)(const void *, const void *)) stIntTuple_equalsFn, NULL, NULL);
+    stSpeciesIndex *index = stSpeciesIndex_construct(speciesTree);
+    int64_t *frozenIndices = getFrozenIndices(index, speciesToIndex);
     for (int64_t i = 0; i < numSpecies; i++) {
-        // get the species node for this index (the intTuple is
-        // necessary to query the hash properly)
-        stIntTuple *query_i = stIntTuple_construct1(i);
-        stTree *species_i = stHash_search(indexToSpecies, query_i);
-        assert(species_i != NULL);
+        int64_t species_i = frozenIndices[i];
         for (int64_t j = i; j < numSpecies; j++) {
-            // get the species node for this index (the intTuple is
-            // necessary to query the hash properly)
-            stIntTuple *query_j = stIntTuple_construct1(j);
-            stTree *species_j = stHash_search(indexToSpecies, query_j);
-            assert(species_j != NULL);
+            int64_t species_j = frozenIndices[j];
 
             // Can't use stPhylogeny_getMRCA as that is only defined for leaves.
-            stTree *mrca = stTree_getMRCA(species_i, species_j);
+            int64_t mrca = stFrozenTree_getLCA(index->tree, species_i, species_j);
 
             // Calculate the number of dups implied when joining species i and j.
             if (species_i == mrca || species_j == mrca) {
@@ -769,18 +775,16 @@ stMatrix *stPhylogeny_computeJoinCosts(stTree *speciesTree, stHash *speciesToInd
 
             // Calculate the minimum number of losses implied when
             // joining species i and j.
-            int64_t numLosses = lossesInSubtree(mrca, species_i, species_j);
+            int64_t numLosses = lossesInSubtreeByIndex(index, mrca, species_i, species_j);
             *stMatrix_getCell(ret, i, j) += costPerLoss * numLosses;
             if (j != i) {
                 *stMatrix_getCell(ret, j, i) += costPerLoss * numLosses;
             }
-
-            stIntTuple_destruct(query_j);
         }
-        stIntTuple_destruct(query_i);
     }
 
-    stHash_destruct(indexToSpecies);
+    free(frozenIndices);
+    stSpeciesIndex_destruct(index);
     return ret;
 }
 
@@ -790,26 +794,23 @@ int64_t **stPhylogeny_getMRCAMatrix(stTree *speciesTree, stHash *speciesToIndex)
     for (int64_t i = 0; i < numSpecies; i++) {
         ret[i] = st_calloc(numSpecies, sizeof(int64_t));
     }
-    stHash *indexToSpecies = stHash_invert(speciesToIndex, (uint64_t (*)(const void *)) stIntTuple_hashKey,
-                                           (int (*)(const void *, const void *)) stIntTuple_equalsFn, NULL, NULL);
+    stSpeciesIndex *index = stSpeciesIndex_construct(speciesTree);
+    int64_t *frozenIndices = getFrozenIndices(index, speciesToIndex);
+    // The inverse of frozenIndices.
+    int64_t *matrixIndices = st_malloc(numSpecies * sizeof(int64_t));
+    for (int64_t i = 0; i < numSpecies; i++) {
+        matrixIndices[frozenIndices[i]] = i;
+    }
     for (int64_t i = 0; i < numSpecies; i++) {
-        stIntTuple *query_i = stIntTuple_construct1(i);
         for (int64_t j = i; j < numSpecies; j++) {
-            stTree *node_i = stHash_search(indexToSpecies, query_i);
-            assert(node_i != NULL);
-            stIntTuple *query_j = stIntTuple_construct1(j);
-            stTree *node_j = stHash_search(indexToSpecies, query_j);
-            assert(node_j != NULL);
-            stTree *mrca = stTree_getMRCA(node_i, node_j);
-            stIntTuple *mrcaIndex = stHash_search(speciesToIndex, mrca);
-            assert(mrcaIndex != NULL);
-            ret[i][j] = stIntTuple_get(mrcaIndex, 0);
+            int64_t mrca = stFrozenTree_getLCA(index->tree, frozenIndices[i], frozenIndices[j]);
+            ret[i][j] = matrixIndices[mrca];
             ret[j][i] = ret[i][j];
-            stIntTuple_destruct(query_j);
         }
-        stIntTuple_destruct(query_i);
     }
-    stHash_destruct(indexToSpecies);
+    free(matrixIndices);
+    free(frozenIndices);
+    stSpeciesIndex_destruct(index);
     return ret;
 }
 
@@ -1094,6 +1095,7 @@ static void fillInReconciliationInfo(stTree *gene, stTree *recon,
 
 static stTree *stPhylogeny_reconcileAtMostBinary_R(stTree *gene,
                                                    stHash *leafToSpecies,
+                                                   stSpeciesIndex *index,
                                                    bool relabelAncestors) {
     stTree *recon;
     stReconciliationEvent event;
@@ -1105,11 +1107,11 @@ static stTree *stPhylogeny_reconcileAtMostBinary_R(stTree *gene,
     } else {
         event = SPECIATION;
         recon = stPhylogeny_reconcileAtMostBinary_R(
-            stTree_getChild(gene, 0), leafToSpecies, relabelAncestors);
+            stTree_getChild(gene, 0), leafToSpecies, index, relabelAncestors);
         for (int64_t i = 1; i < stTree_getChildNumber(gene); i++) {
             stTree *childRecon = stPhylogeny_reconcileAtMostBinary_R(
-                stTree_getChild(gene, i), leafToSpecies, relabelAncestors);
-            recon = stTree_getMRCA(childRecon, recon);
+                stTree_getChild(gene, i), leafToSpecies, index, relabelAncestors);
+            recon = speciesIndex_getMRCA(index, childRecon, recon);
         }
         for (int64_t i = 0; i < stTree_getChildNumber(gene); i++) {
             stPhylogenyInfo *childInfo = stTree_getClientData(stTree_getChild(gene, i));
@@ -1133,7 +1135,16 @@ static stTree *stPhylogeny_reconcileAtMostBinary_R(stTree *gene,
 // children, but may have nodes with only one child.
 void stPhylogeny_reconcileAtMostBinary(stTree *geneTree, stHash *leafToSpecies,
                                        bool relabelAncestors) {
-    stPhylogeny_reconcileAtMostBinary_R(geneTree, leafToSpecies,
+    stSpeciesIndex *index = speciesIndex_constructFromGeneTree(geneTree, leafToSpecies);
+    stPhylogeny_reconcileAtMostBinary2(geneTree, leafToSpecies, index,
+                                       relabelAncestors);
+    stSpeciesIndex_destruct(index);
+}
+
+void stPhylogeny_reconcileAtMostBinary2(stTree *geneTree, stHash *leafToSpecies,
+                                        stSpeciesIndex *speciesIndex,
+                                        bool relabelAncestors) {
+    stPhylogeny_reconcileAtMostBinary_R(geneTree, leafToSpecies, speciesIndex,
                                         relabelAncestors);
 }
 
@@ -1340,13 +1351,12 @@ static void dupLoss(stTree *species, int64_t k, stHash *speciesToNumGenes, stHas
     }
 }
 
-// For a tree that has already been reconciled by
-// reconcileAtMostBinary, calculates the number of dups and losses
-// implied by the reconciliation. dups and losses must be set to 0
-// before calling.
-void stPhylogeny_reconciliationCostAtMostBinary(stTree *reconciledTree,
-                                                int64_t *dups,
-                                                int64_t *losses) {
+// Adds the dups and losses of the reconciled tree, using the index of
+// the species tree it is reconciled to.
+static void reconciliationCostAtMostBinary_R(stTree *reconciledTree,
+                                             stSpeciesIndex *index,
+                                             int64_t *dups,
+                                             int64_t *losses) {
     stPhylogenyInfo *info = stTree_getClientData(reconciledTree);
     assert(info != NULL);
     stReconciliationInfo *recon = info->recon;
@@ -1377,7 +1387,7 @@ void stPhylogeny_reconciliationCostAtMostBinary(stTree *reconciledTree,
         assert(rightRecon != NULL);
         stTree *rightSpecies = rightRecon->species;
 
-        *losses += lossesInSubtree(species, leftSpecies, rightSpecies);
+        *losses += lossesInSubtree(index, species, leftSpecies, rightSpecies);
     } else if (stTree_getChildNumber(reconciledTree) > 2) {
         // We follow the algorithm for finding the minimum mutation
         // cost in an apparent polytomy given by Lafond, Swenson,
@@ -1410,21 +1420,43 @@ void stPhylogeny_reconciliationCostAtMostBinary(stTree *reconciledTree,
     }
 
     for (int64_t i = 0; i < stTree_getChildNumber(reconciledTree); i++) {
-        stPhylogeny_reconciliationCostAtMostBinary(stTree_getChild(reconciledTree, i),
-                                                   dups, losses);
+        reconciliationCostAtMostBinary_R(stTree_getChild(reconciledTree, i),
+                                         index, dups, losses);
     }
 }
 
+// For a tree that has already been reconciled by
+// reconcileAtMostBinary, calculates the number of dups and losses
+// implied by the reconciliation. dups and losses must be set to 0
+// before calling.
+void stPhylogeny_reconciliationCostAtMostBinary(stTree *reconciledTree,
+                                                int64_t *dups,
+                                                int64_t *losses) {
+    stPhylogenyInfo *info = stTree_getClientData(reconciledTree);
+    assert(info != NULL && info->recon != NULL);
+    stSpeciesIndex *index = speciesIndex_constructForRoot(info->recon->species);
+    reconciliationCostAtMostBinary_R(reconciledTree, index, dups, losses);
+    stSpeciesIndex_destruct(index);
+}
+
+void stPhylogeny_reconciliationCostAtMostBinary2(stTree *reconciledTree,
+                                                 stSpeciesIndex *speciesIndex,
+                                                 int64_t *dups,
+                                                 int64_t *losses) {
+    reconciliationCostAtMostBinary_R(reconciledTree, speciesIndex, dups, losses);
+}
+
 // Recurse down a tree testing roots to see which would give the
 // lowest recon cost if the tree was rooted at that position.
 // curRoot is the child of the branch to root on.
-void stPhylogeny_rootByReconciliationAtMostBinary_R(stTree *curRoot,
-                                                    stTree *prevRootParentSpecies,
-                                                    int64_t prevRootDups,
-                                                    int64_t prevRootLosses,
-                                                    int64_t *bestDups,
-                                                    int64_t *bestLosses,
-                                                    stTree **bestRoot) {
+static void rootByReconciliationAtMostBinary_R(stTree *curRoot,
+                                               stSpeciesIndex *index,
+                                               stTree *prevRootParentSpecies,
+                                               int64_t prevRootDups,
+                                               int64_t prevRootLosses,
+                                               int64_t *bestDups,
+                                               int64_t *bestLosses,
+                                               stTree **bestRoot) {
     // The difference between the tree rooted at this branch and the
     // one that was rooted previous to this is just the reconciliation
     // of the parent of this branch and the new root. So recalculate
@@ -1450,7 +1482,7 @@ void stPhylogeny_rootByReconciliationAtMostBinary_R(stTree *curRoot,
     // Call this the parent's new species for consistency, although
     // now it's the sibling in the new tree. The name is confusing
     // either way.
-    stTree *parentNewSpecies = stTree_getMRCA(prevRootParentSpecies, siblingSpecies);
+    stTree *parentNewSpecies = speciesIndex_getMRCA(index, prevRootParentSpecies, siblingSpecies);
 
     // Next, the new root's recon is just the MRCA of our parent's
     // recon in the rerooted tree, and the recon of this node (which
@@ -1458,7 +1490,7 @@ void stPhylogeny_rootByReconciliationAtMostBinary_R(stTree *curRoot,
     stPhylogenyInfo *curInfo = stTree_getClientData(curRoot);
     assert(curInfo != NULL && curInfo->recon != NULL);
     stTree *curSpecies = curInfo->recon->species;
-    stTree *newRootSpecies = stTree_getMRCA(curSpecies, parentNewSpecies);
+    stTree *newRootSpecies = speciesIndex_getMRCA(index, curSpecies, parentNewSpecies);
 
     // Find the new cost in dups. This is just (# of old dups) - (old root
     // was dup? 1 : 0) - (parent used to be dup? 1 : 0) + (new root is
@@ -1467,8 +1499,8 @@ void stPhylogeny_rootByReconciliationAtMostBinary_R(stTree *curRoot,
     if (parentOldSpecies == curSpecies || parentOldSpecies == siblingSpecies) {
         curRootDups--;
     }
-    stTree *oldRootSpecies = stTree_getMRCA(prevRootParentSpecies,
-                                            parentOldSpecies);
+    stTree *oldRootSpecies = speciesIndex_getMRCA(index, prevRootParentSpecies,
+                                                  parentOldSpecies);
     if (oldRootSpecies == prevRootParentSpecies || oldRootSpecies == parentOldSpecies) {
         curRootDups--;
     }
@@ -1481,11 +1513,11 @@ void stPhylogeny_rootByReconciliationAtMostBinary_R(stTree *curRoot,
 
     // Now find the new cost in losses.
     int64_t curRootLosses = prevRootLosses;
-    curRootLosses -= lossesInSubtree(parentOldSpecies, curSpecies, siblingSpecies);
-    curRootLosses -= lossesInSubtree(oldRootSpecies, prevRootParentSpecies, parentOldSpecies);
+    curRootLosses -= lossesInSubtree(index, parentOldSpecies, curSpecies, siblingSpecies);
+    curRootLosses -= lossesInSubtree(index, oldRootSpecies, prevRootParentSpecies, parentOldSpecies);
     assert(curRootLosses >= 0);
-    curRootLosses += lossesInSubtree(newRootSpecies, curSpecies, parentNewSpecies);
-    curRootLosses += lossesInSubtree(parentNewSpecies, siblingSpecies, prevRootParentSpecies);
+    curRootLosses += lossesInSubtree(index, newRootSpecies, curSpecies, parentNewSpecies);
+    curRootLosses += lossesInSubtree(index, parentNewSpecies, siblingSpecies, prevRootParentSpecies);
 
     if (curRootDups < *bestDups || (curRootDups == *bestDups && curRootLosses < *bestLosses)) {
         *bestDups = curRootDups;
@@ -1493,11 +1525,11 @@ void stPhylogeny_rootByReconciliationAtMostBinary_R(stTree *curRoot,
         *bestRoot = curRoot;
     }
     for (int64_t i = 0; i < stTree_getChildNumber(curRoot); i++) {
-        stPhylogeny_rootByReconciliationAtMostBinary_R(stTree_getChild(curRoot, i),
-                                                       parentNewSpecies,
-                                                       curRootDups,
-                                                       curRootLosses, bestDups,
-                                                       bestLosses, bestRoot);
+        rootByReconciliationAtMostBinary_R(stTree_getChild(curRoot, i), index,
+                                           parentNewSpecies,
+                                           curRootDups,
+                                           curRootLosses, bestDups,
+                                           bestLosses, bestRoot);
     }
 }
 
@@ -1508,11 +1540,20 @@ void stPhylogeny_rootByReconciliationAtMostBinary_R(stTree *curRoot,
 // reconciliation information that potentially already exists.
 stTree *stPhylogeny_rootByReconciliationAtMostBinary(stTree *geneTree,
                                                      stHash *leafToSpecies) {
-    stPhylogeny_reconcileAtMostBinary(geneTree, leafToSpecies, false);
+    stSpeciesIndex *index = speciesIndex_constructFromGeneTree(geneTree, leafToSpecies);
+    stTree *rooted = stPhylogeny_rootByReconciliationAtMostBinary2(geneTree, leafToSpecies, index);
+    stSpeciesIndex_destruct(index);
+    return rooted;
+}
+
+stTree *stPhylogeny_rootByReconciliationAtMostBinary2(stTree *geneTree,
+                                                      stHash *leafToSpecies,
+                                                      stSpeciesIndex *index) {
+    stPhylogeny_reconcileAtMostBinary_R(geneTree, leafToSpecies, index, false);
 
     // Find the root which has the lowest reconciliation cost.
     int64_t dups = 0, losses = 0;
-    stPhylogeny_reconciliationCostAtMostBinary(geneTree, &dups, &losses);
+    reconciliationCostAtMostBinary_R(geneTree, index, &dups, &losses);
     stTree *bestRoot = geneTree;
     int64_t bestDups = dups;
     int64_t bestLosses = losses;
@@ -1527,20 +1568,20 @@ stTree *stPhylogeny_rootByReconciliationAtMostBinary(stTree *geneTree,
         stPhylogenyInfo *rightChildInfo = stTree_getClientData(rightChild);
         stTree *rightChildSpecies = rightChildInfo->recon->species;
         for (int64_t i = 0; i < stTree_getChildNumber(leftChild); i++) {
-            stPhylogeny_rootByReconciliationAtMostBinary_R(stTree_getChild(leftChild, i),
-                                                           rightChildSpecies,
-                                                           dups, losses,
-                                                           &bestDups,
-                                                           &bestLosses,
-                                                           &bestRoot);
+            rootByReconciliationAtMostBinary_R(stTree_getChild(leftChild, i), index,
+                                               rightChildSpecies,
+                                               dups, losses,
+                                               &bestDups,
+                                               &bestLosses,
+                                               &bestRoot);
         }
         for (int64_t i = 0; i < stTree_getChildNumber(rightChild); i++) {
-            stPhylogeny_rootByReconciliationAtMostBinary_R(stTree_getChild(rightChild, i),
-                                                           leftChildSpecies,
-                                                           dups, losses,
-                                                           &bestDups,
-                                                           &bestLosses,
-                                                           &bestRoot);
+            rootByReconciliationAtMostBinary_R(stTree_getChild(rightChild, i), index,
+                                               leftChildSpecies,
+                                               dups, losses,
+                                               &bestDups,
+                                               &bestLosses,
+                                               &bestRoot);
         }
         return stTree_reRoot(bestRoot, stTree_getBranchLength(bestRoot)/2);
     }
@@ -1567,7 +1608,16 @@ static stHash *getNewLeafToSpecies(stTree *rerooted) {
 }
 
 stTree *stPhylogeny_rootByReconciliationNaive(stTree *tree, stHash *leafToSpecies) {
-    stPhylogeny_reconcileAtMostBinary(tree, leafToSpecies, false);
+    stSpeciesIndex *index = speciesIndex_constructFromGeneTree(tree, leafToSpecies);
+    stTree *rooted = stPhylogeny_rootByReconciliationNaive2(tree, leafToSpecies, index);
+    stSpeciesIndex_destruct(index);
+    return rooted;
+}
+
+stTree *stPhylogeny_rootByReconciliationNaive2(stTree *tree, stHash *leafToSpecies,
+                                               stSpeciesIndex *index) {
+    // Every rerooting is reconciled to the same species tree, so shares the index.
+    stPhylogeny_reconcileAtMostBinary_R(tree, leafToSpecies, index, false);
     stList *stack = stList_construct();
     stList_append(stack, tree);
     stTree *bestTree = NULL;
@@ -1586,10 +1636,10 @@ stTree *stPhylogeny_rootByReconciliationNaive(stTree *tree, stHash *leafToSpecie
             curTree = stTree_clone(tree);
         }
         stHash *newLeafToSpecies = getNewLeafToSpecies(curTree);
-        stPhylogeny_reconcileAtMostBinary(curTree, newLeafToSpecies, false);
+        stPhylogeny_reconcileAtMostBinary_R(curTree, newLeafToSpecies, index, false);
         stHash_destruct(newLeafToSpecies);
         int64_t dups = 0, losses = 0;
-        stPhylogeny_reconciliationCostAtMostBinary(curTree, &dups, &losses);
+        reconciliationCostAtMostBinary_R(curTree, index, &dups, &losses);
         if (dups < bestDups || (dups == bestDups && losses < bestLosses)) {
             if (bestTree != NULL) {
                 stPhylogenyInfo_destructOnTree(bestTree);
@@ -1636,7 +1686,8 @@ static stSet *climb(stTree *childGene, stTree *childLCARecon, stTree *parentGene
 }
 
 static stTree *stPhylogeny_reconcileNonBinary_R(stTree *gene, stHash *leafToSpecies,
-                                                stHash *N, bool relabelAncestors) {
+                                                stSpeciesIndex *index, stHash *N,
+                                                bool relabelAncestors) {
     stTree *LCARecon;
     stReconciliationEvent event;
     if (stTree_getChildNumber(gene) == 0) {
@@ -1651,10 +1702,10 @@ static stTree *stPhylogeny_reconcileNonBinary_R(stTree *gene, stHash *leafToSpec
         // Internal node
         // Calculate the LCA mapping
         stTree *leftLCARecon = stPhylogeny_reconcileNonBinary_R(
-            stTree_getChild(gene, 0), leafToSpecies, N, relabelAncestors);
+            stTree_getChild(gene, 0), leafToSpecies, index, N, relabelAncestors);
         stTree *rightLCARecon = stPhylogeny_reconcileNonBinary_R(
-            stTree_getChild(gene, 1), leafToSpecies, N, relabelAncestors);
-        LCARecon = stTree_getMRCA(leftLCARecon, rightLCARecon);
+            stTree_getChild(gene, 1), leafToSpecies, index, N, relabelAncestors);
+        LCARecon = speciesIndex_getMRCA(index, leftLCARecon, rightLCARecon);
         // Calculate if this is a required duplication. We don't
         // really care if it's a conditional duplication.
         stSet *leftN = climb(stTree_getChild(gene, 0), leftLCARecon,
@@ -1684,10 +1735,17 @@ static stTree *stPhylogeny_reconcileNonBinary_R(stTree *gene, stHash *leafToSpec
 }
 
 void stPhylogeny_reconcileNonBinary(stTree *geneTree, stHash *leafToSpecies, bool relabelAncestors) {
+    stSpeciesIndex *index = speciesIndex_constructFromGeneTree(geneTree, leafToSpecies);
+    stPhylogeny_reconcileNonBinary2(geneTree, leafToSpecies, index, relabelAncestors);
+    stSpeciesIndex_destruct(index);
+}
+
+void stPhylogeny_reconcileNonBinary2(stTree *geneTree, stHash *leafToSpecies,
+                                     stSpeciesIndex *speciesIndex, bool relabelAncestors) {
     // TODO: this hash is likely unnecessary and values could probably
     // be passed up along the tree by stPhylogeny_reconcile_R.
     stHash *N = stHash_construct();
-    stPhylogeny_reconcileNonBinary_R(geneTree, leafToSpecies, N, relabelAncestors);
+    stPhylogeny_reconcileNonBinary_R(geneTree, leafToSpecies, speciesIndex, N, relabelAncestors);
     stHash_destruct(N);
 }
 
@@ -1932,6 +1990,42 @@ static void assignIsolationIndex(stMatrix *distanceMatrix, stSplit *split) {
     split->isolationIndex = min_isolation / 2;
 }
 
+struct splitExtensionArgs {
+    stMatrix *distanceMatrix;
+    bool relaxed;
+    stList *splits;
+    stIntTuple *iTuple; // The index being added to the splits.
+    bool *addToLeft;
+    bool *addToRight;
+};
+
+// Check whether each split in the range can be extended with i on
+// its left side and on its right side. Each split's lists are only
+// modified (temporarily) by the one check, so ranges can be checked
+// in parallel.
+static void checkSplitExtensions(int64_t start, int64_t end, struct splitExtensionArgs *args) {
+    for (int64_t j = start; j < end; j++) {
+        stSplit *split = stList_get(args->splits, j);
+        stList_append(split->leftSplit, args->iTuple);
+        args->addToLeft[j] = satisfiesFourPoint(args->distanceMatrix, split->leftSplit, split->rightSplit, args->relaxed);
+        stList_pop(split->leftSplit);
+        stList_append(split->rightSplit, args->iTuple);
+        args->addToRight[j] = satisfiesFourPoint(args->distanceMatrix, split->leftSplit, split->rightSplit, args->relaxed);
+        stList_pop(split->rightSplit);
+    }
+}
+
+struct isolationIndexArgs {
+    stMatrix *distanceMatrix;
+    stList *splits;
+};
+
+static void assignIsolationIndexes(int64_t start, int64_t end, struct isolationIndexArgs *args) {
+    for (int64_t i = start; i < end; i++) {
+        assignIsolationIndex(args->distanceMatrix, stList_get(args->splits, i));
+    }
+}
+
 stList *stPhylogeny_getSplits(stMatrix *distanceMatrix, bool relaxed) {
     assert(stMatrix_m(distanceMatrix) == stMatrix_n(distanceMatrix));
     stList *splits = stList_construct3(0, (void (*)(void *)) stSplit_destruct);
@@ -1944,15 +2038,25 @@ stList *stPhylogeny_getSplits(stMatrix *distanceMatrix, bool relaxed) {
         }
         stList *newSplits = stList_construct3(0, (void (*)(void *)) stSplit_destruct);
         stList_append(newSplits, stSplit_construct(singletonSplitLeft, singletonSplitRight, 0.0));
+
+        // The four-point checks for the existing splits are
+        // independent, so run them in parallel first.
+        struct splitExtensionArgs args;
+        args.distanceMatrix = distanceMatrix;
+        args.relaxed = relaxed;
+        args.splits = splits;
+        args.iTuple = stIntTuple_construct1(i);
+        args.addToLeft = st_malloc(stList_length(splits) * sizeof(bool));
+        args.addToRight = st_malloc(stList_length(splits) * sizeof(bool));
+        stParallel_for(0, stList_length(splits), 0,
+                       (void (*)(int64_t, int64_t, void *)) checkSplitExtensions, &args);
+        stIntTuple_destruct(args.iTuple);
+
         while (stList_length(splits) > 0) {
+            bool addToLeft = args.addToLeft[stList_length(splits) - 1];
+            bool addToRight = args.addToRight[stList_length(splits) - 1];
             stSplit *split = stList_pop(splits);
             stIntTuple *iTuple = stIntTuple_construct1(i);
-            stList_append(split->leftSplit, iTuple);
-            bool addToLeft = satisfiesFourPoint(distanceMatrix, split->leftSplit, split->rightSplit, relaxed);
-            stList_pop(split->leftSplit);
-            stList_append(split->rightSplit, iTuple);
-            bool addToRight = satisfiesFourPoint(distanceMatrix, split->leftSplit, split->rightSplit, relaxed);
-            stList_pop(split->rightSplit);
             if (addToRight && addToLeft) {
                 // We are making two new splits, so have to clone the
                 // lists and their elements. For no particular reason,
@@ -1987,17 +2091,25 @@ stList *stPhylogeny_getSplits(stMatrix *distanceMatrix, bool relaxed) {
                 stList_append(split->leftSplit, iTuple);
                 stList_append(newSplits, split);
             } else {
+                stIntTuple_destruct(iTuple);
                 stSplit_destruct(split);
             }
         }
+        free(args.addToLeft);
+        free(args.addToRight);
         stList_destruct(splits);
         splits = newSplits;
     }
 
-    // Remove the remaining trivial splits and assign isolation indexes.
+    // Assign isolation indexes (in parallel, as each split is
+    // independent) and remove the remaining trivial splits.
+    struct isolationIndexArgs isolationArgs;
+    isolationArgs.distanceMatrix = distanceMatrix;
+    isolationArgs.splits = splits;
+    stParallel_for(0, stList_length(splits), 0,
+                   (void (*)(int64_t, int64_t, void *)) assignIsolationIndexes, &isolationArgs);
     for (int64_t i = 0; i < stList_length(splits); i++) {
         stSplit *split = stList_get(splits, i);
-        assignIsolationIndex(distanceMatrix, split);
         if (stList_length(split->leftSplit) == 1 || stList_length(split->rightSplit) == 1) {
             // inefficient
             stList_remove(splits, i);
@@ -2013,11 +2125,15 @@ stList *stPhylogeny_getSplits(stMatrix *distanceMatrix, bool relaxed) {
     return splits;
 }
 
-static bool isCompatibleSplit(stList *splitIndices, stHash *indexToLeaf) {
-    stTree *parent = stTree_getParent(stHash_search(indexToLeaf, stList_get(splitIndices, 0)));
+static stTree *getSplitLeaf(stList *splitIndices, int64_t i, stIntHash *indexToLeaf) {
+    return stIntHash_search(indexToLeaf, stIntTuple_get(stList_get(splitIndices, i), 0));
+}
+
+static bool isCompatibleSplit(stList *splitIndices, stIntHash *indexToLeaf) {
+    stTree *parent = stTree_getParent(getSplitLeaf(splitIndices, 0, indexToLeaf));
     assert(parent != NULL);
     for (int64_t i = 1; i < stList_length(splitIndices); i++) {
-        stTree *leaf = stHash_search(indexToLeaf, stList_get(splitIndices, i));
+        stTree *leaf = getSplitLeaf(splitIndices, i, indexToLeaf);
         if (stTree_getParent(leaf) != parent) {
             return false;
         }
@@ -2025,26 +2141,27 @@ static bool isCompatibleSplit(stList *splitIndices, stHash *indexToLeaf) {
     return true;
 }
 
-static void applyCompatibleSplit(stList *splitIndices, stHash *indexToLeaf) {
-    stTree *parent = stTree_getParent(stHash_search(indexToLeaf, stList_get(splitIndices, 0)));
+static void applyCompatibleSplit(stList *splitIndices, stIntHash *indexToLeaf) {
+    stTree *parent = stTree_getParent(getSplitLeaf(splitIndices, 0, indexToLeaf));
     stTree *newNode = stTree_construct();
     stTree_setParent(newNode, parent);
     // Branch lengths are arbitrarily set to 1.0.
     stTree_setBranchLength(newNode, 1.0);
     for (int64_t i = 0; i < stList_length(splitIndices); i++) {
-        stTree *leaf = stHash_search(indexToLeaf, stList_get(splitIndices, i));
+        stTree *leaf = getSplitLeaf(splitIndices, i, indexToLeaf);
         stTree_setParent(leaf, newNode);
     }
 }
 
 stTree *stPhylogeny_greedySplitDecomposition(stMatrix *distanceMatrix, bool relaxed) {
     assert(stMatrix_m(distanceMatrix) == stMatrix_n(distanceMatrix));
-    stHash *indexToLeaf = stHash_construct3((uint64_t (*)(const void *)) stIntTuple_hashKey, (int (*)(const void *, const void *)) stIntTuple_equalsFn, (void (*)(void *)) stIntTuple_destruct, NULL);
+    stIntHash *indexToLeaf = stIntHash_construct();
+    stIntHash_reserve(indexToLeaf, stMatrix_m(distanceMatrix));
     // We start out with a complete star phylogeny.
     stTree *root = stTree_construct();
     for (int64_t i = 0; i < stMatrix_m(distanceMatrix); i++) {
         stTree *leaf = stTree_construct();
-        stHash_insert(indexToLeaf, stIntTuple_construct1(i), leaf);
+        stIntHash_insert(indexToLeaf, i, leaf);
         char *label = stString_print_r("%" PRIi64, i);
         stTree_setLabel(leaf, label);
         free(label);
@@ -2068,7 +2185,7 @@ stTree *stPhylogeny_greedySplitDecomposition(stMatrix *distanceMatrix, bool rela
         }
     }
     stList_destruct(splits);
-    stHash_destruct(indexToLeaf);
+    stIntHash_destruct(indexToLeaf);
     stPhylogeny_addStIndexedTreeInfo(root);
     return root;
 }
@@ -1,46 +1,61 @@
-// A very simple pthreads thread pool implementation.
+// A pthreads thread pool with a work-stealing scheduler, see
+// stThreadPool.h.
 //
-// A work stack feeds a number of threads. Every work unit is worked
-// on by a single thread, which executes the work function, then
-// fetches a new work unit when finished.
+// Each worker owns a deque of tasks protected by its own lock. The
+// owner pushes onto and (by default) pops from the bottom of its
+// deque, and thieves take from the top, so the only lock shared by
+// all threads is the one idle workers sleep on.
 //
-// Often threads only need to write once to some single "result"
-// variable, after the heavy computational work is done. To avoid
-// needing to manage your own locks for this simple case, an optional
-// "finish" function is available, which is guaranteed to run serially
-// (although the work function and main thread will still run
-// alongside it). If you don't want to use a finishing function, then
-// the value returned by the work function is completely ignored.
-//
-// Note that the work "queue" is actually a stack, not a queue. This
-// shouldn't matter, as you have absolutely no ordering guarantees on
-// what order the work is completed in regardless.
+// Counters that are read without holding a lock are accessed with
+// sequentially consistent atomics. A thread that is about to sleep
+// increments a waiter count before checking the condition it is
+// waiting for, and a thread that changes the condition checks the
+// waiter count afterwards, so between them one always sees the
+// other and no wakeup is lost.
 #include <stdlib.h>
 #include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
 #include "sonLib.h"
 
-struct _stThreadPool {
-    pthread_mutex_t stackLock;  // Locks the stack so work can be
-                                // pushed/popped serially.
-
-    pthread_cond_t stackCond;   // Signals threads waiting on the
-                                // stack that there's new data. Locked
-                                // by stackLock.
+#define INITIAL_DEQUE_CAPACITY 64
+#define CHUNKS_PER_THREAD 4 // Automatic chunking for stParallel_for.
 
-    int64_t numFinishedThreads; // Number of threads currently waiting
-                                // on the stack. Locked by stackLock
-                                // as well.
+#define atomicLoad(x) __atomic_load_n(x, __ATOMIC_SEQ_CST)
+#define atomicStore(x, v) __atomic_store_n(x, v, __ATOMIC_SEQ_CST)
+#define atomicAdd(x, v) __atomic_add_fetch(x, v, __ATOMIC_SEQ_CST)
 
-    pthread_cond_t finishedCond;// Signals the parent thread that work
-                                // just finished. Locked by stackLock.
+struct _stThreadPoolTask {
+    stThreadPool *threadPool;
+    void *(*fn)(void *);        // NULL for work units pushed with
+                                // stThreadPool_push, which use the
+                                // pool's work and finish functions.
+    void *arg;
+    void *result;
+    int done;                   // Set (atomically) once result is
+                                // written. The worker does not touch
+                                // the task after setting it.
+};
 
-    stList *stack;              // Work units stored here. Locked by
-                                // stackLock.
+struct deque {
+    pthread_mutex_t lock;
+    stThreadPoolTask **tasks;   // Circular buffer.
+    int64_t capacity;           // Always a power of two.
+    int64_t top;                // Index of the oldest task.
+    int64_t count;              // Written under the lock, but read
+                                // atomically without it to skip
+                                // empty deques.
+};
 
-    pthread_mutex_t finishLock; // Lock to ensure that all "finish" functions
-                                // are done serially.
+struct worker {
+    stThreadPool *threadPool;
+    struct deque deque;
+    uint64_t randomState;       // For choosing who to steal from.
+    pthread_t thread;
+};
 
-    pthread_t *threads;         // The threads in the pool.
+struct _stThreadPool {
+    struct worker *workers;     // The threads in the pool.
 
     int64_t numThreads;         // Number of threads in the pool.
 
@@ -50,99 +65,273 @@ struct _stThreadPool {
     void (*finishFunc)(void *); // Function that takes a result and
                                 // does something with it.
 
-    bool killFlag;              // Set when the thread pool wants the
-                                // threads to stop. pthread_cancel
-                                // requires that they hit a
-                                // cancellation point, which isn't
-                                // guaranteed to happen.
+    pthread_mutex_t finishLock; // Lock to ensure that all "finish" functions
+                                // are done serially.
+
+    stThreadPoolOrder order;    // Order workers run their own tasks in.
+
+    pthread_key_t workerKey;    // Thread specific pointer to the
+                                // worker struct of each pool thread,
+                                // NULL in other threads.
+
+    pthread_mutex_t sleepLock;  // Idle workers and threads in
+                                // stThreadPool_wait block on this.
+
+    pthread_cond_t sleepCond;   // Signals idle workers that there is
+                                // new work. Locked by sleepLock.
+
+    pthread_cond_t finishedCond;// Signals threads in stThreadPool_wait
+                                // that the pool is idle. Locked by
+                                // sleepLock.
+
+    pthread_mutex_t taskLock;   // Threads outside the pool waiting on
+                                // a task block on this.
+
+    pthread_cond_t taskCond;    // Signals that some task
+                                // completed. Locked by taskLock.
+
+    int64_t queued;             // Tasks sitting in deques.
+
+    int64_t pending;            // Tasks pushed but not yet completed.
+
+    int64_t sleepers;           // Workers idle on sleepCond.
+
+    int64_t poolWaiters;        // Threads in stThreadPool_wait.
+
+    int64_t taskWaiters;        // Threads waiting on taskCond.
+
+    uint64_t nextDeque;         // Round robin counter for spreading
+                                // work pushed from outside the pool.
+
+    int killFlag;               // Set when the thread pool wants the
+                                // threads to stop.
 };
 
-// Worker function for each thread spawned. This function should never
-// return until it is cancelled in the destructor.
-static void worker(stThreadPool *threadPool) {
-    int oldtype;
-    pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
-    // We don't need the old cancellation type but we have to specify
-    // a non-NULL argument to be POSIX-compatible
-    (void) oldtype;
-    while (1) {
-        pthread_mutex_lock(&threadPool->stackLock);
-        // Signal that we're waiting for work.
-        threadPool->numFinishedThreads++;
-        while (stList_length(threadPool->stack) == 0 && !threadPool->killFlag) {
-            // Wake up the main thread in case it's waiting for us to be
-            // done.
-            pthread_cond_signal(&threadPool->finishedCond);
-            // This unlocks the lock and waits to be signaled on stackCond.
-            pthread_cond_wait(&threadPool->stackCond, &threadPool->stackLock);
-            // We have the lock again now.
+static void initLock(pthread_mutex_t *lock) {
+    int pthreadError = pthread_mutex_init(lock, NULL);
+    if (pthreadError) {
+        st_errAbort("stThreadPool: pthread_mutex_init failed: %s",
+                    strerror(pthreadError));
+    }
+}
+
+static void initCond(pthread_cond_t *cond) {
+    int pthreadError = pthread_cond_init(cond, NULL);
+    if (pthreadError) {
+        st_errAbort("stThreadPool: pthread_cond_init failed: %s",
+                    strerror(pthreadError));
+    }
+}
+
+////////////////////////////////////////////////
+// Deques
+////////////////////////////////////////////////
+
+static void deque_init(struct deque *deque) {
+    initLock(&deque->lock);
+    deque->capacity = INITIAL_DEQUE_CAPACITY;
+    deque->tasks = st_malloc(deque->capacity * sizeof(stThreadPoolTask *));
+    deque->top = 0;
+    deque->count = 0;
+}
+
+static void deque_pushBottom(struct deque *deque, stThreadPoolTask *task) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count == deque->capacity) {
+        stThreadPoolTask **tasks = st_malloc(2 * deque->capacity * sizeof(stThreadPoolTask *));
+        for (int64_t i = 0; i < deque->count; i++) {
+            tasks[i] = deque->tasks[(deque->top + i) & (deque->capacity - 1)];
         }
+        free(deque->tasks);
+        deque->tasks = tasks;
+        deque->top = 0;
+        deque->capacity *= 2;
+    }
+    deque->tasks[(deque->top + deque->count) & (deque->capacity - 1)] = task;
+    atomicStore(&deque->count, deque->count + 1);
+    pthread_mutex_unlock(&deque->lock);
+}
+
+// Takes the newest task if fromBottom, else the oldest. Returns NULL
+// if the deque is empty.
+static stThreadPoolTask *deque_pop(struct deque *deque, bool fromBottom) {
+    if (atomicLoad(&deque->count) == 0) {
+        return NULL;
+    }
+    stThreadPoolTask *task = NULL;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count > 0) {
+        if (fromBottom) {
+            task = deque->tasks[(deque->top + deque->count - 1) & (deque->capacity - 1)];
+        } else {
+            task = deque->tasks[deque->top];
+            deque->top = (deque->top + 1) & (deque->capacity - 1);
+        }
+        atomicStore(&deque->count, deque->count - 1);
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return task;
+}
 
-        if (threadPool->killFlag) {
-            // Time to go away now
-            pthread_mutex_unlock(&threadPool->stackLock);
-            pthread_exit(NULL);
+static void deque_destruct(struct deque *deque) {
+    // Work units pushed with stThreadPool_push are owned by the pool,
+    // task handles by whoever submitted them.
+    for (int64_t i = 0; i < deque->count; i++) {
+        stThreadPoolTask *task = deque->tasks[(deque->top + i) & (deque->capacity - 1)];
+        if (task->fn == NULL) {
+            free(task);
         }
+    }
+    free(deque->tasks);
+    pthread_mutex_destroy(&deque->lock);
+}
+
+////////////////////////////////////////////////
+// Scheduling
+////////////////////////////////////////////////
 
-        void *workUnit = stList_pop(threadPool->stack);
-        // Before unlocking the lock, un-signal that we're waiting for work.
-        threadPool->numFinishedThreads--;
-        pthread_mutex_unlock(&threadPool->stackLock);
+// Returns the worker struct if the calling thread belongs to the
+// pool, else NULL.
+static struct worker *getCurrentWorker(stThreadPool *threadPool) {
+    return pthread_getspecific(threadPool->workerKey);
+}
 
-        // Do the actual work.
-        void *result = threadPool->workFunc(workUnit);
+// Finds a task to run, first from the worker's own deque (if the
+// caller is a worker) and then by stealing from the others. Returns
+// NULL if no work was found.
+static stThreadPoolTask *findTask(stThreadPool *threadPool, struct worker *worker) {
+    stThreadPoolTask *task = NULL;
+    int64_t start = 0;
+    if (worker != NULL) {
+        task = deque_pop(&worker->deque, threadPool->order == stThreadPoolLIFO);
+        // xorshift, to spread thieves over the victims.
+        worker->randomState ^= worker->randomState << 13;
+        worker->randomState ^= worker->randomState >> 7;
+        worker->randomState ^= worker->randomState << 17;
+        start = worker->randomState % threadPool->numThreads;
+    }
+    for (int64_t i = 0; task == NULL && i < threadPool->numThreads; i++) {
+        struct worker *victim = &threadPool->workers[(start + i) % threadPool->numThreads];
+        if (victim != worker) {
+            task = deque_pop(&victim->deque, 0);
+        }
+    }
+    if (task != NULL) {
+        atomicAdd(&threadPool->queued, -1);
+    }
+    return task;
+}
 
+static void runTask(stThreadPool *threadPool, stThreadPoolTask *task) {
+    if (task->fn == NULL) {
+        void *result = threadPool->workFunc(task->arg);
+        free(task);
         // Finish up serially if needed.
         if (threadPool->finishFunc != NULL) {
             pthread_mutex_lock(&threadPool->finishLock);
             threadPool->finishFunc(result);
             pthread_mutex_unlock(&threadPool->finishLock);
         }
+    } else {
+        task->result = task->fn(task->arg);
+        atomicStore(&task->done, 1);
+        if (atomicLoad(&threadPool->taskWaiters) > 0) {
+            pthread_mutex_lock(&threadPool->taskLock);
+            pthread_cond_broadcast(&threadPool->taskCond);
+            pthread_mutex_unlock(&threadPool->taskLock);
+        }
+    }
+    if (atomicAdd(&threadPool->pending, -1) == 0 && atomicLoad(&threadPool->poolWaiters) > 0) {
+        pthread_mutex_lock(&threadPool->sleepLock);
+        pthread_cond_broadcast(&threadPool->finishedCond);
+        pthread_mutex_unlock(&threadPool->sleepLock);
+    }
+}
+
+static void enqueue(stThreadPool *threadPool, stThreadPoolTask *task) {
+    atomicAdd(&threadPool->pending, 1);
+    struct worker *worker = getCurrentWorker(threadPool);
+    if (worker == NULL) {
+        uint64_t i = __atomic_fetch_add(&threadPool->nextDeque, 1, __ATOMIC_RELAXED);
+        worker = &threadPool->workers[i % threadPool->numThreads];
+    }
+    deque_pushBottom(&worker->deque, task);
+    atomicAdd(&threadPool->queued, 1);
+    if (atomicLoad(&threadPool->sleepers) > 0) {
+        pthread_mutex_lock(&threadPool->sleepLock);
+        pthread_cond_signal(&threadPool->sleepCond);
+        pthread_mutex_unlock(&threadPool->sleepLock);
     }
 }
 
-// Initialize the thread pool. finishFunc can be NULL if you are
-// managing your own locks for output.
+// Worker function for each thread spawned. Returns when the kill
+// flag is set in the destructor.
+static void *workerLoop(struct worker *worker) {
+    stThreadPool *threadPool = worker->threadPool;
+    pthread_setspecific(threadPool->workerKey, worker);
+    while (!atomicLoad(&threadPool->killFlag)) {
+        stThreadPoolTask *task = findTask(threadPool, worker);
+        if (task != NULL) {
+            runTask(threadPool, task);
+            continue;
+        }
+        pthread_mutex_lock(&threadPool->sleepLock);
+        atomicAdd(&threadPool->sleepers, 1);
+        while (atomicLoad(&threadPool->queued) == 0 && !atomicLoad(&threadPool->killFlag)) {
+            pthread_cond_wait(&threadPool->sleepCond, &threadPool->sleepLock);
+        }
+        atomicAdd(&threadPool->sleepers, -1);
+        pthread_mutex_unlock(&threadPool->sleepLock);
+    }
+    return NULL;
+}
+
+////////////////////////////////////////////////
+// Public interface
+////////////////////////////////////////////////
+
 stThreadPool *stThreadPool_construct(int64_t numThreads,
                                      void *(*workFunc)(void *),
                                      void (*finishFunc)(void *)) {
+    return stThreadPool_construct2(numThreads, workFunc, finishFunc, stThreadPoolLIFO);
+}
+
+stThreadPool *stThreadPool_construct2(int64_t numThreads,
+                                      void *(*workFunc)(void *),
+                                      void (*finishFunc)(void *),
+                                      stThreadPoolOrder order) {
     assert(numThreads > 0);
     stThreadPool *ret = st_calloc(1, sizeof(stThreadPool));
-    ret->threads = st_calloc(numThreads, sizeof(pthread_t));
-    ret->stack = stList_construct();
+    ret->workers = st_calloc(numThreads, sizeof(struct worker));
     ret->workFunc = workFunc;
     ret->finishFunc = finishFunc;
     ret->numThreads = numThreads;
+    ret->order = order;
 
     // Set up the locks.
-    int pthreadError;
-    pthreadError = pthread_mutex_init(&ret->stackLock, NULL);
-    if (pthreadError) {
-        st_errAbort("stThreadPool: pthread_mutex_init failed: %s",
-                    strerror(pthreadError));
-    }
-    pthreadError = pthread_mutex_init(&ret->finishLock, NULL);
-    if (pthreadError) {
-        st_errAbort("stThreadPool: pthread_mutex_init failed: %s",
-                    strerror(pthreadError));
-    }
-    pthreadError = pthread_cond_init(&ret->stackCond, NULL);
+    initLock(&ret->finishLock);
+    initLock(&ret->sleepLock);
+    initLock(&ret->taskLock);
+    initCond(&ret->sleepCond);
+    initCond(&ret->finishedCond);
+    initCond(&ret->taskCond);
+    int pthreadError = pthread_key_create(&ret->workerKey, NULL);
     if (pthreadError) {
-        st_errAbort("stThreadPool: pthread_cond_init failed: %s",
+        st_errAbort("stThreadPool: pthread_key_create failed: %s",
                     strerror(pthreadError));
     }
-    pthreadError = pthread_cond_init(&ret->finishedCond, NULL);
-    if (pthreadError) {
-        st_errAbort("stThreadPool: pthread_cond_init failed: %s",
-                    strerror(pthreadError));
+    for (int64_t i = 0; i < numThreads; i++) {
+        ret->workers[i].threadPool = ret;
+        ret->workers[i].randomState = 0x9E3779B97F4A7C15ULL * (i + 1);
+        deque_init(&ret->workers[i].deque);
     }
 
     // Start the threads. All initialization of the thread pool struct
     // must happen before this, as the threads will look for work
     // right away.
     for (int64_t i = 0; i < numThreads; i++) {
-        pthreadError = pthread_create(&ret->threads[i], NULL,
-                                      (void *(*)(void *)) worker, ret);
+        pthreadError = pthread_create(&ret->workers[i].thread, NULL,
+                                      (void *(*)(void *)) workerLoop, &ret->workers[i]);
         if (pthreadError) {
             st_errAbort("stThreadPool: pthread_create failed: %s",
                         strerror(pthreadError));
@@ -151,57 +340,200 @@ stThreadPool *stThreadPool_construct(int64_t numThreads,
     return ret;
 }
 
-// Push work onto the stack to be consumed by a thread.
+int64_t stThreadPool_getNumThreads(stThreadPool *threadPool) {
+    return threadPool->numThreads;
+}
+
 void stThreadPool_push(stThreadPool *threadPool, void *workUnit) {
-    pthread_mutex_lock(&threadPool->stackLock);
-    stList_append(threadPool->stack, workUnit);
-    pthread_cond_signal(&threadPool->stackCond);
-    pthread_mutex_unlock(&threadPool->stackLock);
+    assert(threadPool->workFunc != NULL);
+    stThreadPoolTask *task = st_calloc(1, sizeof(stThreadPoolTask));
+    task->threadPool = threadPool;
+    task->arg = workUnit;
+    enqueue(threadPool, task);
+}
+
+stThreadPoolTask *stThreadPool_submit(stThreadPool *threadPool,
+                                      void *(*fn)(void *), void *arg) {
+    assert(fn != NULL);
+    stThreadPoolTask *task = st_calloc(1, sizeof(stThreadPoolTask));
+    task->threadPool = threadPool;
+    task->fn = fn;
+    task->arg = arg;
+    enqueue(threadPool, task);
+    return task;
+}
+
+void *stThreadPoolTask_wait(stThreadPoolTask *task) {
+    stThreadPool *threadPool = task->threadPool;
+    struct worker *worker = getCurrentWorker(threadPool);
+    if (worker != NULL) {
+        // Blocking would lose a thread, and could deadlock if every
+        // thread is waiting on a task still in a deque, so help out.
+        while (!atomicLoad(&task->done)) {
+            stThreadPoolTask *other = findTask(threadPool, worker);
+            if (other != NULL) {
+                runTask(threadPool, other);
+            } else {
+                sched_yield();
+            }
+        }
+    } else if (!atomicLoad(&task->done)) {
+        pthread_mutex_lock(&threadPool->taskLock);
+        atomicAdd(&threadPool->taskWaiters, 1);
+        while (!atomicLoad(&task->done)) {
+            pthread_cond_wait(&threadPool->taskCond, &threadPool->taskLock);
+        }
+        atomicAdd(&threadPool->taskWaiters, -1);
+        pthread_mutex_unlock(&threadPool->taskLock);
+    }
+    return task->result;
+}
+
+bool stThreadPoolTask_done(stThreadPoolTask *task) {
+    return atomicLoad(&task->done);
+}
+
+void stThreadPoolTask_destruct(stThreadPoolTask *task) {
+    stThreadPoolTask_wait(task);
+    free(task);
 }
 
-// Block until all work currently in the stack is complete. Can block
-// indefinitely if something goes wrong. Use stThreadPool_waitSafe to
-// ensure that you can get execution back after a timeout.
 void stThreadPool_wait(stThreadPool *threadPool) {
-    pthread_mutex_lock(&threadPool->stackLock);
-    while (stList_length(threadPool->stack) != 0 || threadPool->numFinishedThreads != threadPool->numThreads) {
-        pthread_cond_wait(&threadPool->finishedCond, &threadPool->stackLock);
+    assert(getCurrentWorker(threadPool) == NULL);
+    pthread_mutex_lock(&threadPool->sleepLock);
+    atomicAdd(&threadPool->poolWaiters, 1);
+    while (atomicLoad(&threadPool->pending) != 0) {
+        pthread_cond_wait(&threadPool->finishedCond, &threadPool->sleepLock);
     }
-    pthread_mutex_unlock(&threadPool->stackLock);
+    atomicAdd(&threadPool->poolWaiters, -1);
+    pthread_mutex_unlock(&threadPool->sleepLock);
 }
 
-// Doesn't wait on all the work to complete, just returns whether the
-// work in the stack is all done or not.
 bool stThreadPool_done(stThreadPool *threadPool) {
-    pthread_mutex_lock(&threadPool->stackLock);
-    bool ret = stList_length(threadPool->stack) == 0 && threadPool->numFinishedThreads == threadPool->numThreads;
-    pthread_mutex_unlock(&threadPool->stackLock);
-    return ret;
+    return atomicLoad(&threadPool->pending) == 0;
 }
 
-// Destroys the thread pool and destroys all threads. They must finish
-// running their work before they exit, but any remaining work in the
-// queue will be unfinished.
 void stThreadPool_destruct(stThreadPool *threadPool) {
-    // Wake all currently running threads so they know that they need
-    // to die.
-    threadPool->killFlag = true;
-    for (int64_t i = 0; i < threadPool->numThreads; i++) {
-        pthread_cond_signal(&threadPool->stackCond);
-    }
+    // Wake all currently idle threads so they know that they need to
+    // die.
+    pthread_mutex_lock(&threadPool->sleepLock);
+    atomicStore(&threadPool->killFlag, 1);
+    pthread_cond_broadcast(&threadPool->sleepCond);
+    pthread_mutex_unlock(&threadPool->sleepLock);
     // Ensure that all threads are dead before freeing the memory out
     // from under them.
     for (int64_t i = 0; i < threadPool->numThreads; i++) {
-        pthread_join(threadPool->threads[i], NULL);
+        pthread_join(threadPool->workers[i].thread, NULL);
     }
-    free(threadPool->threads);
-
-    stList_destruct(threadPool->stack);
+    for (int64_t i = 0; i < threadPool->numThreads; i++) {
+        deque_destruct(&threadPool->workers[i].deque);
+    }
+    free(threadPool->workers);
 
-    pthread_mutex_destroy(&threadPool->stackLock);
+    pthread_key_delete(threadPool->workerKey);
     pthread_mutex_destroy(&threadPool->finishLock);
+    pthread_mutex_destroy(&threadPool->sleepLock);
+    pthread_mutex_destroy(&threadPool->taskLock);
+    pthread_cond_destroy(&threadPool->sleepCond);
     pthread_cond_destroy(&threadPool->finishedCond);
-    pthread_cond_destroy(&threadPool->stackCond);
+    pthread_cond_destroy(&threadPool->taskCond);
 
     free(threadPool);
 }
+
+////////////////////////////////////////////////
+// Parallel loops on the default pool
+////////////////////////////////////////////////
+
+static stThreadPool *defaultPool = NULL;
+static pthread_once_t defaultPoolOnce = PTHREAD_ONCE_INIT;
+
+static void constructDefaultPool(void) {
+    int64_t numThreads = sysconf(_SC_NPROCESSORS_ONLN);
+    defaultPool = stThreadPool_construct2(numThreads > 0 ? numThreads : 1, NULL, NULL, stThreadPoolLIFO);
+}
+
+stThreadPool *stThreadPool_getDefault(void) {
+    pthread_once(&defaultPoolOnce, constructDefaultPool);
+    return defaultPool;
+}
+
+struct chunk {
+    int64_t start, end;
+    void (*fn)(int64_t, int64_t, void *);
+    void *(*mapFn)(int64_t, int64_t, void *);
+    void *ctx;
+};
+
+static void *runChunk(struct chunk *chunk) {
+    if (chunk->fn != NULL) {
+        chunk->fn(chunk->start, chunk->end, chunk->ctx);
+        return NULL;
+    }
+    return chunk->mapFn(chunk->start, chunk->end, chunk->ctx);
+}
+
+// Splits the range into chunks, runs all but the first on the
+// default pool and the first in the calling thread, and returns the
+// results in order of the chunks.
+static void **runChunks(int64_t start, int64_t end, int64_t grain,
+                        void (*fn)(int64_t, int64_t, void *),
+                        void *(*mapFn)(int64_t, int64_t, void *),
+                        void *ctx, int64_t *numChunks) {
+    stThreadPool *threadPool = stThreadPool_getDefault();
+    int64_t length = end - start;
+    if (grain <= 0) {
+        grain = length / (CHUNKS_PER_THREAD * threadPool->numThreads);
+    }
+    if (grain < 1) {
+        grain = 1;
+    }
+    *numChunks = (length + grain - 1) / grain;
+    struct chunk *chunks = st_malloc(*numChunks * sizeof(struct chunk));
+    stThreadPoolTask **tasks = st_malloc(*numChunks * sizeof(stThreadPoolTask *));
+    void **results = st_malloc(*numChunks * sizeof(void *));
+    for (int64_t i = 0; i < *numChunks; i++) {
+        chunks[i].start = start + i * grain;
+        chunks[i].end = i == *numChunks - 1 ? end : chunks[i].start + grain;
+        chunks[i].fn = fn;
+        chunks[i].mapFn = mapFn;
+        chunks[i].ctx = ctx;
+        if (i > 0) {
+            tasks[i] = stThreadPool_submit(threadPool, (void *(*)(void *)) runChunk, &chunks[i]);
+        }
+    }
+    results[0] = runChunk(&chunks[0]);
+    for (int64_t i = 1; i < *numChunks; i++) {
+        results[i] = stThreadPoolTask_wait(tasks[i]);
+        stThreadPoolTask_destruct(tasks[i]);
+    }
+    free(tasks);
+    free(chunks);
+    return results;
+}
+
+void stParallel_for(int64_t start, int64_t end, int64_t grain,
+                    void (*fn)(int64_t, int64_t, void *), void *ctx) {
+    if (end <= start) {
+        return;
+    }
+    int64_t numChunks;
+    free(runChunks(start, end, grain, fn, NULL, ctx, &numChunks));
+}
+
+void *stParallel_reduce(int64_t start, int64_t end, int64_t grain,
+                        void *(*mapFn)(int64_t, int64_t, void *),
+                        void *(*reduceFn)(void *, void *, void *),
+                        void *ctx) {
+    if (end <= start) {
+        return NULL;
+    }
+    int64_t numChunks;
+    void **results = runChunks(start, end, grain, NULL, mapFn, ctx, &numChunks);
+    void *result = results[0];
+    for (int64_t i = 1; i < numChunks; i++) {
+        result = reduceFn(result, results[i], ctx);
+    }
+    free(results);
+    return result;
+}
@@ -28,8 +28,14 @@ struct hashtable {
     int (*eqfn) (const void *k1, const void *k2);
     void (*keyFree)(void *);
     void (*valueFree)(void *);
+    struct _stPool *entryPool; /* If non-null entries are allocated from this pool, which is destructed with the table */
 };
 
+/*****************************************************************************/
+/* frees an entry removed from the table */
+void
+hashtable_freeEntry(struct hashtable *h, struct entry *e);
+
 /*****************************************************************************/
 uint64_t
 hashP(struct hashtable *h, void *k);
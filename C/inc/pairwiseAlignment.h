@@ -58,6 +58,76 @@ void cigarWrite(FILE *fileHandle, struct PairwiseAlignment *pA, int64_t writePro
 
 struct PairwiseAlignment *cigarRead(FILE *fileHandle);
 
+/*
+ * A table holding one copy of each string given to it, for sharing contig names between
+ * alignments. The copies last until the table is destructed.
+ */
+struct StringTable;
+
+struct StringTable *constructStringTable(void);
+
+void destructStringTable(struct StringTable *stringTable);
+
+/*
+ * Returns the table's copy of the string, adding one if it has none.
+ */
+const char *stringTableIntern(struct StringTable *stringTable, const char *string);
+
+int64_t stringTableSize(struct StringTable *stringTable);
+
+/*
+ * A PairwiseAlignment held in a single allocation, with its operations in an array following the
+ * struct rather than in a list of separately allocated operations, and contig names shared
+ * through a StringTable rather than copied.
+ */
+struct FlatPairwiseAlignment {
+    const char *contig1;
+    int64_t start1;
+    int64_t end1;
+    int64_t strand1;
+
+    const char *contig2;
+    int64_t start2;
+    int64_t end2;
+    int64_t strand2;
+
+    float score;
+    int64_t operationNumber;
+    struct AlignmentOperation *operations;
+};
+
+/*
+ * Constructs a flat alignment, copying the operations and interning the contig names in the table.
+ */
+struct FlatPairwiseAlignment *constructFlatPairwiseAlignment(struct StringTable *contigNames,
+                                                             const char *contig1, int64_t start1, int64_t end1,
+                                                             int64_t strand1, const char *contig2, int64_t start2,
+                                                             int64_t end2, int64_t strand2, float score,
+                                                             int64_t operationNumber,
+                                                             const struct AlignmentOperation *operations);
+
+/*
+ * Frees the alignment, but not its contig names, which belong to the table.
+ */
+void destructFlatPairwiseAlignment(struct FlatPairwiseAlignment *fPA);
+
+/*
+ * Converts a PairwiseAlignment to a flat alignment, interning its contig names in the table.
+ */
+struct FlatPairwiseAlignment *flattenPairwiseAlignment(struct PairwiseAlignment *pA, struct StringTable *contigNames);
+
+/*
+ * Converts a flat alignment to a new PairwiseAlignment.
+ */
+struct PairwiseAlignment *unflattenPairwiseAlignment(struct FlatPairwiseAlignment *fPA);
+
+void checkFlatPairwiseAlignment(struct FlatPairwiseAlignment *fPA);
+
+/*
+ * Writes the same line as cigarWrite.
+ */
+void cigarWriteFlat(FILE *fileHandle, struct FlatPairwiseAlignment *fPA, int64_t writeProbs);
+
 #ifdef __cplusplus
 }
 #endif
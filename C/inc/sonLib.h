@@ -14,10 +14,13 @@
 #ifndef SONLIB_H_
 #define SONLIB_H_
 
+#include "sonLibArena.h"
 #include "sonLibTree.h"
+#include "sonLibFrozenTree.h"
 #include "sonLibString.h"
 #include "sonLibHash.h"
 #include "sonLibSet.h"
+#include "sonLibIntHash.h"
 #include "sonLibSortedSet.h"
 #include "sonLibList.h"
 #include "sonLibCommon.h"
@@ -28,6 +31,7 @@
 #include "sonLibKVDatabaseConf.h"
 #include "sonLibCompression.h"
 #include "sonLibFile.h"
+#include "sonLibFastaIndex.h"
 #include "sonLibMath.h"
 #include "sonLibCache.h"
 #include "stGraph.h"
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef SONLIB_ARENA_H_
+#define SONLIB_ARENA_H_
+
+/*
+ * sonLibArena.h
+ *
+ * Region allocators for structures that allocate many small objects.
+ *
+ * An stArena hands out memory by bumping a pointer through large blocks, and frees everything
+ * at once when it is destructed, so allocation is cheap and teardown does not have to visit
+ * each object. Memory can not be returned to an arena individually.
+ *
+ * An stPool hands out fixed size elements, keeping freed elements on a free list for reuse.
+ * Its blocks come either from its own private arena or from a given arena, in which case the
+ * memory lives until that arena is destructed.
+ *
+ * Neither is thread safe.
+ */
+
+#include "sonLibTypes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//The exception string
+extern const char *ST_ARENA_EXCEPTION_ID;
+
+/*
+ * Constructs an arena with the default block size.
+ */
+stArena *stArena_construct(void);
+
+/*
+ * Constructs an arena that allocates blocks of the given number of bytes. Requests larger
+ * than a quarter of a block are given a block of their own.
+ */
+stArena *stArena_construct2(int64_t blockSize);
+
+/*
+ * Frees the arena and all memory allocated from it.
+ */
+void stArena_destruct(stArena *arena);
+
+/*
+ * Allocates the given number of bytes from the arena, aligned as for malloc.
+ */
+void *stArena_malloc(stArena *arena, int64_t size);
+
+/*
+ * Allocates zeroed memory for an array of the given number of elements.
+ */
+void *stArena_calloc(stArena *arena, int64_t elementNumber, int64_t elementSize);
+
+/*
+ * Copies the string into the arena.
+ */
+char *stArena_copyString(stArena *arena, const char *string);
+
+/*
+ * Frees all the memory allocated from the arena at once, keeping its first block for reuse.
+ */
+void stArena_reset(stArena *arena);
+
+/*
+ * Returns the number of bytes the arena has obtained from the system.
+ */
+int64_t stArena_getAllocatedBytes(stArena *arena);
+
+/*
+ * Constructs a pool of elements of the given size, with its own private arena.
+ */
+stPool *stPool_construct(int64_t elementSize);
+
+/*
+ * Constructs a pool of elements of the given size that takes its memory from the given arena.
+ * The pool must be destructed before the arena.
+ */
+stPool *stPool_construct2(int64_t elementSize, stArena *arena);
+
+/*
+ * Destructs the pool. If the pool has its own arena the elements are freed, otherwise they
+ * stay allocated until the arena they came from is destructed.
+ */
+void stPool_destruct(stPool *pool);
+
+/*
+ * Returns an uninitialised element.
+ */
+void *stPool_malloc(stPool *pool);
+
+/*
+ * Returns the element to the pool for reuse.
+ */
+void stPool_free(stPool *pool, void *element);
+
+/*
+ * Returns the size of the elements, which is the size the pool was constructed with rounded up
+ * to a multiple of the size of a pointer.
+ */
+int64_t stPool_getElementSize(stPool *pool);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -34,6 +34,15 @@ stCache *stCache_construct(void);
  */
 stCache *stCache_construct2(size_t maxSize);
 
+/*
+ * Create an empty cache of limited size that can be used from several
+ * threads at once. Records are spread over the given number of shards
+ * by key, each with its own lock and least-recently-used eviction
+ * within an equal share of maxSize, so threads using different shards
+ * do not contend. Fragments of one record always share a shard.
+ */
+stCache *stCache_construct3(size_t maxSize, int64_t numShards);
+
 /*
  * Destructs the cache.
  */
@@ -65,6 +74,11 @@ bool stCache_containsRecord(stCache *cache, int64_t key, int64_t zeroBasedByteOf
  */
 void *stCache_getRecord(stCache *cache, int64_t key, int64_t zeroBasedByteOffset, int64_t sizeInBytes, int64_t *recordSize);
 
+/*
+ * Removes all fragments of the record with the given key from the cache.
+ */
+void stCache_removeRecord(stCache *cache, int64_t key);
+
 /*
  * Returns non-zero iff the two buffers have the same size and are identical.
  */
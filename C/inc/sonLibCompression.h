@@ -24,8 +24,11 @@ extern const char *ST_COMPRESSION_EXCEPTION_ID;
 
 /*
  * Compresses the data and returns it. sizeInBytes in the size of the uncompressed data array, the pointer
- * compressedSizeInBytes is given the size of the compressed string. The level is a value between 0 and 10 giving the
- * degree of required compression. If -1 is given then the default level is used.
+ * compressedSizeInBytes is given the size of the compressed string. The level is a value between 0 and 12 giving the
+ * degree of required compression. If -1 is given then the default level is used. Levels 0 and -1 use lz4's
+ * fast mode, levels from 1 to 12 its high compression mode, searching more matches at higher levels, and
+ * levels below -1 make the fast mode skip ahead -level times as fast, for speed at the cost of compression.
+ * Whatever the level, the data is decompressed with stCompression_decompress.
  */
 void *stCompression_compress(void *data, int64_t sizeInBytes, int64_t *compressedSizeInBytes, int64_t level);
 
@@ -45,6 +48,167 @@ void *stCompression_compressZlib(void *data, int64_t sizeInBytes, int64_t *compr
  */
 void *stCompression_decompressZlib(void *compressedData, int64_t compressedSizeInBytes, int64_t *sizeInBytes);
 
+/*
+ * Compresses the data with lz4 as a frame of independent blocks of blockSize bytes (1MB if blockSize is
+ * zero or less), compressing the blocks in parallel (see stParallel_for). The frame starts with the size
+ * of the data and an index of the blocks, so it can be decompressed into a buffer allocated once, in
+ * parallel, and any range of bytes can be decompressed without the rest of the frame. Blocks that
+ * don't get smaller are stored uncompressed.
+ */
+void *stCompression_compressFrame(const void *data, int64_t sizeInBytes, int64_t *compressedSizeInBytes,
+                                  int64_t blockSize);
+
+/*
+ * Decompresses a frame made by stCompression_compressFrame, initialising sizeInBytes to the size of the
+ * decompressed data. The blocks are decompressed in parallel. Throws an exception if the frame is corrupt.
+ */
+void *stCompression_decompressFrame(const void *frame, int64_t frameSizeInBytes, int64_t *sizeInBytes);
+
+/*
+ * Returns the size of the data in a frame made by stCompression_compressFrame, checking its index.
+ */
+int64_t stCompression_getFrameDataSize(const void *frame, int64_t frameSizeInBytes);
+
+/*
+ * Decompresses sizeInBytes bytes of the data in a frame, starting at the given offset, into destination,
+ * only decompressing the blocks that contain them.
+ */
+void stCompression_decompressFrameRange(const void *frame, int64_t frameSizeInBytes, int64_t offset,
+                                        int64_t sizeInBytes, void *destination);
+
+/*
+ * The formats of compression streams: lz4 blocks, a zlib stream that stCompression_decompressZlib can
+ * also decompress, or gzip. Gzip streams are written as bgzip (as made by htslib's bgzip), which any gzip
+ * reader can read, and which is compressed and decompressed in parallel blocks. Gzip readers read any gzip
+ * file, including one of several concatenated gzip members, decompressing bgzip in parallel, and read data
+ * that isn't gzip compressed as it is.
+ */
+typedef enum {
+    stCompressionLZ4,
+    stCompressionZlib,
+    stCompressionGzip
+} stCompressionType;
+
+/*
+ * Constructs a stream that compresses the data written to it, a block at a time, passing the compressed
+ * data to write(data, sizeInBytes, extraArg) as it is made, so memory use is bounded however much data is
+ * written. The level is the zlib level for zlib and gzip, from 0 to 9 or -1 for the default, or the lz4 level
+ * (see stCompression_compress).
+ */
+stCompressionStream *stCompressionStream_constructWriter(stCompressionType type, int64_t level,
+        void (*write)(const void *data, int64_t sizeInBytes, void *extraArg), void *extraArg);
+
+/*
+ * Constructs a stream that writes the compressed data to the file, which is not closed by the stream.
+ */
+stCompressionStream *stCompressionStream_constructFileWriter(stCompressionType type, int64_t level, FILE *file);
+
+/*
+ * Constructs a stream that writes the compressed data to the database as a series of records, with keys
+ * firstKey, firstKey + 1, ... . Records after the last written are ignored when the stream is read.
+ */
+stCompressionStream *stCompressionStream_constructKVWriter(stCompressionType type, int64_t level,
+                                                           stKVDatabase *database, int64_t firstKey);
+
+/*
+ * Writes data to the stream. It is compressed and passed on a block at a time.
+ */
+void stCompressionStream_write(stCompressionStream *stream, const void *data, int64_t sizeInBytes);
+
+/*
+ * Compresses and passes on all the data written to the stream so far.
+ */
+void stCompressionStream_flush(stCompressionStream *stream);
+
+/*
+ * Ends the stream, flushing it. Nothing can be written to the stream after it is finished, and a stream
+ * that isn't finished can't be read to the end.
+ */
+void stCompressionStream_finish(stCompressionStream *stream);
+
+/*
+ * Constructs a stream that decompresses data from a stream of the given type, got by calling
+ * read(buffer, sizeInBytes, extraArg), which should fill the buffer with up to sizeInBytes bytes and return
+ * how many it got, or 0 at the end of the data.
+ */
+stCompressionStream *stCompressionStream_constructReader(stCompressionType type,
+        int64_t (*read)(void *buffer, int64_t sizeInBytes, void *extraArg), void *extraArg);
+
+/*
+ * Constructs a stream that decompresses data read from the file, which is not closed by the stream.
+ */
+stCompressionStream *stCompressionStream_constructFileReader(stCompressionType type, FILE *file);
+
+/*
+ * Constructs a stream that decompresses data from the records written by stCompressionStream_constructKVWriter.
+ */
+stCompressionStream *stCompressionStream_constructKVReader(stCompressionType type, stKVDatabase *database,
+                                                           int64_t firstKey);
+
+/*
+ * Reads up to sizeInBytes bytes of decompressed data into the buffer, returning how many were read. Fewer
+ * are only read at the end of the stream. Throws an exception if the compressed data is corrupt or ends
+ * before the stream was finished.
+ */
+int64_t stCompressionStream_read(stCompressionStream *stream, void *buffer, int64_t sizeInBytes);
+
+/*
+ * Destructs the stream, without finishing it.
+ */
+void stCompressionStream_destruct(stCompressionStream *stream);
+
+/*
+ * Returns a file that reads the decompressed data of the reader stream, so it can be given to functions
+ * that read files, such as fastaRead, fastaReadToFunction, cigarRead and stFile_getLineFromFile.
+ * Closing the file destructs the stream. If the data is corrupt the file's error indicator is set.
+ */
+FILE *stCompressionStream_openAsFile(stCompressionStream *stream);
+
+/*
+ * Opens the named file for reading through a gzip stream (see stCompressionGzip), so gzip and bgzip files
+ * are decompressed as they are read and other files are read as they are. Returns NULL, with errno set, if
+ * the file can't be opened. The file is closed with fclose.
+ */
+FILE *stCompressionStream_openFile(const char *fileName);
+
+/*
+ * Dictionaries, for compressing many small records that share content. Only the last
+ * ST_COMPRESSION_DICTIONARY_MAX_SIZE bytes of a dictionary are used.
+ */
+#define ST_COMPRESSION_DICTIONARY_MAX_SIZE 65536
+
+/*
+ * Constructs a dictionary from the given data, which is copied.
+ */
+stCompressionDictionary *stCompressionDictionary_construct(const void *data, int64_t sizeInBytes);
+
+/*
+ * Constructs a dictionary of at most maxSizeInBytes bytes (or ST_COMPRESSION_DICTIONARY_MAX_SIZE if it is zero
+ * or less) from the content most shared between the samples, typical records of the kind to be compressed.
+ */
+stCompressionDictionary *stCompressionDictionary_train(const void **samples, const int64_t *sampleSizes,
+                                                       int64_t numberOfSamples, int64_t maxSizeInBytes);
+
+/*
+ * Returns the content of the dictionary, which can be stored and passed to stCompressionDictionary_construct
+ * to get the same dictionary back.
+ */
+const void *stCompressionDictionary_getData(const stCompressionDictionary *dictionary, int64_t *sizeInBytes);
+
+void stCompressionDictionary_destruct(stCompressionDictionary *dictionary);
+
+/*
+ * Compresses the data with lz4 as stCompression_compress does, except that the content of the dictionary can
+ * be referenced, so even small records compress. The data must be decompressed with
+ * stCompression_decompressWithDictionary and the same dictionary. Dictionaries are read only, so one can be
+ * used by several threads at once.
+ */
+void *stCompression_compressWithDictionary(const stCompressionDictionary *dictionary, const void *data,
+                                           int64_t sizeInBytes, int64_t *compressedSizeInBytes, int64_t level);
+
+void *stCompression_decompressWithDictionary(const stCompressionDictionary *dictionary, const void *compressedData,
+                                             int64_t compressedSizeInBytes, int64_t *sizeInBytes);
+
 #ifdef __cplusplus
 }
 #endif
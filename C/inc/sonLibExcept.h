@@ -45,6 +45,10 @@
  *  return cnt;
  * \endcode
  *
+ * The stack of try blocks is kept per thread, so exceptions can be used
+ * concurrently from several threads. An exception is only ever caught by
+ * a try block in the thread that threw it.
+ *
  * If environment variable ST_ABORT is set, throwing an error causes the
  * message to be printed to stderr and an abort(), which is useful for
  * stopping under a debugger. Setting ST_ABORT_UNCAUGHT environment
@@ -156,10 +160,11 @@ struct _stExceptContext {
 };
 
 /* 
- * Exception content Top Of Stack.
+ * Exception content Top Of Stack. Each thread has its own stack, so
+ * threads can throw and catch exceptions independently.
  * (Internal structure, don't use directly)
  */
-extern struct _stExceptContext *_cexceptTOS;
+extern __thread struct _stExceptContext *_cexceptTOS;
 
 /// @defgroup CMacros C try/catch macros
 /// @ingroup stExceptions
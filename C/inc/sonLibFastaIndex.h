@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * sonLibFastaIndex.h
+ *
+ * Random access to the sequences of a fasta file, through an index in the format of
+ * samtools faidx (a .fai file beside the fasta file) and a read only mapping of the file.
+ */
+
+#ifndef SONLIBFASTAINDEX_H_
+#define SONLIBFASTAINDEX_H_
+
+#include "sonLibTypes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//The exception string
+extern const char *ST_FASTA_INDEX_EXCEPTION_ID;
+
+/*
+ * Opens the fasta file for random access. The index is read from fastaFile.fai if that is
+ * at least as new as the fasta file, otherwise it is built, in one pass over the file, and
+ * written there if possible. Throws ST_FASTA_INDEX_EXCEPTION_ID if the file can't be read,
+ * or can't be indexed because the lines of a sequence differ in length (apart from its
+ * last line), or two sequences have the same name.
+ */
+stFastaIndex *stFastaIndex_construct(const char *fastaFile);
+
+/*
+ * Unmaps the fasta file and frees the index.
+ */
+void stFastaIndex_destruct(stFastaIndex *index);
+
+/*
+ * Returns the number of sequences in the file.
+ */
+int64_t stFastaIndex_getNumberOfSequences(stFastaIndex *index);
+
+/*
+ * Returns the name of the ith sequence in the file, which is the first word of its header.
+ */
+const char *stFastaIndex_getName(stFastaIndex *index, int64_t i);
+
+/*
+ * Returns non-zero if the file contains a sequence with the given name.
+ */
+bool stFastaIndex_containsSequence(stFastaIndex *index, const char *name);
+
+/*
+ * Returns the length of the named sequence. Throws ST_FASTA_INDEX_EXCEPTION_ID if there is no
+ * such sequence.
+ */
+int64_t stFastaIndex_getLength(stFastaIndex *index, const char *name);
+
+/*
+ * Copies the length bases of the named sequence starting at start (counting from zero) into
+ * buffer, which is not null terminated. Only the lines holding the bases are read. Throws
+ * ST_FASTA_INDEX_EXCEPTION_ID if there is no such sequence or the range isn't within it.
+ */
+void stFastaIndex_copySubsequence(stFastaIndex *index, const char *name, int64_t start, int64_t length,
+                                  char *buffer);
+
+/*
+ * As stFastaIndex_copySubsequence, but returns the bases as a new null terminated string.
+ */
+char *stFastaIndex_getSubsequence(stFastaIndex *index, const char *name, int64_t start, int64_t length);
+
+/*
+ * Returns the whole of the named sequence, as a new string.
+ */
+char *stFastaIndex_getSequence(stFastaIndex *index, const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * sonLibFrozenTree.h
+ *
+ * A read only copy of an stTree held in flat arrays, for analyses over large trees. The nodes
+ * are numbered 0 to n - 1 in preorder, so the root is 0, every node comes before its descendants
+ * and the subtree of node i is the nodes i to i + stFrozenTree_getSubtreeSize(tree, i) - 1. The
+ * parent, first child and next sibling of each node are stored as these numbers, with -1 for
+ * none, along with its branch length, depth and the offset of its label in one block of labels.
+ *
+ * Visiting the nodes in order 0 to n - 1 is a preorder traversal, and visiting them from n - 1
+ * down to 0 visits every node after all of its descendants, as a postorder traversal would.
+ *
+ * A frozen tree can also be built with an LCA index, a sparse table of O(n log n) numbers built
+ * in the same time, with which lowest common ancestors and distances take constant time.
+ */
+
+#ifndef SONLIBFROZENTREE_H_
+#define SONLIBFROZENTREE_H_
+
+#include "sonLibTypes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Builds a frozen copy of the tree below the given node, which becomes the root. The stTree is
+ * not changed, and the frozen tree does not depend on it other than through
+ * stFrozenTree_getStTree and stFrozenTree_getIndex.
+ */
+stFrozenTree *stFrozenTree_construct(stTree *tree);
+
+/*
+ * As stFrozenTree_construct, also building the LCA index if indexLCAs is set.
+ */
+stFrozenTree *stFrozenTree_construct2(stTree *tree, bool indexLCAs);
+
+/*
+ * Frees the frozen tree.
+ */
+void stFrozenTree_destruct(stFrozenTree *tree);
+
+/*
+ * Returns the number of nodes in the tree.
+ */
+int64_t stFrozenTree_getNodeNumber(stFrozenTree *tree);
+
+/*
+ * Returns the number of leaves in the tree.
+ */
+int64_t stFrozenTree_getLeafNumber(stFrozenTree *tree);
+
+/*
+ * Returns the stTree node that node i was copied from.
+ */
+stTree *stFrozenTree_getStTree(stFrozenTree *tree, int64_t i);
+
+/*
+ * Returns the number of the node copied from the given stTree node, or -1 if it was not part of
+ * the tree that was frozen.
+ */
+int64_t stFrozenTree_getIndex(stFrozenTree *tree, stTree *node);
+
+/*
+ * Returns the parent of node i, or -1 for the root.
+ */
+int64_t stFrozenTree_getParent(stFrozenTree *tree, int64_t i);
+
+/*
+ * Returns the first child of node i, or -1 if it is a leaf.
+ */
+int64_t stFrozenTree_getFirstChild(stFrozenTree *tree, int64_t i);
+
+/*
+ * Returns the next child of the parent of node i, or -1 if it is the last.
+ */
+int64_t stFrozenTree_getNextSibling(stFrozenTree *tree, int64_t i);
+
+/*
+ * Returns the number of children of node i.
+ */
+int64_t stFrozenTree_getChildNumber(stFrozenTree *tree, int64_t i);
+
+/*
+ * Returns true if node i has no children.
+ */
+bool stFrozenTree_isLeaf(stFrozenTree *tree, int64_t i);
+
+/*
+ * Returns the label of node i, or NULL if it has none. The label lasts as long as the tree.
+ */
+const char *stFrozenTree_getLabel(stFrozenTree *tree, int64_t i);
+
+/*
+ * Returns the length of the branch above node i, INFINITY if it was not set.
+ */
+double stFrozenTree_getBranchLength(stFrozenTree *tree, int64_t i);
+
+/*
+ * Returns the number of branches between node i and the root.
+ */
+int64_t stFrozenTree_getDepth(stFrozenTree *tree, int64_t i);
+
+/*
+ * Returns the number of nodes in the subtree of node i, including i.
+ */
+int64_t stFrozenTree_getSubtreeSize(stFrozenTree *tree, int64_t i);
+
+/*
+ * Returns the number of leaves in the subtree of node i.
+ */
+int64_t stFrozenTree_getSubtreeLeafNumber(stFrozenTree *tree, int64_t i);
+
+/*
+ * Returns true if node i is node j or one of its ancestors. Takes constant time.
+ */
+bool stFrozenTree_isAncestor(stFrozenTree *tree, int64_t i, int64_t j);
+
+/*
+ * Returns true if the tree was built with the LCA index.
+ */
+bool stFrozenTree_hasLCAIndex(stFrozenTree *tree);
+
+/*
+ * Returns the lowest common ancestor of nodes i and j. Takes constant time with the LCA index,
+ * otherwise climbs from the deeper of the two.
+ */
+int64_t stFrozenTree_getLCA(stFrozenTree *tree, int64_t i, int64_t j);
+
+/*
+ * Returns the sum of the branch lengths on the path between nodes i and j. With the LCA index
+ * this takes constant time, as the difference of the distances of the nodes from the root, so
+ * it needs the branch lengths below the root to be set, and may differ in the last bits from
+ * the sum along the path.
+ */
+double stFrozenTree_getDistance(stFrozenTree *tree, int64_t i, int64_t j);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -22,11 +22,26 @@ extern "C" {
 
 // FIXME: passing key as non-const is causing unnecessary casts
 
+/*
+ * The table used to store the hash. The chained table allocates an entry per key, the open
+ * addressing table stores keys and values inline in a flat array, which uses less memory and
+ * is faster for large pointer-keyed hashes. Both have the same semantics.
+ */
+typedef enum {
+    stHashTypeChained,
+    stHashTypeOpenAddressing,
+} stHashType;
+
 /*
  * Function which generates hash key from pointer, should work well regardless of pointer size.
  */
 uint64_t stHash_pointer( const void *k );
 
+/*
+ * Key equality function that compares pointers, for use with stHash_pointer.
+ */
+int stHash_equalKey(const void *key1, const void *key2);
+
 /*
  * Constructs hash, with no destructors for keys or values.
  */
@@ -43,6 +58,31 @@ stHash *stHash_construct2(void (*destructKeys)(void *), void (*destructValues)(v
 stHash *stHash_construct3(uint64_t (*hashKey)(const void *), int (*hashEqualsKey)(const void *, const void *),
                           void (*destructKeys)(void *), void (*destructValues)(void *));
 
+/*
+ * As stHash_construct3, but with the given type of underlying table.
+ */
+stHash *stHash_construct4(uint64_t (*hashKey)(const void *), int (*hashEqualsKey)(const void *, const void *),
+                          void (*destructKeys)(void *), void (*destructValues)(void *), stHashType type);
+
+/*
+ * As stHash_construct, but using an open addressing table.
+ */
+stHash *stHash_constructOpenAddressing(void);
+
+/*
+ * As stHash_construct3, but the chained table's entries are allocated from a pool in the
+ * given arena, so inserts do not call malloc and destruction does not visit each entry unless
+ * keys or values need destructing. Removed entries are reused by later inserts. The arena
+ * must outlive the hash.
+ */
+stHash *stHash_constructInArena(uint64_t (*hashKey)(const void *), int (*hashEqualsKey)(const void *, const void *),
+                                void (*destructKeys)(void *), void (*destructValues)(void *), stArena *arena);
+
+/*
+ * Returns the type of the underlying table.
+ */
+stHashType stHash_getType(stHash *hash);
+
 /*
  * Destructs a hash.
  */
@@ -63,6 +103,12 @@ void stHash_setDestructValues(stHash *hash, void(*destructor)(void *));
  */
 void stHash_insert(stHash *hash, void *key, void *value);
 
+/*
+ * Preallocates space for the given number of elements, avoiding rehashing while they are
+ * inserted. Has no effect on chained hashes.
+ */
+void stHash_reserve(stHash *hash, int64_t size);
+
 /*
  * Search for value, returns null if not present.
  */
@@ -89,7 +135,8 @@ int64_t stHash_size(stHash *hash);
 stHashIterator *stHash_getIterator(stHash *hash);
 
 /*
- * Gets the next key from the iterator.
+ * Gets the next key from the iterator. The key just returned may be removed from the hash
+ * without invalidating the iterator, but any other modification does.
  */
 void *stHash_getNext(stHashIterator *iterator);
 
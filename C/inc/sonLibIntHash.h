@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef SONLIB_INT_HASH_H_
+#define SONLIB_INT_HASH_H_
+
+/*
+ * sonLibIntHash.h
+ *
+ * A hash from int64 keys to pointer values, and a set of int64 keys. Keys are stored
+ * inline in an open addressing table, so unlike an stHash keyed by stIntTuples no
+ * allocation is needed per key and no pointer is followed to compare keys.
+ */
+
+#include "sonLibTypes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Constructs an int hash, with no destructor for the values.
+ */
+stIntHash *stIntHash_construct(void);
+
+/*
+ * Constructs an int hash with the given value destructor, if null then the destructor is ignored.
+ */
+stIntHash *stIntHash_construct2(void (*destructValues)(void *));
+
+/*
+ * Destructs the hash, calling the value destructor on any remaining values.
+ */
+void stIntHash_destruct(stIntHash *hash);
+
+/*
+ * Set destructor for the values.
+ */
+void stIntHash_setDestructValues(stIntHash *hash, void (*destructor)(void *));
+
+/*
+ * Insert element, overriding if already present.
+ */
+void stIntHash_insert(stIntHash *hash, int64_t key, void *value);
+
+/*
+ * Inserts the given number of key/value pairs, reserving space for them first.
+ */
+void stIntHash_insertAll(stIntHash *hash, const int64_t *keys, void **values, int64_t length);
+
+/*
+ * Search for value, returns null if not present.
+ */
+void *stIntHash_search(stIntHash *hash, int64_t key);
+
+/*
+ * Returns non-zero iff the key is present (useful if null values are stored).
+ */
+bool stIntHash_contains(stIntHash *hash, int64_t key);
+
+/*
+ * Removes element, returning removed value (or null if not present).
+ */
+void *stIntHash_remove(stIntHash *hash, int64_t key);
+
+/*
+ * Returns the number of key/value pairs in the hash.
+ */
+int64_t stIntHash_size(stIntHash *hash);
+
+/*
+ * Preallocates space for the given number of elements, avoiding rehashing while they are inserted.
+ */
+void stIntHash_reserve(stIntHash *hash, int64_t size);
+
+/*
+ * Returns an iterator over the key/value pairs of the hash.
+ */
+stIntHashIterator *stIntHash_getIterator(stIntHash *hash);
+
+/*
+ * Gets the next key/value pair from the iterator, returning false when there are no more. Either
+ * of key and value may be null if not wanted. The key just returned may be removed from the hash
+ * without invalidating the iterator, but any other modification does.
+ */
+bool stIntHash_getNext(stIntHashIterator *iterator, int64_t *key, void **value);
+
+/*
+ * Duplicates the iterator.
+ */
+stIntHashIterator *stIntHash_copyIterator(stIntHashIterator *iterator);
+
+/*
+ * Destructs the iterator.
+ */
+void stIntHash_destructIterator(stIntHashIterator *iterator);
+
+/*
+ * Gets the values in the hash as a list.
+ */
+stList *stIntHash_getValues(stIntHash *hash);
+
+/*
+ * Constructs an empty int set.
+ */
+stIntSet *stIntSet_construct(void);
+
+/*
+ * Destructs the set.
+ */
+void stIntSet_destruct(stIntSet *set);
+
+/*
+ * Insert key, doing nothing if already present.
+ */
+void stIntSet_insert(stIntSet *set, int64_t key);
+
+/*
+ * Inserts the given number of keys, reserving space for them first.
+ */
+void stIntSet_insertAll(stIntSet *set, const int64_t *keys, int64_t length);
+
+/*
+ * Returns non-zero iff the key is in the set.
+ */
+bool stIntSet_contains(stIntSet *set, int64_t key);
+
+/*
+ * Removes the key, returning non-zero iff it was present.
+ */
+bool stIntSet_remove(stIntSet *set, int64_t key);
+
+/*
+ * Returns the number of keys in the set.
+ */
+int64_t stIntSet_size(stIntSet *set);
+
+/*
+ * Preallocates space for the given number of keys.
+ */
+void stIntSet_reserve(stIntSet *set, int64_t size);
+
+/*
+ * Returns an iterator over the keys of the set.
+ */
+stIntSetIterator *stIntSet_getIterator(stIntSet *set);
+
+/*
+ * Gets the next key from the iterator, returning false when there are no more.
+ */
+bool stIntSet_getNext(stIntSetIterator *iterator, int64_t *key);
+
+/*
+ * Duplicates the iterator.
+ */
+stIntSetIterator *stIntSet_copyIterator(stIntSetIterator *iterator);
+
+/*
+ * Destructs the iterator.
+ */
+void stIntSet_destructIterator(stIntSetIterator *iterator);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
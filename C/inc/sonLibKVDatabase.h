@@ -132,6 +132,20 @@ void *stKVDatabase_getRecord(stKVDatabase *database, int64_t key);
  */
 void *stKVDatabase_getRecord2(stKVDatabase *database, int64_t key, int64_t *recordSize);
 
+/*
+ * As stKVDatabase_getRecord2, but returns a read only view of the record rather than a copy
+ * where the database can (log file databases return the record in place from their mapping of
+ * the file, Redis databases the buffer the reply was read into), avoiding copying large records.
+ * The view remains valid, and unchanged, until it is given to stKVDatabase_releaseRecord, even if
+ * the record is updated or removed in the meantime. Views must be released before the database
+ * is destructed. Returns NULL if the database does not contain the record.
+ */
+const void *stKVDatabase_borrowRecord(stKVDatabase *database, int64_t key, int64_t *recordSize);
+
+/*
+ * Releases a view returned by stKVDatabase_borrowRecord. Does nothing if the view is NULL.
+ */
+void stKVDatabase_releaseRecord(stKVDatabase *database, const void *record);
 
 /*
  * Construct a bulk result (like a bulk request but keys are not stored)
@@ -179,11 +193,101 @@ void *stKVDatabase_getPartialRecord(stKVDatabase *database, int64_t key, int64_t
 int64_t stKVDatabase_getNumberOfRecords(stKVDatabase *database);
 
 
+/*
+ * Writes any records held back by the database's cache (see stKVDatabaseConf_setCache),
+ * and for log file databases forces the records written to disk. Does nothing for other
+ * databases without a write back cache.
+ */
+void stKVDatabase_flush(stKVDatabase *database);
+
+/*
+ * Gets the number of reads answered from the database's cache, and the number that had to
+ * go to the database. Both are zero for databases without a cache.
+ */
+void stKVDatabase_getCacheStats(stKVDatabase *database, int64_t *hits, int64_t *misses);
+
+/*
+ * Gets the total size of the records written to a compressed database (see
+ * stKVDatabaseConf_setCompression) before and after compression, so their ratio is the
+ * compression ratio, and the time in seconds spent compressing and decompressing records.
+ * All are zero for databases without compression.
+ */
+void stKVDatabase_getCompressionStats(stKVDatabase *database, int64_t *uncompressedBytes, int64_t *compressedBytes,
+                                      double *compressSeconds, double *decompressSeconds);
+
 /*
  * get the configuration object for the database.
  */
 stKVDatabaseConf *stKVDatabase_getConf(stKVDatabase *database);
 
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+//Asynchronous requests
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+////////////////////////////////////////////////
+
+/*
+ * Constructs a pipeline that sends requests to the database asynchronously, so
+ * the caller can carry on (and submit more requests) while they are in flight.
+ * Requests are sent in order by a thread of the pipeline, in batches of up to
+ * maxBatchSize requests, each run of gets, sets or removes in a batch being sent
+ * as one bulk request. The database must not be used directly while the pipeline
+ * exists. The functions of the pipeline and its requests may be called from any
+ * thread.
+ */
+stKVDatabasePipeline *stKVDatabasePipeline_construct(stKVDatabase *database, int64_t maxBatchSize);
+
+/*
+ * Waits for all submitted requests to complete, then destructs the pipeline.
+ * Request handles remain valid and must still be destructed.
+ */
+void stKVDatabasePipeline_destruct(stKVDatabasePipeline *pipeline);
+
+/*
+ * Waits for all submitted requests to complete.
+ */
+void stKVDatabasePipeline_wait(stKVDatabasePipeline *pipeline);
+
+/*
+ * Submits a request for the record with the given key, returning its handle.
+ */
+stKVDatabaseRequest *stKVDatabasePipeline_getRecord(stKVDatabasePipeline *pipeline, int64_t key);
+
+/*
+ * Submits a request to set the record, as stKVDatabase_setRecord. The value is copied.
+ */
+stKVDatabaseRequest *stKVDatabasePipeline_setRecord(stKVDatabasePipeline *pipeline, int64_t key,
+                                                    const void *value, int64_t sizeOfRecord);
+
+/*
+ * Submits a request to remove the record, as stKVDatabase_removeRecord.
+ */
+stKVDatabaseRequest *stKVDatabasePipeline_removeRecord(stKVDatabasePipeline *pipeline, int64_t key);
+
+/*
+ * Returns non-zero if the request is complete, without blocking.
+ */
+bool stKVDatabaseRequest_done(stKVDatabaseRequest *request);
+
+/*
+ * Blocks until the request is complete. Throws an exception if the request failed.
+ */
+void stKVDatabaseRequest_wait(stKVDatabaseRequest *request);
+
+/*
+ * Waits for a get request and returns the record, or NULL if there is no record
+ * with the key, setting recordSize to its size. The caller owns the record, and it
+ * is only returned by the first call. Returns NULL for other requests.
+ */
+void *stKVDatabaseRequest_getRecord(stKVDatabaseRequest *request, int64_t *recordSize);
+
+/*
+ * Waits for the request if necessary, then frees it, ignoring any failure.
+ */
+void stKVDatabaseRequest_destruct(stKVDatabaseRequest *request);
+
 
 #ifdef __cplusplus
 }
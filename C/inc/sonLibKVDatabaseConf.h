@@ -17,6 +17,8 @@ typedef enum {
     stKVDatabaseTypeKyotoTycoon,
     stKVDatabaseTypeMySql,
     stKVDatabaseTypeRedis,
+    stKVDatabaseTypeLogFile,
+    stKVDatabaseTypeSharded,
 } stKVDatabaseType;
 
 /* 
@@ -25,6 +27,26 @@ typedef enum {
  */
 stKVDatabaseConf *stKVDatabaseConf_constructTokyoCabinet(const char *databaseDir);
 
+/*
+ * Construct a new database configuration object for a log file database,
+ * an embedded database kept in a single file in the given directory that
+ * needs no server or external library. Each operation (including a whole
+ * bulk set or remove) is applied atomically, even if the process or machine
+ * crashes while it is written. Records are written to the file immediately;
+ * stKVDatabase_flush forces them to disk.
+ */
+stKVDatabaseConf *stKVDatabaseConf_constructLogFile(const char *databaseDir);
+
+/*
+ * Construct a new database configuration object for a database spread over
+ * several databases (shards), one per configuration in the list, which is
+ * copied. Keys are assigned to shards by consistent hashing, so the shards
+ * must always be given in the same order; appending a shard only moves about
+ * 1/n of the keys (the rest are found where they were), but the moved records
+ * are not migrated. Bulk requests are sent to the shards in parallel.
+ */
+stKVDatabaseConf *stKVDatabaseConf_constructSharded(stList *shardConfs);
+
 /* 
  * Construct a new database configuration object for a Kyoto Tycoon
  * database remote object.
@@ -52,14 +74,21 @@ stKVDatabaseConf *stKVDatabaseConf_constructMySql(const char *host, unsigned por
  * Decodes a simple piece of XML, structured as follows:
  * <st_kv_database_conf type="TYPE">
  *      <tokyo_cabinet database_dir=""/>
+ *      <log_file database_dir=""/>
  *      <mysql host="" port="" user="" password="" database_name="" table_name=""/>
  *      <kyoto_cabinet host="" port=""/>
+ *      <sharded> <st_kv_database_conf ...> ... </st_kv_database_conf> ... </sharded>
  * </st_kv_database_conf>
  *
- * Type can be "tokyo_cabinet", "mysql", or "kyoto_cabinet". If it is of that type then
+ * Type can be "tokyo_cabinet", "log_file", "mysql", "kyoto_cabinet" or "sharded". If it is of that type then
  * you need to include a nested tag with the parameters for that conf constructor.
  * The labels for the nested tag are name value pairs (no order assumed) for the conf constructor
- * (see above).  The port is optional.
+ * (see above).  The port is optional. The sharded tag instead contains a complete configuration
+ * for each shard, in order.
+ *
+ * The nested tag of any type may also have cache_size and cache_write_back_size
+ * attributes, see stKVDatabaseConf_setCache, and a compression_chunk_size attribute,
+ * see stKVDatabaseConf_setCompression.
  */
 stKVDatabaseConf *stKVDatabaseConf_constructFromString(const char *xmlString);
 
@@ -118,6 +147,41 @@ const char *stKVDatabaseConf_getDatabaseName(stKVDatabaseConf *conf);
 /* get the table name for server based databases */
 const char *stKVDatabaseConf_getTableName(stKVDatabaseConf *conf);
 
+/* get the number of shards of a sharded database, zero for other databases */
+int64_t stKVDatabaseConf_getNumberOfShards(stKVDatabaseConf *conf);
+
+/* get the configuration of a shard of a sharded database */
+stKVDatabaseConf *stKVDatabaseConf_getShard(stKVDatabaseConf *conf, int64_t shard);
+
+/*
+ * Puts a cache in front of databases constructed from the configuration.
+ * Records read are kept in memory, up to cacheSize bytes, so repeated reads
+ * don't go to the database. If writeBackSize is non-zero, set and update
+ * requests are also held in memory until writeBackSize bytes are waiting,
+ * or stKVDatabase_flush is called, then written with one bulk set. A
+ * cacheSize of zero (the default) disables the cache.
+ */
+void stKVDatabaseConf_setCache(stKVDatabaseConf *conf, int64_t cacheSize, int64_t writeBackSize);
+
+/* get the maximum size in bytes of the records held in the cache, or zero if not cached */
+int64_t stKVDatabaseConf_getCacheSize(stKVDatabaseConf *conf);
+
+/* get the size in bytes of the writes held by the cache before they are written back */
+int64_t stKVDatabaseConf_getCacheWriteBackSize(stKVDatabaseConf *conf);
+
+/*
+ * Compresses the records of databases constructed from the configuration with LZ4, as they
+ * are written, and decompresses them as they are read. Records are compressed in independent
+ * chunks of chunkSize bytes, so stKVDatabase_getPartialRecord only decompresses the chunks it
+ * needs; 64KB is a reasonable size. Int64 records are not compressed. If the database is also
+ * cached the cache holds the uncompressed records. A chunkSize of zero (the default) disables
+ * compression. A database must always be opened with compression on, or always with it off.
+ */
+void stKVDatabaseConf_setCompression(stKVDatabaseConf *conf, int64_t chunkSize);
+
+/* get the size of the chunks records are compressed in, or zero if not compressed */
+int64_t stKVDatabaseConf_getCompressionChunkSize(stKVDatabaseConf *conf);
+
 #ifdef __cplusplus
 }
 #endif
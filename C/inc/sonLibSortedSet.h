@@ -16,6 +16,16 @@ extern "C" {
 //The exception string
 extern const char *SORTED_SET_EXCEPTION_ID;
 
+/*
+ * The tree used to store the sorted set. The AVL tree allocates a node per element, the B-tree
+ * stores elements in sorted arrays in linked leaves, which uses less memory and is faster for
+ * searches, range queries and ordered iteration over large sets. Both have the same semantics.
+ */
+typedef enum {
+    stSortedSetTypeAVL,
+    stSortedSetTypeBTree,
+} stSortedSetType;
+
 ////////////////////////////////////////////////
 ////////////////////////////////////////////////
 ////////////////////////////////////////////////
@@ -44,7 +54,27 @@ stSortedSet *stSortedSet_construct3(int (*compareFn)(const void *, const void *)
                                       void (*destructElementFn)(void *));
 
 /*
- * Clones the given sorted set, setting the element destructor to the given function.
+ * As stSortedSet_construct3, but with the given type of underlying tree.
+ */
+stSortedSet *stSortedSet_construct4(int (*compareFn)(const void *, const void *),
+                                      void (*destructElementFn)(void *), stSortedSetType type);
+
+/*
+ * As stSortedSet_construct3, but the nodes of the AVL tree are allocated from a pool in the
+ * given arena, so destruction does not visit each node unless the elements need destructing.
+ * The arena must outlive the set.
+ */
+stSortedSet *stSortedSet_constructInArena(int (*compareFn)(const void *, const void *),
+                                      void (*destructElementFn)(void *), stArena *arena);
+
+/*
+ * Returns the type of the underlying tree.
+ */
+stSortedSetType stSortedSet_getType(stSortedSet *sortedSet);
+
+/*
+ * Clones the given sorted set, setting the element destructor to the given function. The clone
+ * has the same type of underlying tree.
  */
 stSortedSet *stSortedSet_copyConstruct(stSortedSet *sortedSet, void (*destructElementFn)(void *));
 
@@ -25,6 +25,13 @@ extern "C" {
  */
 stTree *stTree_construct(void);
 
+/*
+ * As stTree_construct, but the node, and any label it is given, are allocated in the arena.
+ * The node is still destructed with stTree_destruct, which frees its list of children but
+ * leaves its memory to be freed with the arena. The arena must outlive the node.
+ */
+stTree *stTree_constructInArena(stArena *arena);
+
 /*
  * Destruct the eTree node and any descendants.
  */
@@ -113,12 +120,20 @@ void stTree_sortChildren(stTree *root, int (*cmpFn)(stTree *a, stTree *b));
 double stTree_getLongestPathLength(stTree *node);
 
 /*
- * Parses the newick tree string according to the format standard (I think).
+ * Parses the newick tree string according to the format standard (I think). The string is
+ * read in one pass without recursion, so trees of any depth can be parsed. Aborts if the
+ * string is not a valid tree ending with ';'.
  */
 stTree *stTree_parseNewickString(const char *string);
 
 /*
- * Writes a newick tree string.
+ * As stTree_parseNewickString, but the nodes and labels are allocated in the arena, as by
+ * stTree_constructInArena.
+ */
+stTree *stTree_parseNewickStringInArena(const char *string, stArena *arena);
+
+/*
+ * Writes a newick tree string, in one pass into a growing buffer.
  */
 char *stTree_getNewickTreeString(stTree *eTree);
 
@@ -39,6 +39,12 @@ stIntTuple *stIntTuple_construct5(int64_t value1, int64_t value2, int64_t value3
 
 stIntTuple *stIntTuple_constructN(int64_t length, const int64_t iA[]);
 
+/*
+ * As stIntTuple_constructN, but allocates the tuple in the given arena. The tuple is freed with
+ * the arena and must not be passed to stIntTuple_destruct.
+ */
+stIntTuple *stIntTuple_constructNInArena(int64_t length, const int64_t iA[], stArena *arena);
+
 /*
  * Destructs the tuple.
  */
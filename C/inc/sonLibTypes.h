@@ -34,8 +34,14 @@ extern "C" {
 typedef struct _stTree stTree;
 typedef struct _stHash stHash;
 typedef struct _stSet stSet;
-typedef struct hashtable_itr stHashIterator;
+typedef struct _stHashIterator stHashIterator;
 typedef struct _stSetIterator stSetIterator;
+typedef struct _stIntHash stIntHash;
+typedef struct _stIntHashIterator stIntHashIterator;
+typedef struct _stIntSet stIntSet;
+typedef struct _stIntSetIterator stIntSetIterator;
+typedef struct _stArena stArena;
+typedef struct _stPool stPool;
 typedef struct _stSortedSet stSortedSet;
 typedef struct _stSortedSetIterator stSortedSetIterator;
 typedef struct _stList stList;
@@ -44,10 +50,15 @@ typedef int64_t stIntTuple;
 typedef double stDoubleTuple;
 typedef struct stExcept stExcept;
 typedef struct stCache stCache;
+typedef struct _stCompressionStream stCompressionStream;
+typedef struct _stCompressionDictionary stCompressionDictionary;
+typedef struct _stFastaIndex stFastaIndex;
 typedef struct stKVDatabase stKVDatabase;
 typedef struct stKVDatabaseConf stKVDatabaseConf;
 typedef struct stKVDatabaseBulkRequest stKVDatabaseBulkRequest;
 typedef struct stKVDatabaseBulkResult stKVDatabaseBulkResult;
+typedef struct stKVDatabasePipeline stKVDatabasePipeline;
+typedef struct stKVDatabaseRequest stKVDatabaseRequest;
 typedef struct _stEdge stEdge;
 typedef struct _stGraph stGraph;
 typedef struct _stPosetAlignment stPosetAlignment;
@@ -70,6 +81,7 @@ typedef struct _stNaiveConnectedComponent stNaiveConnectedComponent;
 typedef struct _stNaiveConnectedComponentIterator stNaiveConnectedComponentIterator;
 typedef struct _stNaiveConnectedComponentNodeIterator stNaiveConnectedComponentNodeIterator;
 typedef struct _stMatrix stMatrix;
+typedef struct _stFrozenTree stFrozenTree;
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * stCigarStream.h
+ *
+ * Streaming readers and writers of pairwise alignments, in the text cigar format of cigarRead
+ * and cigarWrite or in a compact binary format.
+ *
+ * A reader returns each alignment as an stCigar, whose operations are held in one array that is
+ * reused from alignment to alignment, so reading allocates nothing per operation.
+ *
+ * The binary format is the magic bytes "stCigar1" followed by the alignments. Each alignment is
+ * written as varints (7 bits a byte, least significant first):
+ *
+ *   flags: bit 0 the strand of the first sequence, bit 1 that of the second, bit 2 set if the
+ *       operations have scores
+ *   contig1, start1, end1 - start1 (zigzag encoded), contig2, start2, end2 - start2 (zigzag)
+ *   the score, as a little endian 32 bit float
+ *   the number of operations, then for each operation (length << 2) | type
+ *   if the operations have scores, a little endian 32 bit float for each
+ *
+ * A contig name is written as its index among the distinct names of the stream so far, with the
+ * index one past the last being followed by the length and bytes of a new name.
+ */
+
+#ifndef ST_CIGAR_STREAM_H_
+#define ST_CIGAR_STREAM_H_
+
+#include "sonLibTypes.h"
+#include "pairwiseAlignment.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//The exception string
+extern const char *ST_CIGAR_EXCEPTION_ID;
+
+typedef struct _stCigarReader stCigarReader;
+typedef struct _stCigarWriter stCigarWriter;
+
+typedef enum _stCigarFormat {
+    stCigarText, // The format of cigarRead and cigarWrite.
+    stCigarBinary
+} stCigarFormat;
+
+/*
+ * An alignment as read by an stCigarReader, with the fields of a PairwiseAlignment.
+ */
+typedef struct _stCigar {
+    const char *contig1;
+    int64_t start1;
+    int64_t end1;
+    int64_t strand1;
+
+    const char *contig2;
+    int64_t start2;
+    int64_t end2;
+    int64_t strand2;
+
+    float score;
+    bool hasScores; // If false the scores of the operations are all zero.
+    int64_t operationNumber;
+    struct AlignmentOperation *operations;
+} stCigar;
+
+/*
+ * Constructs a reader of the alignments in the file, which may be in either format. The format
+ * is told by the first bytes of the file. The file is read from its current position, in blocks,
+ * and is not closed by the reader.
+ */
+stCigarReader *stCigarReader_construct(FILE *file);
+
+/*
+ * Frees the reader, including the names of the contigs it has read.
+ */
+void stCigarReader_destruct(stCigarReader *reader);
+
+/*
+ * Returns the format of the file being read.
+ */
+stCigarFormat stCigarReader_getFormat(stCigarReader *reader);
+
+/*
+ * Returns the next alignment, or NULL at the end of the file. The alignment, including its
+ * operations, is overwritten by the next call, but its contig names last as long as the reader.
+ * Throws ST_CIGAR_EXCEPTION_ID if the file is malformed.
+ */
+const stCigar *stCigarReader_next(stCigarReader *reader);
+
+/*
+ * As stCigarReader_next, but returns the alignment as a new PairwiseAlignment.
+ */
+struct PairwiseAlignment *stCigarReader_nextPairwiseAlignment(stCigarReader *reader);
+
+/*
+ * As stCigarReader_next, but returns the alignment as a new FlatPairwiseAlignment, with its contig
+ * names interned in the given table.
+ */
+struct FlatPairwiseAlignment *stCigarReader_nextFlatPairwiseAlignment(stCigarReader *reader,
+                                                                      struct StringTable *contigNames);
+
+/*
+ * Constructs a writer of alignments to the file in the given format. Writing is buffered, and the
+ * file is not closed by the writer.
+ */
+stCigarWriter *stCigarWriter_construct(FILE *file, stCigarFormat format);
+
+/*
+ * Flushes and frees the writer.
+ */
+void stCigarWriter_destruct(stCigarWriter *writer);
+
+/*
+ * Writes the alignment, with the scores of its operations if cigar->hasScores is set. In text
+ * this is the line cigarWrite writes.
+ */
+void stCigarWriter_write(stCigarWriter *writer, const stCigar *cigar);
+
+/*
+ * Writes a PairwiseAlignment, with the scores of its operations if writeScores is set.
+ */
+void stCigarWriter_writePairwiseAlignment(stCigarWriter *writer, struct PairwiseAlignment *pA, bool writeScores);
+
+/*
+ * Writes a FlatPairwiseAlignment, with the scores of its operations if writeScores is set.
+ */
+void stCigarWriter_writeFlatPairwiseAlignment(stCigarWriter *writer, struct FlatPairwiseAlignment *fPA,
+                                               bool writeScores);
+
+/*
+ * Writes what has been buffered to the file.
+ */
+void stCigarWriter_flush(stCigarWriter *writer);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
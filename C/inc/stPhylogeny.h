@@ -56,6 +56,10 @@ typedef struct {
                                  // Can be NULL.
 } stPhylogenyInfo;
 
+// An index of a species tree for reconciliation, see
+// stSpeciesIndex_construct.
+typedef struct _stSpeciesIndex stSpeciesIndex;
+
 // Represents a d-split as characterized by Bandelt and Dress, 1992.
 typedef struct {
     stList *leftSplit;
@@ -118,9 +122,8 @@ stTree *stPhylogeny_neighborJoin(stMatrix *distances, stList *outgroups);
 stTree *stPhylogeny_getLeafByIndex(stTree *tree, int64_t leafIndex);
 
 // Find the distance between two arbitrary nodes (which must be in the
-// same tree).
-// Requires an indexed tree (which has stPhylogenyInfo with non-null
-// stIndexedTreeInfo.)
+// same tree). For many queries on one tree, freeze it with an LCA
+// index and use stFrozenTree_getDistance, which takes constant time.
 double stPhylogeny_distanceBetweenNodes(stTree *node1, stTree *node2);
 
 // Find the distance between leaves (given by their index in the
@@ -165,6 +168,16 @@ stTree *stPhylogeny_guidedNeighborJoining(stMatrix *distanceMatrix,
                                           int64_t **speciesMRCAMatrix,
                                           stTree *speciesTree);
 
+// Builds an index of the species tree below the given node, normally
+// its root, that answers the MRCA queries of reconciliation in
+// constant time. The reconciliation functions build one on each
+// call; the "2" variants take one instead, so it can be built once
+// and shared by many gene trees reconciled to the same species tree.
+// The index is invalidated by any change to the species tree.
+stSpeciesIndex *stSpeciesIndex_construct(stTree *speciesTree);
+
+void stSpeciesIndex_destruct(stSpeciesIndex *index);
+
 // Reconcile a gene tree (without rerooting), set the proper
 // stReconcilationInfo (as an entry of stPhylogenyInfo) as client data
 // on all nodes, and optionally set the labels of the ancestors to the
@@ -176,6 +189,12 @@ stTree *stPhylogeny_guidedNeighborJoining(stMatrix *distanceMatrix,
 void stPhylogeny_reconcileAtMostBinary(stTree *geneTree, stHash *leafToSpecies,
                                        bool relabelAncestors);
 
+// As stPhylogeny_reconcileAtMostBinary, using an index of the species
+// tree.
+void stPhylogeny_reconcileAtMostBinary2(stTree *geneTree, stHash *leafToSpecies,
+                                        stSpeciesIndex *speciesIndex,
+                                        bool relabelAncestors);
+
 // For a tree that has already been reconciled by
 // reconcileAtMostBinary, calculates the number of dups and losses
 // implied by the reconciliation. dups and losses must be set to 0
@@ -184,6 +203,13 @@ void stPhylogeny_reconciliationCostAtMostBinary(stTree *reconciledTree,
                                                 int64_t *dups,
                                                 int64_t *losses);
 
+// As stPhylogeny_reconciliationCostAtMostBinary, using an index of the
+// species tree.
+void stPhylogeny_reconciliationCostAtMostBinary2(stTree *reconciledTree,
+                                                 stSpeciesIndex *speciesIndex,
+                                                 int64_t *dups,
+                                                 int64_t *losses);
+
 // Return a copy of geneTree that is rooted to minimize duplications.
 // The gene tree must not have any polytomies.
 // NOTE: the returned tree does *not* have reconciliation info set,
@@ -192,17 +218,34 @@ void stPhylogeny_reconciliationCostAtMostBinary(stTree *reconciledTree,
 stTree *stPhylogeny_rootByReconciliationAtMostBinary(stTree *geneTree,
                                                      stHash *leafToSpecies);
 
+// As stPhylogeny_rootByReconciliationAtMostBinary, using an index of
+// the species tree.
+stTree *stPhylogeny_rootByReconciliationAtMostBinary2(stTree *geneTree,
+                                                      stHash *leafToSpecies,
+                                                      stSpeciesIndex *speciesIndex);
+
 // Return a copy of geneTree that is rooted to minimize duplications.
 // This function is slower than rootByReconciliationAtMostBinary, but
 // supports gene trees with polytomies.
 stTree *stPhylogeny_rootByReconciliationNaive(stTree *geneTree, stHash *leafToSpecies);
 
+// As stPhylogeny_rootByReconciliationNaive, using an index of the
+// species tree.
+stTree *stPhylogeny_rootByReconciliationNaive2(stTree *geneTree, stHash *leafToSpecies,
+                                               stSpeciesIndex *speciesIndex);
+
 // Reconcile a binary gene tree to a species tree that may include
 // polytomies. Based on the method used by NOTUNG, described in
 // Vernot, Stolzer, Goldman, Durand, J Comput Biol 2008.
 void stPhylogeny_reconcileNonBinary(stTree *geneTree, stHash *leafToSpecies,
                                     bool relabelAncestors);
 
+// As stPhylogeny_reconcileNonBinary, using an index of the species
+// tree.
+void stPhylogeny_reconcileNonBinary2(stTree *geneTree, stHash *leafToSpecies,
+                                     stSpeciesIndex *speciesIndex,
+                                     bool relabelAncestors);
+
 // Nearest-neighbor interchange (for strictly binary trees). Returns
 // two new neighboring trees in the parameters tree1 and tree2. Does
 // not modify the original tree.
@@ -1,20 +1,32 @@
-// A very simple pthreads thread pool implementation.
+// A pthreads thread pool with a work-stealing scheduler.
 //
-// A work stack feeds a number of threads. Every work unit is worked
-// on by a single thread, which executes the work function, then
-// fetches a new work unit when finished.
+// Every worker thread has its own deque of tasks. Work pushed from
+// outside the pool is spread over the deques, and work pushed from
+// inside a running task goes onto the deque of the worker running
+// it. A worker takes tasks from its own deque, and when that is empty
+// steals the oldest task from another worker's deque, so workers
+// rarely contend for the same lock.
 //
-// Often threads only need to write once to some single "result"
-// variable, after the heavy computational work is done. To avoid
-// needing to manage your own locks for this simple case, an optional
-// "finish" function is available, which is guaranteed to run serially
-// (although the work function and main thread will still run
+// There are two ways to give the pool work. The original interface
+// takes a single work function at construction and pushes work units
+// onto the pool; often threads only need to write once to some single
+// "result" variable, after the heavy computational work is done. To
+// avoid needing to manage your own locks for this simple case, an
+// optional "finish" function is available, which is guaranteed to run
+// serially (although the work function and main thread will still run
 // alongside it). If you don't want to use a finishing function, then
 // the value returned by the work function is completely ignored.
 //
-// Note that the work "queue" is actually a stack, not a queue. This
-// shouldn't matter, as you have absolutely no ordering guarantees on
-// what order the work is completed in regardless.
+// Alternatively stThreadPool_submit runs an arbitrary function and
+// returns a task handle that can be waited on for that function's
+// result. Waiting on a task from inside a worker runs other tasks
+// while waiting, so tasks can safely submit subtasks and wait on them.
+//
+// By default a worker runs the newest task on its own deque first (so
+// the work "queue" behaves as a stack, which keeps nested work cache
+// friendly), but a pool can be constructed to run them oldest first.
+// Either way there are no guarantees on the order work completes in
+// when there is more than one thread.
 #ifndef SONLIB_THREADPOOL_H_
 #define SONLIB_THREADPOOL_H_
 #ifdef __cplusplus
@@ -22,6 +34,14 @@ extern "C" {
 #endif
 
 typedef struct _stThreadPool stThreadPool;
+typedef struct _stThreadPoolTask stThreadPoolTask;
+
+// The order in which a worker runs the tasks on its own deque. Stolen
+// tasks are always taken oldest first.
+typedef enum {
+    stThreadPoolLIFO,
+    stThreadPoolFIFO
+} stThreadPoolOrder;
 
 // Initialize the thread pool. finishFunc can be NULL if you are
 // managing your own locks for output.
@@ -29,21 +49,74 @@ stThreadPool *stThreadPool_construct(int64_t numThreads,
                                      void *(*workFunc)(void *),
                                      void (*finishFunc)(void *));
 
-// Push work onto the stack to be consumed by a thread.
+// As stThreadPool_construct, with the given order of running
+// tasks. workFunc can be NULL if only stThreadPool_submit is used.
+stThreadPool *stThreadPool_construct2(int64_t numThreads,
+                                      void *(*workFunc)(void *),
+                                      void (*finishFunc)(void *),
+                                      stThreadPoolOrder order);
+
+// Returns the number of threads in the pool.
+int64_t stThreadPool_getNumThreads(stThreadPool *threadPool);
+
+// Push work onto the pool to be consumed by a thread. Can be called
+// from inside a running work function.
 void stThreadPool_push(stThreadPool *threadPool, void *workUnit);
 
-// Block until all work currently in the stack is complete. Can block
-// indefinitely if something goes wrong. Use stThreadPool_waitSafe to
-// ensure that you can get execution back after a timeout.
+// Run fn(arg) on the pool, returning a handle for its result. The
+// finish function is not called on the result. Can be called from
+// inside a running task.
+stThreadPoolTask *stThreadPool_submit(stThreadPool *threadPool,
+                                      void *(*fn)(void *), void *arg);
+
+// Block until the task is complete and return its result. When
+// called from a worker thread the worker runs other tasks while it
+// waits.
+void *stThreadPoolTask_wait(stThreadPoolTask *task);
+
+// Returns whether the task is complete, without blocking.
+bool stThreadPoolTask_done(stThreadPoolTask *task);
+
+// Waits for the task if it is not complete, then frees the handle.
+void stThreadPoolTask_destruct(stThreadPoolTask *task);
+
+// Block until all work currently in the pool is complete, including
+// work pushed by running tasks. Must not be called from inside a
+// task. Can block indefinitely if something goes wrong.
 void stThreadPool_wait(stThreadPool *threadPool);
 
 // Doesn't wait on all the work to complete, just returns whether the
-// work in the stack is all done or not.
+// work in the pool is all done or not.
 bool stThreadPool_done(stThreadPool *threadPool);
 
-// Destroys the thread pool and destroys all threads *without*
-// checking if they are still processing work or if there is work in
-// the queue.
+// Returns a shared pool with one thread per online processor,
+// creating it on first use. It is used by stParallel_for and
+// stParallel_reduce, and must not be destructed.
+stThreadPool *stThreadPool_getDefault(void);
+
+// Calls fn(chunkStart, chunkEnd, ctx) on consecutive chunks covering
+// [start, end), running the chunks in parallel on the default pool
+// and returning when all are done. Chunks have at least grain indices
+// (except the last), or if grain is <= 0 the range is split into a
+// few chunks per thread. fn must be safe to run concurrently on
+// different chunks. Can be called from inside a task on the pool.
+void stParallel_for(int64_t start, int64_t end, int64_t grain,
+                    void (*fn)(int64_t, int64_t, void *), void *ctx);
+
+// As stParallel_for, but each chunk's mapFn(chunkStart, chunkEnd,
+// ctx) returns a result, and the results are combined pairwise in
+// order of the chunks with reduceFn(result1, result2, ctx), which
+// must be associative, and return the combined result. Returns NULL
+// if the range is empty.
+void *stParallel_reduce(int64_t start, int64_t end, int64_t grain,
+                        void *(*mapFn)(int64_t, int64_t, void *),
+                        void *(*reduceFn)(void *, void *, void *),
+                        void *ctx);
+
+// Destroys the thread pool and destroys all threads. They must finish
+// running their current task before they exit, but any remaining work
+// in the pool will be unfinished, and waiting on unfinished task
+// handles will block forever.
 void stThreadPool_destruct(stThreadPool *threadPool);
 
 #ifdef __cplusplus
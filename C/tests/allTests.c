@@ -10,6 +10,8 @@ CuSuite* sonLib_ETreeTestSuite(void);
 CuSuite* sonLib_stStringTestSuite(void);
 CuSuite* sonLib_stHashTestSuite(void);
 CuSuite* sonLib_stSetTestSuite(void);
+CuSuite* sonLib_stIntHashTestSuite(void);
+CuSuite* sonLib_stArenaTestSuite(void);
 CuSuite* sonLib_stSortedSetTestSuite(void);
 CuSuite* sonLib_stListTestSuite(void);
 CuSuite* sonLib_stCommonTestSuite(void);
@@ -20,6 +22,11 @@ CuSuite* sonLib_stRandomTestSuite(void);
 CuSuite* sonLib_stCompressionTestSuite(void);
 CuSuite* sonLibFileTestSuite(void);
 CuSuite* stCacheSuite(void);
+CuSuite* sonLib_stKVDatabaseCacheTestSuite(void);
+CuSuite* sonLib_stKVDatabasePipelineTestSuite(void);
+CuSuite* sonLib_stKVDatabaseLogFileTestSuite(void);
+CuSuite* sonLib_stKVDatabaseShardedTestSuite(void);
+CuSuite* sonLib_stKVDatabaseCompressionTestSuite(void);
 CuSuite* stPosetAlignmentTestSuite(void);
 CuSuite* sonLibGraphTestSuite(void);
 CuSuite* sonLib_stConnectivityTestSuite(void);
@@ -30,6 +37,10 @@ CuSuite* sonLib_stMatrixTestSuite(void);
 CuSuite* sonLib_stPhylogenyTestSuite(void);
 CuSuite* sonLib_stThreadPoolTestSuite(void);
 CuSuite* sonLib_stUnionFindTestSuite(void);
+CuSuite* sonLib_fastaTestSuite(void);
+CuSuite* sonLib_stFastaIndexTestSuite(void);
+CuSuite* sonLib_stCigarStreamTestSuite(void);
+CuSuite* sonLib_stFrozenTreeTestSuite(void);
 
 int sonLibRunAllTests(void) {
     CuString *output = CuStringNew();
@@ -50,6 +61,8 @@ int sonLibRunAllTests(void) {
     CuSuiteAddSuite(suite, sonLib_stDoubleTuplesTestSuite());
     CuSuiteAddSuite(suite, sonLib_stHashTestSuite());
     CuSuiteAddSuite(suite, sonLib_stSetTestSuite());
+    CuSuiteAddSuite(suite, sonLib_stIntHashTestSuite());
+    CuSuiteAddSuite(suite, sonLib_stArenaTestSuite());
     CuSuiteAddSuite(suite, sonLib_stListTestSuite());
     CuSuiteAddSuite(suite, sonLib_stSortedSetTestSuite());
     CuSuiteAddSuite(suite, sonLib_stExceptTestSuite());
@@ -57,7 +70,16 @@ int sonLibRunAllTests(void) {
     CuSuiteAddSuite(suite, sonLib_stCompressionTestSuite());
     CuSuiteAddSuite(suite, sonLibFileTestSuite());
     CuSuiteAddSuite(suite, stCacheSuite());
+    CuSuiteAddSuite(suite, sonLib_stKVDatabaseCacheTestSuite());
+    CuSuiteAddSuite(suite, sonLib_stKVDatabasePipelineTestSuite());
+    CuSuiteAddSuite(suite, sonLib_stKVDatabaseLogFileTestSuite());
+    CuSuiteAddSuite(suite, sonLib_stKVDatabaseShardedTestSuite());
+    CuSuiteAddSuite(suite, sonLib_stKVDatabaseCompressionTestSuite());
     CuSuiteAddSuite(suite, sonLib_stUnionFindTestSuite());
+    CuSuiteAddSuite(suite, sonLib_fastaTestSuite());
+    CuSuiteAddSuite(suite, sonLib_stFastaIndexTestSuite());
+    CuSuiteAddSuite(suite, sonLib_stCigarStreamTestSuite());
+    CuSuiteAddSuite(suite, sonLib_stFrozenTreeTestSuite());
     CuSuiteRun(suite);
     CuSuiteSummary(suite, output);
     CuSuiteDetails(suite, output);
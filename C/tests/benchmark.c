@@ -0,0 +1,1267 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * Timing benchmarks for the sonLib containers, comparing the alternative implementations
+ * against each other.
+ *
+ * Usage: sonLib_benchmark <benchmark> [size]
+ * Run with no arguments to list the available benchmarks.
+ */
+
+#define _POSIX_C_SOURCE 199309L // needed for clock_gettime()
+
+#include <time.h>
+#include <pthread.h>
+#include "sonLibGlobalsTest.h"
+#include "sonLibKVDatabaseTestMemory.h"
+#include "bioioC.h"
+#include "stCigarStream.h"
+#include <zlib.h>
+
+static double startTime;
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1.0e9;
+}
+
+static void startTimer(void) {
+    startTime = now();
+}
+
+/*
+ * Prints the time since startTimer() and the throughput for the given number of operations.
+ */
+static void reportTimer(const char *label, int64_t operations) {
+    double elapsed = now() - startTime;
+    printf("%-40s %10.3f s %12.0f ops/s\n", label, elapsed, elapsed > 0 ? operations / elapsed : 0.0);
+}
+
+/*
+ * Returns a shuffled array of distinct, pointer-like keys.
+ */
+static void **getPointerKeys(int64_t size) {
+    void **keys = st_malloc(size * sizeof(void *));
+    for (int64_t i = 0; i < size; i++) {
+        keys[i] = (void *) (intptr_t) ((i + 1) * 16); // Aligned like heap pointers.
+    }
+    for (int64_t i = size - 1; i > 0; i--) {
+        int64_t j = st_randomInt64(0, i + 1);
+        void *k = keys[i];
+        keys[i] = keys[j];
+        keys[j] = k;
+    }
+    return keys;
+}
+
+////////////////////////////////////////////////
+//stHash
+////////////////////////////////////////////////
+
+static int pointerEqualKey(const void *key1, const void *key2) {
+    return key1 == key2;
+}
+
+static void benchmarkHash(stHashType type, const char *name, void **keys, int64_t size) {
+    char label[100];
+    stHash *hash = stHash_construct4(stHash_pointer, pointerEqualKey, NULL, NULL, type);
+
+    startTimer();
+    for (int64_t i = 0; i < size; i++) {
+        stHash_insert(hash, keys[i], keys[i]);
+    }
+    sprintf(label, "%s: insert", name);
+    reportTimer(label, size);
+
+    startTimer();
+    int64_t found = 0;
+    for (int64_t i = 0; i < size; i++) {
+        found += stHash_search(hash, keys[size - 1 - i]) != NULL;
+    }
+    sprintf(label, "%s: search (hits)", name);
+    reportTimer(label, size);
+    assert(found == size);
+
+    startTimer();
+    for (int64_t i = 0; i < size; i++) {
+        found += stHash_search(hash, (char *) keys[i] + 1) != NULL; // Unaligned, so never present.
+    }
+    sprintf(label, "%s: search (misses)", name);
+    reportTimer(label, size);
+    assert(found == size);
+
+    startTimer();
+    stHashIterator *it = stHash_getIterator(hash);
+    void *key;
+    int64_t iterated = 0;
+    while ((key = stHash_getNext(it)) != NULL) {
+        iterated++;
+    }
+    stHash_destructIterator(it);
+    sprintf(label, "%s: iterate", name);
+    reportTimer(label, iterated);
+    assert(iterated == size);
+
+    startTimer();
+    for (int64_t i = 0; i < size; i += 2) {
+        stHash_remove(hash, keys[i]);
+    }
+    sprintf(label, "%s: remove half", name);
+    reportTimer(label, size / 2);
+
+    startTimer();
+    stHash_destruct(hash);
+    sprintf(label, "%s: destruct", name);
+    reportTimer(label, size - size / 2);
+}
+
+static void benchmark_hash(int64_t size) {
+    void **keys = getPointerKeys(size);
+    benchmarkHash(stHashTypeChained, "chained", keys, size);
+    benchmarkHash(stHashTypeOpenAddressing, "open addressing", keys, size);
+    free(keys);
+}
+
+////////////////////////////////////////////////
+//stIntHash
+////////////////////////////////////////////////
+
+static void benchmark_intHash(int64_t size) {
+    int64_t *keys = st_malloc(size * sizeof(int64_t));
+    for (int64_t i = 0; i < size; i++) {
+        keys[i] = st_randomInt64(INT64_MIN, INT64_MAX);
+    }
+
+    // The boxed baseline allocates an stIntTuple and a chained entry per key.
+    startTimer();
+    stHash *boxed = stHash_construct3((uint64_t (*)(const void *)) stIntTuple_hashKey,
+            (int (*)(const void *, const void *)) stIntTuple_equalsFn, (void (*)(void *)) stIntTuple_destruct, NULL);
+    for (int64_t i = 0; i < size; i++) {
+        stHash_insert(boxed, stIntTuple_construct1(keys[i]), keys + i);
+    }
+    reportTimer("stHash of stIntTuple: insert", size);
+    startTimer();
+    int64_t found = 0;
+    for (int64_t i = 0; i < size; i++) {
+        stIntTuple *query = stIntTuple_construct1(keys[i]);
+        found += stHash_search(boxed, query) != NULL;
+        stIntTuple_destruct(query);
+    }
+    reportTimer("stHash of stIntTuple: search", size);
+    startTimer();
+    stHash_destruct(boxed);
+    reportTimer("stHash of stIntTuple: destruct", size);
+
+    startTimer();
+    stIntHash *hash = stIntHash_construct();
+    for (int64_t i = 0; i < size; i++) {
+        stIntHash_insert(hash, keys[i], keys + i);
+    }
+    reportTimer("stIntHash: insert", size);
+    startTimer();
+    for (int64_t i = 0; i < size; i++) {
+        found += stIntHash_search(hash, keys[i]) != NULL;
+    }
+    reportTimer("stIntHash: search", size);
+    startTimer();
+    stIntHash_destruct(hash);
+    reportTimer("stIntHash: destruct", size);
+
+    startTimer();
+    stIntSet *set = stIntSet_construct();
+    stIntSet_insertAll(set, keys, size);
+    reportTimer("stIntSet: bulk insert", size);
+    stIntSet_destruct(set);
+
+    assert(found == 2 * size);
+    free(keys);
+}
+
+////////////////////////////////////////////////
+//stSortedSet
+////////////////////////////////////////////////
+
+static int pointerCompare(const void *a, const void *b) {
+    return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+static void benchmarkSortedSet(stSortedSetType type, const char *name, void **keys, int64_t size) {
+    char label[100];
+    stSortedSet *set = stSortedSet_construct4(pointerCompare, NULL, type);
+
+    startTimer();
+    for (int64_t i = 0; i < size; i++) {
+        stSortedSet_insert(set, keys[i]);
+    }
+    sprintf(label, "%s: insert", name);
+    reportTimer(label, size);
+
+    startTimer();
+    int64_t found = 0;
+    for (int64_t i = 0; i < size; i++) {
+        found += stSortedSet_search(set, keys[size - 1 - i]) != NULL;
+    }
+    sprintf(label, "%s: search", name);
+    reportTimer(label, size);
+    assert(found == size);
+
+    startTimer();
+    stSortedSetIterator *it = stSortedSet_getIterator(set);
+    int64_t iterated = 0;
+    while (stSortedSet_getNext(it) != NULL) {
+        iterated++;
+    }
+    stSortedSet_destructIterator(it);
+    sprintf(label, "%s: ordered iteration", name);
+    reportTimer(label, iterated);
+    assert(iterated == size);
+
+    // Range queries: find the start of a range with a search, then iterate 100 elements.
+    int64_t queries = size / 100 + 1, scanned = 0;
+    startTimer();
+    for (int64_t i = 0; i < queries; i++) {
+        void *start = stSortedSet_searchGreaterThanOrEqual(set, keys[i % size]);
+        stSortedSetIterator *it = stSortedSet_getIteratorFrom(set, start);
+        for (int64_t j = 0; j < 100 && stSortedSet_getNext(it) != NULL; j++) {
+            scanned++;
+        }
+        stSortedSet_destructIterator(it);
+    }
+    sprintf(label, "%s: range queries of 100", name);
+    reportTimer(label, queries);
+
+    startTimer();
+    for (int64_t i = 0; i < size; i += 2) {
+        stSortedSet_remove(set, keys[i]);
+    }
+    sprintf(label, "%s: remove half", name);
+    reportTimer(label, size / 2);
+
+    startTimer();
+    stSortedSet_destruct(set);
+    sprintf(label, "%s: destruct", name);
+    reportTimer(label, size - size / 2);
+}
+
+static void benchmark_sortedSet(int64_t size) {
+    void **keys = getPointerKeys(size);
+    benchmarkSortedSet(stSortedSetTypeAVL, "AVL", keys, size);
+    benchmarkSortedSet(stSortedSetTypeBTree, "B-tree", keys, size);
+    free(keys);
+}
+
+////////////////////////////////////////////////
+//stArena
+////////////////////////////////////////////////
+
+static void benchmarkArenaContainers(stArena *arena, const char *name, void **keys, int64_t size) {
+    char label[100];
+    startTimer();
+    stHash *hash = arena != NULL ? stHash_constructInArena(stHash_pointer, pointerEqualKey, NULL, NULL, arena) :
+            stHash_construct3(stHash_pointer, pointerEqualKey, NULL, NULL);
+    for (int64_t i = 0; i < size; i++) {
+        stHash_insert(hash, keys[i], keys[i]);
+    }
+    sprintf(label, "%s: stHash insert", name);
+    reportTimer(label, size);
+    startTimer();
+    stHash_destruct(hash);
+    sprintf(label, "%s: stHash destruct", name);
+    reportTimer(label, size);
+
+    startTimer();
+    stSortedSet *set = arena != NULL ? stSortedSet_constructInArena(pointerCompare, NULL, arena) :
+            stSortedSet_construct3(pointerCompare, NULL);
+    for (int64_t i = 0; i < size; i++) {
+        stSortedSet_insert(set, keys[i]);
+    }
+    sprintf(label, "%s: stSortedSet insert", name);
+    reportTimer(label, size);
+    startTimer();
+    stSortedSet_destruct(set);
+    sprintf(label, "%s: stSortedSet destruct", name);
+    reportTimer(label, size);
+
+    startTimer();
+    stIntTuple **tuples = st_malloc(size * sizeof(stIntTuple *));
+    for (int64_t i = 0; i < size; i++) {
+        int64_t values[] = { i, i + 1 };
+        tuples[i] = arena != NULL ? stIntTuple_constructNInArena(2, values, arena) : stIntTuple_constructN(2, values);
+    }
+    sprintf(label, "%s: stIntTuple construct", name);
+    reportTimer(label, size);
+    startTimer();
+    if (arena == NULL) {
+        for (int64_t i = 0; i < size; i++) {
+            stIntTuple_destruct(tuples[i]);
+        }
+    }
+    free(tuples);
+    sprintf(label, "%s: stIntTuple destruct", name);
+    reportTimer(label, size);
+}
+
+static void benchmark_arena(int64_t size) {
+    void **keys = getPointerKeys(size);
+    benchmarkArenaContainers(NULL, "malloc", keys, size);
+    stArena *arena = stArena_construct2(1 << 20);
+    benchmarkArenaContainers(arena, "arena", keys, size);
+    startTimer();
+    stArena_destruct(arena);
+    reportTimer("arena: arena destruct", 1);
+    free(keys);
+}
+
+////////////////////////////////////////////////
+//stThreadPool
+////////////////////////////////////////////////
+
+static void *spin(void *x) {
+    volatile int64_t j = 0;
+    for (int64_t i = 0; i < 100; i++) {
+        j += i;
+    }
+    return x;
+}
+
+static stThreadPool *fibPool;
+
+static void *fib(void *n) {
+    intptr_t i = (intptr_t) n;
+    if (i < 2) {
+        return n;
+    }
+    stThreadPoolTask *task = stThreadPool_submit(fibPool, fib, (void *) (i - 1));
+    intptr_t f = (intptr_t) fib((void *) (i - 2));
+    f += (intptr_t) stThreadPoolTask_wait(task);
+    stThreadPoolTask_destruct(task);
+    return (void *) f;
+}
+
+static void benchmark_threadPool(int64_t size) {
+    char label[100];
+    int64_t threadNumbers[] = { 1, 2, 4, 8 };
+    for (int64_t t = 0; t < 4; t++) {
+        // Tiny work units pushed from outside the pool.
+        stThreadPool *threadPool = stThreadPool_construct(threadNumbers[t], spin, NULL);
+        startTimer();
+        for (int64_t i = 0; i < size; i++) {
+            stThreadPool_push(threadPool, NULL);
+        }
+        stThreadPool_wait(threadPool);
+        sprintf(label, "%" PRIi64 " threads: push tiny work units", threadNumbers[t]);
+        reportTimer(label, size);
+        stThreadPool_destruct(threadPool);
+
+        // Nested fork/join, about 1.6 * size tasks.
+        fibPool = stThreadPool_construct2(threadNumbers[t], NULL, NULL, stThreadPoolLIFO);
+        intptr_t n = 2;
+        while (n < 40 && pow(1.618, n + 2) < size) {
+            n++;
+        }
+        startTimer();
+        stThreadPoolTask *task = stThreadPool_submit(fibPool, fib, (void *) n);
+        stThreadPoolTask_destruct(task);
+        sprintf(label, "%" PRIi64 " threads: nested fib(%" PRIi64 ")", threadNumbers[t], (int64_t) n);
+        reportTimer(label, (int64_t) pow(1.618, n + 1));
+        stThreadPool_destruct(fibPool);
+    }
+}
+
+////////////////////////////////////////////////
+//stCache
+////////////////////////////////////////////////
+
+#define CACHE_KEYS 100000
+#define CACHE_RECORD_SIZE 100
+
+struct cacheWorker {
+    stCache *cache;
+    pthread_mutex_t *lock; // Non-NULL to guard every access with one global lock.
+    int64_t operations;
+    uint64_t seed;
+    int64_t hits, misses;
+};
+
+/*
+ * Reads records through the cache, inserting them on a miss as if they had
+ * been fetched from a database. Keys are skewed, so the cache (which holds a
+ * tenth of the keys) gets a realistic mix of hits and misses.
+ */
+static void *readThroughCache(void *arg) {
+    struct cacheWorker *worker = arg;
+    char value[CACHE_RECORD_SIZE];
+    memset(value, 'a', CACHE_RECORD_SIZE);
+    uint64_t x = worker->seed;
+    for (int64_t i = 0; i < worker->operations; i++) {
+        x ^= x << 13; // xorshift, as st_random is not thread safe.
+        x ^= x >> 7;
+        x ^= x << 17;
+        double r = (x >> 11) * (1.0 / 9007199254740992.0);
+        int64_t key = (int64_t) (CACHE_KEYS * r * r * r);
+        if (worker->lock != NULL) {
+            pthread_mutex_lock(worker->lock);
+        }
+        int64_t size;
+        void *record = stCache_getRecord(worker->cache, key, 0, INT64_MAX, &size);
+        if (record != NULL) {
+            worker->hits++;
+            free(record);
+        } else {
+            worker->misses++;
+            stCache_setRecord(worker->cache, key, 0, CACHE_RECORD_SIZE, value);
+        }
+        if (worker->lock != NULL) {
+            pthread_mutex_unlock(worker->lock);
+        }
+    }
+    return NULL;
+}
+
+static void benchmarkCache(const char *name, stCache *cache, pthread_mutex_t *lock, int64_t threadNumber,
+        int64_t size) {
+    char label[100];
+    pthread_t threads[16];
+    struct cacheWorker workers[16];
+    startTimer();
+    for (int64_t i = 0; i < threadNumber; i++) {
+        workers[i].cache = cache;
+        workers[i].lock = lock;
+        workers[i].operations = size / threadNumber;
+        workers[i].seed = 88172645463325252ULL + i;
+        workers[i].hits = workers[i].misses = 0;
+        pthread_create(&threads[i], NULL, readThroughCache, &workers[i]);
+    }
+    int64_t hits = 0, misses = 0;
+    for (int64_t i = 0; i < threadNumber; i++) {
+        pthread_join(threads[i], NULL);
+        hits += workers[i].hits;
+        misses += workers[i].misses;
+    }
+    sprintf(label, "%" PRIi64 " threads: %s, %.1f%% hits", threadNumber, name,
+            100.0 * hits / (hits + misses > 0 ? hits + misses : 1));
+    reportTimer(label, hits + misses);
+}
+
+static void benchmark_cache(int64_t size) {
+    size_t maxSize = CACHE_KEYS / 10 * CACHE_RECORD_SIZE;
+    int64_t threadNumbers[] = { 1, 2, 4, 8 };
+    for (int64_t t = 0; t < 4; t++) {
+        pthread_mutex_t lock;
+        pthread_mutex_init(&lock, NULL);
+        stCache *cache = stCache_construct2(maxSize);
+        benchmarkCache("global lock", cache, &lock, threadNumbers[t], size);
+        stCache_destruct(cache);
+        pthread_mutex_destroy(&lock);
+
+        cache = stCache_construct3(maxSize, 64);
+        benchmarkCache("64 shards", cache, NULL, threadNumbers[t], size);
+        stCache_destruct(cache);
+    }
+}
+
+////////////////////////////////////////////////
+//stKVDatabasePipeline
+////////////////////////////////////////////////
+
+#define PIPELINE_LATENCY 200 // Microseconds per request, roughly a round trip to a server on the local network.
+
+/*
+ * Gets size records one at a time and then through pipelines with different
+ * batch sizes, from an in memory database that simulates the round trip to a
+ * server by sleeping for each request it gets.
+ */
+static void benchmark_kvPipeline(int64_t size) {
+    char label[100];
+    char value[100];
+    memset(value, 'a', sizeof(value));
+    stKVDatabase *database = memoryDatabase_construct();
+    for (int64_t i = 0; i < size; i++) {
+        stKVDatabase_setRecord(database, i, value, sizeof(value));
+    }
+    memoryDatabase->latency = PIPELINE_LATENCY;
+
+    startTimer();
+    for (int64_t i = 0; i < size; i++) {
+        free(stKVDatabase_getRecord(database, i));
+    }
+    sprintf(label, "synchronous gets, %d us latency", PIPELINE_LATENCY);
+    reportTimer(label, size);
+
+    int64_t batchSizes[] = { 1, 10, 100, 1000 };
+    stKVDatabaseRequest **requests = st_malloc(size * sizeof(stKVDatabaseRequest *));
+    for (int64_t b = 0; b < 4; b++) {
+        stKVDatabasePipeline *pipeline = stKVDatabasePipeline_construct(database, batchSizes[b]);
+        double latency = 0.0;
+        startTimer();
+        for (int64_t i = 0; i < size; i++) {
+            requests[i] = stKVDatabasePipeline_getRecord(pipeline, i);
+        }
+        for (int64_t i = 0; i < size; i++) {
+            int64_t recordSize;
+            free(stKVDatabaseRequest_getRecord(requests[i], &recordSize));
+            stKVDatabaseRequest_destruct(requests[i]);
+        }
+        sprintf(label, "pipelined gets, batches of %" PRIi64, batchSizes[b]);
+        reportTimer(label, size);
+        stKVDatabasePipeline_destruct(pipeline);
+
+        // Latency of a single request through an idle pipeline.
+        pipeline = stKVDatabasePipeline_construct(database, batchSizes[b]);
+        for (int64_t i = 0; i < 100; i++) {
+            double start = now();
+            stKVDatabaseRequest *request = stKVDatabasePipeline_getRecord(pipeline, i % size);
+            int64_t recordSize;
+            free(stKVDatabaseRequest_getRecord(request, &recordSize));
+            stKVDatabaseRequest_destruct(request);
+            latency += now() - start;
+        }
+        printf("%-40s %10.1f us\n", "  mean latency when idle", latency / 100 * 1.0e6);
+        stKVDatabasePipeline_destruct(pipeline);
+    }
+    free(requests);
+    stKVDatabase_destruct(database);
+}
+
+////////////////////////////////////////////////
+//stKVDatabase_borrowRecord
+////////////////////////////////////////////////
+
+#define BORROW_RECORD_SIZE (1 << 20)
+#define BORROW_RECORDS 64
+
+// Stands in for the work done with a record, so the reads aren't optimised away.
+static int64_t sumRecord(const char *record, int64_t size) {
+    int64_t total = 0;
+    for (int64_t i = 0; i < size; i += 64) {
+        total += record[i];
+    }
+    return total;
+}
+
+/*
+ * Reads size large records from a log file database, copying them with
+ * stKVDatabase_getRecord2 vs borrowing them in place.
+ */
+static void benchmark_kvBorrow(int64_t size) {
+    char label[100];
+    stKVDatabaseConf *conf = stKVDatabaseConf_constructLogFile("sonLibBenchmarkDatabase");
+    stKVDatabase *database = stKVDatabase_construct(conf, true);
+    char *value = st_malloc(BORROW_RECORD_SIZE);
+    for (int64_t i = 0; i < BORROW_RECORDS; i++) {
+        memset(value, 'a' + i % 26, BORROW_RECORD_SIZE);
+        stKVDatabase_setRecord(database, i, value, BORROW_RECORD_SIZE);
+    }
+    free(value);
+
+    int64_t total = 0;
+    startTimer();
+    for (int64_t i = 0; i < size; i++) {
+        int64_t recordSize;
+        char *record = stKVDatabase_getRecord2(database, i % BORROW_RECORDS, &recordSize);
+        total += sumRecord(record, recordSize);
+        free(record);
+    }
+    sprintf(label, "getRecord2, %d KB records", BORROW_RECORD_SIZE / 1024);
+    reportTimer(label, size);
+
+    startTimer();
+    for (int64_t i = 0; i < size; i++) {
+        int64_t recordSize;
+        const char *record = stKVDatabase_borrowRecord(database, i % BORROW_RECORDS, &recordSize);
+        total -= sumRecord(record, recordSize);
+        stKVDatabase_releaseRecord(database, record);
+    }
+    sprintf(label, "borrowRecord, %d KB records", BORROW_RECORD_SIZE / 1024);
+    reportTimer(label, size);
+    if (total != 0) {
+        st_errAbort("Borrowed records differ from the copies");
+    }
+    stKVDatabase_deleteFromDisk(database);
+    stKVDatabase_destruct(database);
+    stKVDatabaseConf_destruct(conf);
+}
+
+////////////////////////////////////////////////
+//stCompression
+////////////////////////////////////////////////
+
+/*
+ * Prints the compression ratio and the throughput of compressing and decompressing size bytes.
+ */
+static void reportCompression(const char *label, int64_t size, int64_t compressedSize, double compressSeconds,
+                              double decompressSeconds) {
+    printf("%-40s ratio %6.3f  compress %9.1f MB/s  decompress %9.1f MB/s\n", label, (double) compressedSize / size,
+           size / 1.0e6 / compressSeconds, size / 1.0e6 / decompressSeconds);
+}
+
+static void benchmarkCompression(const char *label, char *data, int64_t size, int64_t level,
+                                 void *(*compress)(void *, int64_t, int64_t *, int64_t),
+                                 void *(*decompress)(void *, int64_t, int64_t *)) {
+    int64_t compressedSize, size2;
+    startTimer();
+    char *compressed = compress(data, size, &compressedSize, level);
+    double compressSeconds = now() - startTime;
+    startTimer();
+    char *data2 = decompress(compressed, compressedSize, &size2);
+    double decompressSeconds = now() - startTime;
+    if (size2 != size || memcmp(data, data2, size) != 0) {
+        st_errAbort("%s: the decompressed data differs", label);
+    }
+    reportCompression(label, size, compressedSize, compressSeconds, decompressSeconds);
+    free(data2);
+    free(compressed);
+}
+
+// A small record like those stored in the KV databases, mostly shared with the others.
+static char *getCompressionRecord(int64_t i, int64_t *size) {
+    char *record = stString_print("{\"name\": \"sequence_%" PRIi64 "\", \"species\": \"%s\", \"length\": %" PRIi64
+                                  ", \"source\": \"assembly_hub/chromosome_%" PRIi64 "\", \"flags\": [\"primary\"]}",
+                                  i, i % 2 ? "Homo sapiens" : "Mus musculus", st_randomInt64(0, 1000000000), i % 23);
+    *size = strlen(record);
+    return record;
+}
+
+static void benchmarkSmallRecords(const char *label, char **records, int64_t *sizes, int64_t numberOfRecords,
+                                  stCompressionDictionary *dictionary, int64_t level) {
+    int64_t totalSize = 0, totalCompressed = 0;
+    char **compressed = st_malloc(numberOfRecords * sizeof(char *));
+    int64_t *compressedSizes = st_malloc(numberOfRecords * sizeof(int64_t));
+    startTimer();
+    for (int64_t i = 0; i < numberOfRecords; i++) {
+        compressed[i] = dictionary == NULL ? stCompression_compress(records[i], sizes[i], &compressedSizes[i], level)
+                : stCompression_compressWithDictionary(dictionary, records[i], sizes[i], &compressedSizes[i], level);
+        totalSize += sizes[i];
+        totalCompressed += compressedSizes[i];
+    }
+    double compressSeconds = now() - startTime;
+    startTimer();
+    for (int64_t i = 0; i < numberOfRecords; i++) {
+        int64_t size;
+        free(dictionary == NULL ? stCompression_decompress(compressed[i], compressedSizes[i], &size)
+                : stCompression_decompressWithDictionary(dictionary, compressed[i], compressedSizes[i], &size));
+        free(compressed[i]);
+    }
+    double decompressSeconds = now() - startTime;
+    reportCompression(label, totalSize, totalCompressed, compressSeconds, decompressSeconds);
+    free(compressed);
+    free(compressedSizes);
+}
+
+/*
+ * Compresses size bytes of sequence-like data with lz4 at each level and with zlib, then size / 100
+ * small similar records one at a time, with and without a trained dictionary.
+ */
+static void benchmark_compression(int64_t size) {
+    char label[100];
+    char *data = st_malloc(size);
+    for (int64_t i = 0; i < size; i++) { // Sequence with repeats, as in a genome.
+        data[i] = i >= 1000 && st_random() < 0.3 ? data[i - st_randomInt64(1, 1000)] : "ACGT"[st_randomInt(0, 4)];
+    }
+    int64_t levels[] = { -8, -2, -1, 1, 4, 9, 12 };
+    for (int64_t i = 0; i < 7; i++) {
+        sprintf(label, "lz4, level %" PRIi64, levels[i]);
+        benchmarkCompression(label, data, size, levels[i], stCompression_compress, stCompression_decompress);
+    }
+    for (int64_t level = 1; level <= 9; level += 4) {
+        sprintf(label, "zlib, level %" PRIi64, level);
+        benchmarkCompression(label, data, size, level, stCompression_compressZlib, stCompression_decompressZlib);
+    }
+    free(data);
+
+    int64_t numberOfRecords = size / 100 > 1000 ? size / 100 : 1000;
+    char **records = st_malloc(numberOfRecords * sizeof(char *));
+    int64_t *sizes = st_malloc(numberOfRecords * sizeof(int64_t));
+    for (int64_t i = 0; i < numberOfRecords; i++) {
+        records[i] = getCompressionRecord(i, &sizes[i]);
+    }
+    stCompressionDictionary *dictionary = stCompressionDictionary_train((const void **) records, sizes, 1000, 0);
+    for (int64_t i = 0; i < 7; i++) {
+        sprintf(label, "small records, level %" PRIi64, levels[i]);
+        benchmarkSmallRecords(label, records, sizes, numberOfRecords, NULL, levels[i]);
+        sprintf(label, "small records, dictionary, level %" PRIi64, levels[i]);
+        benchmarkSmallRecords(label, records, sizes, numberOfRecords, dictionary, levels[i]);
+    }
+    stCompressionDictionary_destruct(dictionary);
+    for (int64_t i = 0; i < numberOfRecords; i++) {
+        free(records[i]);
+    }
+    free(records);
+    free(sizes);
+}
+
+////////////////////////////////////////////////
+//fasta reading
+////////////////////////////////////////////////
+
+static void countFastaSeq(void *destination, const char *name, const char *seq, int64_t length) {
+    ((int64_t *) destination)[0]++;
+    ((int64_t *) destination)[1] += length;
+}
+
+/*
+ * Reads a fasta file a character at a time with getc, checking each with isalpha and growing the
+ * sequence a character at a time, as the fasta reader used to.
+ */
+static void fastaReadByCharacter(FILE *file, void *destination,
+        void (*addSeq)(void *destination, const char *name, const char *seq, int64_t length)) {
+    int64_t nameLength = 0, nameMaxLength = 0, seqLength = 0, seqMaxLength = 0;
+    char *name = NULL, *seq = NULL;
+    int j, inName = 0, started = 0;
+    while ((j = getc(file)) != EOF) {
+        if (j == '>') {
+            if (started) {
+                addSeq(destination, name, seq, seqLength);
+            }
+            started = inName = 1;
+            nameLength = seqLength = 0;
+        } else if (inName) {
+            name = arrayPrepareAppend(name, &nameMaxLength, nameLength + 1, sizeof(char));
+            name[nameLength++] = j == '\n' ? '\0' : j;
+            inName = j != '\n';
+        } else if (started && j != '\n' && j != ' ' && j != '\t') {
+            if (!isalpha(j) && j != '-') {
+                st_errAbort("Got an unexpected character in input fasta sequence: '%c'", j);
+            }
+            seq = arrayPrepareAppend(seq, &seqMaxLength, seqLength + 1, sizeof(char));
+            seq[seqLength++] = j;
+        }
+    }
+    if (started) {
+        addSeq(destination, name, seq, seqLength);
+    }
+    free(name);
+    free(seq);
+}
+
+/*
+ * Reads a gzip or bgzip fasta file through a stCompressionStream adapted to a FILE, as
+ * stCompressionStream_openFile does.
+ */
+static void fastaReadCompressed(FILE *file, void *destination,
+        void (*addSeq)(void *destination, const char *name, const char *seq, int64_t length)) {
+    stCompressionStream *stream = stCompressionStream_constructFileReader(stCompressionGzip, file);
+    FILE *streamFile = stCompressionStream_openAsFile(stream);
+    fastaReadToFunction(streamFile, destination, addSeq);
+    fclose(streamFile);
+}
+
+static void benchmarkFastaRead(const char *label, const char *fileName, int64_t size,
+        void (*readFn)(FILE *, void *, void (*)(void *, const char *, const char *, int64_t))) {
+    int64_t counts[2] = { 0, 0 };
+    FILE *file = st_fopen(fileName, "r");
+    startTimer();
+    readFn(file, counts, countFastaSeq);
+    double elapsed = now() - startTime;
+    fclose(file);
+    if (counts[1] != size) {
+        st_errAbort("Read %" PRIi64 " bases, expected %" PRIi64, counts[1], size);
+    }
+    printf("%-40s %10.3f s %10.1f MB/s %6" PRIi64 " sequences\n", label, elapsed, size / elapsed / 1.0e6, counts[0]);
+}
+
+/*
+ * Writes a genome-like fasta file of size bases, as chromosomes of up to 100Mb in lines of 60,
+ * and reads it back a character at a time and in blocks, then from gzip and bgzip copies.
+ */
+static void benchmark_fasta(int64_t size) {
+    char *fileName = getTempFile();
+    FILE *file = st_fopen(fileName, "w");
+    char line[61];
+    line[60] = '\0';
+    int64_t chromosomeSize = 100000000;
+    for (int64_t i = 0; i < size; i += chromosomeSize) {
+        int64_t end = size - i < chromosomeSize ? size : i + chromosomeSize;
+        fprintf(file, ">chr%" PRIi64 " length=%" PRIi64 "\n", i / chromosomeSize + 1, end - i);
+        for (int64_t j = i; j < end; j += 60) {
+            int64_t lineLength = end - j < 60 ? end - j : 60;
+            for (int64_t k = 0; k < lineLength; k++) {
+                line[k] = "ACGTNacgt"[st_randomInt(0, 9)];
+            }
+            fwrite(line, sizeof(char), lineLength, file);
+            fputc('\n', file);
+        }
+    }
+    fclose(file);
+    benchmarkFastaRead("fasta, a character at a time", fileName, size, fastaReadByCharacter);
+    benchmarkFastaRead("fasta, in blocks", fileName, size, fastaReadToFunction);
+
+    // Compressed copies, read through stCompressionStream_openFile.
+    char *gzipFileName = getTempFile(), *bgzipFileName = getTempFile();
+    file = st_fopen(fileName, "rb");
+    gzFile gzipFile = gzopen(gzipFileName, "wb");
+    FILE *bgzipFile = st_fopen(bgzipFileName, "wb");
+    stCompressionStream *stream = stCompressionStream_constructFileWriter(stCompressionGzip, -1, bgzipFile);
+    char *buffer = st_malloc(1048576);
+    int64_t length;
+    while ((length = fread(buffer, 1, 1048576, file)) > 0) {
+        gzwrite(gzipFile, buffer, length);
+        stCompressionStream_write(stream, buffer, length);
+    }
+    stCompressionStream_finish(stream);
+    stCompressionStream_destruct(stream);
+    fclose(bgzipFile);
+    gzclose(gzipFile);
+    fclose(file);
+    free(buffer);
+    benchmarkFastaRead("fasta, gzip", gzipFileName, size, fastaReadCompressed);
+    benchmarkFastaRead("fasta, bgzip", bgzipFileName, size, fastaReadCompressed);
+    removeTempFile(gzipFileName);
+    removeTempFile(bgzipFileName);
+    removeTempFile(fileName);
+}
+
+////////////////////////////////////////////////
+//cigar reading and writing
+////////////////////////////////////////////////
+
+static void reportCigar(const char *label, int64_t operations, const char *fileName) {
+    double elapsed = now() - startTime;
+    struct stat fileStat;
+    stat(fileName, &fileStat);
+    printf("%-40s %10.3f s %10.1f Mops/s %10.1f MB/s %8.1f MB\n", label, elapsed, operations / elapsed / 1.0e6,
+           fileStat.st_size / elapsed / 1.0e6, fileStat.st_size / 1.0e6);
+}
+
+static void checkCigarOperations(int64_t operations, int64_t expected) {
+    if (operations != expected) {
+        st_errAbort("Read %" PRIi64 " operations, expected %" PRIi64, operations, expected);
+    }
+}
+
+static void benchmarkCigarWrite(const char *label, const char *fileName, stCigar *cigars, int64_t cigarNumber,
+                                int64_t size, stCigarFormat format) {
+    FILE *file = st_fopen(fileName, "wb");
+    startTimer();
+    stCigarWriter *writer = stCigarWriter_construct(file, format);
+    for (int64_t i = 0; i < cigarNumber; i++) {
+        stCigarWriter_write(writer, &cigars[i]);
+    }
+    stCigarWriter_destruct(writer);
+    fclose(file);
+    reportCigar(label, size, fileName);
+}
+
+static void benchmarkCigarRead(const char *label, const char *fileName, int64_t size) {
+    FILE *file = st_fopen(fileName, "rb");
+    int64_t operations = 0;
+    startTimer();
+    stCigarReader *reader = stCigarReader_construct(file);
+    const stCigar *cigar;
+    while ((cigar = stCigarReader_next(reader)) != NULL) {
+        operations += cigar->operationNumber;
+    }
+    stCigarReader_destruct(reader);
+    fclose(file);
+    reportCigar(label, size, fileName);
+    checkCigarOperations(operations, size);
+}
+
+/*
+ * Reads all the alignments of the file into memory, as PairwiseAlignments or as
+ * FlatPairwiseAlignments, then frees them.
+ */
+static void benchmarkCigarLoad(const char *label, const char *fileName, int64_t size, bool flat) {
+    FILE *file = st_fopen(fileName, "rb");
+    struct StringTable *contigNames = constructStringTable();
+    struct List *alignments = constructEmptyList(0, NULL);
+    startTimer();
+    stCigarReader *reader = stCigarReader_construct(file);
+    void *alignment;
+    while ((alignment = flat ? (void *) stCigarReader_nextFlatPairwiseAlignment(reader, contigNames)
+                             : (void *) stCigarReader_nextPairwiseAlignment(reader)) != NULL) {
+        listAppend(alignments, alignment);
+    }
+    stCigarReader_destruct(reader);
+    for (int64_t i = 0; i < alignments->length; i++) {
+        if (flat) {
+            destructFlatPairwiseAlignment(alignments->list[i]);
+        } else {
+            destructPairwiseAlignment(alignments->list[i]);
+        }
+    }
+    destructList(alignments);
+    destructStringTable(contigNames);
+    fclose(file);
+    reportCigar(label, size, fileName);
+}
+
+/*
+ * Makes alignments of 1000 operations, totalling size operations, and times writing and reading
+ * them with cigarWrite and cigarRead and with stCigarWriter and stCigarReader in both formats, then
+ * times holding them in memory as PairwiseAlignments and as FlatPairwiseAlignments.
+ */
+static void benchmark_cigar(int64_t size) {
+    int64_t cigarNumber = (size + 999) / 1000;
+    struct AlignmentOperation *operations = st_malloc(size * sizeof(struct AlignmentOperation));
+    stCigar *cigars = st_calloc(cigarNumber, sizeof(stCigar));
+    struct PairwiseAlignment **pAs = st_malloc(cigarNumber * sizeof(struct PairwiseAlignment *));
+    char contigs[24][10];
+    for (int64_t i = 0; i < 24; i++) {
+        sprintf(contigs[i], "chr%" PRIi64, i + 1);
+    }
+    for (int64_t i = 0; i < cigarNumber; i++) {
+        stCigar *cigar = &cigars[i];
+        cigar->operations = operations + i * 1000;
+        cigar->operationNumber = size - i * 1000 < 1000 ? size - i * 1000 : 1000;
+        int64_t length1 = 0, length2 = 0;
+        // The operations are listed by pointer in the PairwiseAlignment, not copied.
+        struct List *operationList = constructEmptyList(0, NULL);
+        for (int64_t j = 0; j < cigar->operationNumber; j++) {
+            struct AlignmentOperation *op = &cigar->operations[j];
+            op->opType = j % 2 == 0 ? PAIRWISE_MATCH : st_randomInt(1, 3);
+            op->length = op->opType == PAIRWISE_MATCH ? st_randomInt(1, 500) : st_randomInt(1, 10);
+            op->score = 0.0;
+            length1 += op->opType != PAIRWISE_INDEL_Y ? op->length : 0;
+            length2 += op->opType != PAIRWISE_INDEL_X ? op->length : 0;
+            listAppend(operationList, op);
+        }
+        cigar->contig1 = contigs[st_randomInt(0, 24)];
+        cigar->start1 = st_randomInt(0, 200000000);
+        cigar->end1 = cigar->start1 + length1;
+        cigar->strand1 = 1;
+        cigar->contig2 = contigs[st_randomInt(0, 24)];
+        cigar->strand2 = st_randomInt(0, 2);
+        cigar->start2 = st_randomInt(0, 200000000) + (cigar->strand2 ? 0 : length2);
+        cigar->end2 = cigar->strand2 ? cigar->start2 + length2 : cigar->start2 - length2;
+        cigar->score = st_randomInt(0, 1000000);
+        pAs[i] = constructPairwiseAlignment((char *) cigar->contig1, cigar->start1, cigar->end1, cigar->strand1,
+                                            (char *) cigar->contig2, cigar->start2, cigar->end2, cigar->strand2,
+                                            cigar->score, operationList);
+    }
+
+    char *textFileName = getTempFile(), *binaryFileName = getTempFile();
+    FILE *file = st_fopen(textFileName, "w");
+    startTimer();
+    for (int64_t i = 0; i < cigarNumber; i++) {
+        cigarWrite(file, pAs[i], 0);
+    }
+    fclose(file);
+    reportCigar("cigarWrite", size, textFileName);
+    benchmarkCigarWrite("stCigarWriter, text", textFileName, cigars, cigarNumber, size, stCigarText);
+    benchmarkCigarWrite("stCigarWriter, binary", binaryFileName, cigars, cigarNumber, size, stCigarBinary);
+
+    file = st_fopen(textFileName, "r");
+    int64_t operationCount = 0;
+    startTimer();
+    struct PairwiseAlignment *pA;
+    while ((pA = cigarRead(file)) != NULL) {
+        operationCount += pA->operationList->length;
+        destructPairwiseAlignment(pA);
+    }
+    fclose(file);
+    reportCigar("cigarRead", size, textFileName);
+    checkCigarOperations(operationCount, size);
+    benchmarkCigarRead("stCigarReader, text", textFileName, size);
+    benchmarkCigarRead("stCigarReader, binary", binaryFileName, size);
+    benchmarkCigarLoad("load and free, PairwiseAlignment", binaryFileName, size, false);
+    benchmarkCigarLoad("load and free, FlatPairwiseAlignment", binaryFileName, size, true);
+
+    removeTempFile(textFileName);
+    removeTempFile(binaryFileName);
+    for (int64_t i = 0; i < cigarNumber; i++) {
+        destructPairwiseAlignment(pAs[i]);
+    }
+    free(pAs);
+    free(cigars);
+    free(operations);
+}
+
+////////////////////////////////////////////////
+//newick parsing and writing
+////////////////////////////////////////////////
+
+/*
+ * The recursive newick parser stTree used to have, which respaces the string with stString_replace
+ * and parses it a token at a time.
+ */
+static void oldNewick_getNextToken(char **token, char **newickTreeString) {
+    free(*token);
+    *token = stString_getNextWord(newickTreeString);
+    if (*token == NULL) {
+        st_errAbort("invalid Newick tree, doesn't end with ';'");
+    }
+}
+
+static stTree *oldNewick_parse(char **token, char **newickTreeString) {
+    stTree *tree = stTree_construct();
+    if ((*token)[0] == '(') {
+        oldNewick_getNextToken(token, newickTreeString);
+        while (1) {
+            stTree_setParent(oldNewick_parse(token, newickTreeString), tree);
+            if ((*token)[0] == ',') {
+                oldNewick_getNextToken(token, newickTreeString);
+            } else {
+                break;
+            }
+        }
+        if ((*token)[0] != ')') {
+            st_errAbort("Invalid Newick tree, unbalanced parenthesis");
+        }
+        oldNewick_getNextToken(token, newickTreeString);
+    }
+    if (**token != ':' && **token != ',' && **token != ';' && **token != ')') {
+        stTree_setLabel(tree, *token);
+        oldNewick_getNextToken(token, newickTreeString);
+    }
+    if (**token == ':') {
+        oldNewick_getNextToken(token, newickTreeString);
+        double distance;
+        if (sscanf(*token, "%lf", &distance) != 1) {
+            st_errAbort("Invalid Newick tree");
+        }
+        stTree_setBranchLength(tree, distance);
+        oldNewick_getNextToken(token, newickTreeString);
+    }
+    return tree;
+}
+
+static stTree *oldNewick_parseNewickString(const char *string) {
+    const char *patterns[] = { "(", " ( ", ")", " ) ", ":", " : ", ",", " , ", ";", " ; " };
+    char *cA = stString_copy(string);
+    for (int64_t i = 0; i < 10; i += 2) {
+        char *cA2 = stString_replace(cA, patterns[i], patterns[i + 1]);
+        free(cA);
+        cA = cA2;
+    }
+    char *cA2 = cA;
+    char *token = stString_getNextWord(&cA);
+    stTree *tree = oldNewick_parse(&token, &cA);
+    if (*token != ';') {
+        st_errAbort("Invalid Newick tree, missing ';'");
+    }
+    free(cA2);
+    free(token);
+    return tree;
+}
+
+/*
+ * The recursive writer stTree used to have, which builds each subtree's string with stString_print.
+ */
+static char *oldNewick_getString(stTree *tree) {
+    char *cA = stString_copy(""), *cA2;
+    if (stTree_getChildNumber(tree) > 0) {
+        free(cA);
+        cA = stString_copy("(");
+        for (int64_t i = 0; i < stTree_getChildNumber(tree); i++) {
+            cA2 = oldNewick_getString(stTree_getChild(tree, i));
+            char *cA3 = stString_print(i + 1 < stTree_getChildNumber(tree) ? "%s%s," : "%s%s", cA, cA2);
+            free(cA);
+            free(cA2);
+            cA = cA3;
+        }
+        cA2 = stString_print("%s)", cA);
+        free(cA);
+        cA = cA2;
+    }
+    if (stTree_getLabel(tree) != NULL) {
+        cA2 = stString_print("%s%s", cA, stTree_getLabel(tree));
+        free(cA);
+        cA = cA2;
+    }
+    if (stTree_getBranchLength(tree) != INFINITY) {
+        cA2 = stString_print("%s:%g", cA, stTree_getBranchLength(tree));
+        free(cA);
+        cA = cA2;
+    }
+    return cA;
+}
+
+static char *oldNewick_getNewickTreeString(stTree *tree) {
+    char *cA = oldNewick_getString(tree);
+    char *cA2 = stString_print("%s;", cA);
+    free(cA);
+    return cA2;
+}
+
+/*
+ * Returns a random binary tree with the given number of leaves, splitting the leaves at random at
+ * each node, with labelled leaves and branch lengths.
+ */
+static stTree *getRandomTree(int64_t leafNumber, int64_t *leafIndex) {
+    stTree *tree = stTree_construct();
+    stTree_setBranchLength(tree, st_randomInt(1, 1000) / 100.0);
+    if (leafNumber == 1) {
+        char label[32];
+        sprintf(label, "leaf%" PRIi64, (*leafIndex)++);
+        stTree_setLabel(tree, label);
+    } else {
+        int64_t leftLeafNumber = st_randomInt(1, leafNumber);
+        stTree_setParent(getRandomTree(leftLeafNumber, leafIndex), tree);
+        stTree_setParent(getRandomTree(leafNumber - leftLeafNumber, leafIndex), tree);
+    }
+    return tree;
+}
+
+static void reportNewick(const char *label, int64_t leafNumber, int64_t stringLength) {
+    double elapsed = now() - startTime;
+    printf("%-40s %10.3f s %10.1f Mleaves/s %10.1f MB/s\n", label, elapsed, leafNumber / elapsed / 1.0e6,
+           stringLength / elapsed / 1.0e6);
+}
+
+static void checkNewick(const char *string, stTree *tree) {
+    char *string2 = stTree_getNewickTreeString(tree);
+    if (!stString_eq(string, string2)) {
+        st_errAbort("Newick tree was not parsed correctly");
+    }
+    free(string2);
+}
+
+/*
+ * Parses and writes a random tree with size leaves with the old recursive parser and writer and
+ * with the single pass ones, with and without an arena.
+ */
+static void benchmark_newick(int64_t size) {
+    int64_t leafIndex = 0;
+    stTree *tree = getRandomTree(size, &leafIndex);
+    char *string = stTree_getNewickTreeString(tree);
+    int64_t length = strlen(string);
+
+    startTimer();
+    stTree *tree2 = oldNewick_parseNewickString(string);
+    reportNewick("parse, recursive", size, length);
+    startTimer();
+    stTree_destruct(tree2);
+    reportNewick("destruct, recursive parse", size, length);
+
+    startTimer();
+    tree2 = stTree_parseNewickString(string);
+    reportNewick("parse, single pass", size, length);
+    checkNewick(string, tree2);
+    startTimer();
+    stTree_destruct(tree2);
+    reportNewick("destruct, single pass parse", size, length);
+
+    startTimer();
+    stArena *arena = stArena_construct();
+    tree2 = stTree_parseNewickStringInArena(string, arena);
+    reportNewick("parse, single pass in an arena", size, length);
+    checkNewick(string, tree2);
+    startTimer();
+    stTree_destruct(tree2);
+    stArena_destruct(arena);
+    reportNewick("destruct, arena parse", size, length);
+
+    startTimer();
+    char *string2 = oldNewick_getNewickTreeString(tree);
+    reportNewick("write, recursive", size, length);
+    if (!stString_eq(string, string2)) {
+        st_errAbort("Newick trees were written differently");
+    }
+    free(string2);
+    startTimer();
+    string2 = stTree_getNewickTreeString(tree);
+    reportNewick("write, single pass", size, length);
+    free(string2);
+
+    free(string);
+    stTree_destruct(tree);
+}
+
+////////////////////////////////////////////////
+//LCA queries
+////////////////////////////////////////////////
+
+/*
+ * Answers size random MRCA queries on a random tree of size nodes with stTree_getMRCA, then on a
+ * frozen copy of the tree by climbing and with the LCA index.
+ */
+static void benchmark_lca(int64_t size) {
+    int64_t leafIndex = 0;
+    stTree *tree = getRandomTree((size + 1) / 2, &leafIndex);
+    stFrozenTree *frozenTree = stFrozenTree_construct(tree);
+    int64_t n = stFrozenTree_getNodeNumber(frozenTree);
+    int64_t *queries = st_malloc(2 * size * sizeof(int64_t));
+    stTree **nodes = st_malloc(2 * size * sizeof(stTree *));
+    for (int64_t i = 0; i < 2 * size; i++) {
+        queries[i] = st_randomInt(0, n);
+        nodes[i] = stFrozenTree_getStTree(frozenTree, queries[i]);
+    }
+    int64_t checksum = 0, checksum2 = 0, checksum3 = 0;
+
+    startTimer();
+    for (int64_t i = 0; i < size; i++) {
+        checksum += (int64_t) stTree_getMRCA(nodes[2 * i], nodes[2 * i + 1]);
+    }
+    reportTimer("stTree_getMRCA", size);
+
+    startTimer();
+    for (int64_t i = 0; i < size; i++) {
+        checksum2 += (int64_t) stFrozenTree_getStTree(frozenTree,
+                stFrozenTree_getLCA(frozenTree, queries[2 * i], queries[2 * i + 1]));
+    }
+    reportTimer("stFrozenTree_getLCA, climbing", size);
+
+    startTimer();
+    stFrozenTree *indexedTree = stFrozenTree_construct2(tree, true);
+    reportTimer("stFrozenTree with LCA index, build", n);
+    startTimer();
+    for (int64_t i = 0; i < size; i++) {
+        checksum3 += (int64_t) stFrozenTree_getStTree(indexedTree,
+                stFrozenTree_getLCA(indexedTree, queries[2 * i], queries[2 * i + 1]));
+    }
+    reportTimer("stFrozenTree_getLCA, indexed", size);
+    if (checksum != checksum2 || checksum != checksum3) {
+        st_errAbort("The LCA queries disagree");
+    }
+
+    free(queries);
+    free(nodes);
+    stFrozenTree_destruct(indexedTree);
+    stFrozenTree_destruct(frozenTree);
+    stTree_destruct(tree);
+}
+
+////////////////////////////////////////////////
+//Driver
+////////////////////////////////////////////////
+
+struct benchmark {
+    const char *name;
+    void (*fn)(int64_t size);
+    int64_t defaultSize;
+    const char *description;
+};
+
+static struct benchmark benchmarks[] = {
+    { "hash", benchmark_hash, 10000000, "stHash chained vs open addressing with pointer keys" },
+    { "intHash", benchmark_intHash, 10000000, "stIntHash vs stHash keyed by stIntTuple" },
+    { "sortedSet", benchmark_sortedSet, 1000000, "stSortedSet AVL vs B-tree with pointer keys" },
+    { "arena", benchmark_arena, 1000000, "stHash, stSortedSet and stIntTuple allocated with malloc vs in an stArena" },
+    { "threadPool", benchmark_threadPool, 1000000, "stThreadPool throughput for flat and nested tiny tasks" },
+    { "cache", benchmark_cache, 4000000, "stCache read-through hit rate and throughput, global lock vs sharded" },
+    { "kvPipeline", benchmark_kvPipeline, 10000, "stKVDatabase gets one at a time vs pipelined, with simulated latency" },
+    { "kvBorrow", benchmark_kvBorrow, 10000, "stKVDatabase log file reads of large records, copied vs borrowed" },
+    { "compression", benchmark_compression, 100000000, "stCompression ratio and throughput by level, and with dictionaries" },
+    { "fasta", benchmark_fasta, 1000000000, "fasta reading, a character at a time vs in blocks, and from gzip and bgzip" },
+    { "cigar", benchmark_cigar, 10000000, "cigar operations read and written, cigarRead/cigarWrite vs stCigarStream text and binary" },
+    { "newick", benchmark_newick, 1000000, "newick trees parsed and written, recursively vs in a single pass" },
+    { "lca", benchmark_lca, 1000000, "MRCA queries, stTree_getMRCA vs stFrozenTree climbing and with its LCA index" },
+};
+
+int main(int argc, char *argv[]) {
+    int64_t benchmarkNumber = sizeof(benchmarks) / sizeof(benchmarks[0]);
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s <benchmark> [size]\nBenchmarks:\n", argv[0]);
+        for (int64_t i = 0; i < benchmarkNumber; i++) {
+            fprintf(stderr, "  %-12s %s (default size %" PRIi64 ")\n", benchmarks[i].name, benchmarks[i].description,
+                    benchmarks[i].defaultSize);
+        }
+        return 1;
+    }
+    for (int64_t i = 0; i < benchmarkNumber; i++) {
+        if (strcmp(argv[1], benchmarks[i].name) == 0) {
+            int64_t size = argc == 3 ? atoll(argv[2]) : benchmarks[i].defaultSize;
+            printf("Running %s benchmark with size %" PRIi64 "\n", benchmarks[i].name, size);
+            benchmarks[i].fn(size);
+            return 0;
+        }
+    }
+    fprintf(stderr, "Unknown benchmark: %s\n", argv[1]);
+    return 1;
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * Converts alignments between the text cigar format and the binary format of stCigarStream.
+ *
+ * Usage: sonLib_cigarConvert (text|binary) inputFile outputFile
+ * The format of the input is detected, and either file may be - for stdin or stdout.
+ */
+
+#include "sonLib.h"
+#include "stCigarStream.h"
+
+int main(int argc, char *argv[]) {
+    if (argc != 4 || (strcmp(argv[1], "text") != 0 && strcmp(argv[1], "binary") != 0)) {
+        fprintf(stderr, "Usage: %s (text|binary) inputFile outputFile\n", argv[0]);
+        return 1;
+    }
+    stCigarFormat format = strcmp(argv[1], "text") == 0 ? stCigarText : stCigarBinary;
+    FILE *input = strcmp(argv[2], "-") == 0 ? stdin : st_fopen(argv[2], "rb");
+    FILE *output = strcmp(argv[3], "-") == 0 ? stdout : st_fopen(argv[3], "wb");
+
+    stCigarReader *reader = stCigarReader_construct(input);
+    stCigarWriter *writer = stCigarWriter_construct(output, format);
+    const stCigar *cigar;
+    while ((cigar = stCigarReader_next(reader)) != NULL) {
+        stCigarWriter_write(writer, cigar);
+    }
+    stCigarWriter_destruct(writer);
+    stCigarReader_destruct(reader);
+
+    if (input != stdin) {
+        fclose(input);
+    }
+    if (output != stdout && fclose(output) != 0) {
+        st_errAbort("Writing %s failed", argv[3]);
+    }
+    return 0;
+}
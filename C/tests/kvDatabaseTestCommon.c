@@ -17,15 +17,18 @@ static void usage(const char *desc) {
     static const char *help = 
         "Options:\n"
         "\n"
-        "-t --type=dbtype - one of 'KyotoTycoon', 'TokyoCabinet' or 'MySql'.\n"
+        "-t --type=dbtype - one of 'KyotoTycoon', 'TokyoCabinet', 'LogFile', 'MySql' or 'Redis'.\n"
         "    Values area case-insensitive, defaults to TokyoCabinet.\n"
-        "-d --db=database - database directory for TokyoCabinet or database name\n"
+        "-d --db=database - database directory for TokyoCabinet or LogFile, or database name\n"
         "    for SQL databases. Defaults to testTCDatabase for TokyoCabinet,\n"
         "    SQL databases must specify.\n"
         "--host=host - Tycoon or SQL database host, defaults to localhost\n"
         "--port=port - Tycoon or SQL database port.\n"
         "-u, --user=user - SQL database user.\n"
         "-p, --pass=pass - SQL database password.\n"
+        "-s, --shards=n - shard the database over n databases of the type, with the database\n"
+        "    directory or name suffixed _0, _1, ..., and ports port, port+1, ...\n"
+        "-c, --compression=chunkSize - compress records in chunks of chunkSize bytes.\n"
         "-h, --help - print this message.\n";
     fprintf(stderr, "%s\n%s\n", desc, help);
     exit(1);
@@ -34,6 +37,8 @@ static void usage(const char *desc) {
 static stKVDatabaseType parseDbType(const char *dbTypeStr) {
     if (stString_eqcase(dbTypeStr, "TokyoCabinet")) {
         return stKVDatabaseTypeTokyoCabinet;
+    } else if (stString_eqcase(dbTypeStr, "LogFile")) {
+        return stKVDatabaseTypeLogFile;
     } else if (stString_eqcase(dbTypeStr, "KyotoTycoon")) {
         return stKVDatabaseTypeKyotoTycoon;
     } else if (stString_eqcase(dbTypeStr, "MySql")) {
@@ -62,6 +67,8 @@ stKVDatabaseConf *kvDatabaseTestParseOptions(int argc, char *const *argv, const
         {"user", required_argument, NULL, 'u'},
         {"pass", required_argument, NULL, 'p'},
         {"name", required_argument, NULL, 'n'},
+        {"shards", required_argument, NULL, 's'},
+        {"compression", required_argument, NULL, 'c'},
         {"help", no_argument,       NULL, 'h'},
         {NULL, 0, NULL, '\0'}
     };
@@ -77,8 +84,10 @@ stKVDatabaseConf *kvDatabaseTestParseOptions(int argc, char *const *argv, const
     const char *optUser = NULL;
     const char *optPass = NULL;
     const char *optName = NULL;
+    int64_t optShards = 0;
+    int64_t optCompression = 0;
     int optKey, optIndex;
-    while ((optKey = getopt_long(argc, argv, "t:d:H:P:i:r:b:R:u:p:h", longOptions, &optIndex)) >= 0) {
+    while ((optKey = getopt_long(argc, argv, "t:d:H:P:i:r:b:R:u:p:s:c:h", longOptions, &optIndex)) >= 0) {
         switch (optKey) {
         case 't':
             optType = parseDbType(optarg);
@@ -113,6 +122,12 @@ stKVDatabaseConf *kvDatabaseTestParseOptions(int argc, char *const *argv, const
         case 'n':
         	optName = optarg;
         	break;
+        case 's':
+            optShards = stSafeStrToInt64(optarg);
+            break;
+        case 'c':
+            optCompression = stSafeStrToInt64(optarg);
+            break;
         case 'h':
             usage(desc);
             break;
@@ -138,21 +153,42 @@ stKVDatabaseConf *kvDatabaseTestParseOptions(int argc, char *const *argv, const
     if (numPositionalRet != NULL) {
         *numPositionalRet = numPositional;
     }
-    stKVDatabaseConf *conf = NULL;
-    if (optType == stKVDatabaseTypeTokyoCabinet) {
-        conf = stKVDatabaseConf_constructTokyoCabinet(optDb);
-        fprintf(stderr, "running Tokyo Cabinet sonLibKVDatabase tests\n");
-    } else if (optType == stKVDatabaseTypeKyotoTycoon) {
-        conf = stKVDatabaseConf_constructKyotoTycoon(optHost, optPort, optTimeout,
-        		optMaxKTRecordSize, optMaxKTBulkSetSize, optMaxKTBulkSetNumRecords, optDb, optName);
-        fprintf(stderr, "running Kyoto Tycoon sonLibKVDatabase tests\n");
-    } else if (optType == stKVDatabaseTypeMySql) {
-        conf = stKVDatabaseConf_constructMySql(optHost, 0, optUser, optPass, optDb, "cactusDbTest");
-        fprintf(stderr, "running MySQL sonLibKVDatabase tests\n");
-    } else if (optType == stKVDatabaseTypeRedis) {
-        conf = stKVDatabaseConf_constructRedis(optHost, optPort, optMaxRedisBulkSetSize);
-        fprintf(stderr, "running Redis sonLibKVDatabase tests\n");
+    stList *confs = stList_construct3(0, (void (*)(void *)) stKVDatabaseConf_destruct);
+    const char *typeName = NULL;
+    for (int64_t i = 0; i < (optShards > 0 ? optShards : 1); i++) {
+        char *db = optShards > 0 ? stString_print("%s_%" PRIi64, optDb, i) : stString_copy(optDb);
+        unsigned int port = optPort == 0 ? 0 : optPort + i;
+        stKVDatabaseConf *conf = NULL;
+        if (optType == stKVDatabaseTypeTokyoCabinet) {
+            conf = stKVDatabaseConf_constructTokyoCabinet(db);
+            typeName = "Tokyo Cabinet";
+        } else if (optType == stKVDatabaseTypeLogFile) {
+            conf = stKVDatabaseConf_constructLogFile(db);
+            typeName = "log file";
+        } else if (optType == stKVDatabaseTypeKyotoTycoon) {
+            conf = stKVDatabaseConf_constructKyotoTycoon(optHost, port, optTimeout,
+                    optMaxKTRecordSize, optMaxKTBulkSetSize, optMaxKTBulkSetNumRecords, db, optName);
+            typeName = "Kyoto Tycoon";
+        } else if (optType == stKVDatabaseTypeMySql) {
+            conf = stKVDatabaseConf_constructMySql(optHost, 0, optUser, optPass, db, "cactusDbTest");
+            typeName = "MySQL";
+        } else if (optType == stKVDatabaseTypeRedis) {
+            conf = stKVDatabaseConf_constructRedis(optHost, port, optMaxRedisBulkSetSize);
+            typeName = "Redis";
+        }
+        stList_append(confs, conf);
+        free(db);
+    }
+    stKVDatabaseConf *conf;
+    if (optShards > 0) {
+        conf = stKVDatabaseConf_constructSharded(confs);
+        fprintf(stderr, "running %s sonLibKVDatabase tests sharded over %" PRIi64 " databases\n", typeName, optShards);
+    } else {
+        conf = stKVDatabaseConf_constructClone(stList_get(confs, 0));
+        fprintf(stderr, "running %s sonLibKVDatabase tests\n", typeName);
     }
+    stList_destruct(confs);
+    stKVDatabaseConf_setCompression(conf, optCompression);
     return conf;
 }
 
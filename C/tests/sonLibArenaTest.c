@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "sonLibGlobalsTest.h"
+
+static void test_stArena_malloc(CuTest *testCase) {
+    stArena *arena = stArena_construct2(1024);
+    CuAssertIntEquals(testCase, 0, stArena_getAllocatedBytes(arena));
+    stList *allocations = stList_construct();
+    for (int64_t i = 0; i < 1000; i++) {
+        int64_t size = st_randomInt(1, i % 10 == 0 ? 2000 : 100); // Some bigger than a block.
+        char *memory = stArena_malloc(arena, size);
+        CuAssertIntEquals(testCase, 0, ((uintptr_t) memory) % 16);
+        memset(memory, (char) i, size);
+        stList_append(allocations, memory);
+        stList_append(allocations, (void *) (intptr_t) size);
+    }
+    // Check nothing was overwritten by later allocations.
+    for (int64_t i = 0; i < 1000; i++) {
+        char *memory = stList_get(allocations, 2 * i);
+        int64_t size = (intptr_t) stList_get(allocations, 2 * i + 1);
+        for (int64_t j = 0; j < size; j++) {
+            CuAssertIntEquals(testCase, (char) i, memory[j]);
+        }
+    }
+    CuAssertTrue(testCase, stArena_getAllocatedBytes(arena) > 1024);
+
+    char *zeroed = stArena_calloc(arena, 10, sizeof(int64_t));
+    for (int64_t i = 0; i < 10 * (int64_t) sizeof(int64_t); i++) {
+        CuAssertIntEquals(testCase, 0, zeroed[i]);
+    }
+    char *string = stArena_copyString(arena, "hello");
+    CuAssertStrEquals(testCase, "hello", string);
+
+    stArena_reset(arena);
+    CuAssertTrue(testCase, stArena_getAllocatedBytes(arena) <= 1024 + 64);
+    CuAssertTrue(testCase, stArena_malloc(arena, 100) != NULL);
+    stList_destruct(allocations);
+    stArena_destruct(arena);
+}
+
+static void test_stPool(CuTest *testCase) {
+    stPool *pool = stPool_construct(3);
+    CuAssertIntEquals(testCase, sizeof(void *), stPool_getElementSize(pool));
+    stPool_destruct(pool);
+
+    stArena *arena = stArena_construct();
+    pool = stPool_construct2(sizeof(int64_t) * 3, arena);
+    stSet *live = stSet_construct();
+    for (int64_t i = 0; i < 10000; i++) {
+        if (stSet_size(live) > 0 && st_random() > 0.6) {
+            void *element = stSet_peek(live);
+            stSet_remove(live, element);
+            stPool_free(pool, element);
+        } else {
+            int64_t *element = stPool_malloc(pool);
+            CuAssertTrue(testCase, stSet_search(live, element) == NULL);
+            element[0] = element[1] = element[2] = i;
+            stSet_insert(live, element);
+        }
+    }
+    // Freed elements are reused, so the live elements never overlap.
+    stSetIterator *it = stSet_getIterator(live);
+    int64_t *element;
+    while ((element = stSet_getNext(it)) != NULL) {
+        CuAssertTrue(testCase, element[0] == element[1] && element[1] == element[2]);
+    }
+    stSet_destructIterator(it);
+    stSet_destruct(live);
+    stPool_destruct(pool);
+    stArena_destruct(arena);
+}
+
+static void test_stIntTuple_constructNInArena(CuTest *testCase) {
+    stArena *arena = stArena_construct();
+    int64_t values[] = { 1, 5, -2 };
+    stIntTuple *tuple = stIntTuple_constructNInArena(3, values, arena);
+    stIntTuple *expected = stIntTuple_constructN(3, values);
+    CuAssertTrue(testCase, stIntTuple_equalsFn(tuple, expected));
+    CuAssertIntEquals(testCase, 0, stIntTuple_length(stIntTuple_constructNInArena(0, NULL, arena)));
+    stIntTuple_destruct(expected);
+    stArena_destruct(arena);
+}
+
+static int pointerEqualKey(const void *key1, const void *key2) {
+    return key1 == key2;
+}
+
+static void test_stHash_constructInArena(CuTest *testCase) {
+    stArena *arena = stArena_construct();
+    stHash *expected = stHash_construct();
+    stHash *hash = stHash_constructInArena(stHash_pointer, pointerEqualKey, NULL, free, arena);
+    for (int64_t i = 0; i < 10000; i++) {
+        void *key = (void *) (intptr_t) st_randomInt(1, 1000);
+        if (st_random() > 0.3) {
+            if (stHash_search(hash, key) == NULL) {
+                stHash_insert(hash, key, st_malloc(1));
+                stHash_insert(expected, key, key);
+            }
+        } else if (stHash_search(hash, key) != NULL) {
+            free(stHash_remove(hash, key));
+            stHash_remove(expected, key);
+        }
+        CuAssertIntEquals(testCase, stHash_size(expected), stHash_size(hash));
+    }
+    stHashIterator *it = stHash_getIterator(expected);
+    void *key;
+    while ((key = stHash_getNext(it)) != NULL) {
+        CuAssertTrue(testCase, stHash_search(hash, key) != NULL);
+    }
+    stHash_destructIterator(it);
+    stHash_destruct(expected);
+    stHash_destruct(hash); // Frees the values.
+    stArena_destruct(arena);
+}
+
+static void test_stSortedSet_constructInArena(CuTest *testCase) {
+    stArena *arena = stArena_construct();
+    stSortedSet *set = stSortedSet_constructInArena((int (*)(const void *, const void *)) stIntTuple_cmpFn,
+            (void (*)(void *)) stIntTuple_destruct, arena);
+    stSortedSet *expected = stSortedSet_construct3((int (*)(const void *, const void *)) stIntTuple_cmpFn,
+            (void (*)(void *)) stIntTuple_destruct);
+    for (int64_t i = 0; i < 10000; i++) {
+        stIntTuple *key = stIntTuple_construct1(st_randomInt(0, 1000));
+        if (st_random() > 0.3) {
+            if (stSortedSet_search(set, key) == NULL) {
+                stSortedSet_insert(set, stIntTuple_construct1(stIntTuple_get(key, 0)));
+                stSortedSet_insert(expected, stIntTuple_construct1(stIntTuple_get(key, 0)));
+            }
+        } else if (stSortedSet_search(set, key) != NULL) {
+            stIntTuple_destruct(stSortedSet_remove(set, key));
+            stIntTuple_destruct(stSortedSet_remove(expected, key));
+        }
+        stIntTuple_destruct(key);
+    }
+    CuAssertTrue(testCase, stSortedSet_equals(set, expected));
+    stSortedSet_destruct(expected);
+    stSortedSet_destruct(set); // Frees the remaining elements.
+    stArena_destruct(arena);
+}
+
+CuSuite* sonLib_stArenaTestSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, test_stArena_malloc);
+    SUITE_ADD_TEST(suite, test_stPool);
+    SUITE_ADD_TEST(suite, test_stIntTuple_constructNInArena);
+    SUITE_ADD_TEST(suite, test_stHash_constructInArena);
+    SUITE_ADD_TEST(suite, test_stSortedSet_constructInArena);
+    return suite;
+}
@@ -11,9 +11,11 @@
 
 #include "sonLibGlobalsTest.h"
 #include "kvDatabaseTestCommon.h"
+#include <pthread.h>
 
 static stCache *cache = NULL;
 static int64_t recordSize;
+static int64_t numShards = 0; // Non-zero to test concurrent caches.
 
 static void teardown() {
     if(cache != NULL) {
@@ -24,7 +26,7 @@ static void teardown() {
 
 static void setup(size_t maxSize) {
     teardown();
-    cache = stCache_construct2(maxSize);
+    cache = numShards > 0 ? stCache_construct3(maxSize, numShards) : stCache_construct2(maxSize);
 }
 
 static void readAndUpdateRecord(CuTest *testCase) {
@@ -236,12 +238,85 @@ static void testMergeRecords(CuTest *testCase) {
     teardown();
 }
 
+/*
+ * Reruns the tests that don't depend on the eviction order with a
+ * concurrent cache.
+ */
+static void testConcurrentCache(CuTest *testCase) {
+    numShards = 7;
+    readAndUpdateRecord(testCase);
+    readAndUpdateRecords(testCase);
+    testMergeRecords(testCase);
+    numShards = 0;
+}
+
+#define THREADS 8
+#define KEYS 200
+#define RECORD_LENGTH 64
+
+struct cacheThreadArgs {
+    int64_t thread;
+    int64_t wrong;
+};
+
+/*
+ * Each record holds bytes that all equal its key, so any torn or
+ * misplaced record shows up when it is read back. Threads overwrite
+ * fragments of shared keys and read them back concurrently.
+ */
+static void *useCache(void *arg) {
+    struct cacheThreadArgs *args = arg;
+    char value[RECORD_LENGTH];
+    for (int64_t i = 0; i < 20000; i++) {
+        int64_t key = (i * 31 + args->thread * 17) % KEYS;
+        memset(value, (char) key, RECORD_LENGTH);
+        int64_t start = (i % 4) * (RECORD_LENGTH / 4);
+        stCache_setRecord(cache, key, start, RECORD_LENGTH / 2, value);
+        int64_t size;
+        char *read = stCache_getRecord(cache, key, 0, INT64_MAX, &size);
+        if (read != NULL) {
+            for (int64_t j = 0; j < size; j++) {
+                if (read[j] != (char) key) {
+                    args->wrong++;
+                    break;
+                }
+            }
+            free(read);
+        }
+    }
+    return NULL;
+}
+
+static void testConcurrentCacheThreads(CuTest *testCase) {
+    size_t maxSize = KEYS * RECORD_LENGTH / 4;
+    cache = stCache_construct3(maxSize, 16);
+    pthread_t threads[THREADS];
+    struct cacheThreadArgs args[THREADS];
+    for (int64_t i = 0; i < THREADS; i++) {
+        args[i].thread = i;
+        args[i].wrong = 0;
+        pthread_create(&threads[i], NULL, useCache, &args[i]);
+    }
+    for (int64_t i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        CuAssertIntEquals(testCase, 0, args[i].wrong);
+    }
+    size_t size = stCache_size(cache);
+    CuAssertTrue(testCase, size <= maxSize);
+    CuAssertTrue(testCase, size > 0);
+    stCache_clear(cache);
+    CuAssertIntEquals(testCase, 0, stCache_size(cache));
+    teardown();
+}
+
 CuSuite* stCacheSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, readAndUpdateRecord);
     SUITE_ADD_TEST(suite, readAndUpdateRecords);
     SUITE_ADD_TEST(suite, limitedSizeCache);
     SUITE_ADD_TEST(suite, testMergeRecords);
+    SUITE_ADD_TEST(suite, testConcurrentCache);
+    SUITE_ADD_TEST(suite, testConcurrentCacheThreads);
 
     return suite;
 }
@@ -12,7 +12,9 @@
  */
 
 #include "sonLibGlobalsTest.h"
+#include "commonC.h"
 #include <time.h>
+#include <zlib.h>
 
 static void test_stCompression_compressAndDecompressP(CuTest *testCase, int64_t rounds, int64_t minSize, int64_t maxSize,
         void *(*compress)(void *, int64_t, int64_t *, int64_t), void *(*decompress)(void *, int64_t, int64_t *)) {
@@ -78,11 +80,474 @@ static void test_stCompression_compressAndDecompress_Big_Zlib(CuTest *testCase)
     test_stCompression_compressAndDecompressP(testCase, 5, 10000000, 50000000, stCompression_compressZlib, stCompression_decompressZlib);
 }
 
+static void *compressFrameSmallBlocks(void *data, int64_t sizeInBytes, int64_t *compressedSizeInBytes, int64_t level) {
+    return stCompression_compressFrame(data, sizeInBytes, compressedSizeInBytes, 1000);
+}
+
+static void *compressFrame(void *data, int64_t sizeInBytes, int64_t *compressedSizeInBytes, int64_t level) {
+    return stCompression_compressFrame(data, sizeInBytes, compressedSizeInBytes, 0);
+}
+
+static void *decompressFrame(void *frame, int64_t frameSizeInBytes, int64_t *sizeInBytes) {
+    return stCompression_decompressFrame(frame, frameSizeInBytes, sizeInBytes);
+}
+
+/*
+ * Does a large number of rounds of frames of small strings, split into many blocks.
+ */
+static void test_stCompression_compressAndDecompress_Lots_Frame(CuTest *testCase) {
+    test_stCompression_compressAndDecompressP(testCase, 1000, 50, 5000, compressFrameSmallBlocks, decompressFrame);
+}
+
+/*
+ * Does a small number of rounds of large strings, with the default block size.
+ */
+static void test_stCompression_compressAndDecompress_Big_Frame(CuTest *testCase) {
+    test_stCompression_compressAndDecompressP(testCase, 5, 10000000, 50000000, compressFrame, decompressFrame);
+}
+
+static void test_stCompression_frameRange(CuTest *testCase) {
+    int64_t size = 100000, frameSize;
+    char *data = st_malloc(size);
+    for (int64_t i = 0; i < size; i++) {
+        data[i] = i % 3 == 0 ? (char) st_randomInt(0, 256) : 'A'; // Some blocks compress, some don't.
+    }
+    for (int64_t i = 50000; i < 60000; i++) {
+        data[i] = (char) st_randomInt(0, 256);
+    }
+    char *frame = stCompression_compressFrame(data, size, &frameSize, 1000);
+    CuAssertTrue(testCase, frameSize < size);
+    CuAssertIntEquals(testCase, size, stCompression_getFrameDataSize(frame, frameSize));
+    char *part = st_malloc(size);
+    for (int64_t i = 0; i < 1000; i++) {
+        int64_t offset = st_randomInt64(0, size), length = st_randomInt64(0, size - offset + 1);
+        stCompression_decompressFrameRange(frame, frameSize, offset, length, part);
+        CuAssertTrue(testCase, memcmp(data + offset, part, length) == 0);
+    }
+    stTry {
+        stCompression_decompressFrameRange(frame, frameSize, size - 10, 11, part);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_idEq(except, ST_COMPRESSION_EXCEPTION_ID));
+    } stTryEnd;
+    free(part);
+    free(frame);
+    free(data);
+}
+
+static void test_stCompression_frameEmpty(CuTest *testCase) {
+    int64_t frameSize, size;
+    void *frame = stCompression_compressFrame("", 0, &frameSize, 0);
+    void *data = stCompression_decompressFrame(frame, frameSize, &size);
+    CuAssertIntEquals(testCase, 0, size);
+    free(data);
+    free(frame);
+}
+
+static void test_stCompression_frameCorrupt(CuTest *testCase) {
+    int64_t size = 10000, frameSize, size2;
+    char *data = st_malloc(size);
+    for (int64_t i = 0; i < size; i++) {
+        data[i] = "ACGT"[(i / 7) % 4];
+    }
+    char *frame = stCompression_compressFrame(data, size, &frameSize, 1000);
+    // A garbled block can't be decompressed, but the other blocks can.
+    memset(frame + frameSize - 20, 0xff, 20);
+    char part[1000];
+    stCompression_decompressFrameRange(frame, frameSize, 0, 1000, part);
+    CuAssertTrue(testCase, memcmp(data, part, 1000) == 0);
+    stTry {
+        free(stCompression_decompressFrame(frame, frameSize, &size2));
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_idEq(except, ST_COMPRESSION_EXCEPTION_ID));
+    } stTryEnd;
+    // Truncated frames, and data that isn't a frame, are rejected before anything is decompressed.
+    stTry {
+        stCompression_getFrameDataSize(frame, frameSize - 1);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_idEq(except, ST_COMPRESSION_EXCEPTION_ID));
+    } stTryEnd;
+    stTry {
+        stCompression_getFrameDataSize(data, size);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_idEq(except, ST_COMPRESSION_EXCEPTION_ID));
+    } stTryEnd;
+    free(frame);
+    free(data);
+}
+
+// A string alternating between repetitive runs that compress and random runs that don't.
+static char *getStreamData(int64_t size) {
+    char *data = st_malloc(size);
+    for (int64_t i = 0; i < size; i++) {
+        data[i] = (i / 100000) % 2 == 0 ? "ACGT"[(i / 7) % 4] : (char) st_randomInt(0, 256);
+    }
+    return data;
+}
+
+// Writes the data to the stream in randomly sized pieces, flushing now and again, and finishes it.
+static void writeStream(stCompressionStream *stream, const char *data, int64_t size) {
+    for (int64_t i = 0; i < size;) {
+        int64_t length = st_randomInt64(0, 300000);
+        length = length < size - i ? length : size - i;
+        stCompressionStream_write(stream, data + i, length);
+        i += length;
+        if (st_random() > 0.9) {
+            stCompressionStream_flush(stream);
+        }
+    }
+    stCompressionStream_finish(stream);
+}
+
+// Reads the stream in randomly sized pieces, checking it gives back the data.
+static void checkStream(CuTest *testCase, stCompressionStream *stream, const char *data, int64_t size) {
+    char *buffer = st_malloc(size + 1);
+    int64_t i = 0;
+    while (1) {
+        int64_t length = stCompressionStream_read(stream, buffer + i, st_randomInt64(1, size + 2 - i));
+        if (length == 0) {
+            break;
+        }
+        i += length;
+    }
+    CuAssertIntEquals(testCase, size, i);
+    CuAssertTrue(testCase, memcmp(data, buffer, size) == 0);
+    free(buffer);
+}
+
+static void test_stCompressionStream_file(CuTest *testCase) {
+    stCompressionType types[] = { stCompressionLZ4, stCompressionZlib, stCompressionGzip };
+    for (int64_t i = 0; i < 3; i++) {
+        int64_t size = st_randomInt64(0, 5000000);
+        char *data = getStreamData(size);
+        FILE *file = tmpfile();
+        stCompressionStream *stream = stCompressionStream_constructFileWriter(types[i], -1, file);
+        writeStream(stream, data, size);
+        stCompressionStream_destruct(stream);
+        CuAssertTrue(testCase, ftell(file) < size * 0.6 + 1000);
+        rewind(file);
+        stream = stCompressionStream_constructFileReader(types[i], file);
+        checkStream(testCase, stream, data, size);
+        stCompressionStream_destruct(stream);
+        fclose(file);
+        free(data);
+    }
+}
+
+static void test_stCompressionStream_kv(CuTest *testCase) {
+    stKVDatabaseConf *conf = stKVDatabaseConf_constructLogFile("sonLibCompressionTestDir");
+    stKVDatabase *database = stKVDatabase_construct(conf, true);
+    stCompressionType types[] = { stCompressionLZ4, stCompressionZlib, stCompressionGzip };
+    for (int64_t i = 0; i < 3; i++) {
+        int64_t size = 5000000;
+        char *data = getStreamData(size);
+        stCompressionStream *stream = stCompressionStream_constructKVWriter(types[i], -1, database, 1000 * i);
+        writeStream(stream, data, size);
+        stCompressionStream_destruct(stream);
+        // The stream is stored in many records, none bigger than a block.
+        int64_t numRecords = 0, recordSize;
+        for (int64_t key = 1000 * i; stKVDatabase_containsRecord(database, key); key++) {
+            free(stKVDatabase_getRecord2(database, key, &recordSize));
+            CuAssertTrue(testCase, recordSize < 1100000);
+            numRecords++;
+        }
+        CuAssertTrue(testCase, numRecords > 1);
+        stream = stCompressionStream_constructKVReader(types[i], database, 1000 * i);
+        checkStream(testCase, stream, data, size);
+        stCompressionStream_destruct(stream);
+        free(data);
+    }
+    stKVDatabase_deleteFromDisk(database);
+    stKVDatabase_destruct(database);
+    stKVDatabaseConf_destruct(conf);
+}
+
+typedef struct _buffer {
+    char *data;
+    int64_t length;
+} Buffer;
+
+static void appendToBuffer(const void *data, int64_t sizeInBytes, void *extraArg) {
+    Buffer *buffer = extraArg;
+    buffer->data = st_realloc(buffer->data, buffer->length + sizeInBytes);
+    memcpy(buffer->data + buffer->length, data, sizeInBytes);
+    buffer->length += sizeInBytes;
+}
+
+static void test_stCompressionStream_zlibCompatible(CuTest *testCase) {
+    int64_t size = 1000000, size2;
+    char *data = getStreamData(size);
+    Buffer buffer = { NULL, 0 };
+    stCompressionStream *stream = stCompressionStream_constructWriter(stCompressionZlib, 9, appendToBuffer, &buffer);
+    writeStream(stream, data, size);
+    stCompressionStream_destruct(stream);
+    char *data2 = stCompression_decompressZlib(buffer.data, buffer.length, &size2);
+    CuAssertIntEquals(testCase, size, size2);
+    CuAssertTrue(testCase, memcmp(data, data2, size) == 0);
+    free(data2);
+    free(buffer.data);
+    free(data);
+}
+
+static void test_stCompressionStream_errors(CuTest *testCase) {
+    stCompressionType types[] = { stCompressionLZ4, stCompressionZlib };
+    for (int64_t i = 0; i < 2; i++) {
+        char *data = getStreamData(100000);
+        FILE *file = tmpfile();
+        stCompressionStream *stream = stCompressionStream_constructFileWriter(types[i], -1, file);
+        stCompressionStream_write(stream, data, 100000);
+        stCompressionStream_flush(stream);
+        // A stream that isn't finished can be read up to the flush, but not to the end.
+        rewind(file);
+        stCompressionStream *reader = stCompressionStream_constructFileReader(types[i], file);
+        char buffer[100001];
+        stTry {
+            stCompressionStream_read(reader, buffer, 100001);
+            CuAssertTrue(testCase, 0);
+        } stCatch(except) {
+            CuAssertTrue(testCase, stExcept_idEq(except, ST_COMPRESSION_EXCEPTION_ID));
+        } stTryEnd;
+        stCompressionStream_destruct(reader);
+        fseek(file, 0, SEEK_END);
+        stCompressionStream_finish(stream);
+        stTry {
+            stCompressionStream_write(stream, data, 1);
+            CuAssertTrue(testCase, 0);
+        } stCatch(except) {
+            CuAssertTrue(testCase, stExcept_idEq(except, ST_COMPRESSION_EXCEPTION_ID));
+        } stTryEnd;
+        stCompressionStream_destruct(stream);
+        fclose(file);
+        free(data);
+    }
+    FILE *file = tmpfile();
+    fputs("not a stream", file);
+    rewind(file);
+    stTry {
+        stCompressionStream_constructFileReader(stCompressionLZ4, file);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_idEq(except, ST_COMPRESSION_EXCEPTION_ID));
+    } stTryEnd;
+    fclose(file);
+}
+
+// Reads the whole of a file.
+static char *readFile(FILE *file, int64_t *size) {
+    char *data = NULL;
+    int64_t length;
+    *size = 0;
+    do {
+        data = st_realloc(data, *size + 100000);
+        length = fread(data + *size, 1, 100000, file);
+        *size += length;
+    } while (length > 0);
+    return data;
+}
+
+static void test_stCompressionStream_gzip(CuTest *testCase) {
+    int64_t size = 10000000, size2;
+    char *data = getStreamData(size);
+    char *fileName = getTempFile();
+
+    // Gzip streams are written as bgzip, which gzip readers can read.
+    FILE *file = st_fopen(fileName, "wb");
+    stCompressionStream *stream = stCompressionStream_constructFileWriter(stCompressionGzip, 6, file);
+    writeStream(stream, data, size);
+    stCompressionStream_destruct(stream);
+    fclose(file);
+    gzFile gz = gzopen(fileName, "rb");
+    char *data2 = st_malloc(size + 1);
+    CuAssertIntEquals(testCase, size, gzread(gz, data2, size + 1));
+    CuAssertTrue(testCase, memcmp(data, data2, size) == 0);
+    gzclose(gz);
+
+    // Bgzip is read in parallel blocks, through a file as well as directly.
+    file = stCompressionStream_openFile(fileName);
+    free(data2);
+    data2 = readFile(file, &size2);
+    fclose(file);
+    CuAssertIntEquals(testCase, size, size2);
+    CuAssertTrue(testCase, memcmp(data, data2, size) == 0);
+    free(data2);
+
+    // As is a corrupt block.
+    file = st_fopen(fileName, "r+b");
+    fseek(file, size / 4, SEEK_SET);
+    fputs("corrupt", file);
+    rewind(file);
+    stream = stCompressionStream_constructFileReader(stCompressionGzip, file);
+    char *buffer = st_malloc(size);
+    stTry {
+        while (stCompressionStream_read(stream, buffer, size) > 0) {
+        }
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_idEq(except, ST_COMPRESSION_EXCEPTION_ID));
+    } stTryEnd;
+    free(buffer);
+    stCompressionStream_destruct(stream);
+    fclose(file);
+
+    // Other gzip files, of several members, as gzip makes when files are concatenated.
+    for (int64_t i = 0; i < 2; i++) {
+        gz = gzopen(fileName, i == 0 ? "wb" : "ab");
+        gzwrite(gz, data + i * (size / 2), size / 2);
+        gzclose(gz);
+    }
+    file = st_fopen(fileName, "rb");
+    stream = stCompressionStream_constructFileReader(stCompressionGzip, file);
+    checkStream(testCase, stream, data, size);
+    stCompressionStream_destruct(stream);
+    fclose(file);
+
+    // Files that aren't compressed are read as they are.
+    for (int64_t i = 0; i < 3; i++) {
+        int64_t length = i == 0 ? 0 : (i == 1 ? 1 : size);
+        file = st_fopen(fileName, "wb");
+        fwrite(data, 1, length, file);
+        fclose(file);
+        file = stCompressionStream_openFile(fileName);
+        data2 = readFile(file, &size2);
+        fclose(file);
+        CuAssertIntEquals(testCase, length, size2);
+        CuAssertTrue(testCase, memcmp(data, data2, length) == 0);
+        free(data2);
+    }
+    removeTempFile(fileName);
+    CuAssertPtrEquals(testCase, NULL, stCompressionStream_openFile("/nonexistent/file.gz"));
+    free(data);
+}
+
+static void test_stCompression_levels(CuTest *testCase) {
+    int64_t size = 3000000;
+    char *data = getStreamData(size);
+    int64_t levels[] = { -20, -2, -1, 0, 1, 4, 9, 12 }, compressedSizes[8];
+    for (int64_t i = 0; i < 8; i++) {
+        int64_t size2;
+        char *compressed = stCompression_compress(data, size, &compressedSizes[i], levels[i]);
+        char *data2 = stCompression_decompress(compressed, compressedSizes[i], &size2);
+        CuAssertIntEquals(testCase, size, size2);
+        CuAssertTrue(testCase, memcmp(data, data2, size) == 0);
+        free(data2);
+        free(compressed);
+    }
+    // Acceleration costs compression, and high compression gains it.
+    CuAssertTrue(testCase, compressedSizes[0] >= compressedSizes[2]);
+    CuAssertTrue(testCase, compressedSizes[2] == compressedSizes[3]);
+    CuAssertTrue(testCase, compressedSizes[6] < compressedSizes[2]);
+    CuAssertTrue(testCase, compressedSizes[7] <= compressedSizes[6]);
+
+    // Streams honour the level too.
+    FILE *file = tmpfile();
+    stCompressionStream *stream = stCompressionStream_constructFileWriter(stCompressionLZ4, 9, file);
+    writeStream(stream, data, size);
+    stCompressionStream_destruct(stream);
+    rewind(file);
+    stream = stCompressionStream_constructFileReader(stCompressionLZ4, file);
+    checkStream(testCase, stream, data, size);
+    stCompressionStream_destruct(stream);
+    fclose(file);
+    free(data);
+}
+
+// Small records with the same structure and much of the same content, as KV records often are.
+static char *getSimilarRecord(int64_t i, int64_t *size) {
+    char *record = stString_print("{\"name\": \"sequence_%" PRIi64 "\", \"species\": \"%s\", \"length\": %" PRIi64
+                                  ", \"strand\": \"%c\", \"source\": \"assembly_hub/chromosome_%" PRIi64 "\","
+                                  " \"flags\": [\"primary\", \"reviewed\"]}",
+                                  i, i % 2 ? "Homo sapiens" : "Mus musculus", st_randomInt64(0, 1000000000),
+                                  i % 3 ? '+' : '-', i % 23);
+    *size = strlen(record);
+    return record;
+}
+
+static void test_stCompression_dictionary(CuTest *testCase) {
+    int64_t numberOfSamples = 200;
+    const void **samples = st_malloc(numberOfSamples * sizeof(void *));
+    int64_t *sampleSizes = st_malloc(numberOfSamples * sizeof(int64_t));
+    for (int64_t i = 0; i < numberOfSamples; i++) {
+        samples[i] = getSimilarRecord(i, &sampleSizes[i]);
+    }
+    stCompressionDictionary *dictionary = stCompressionDictionary_train(samples, sampleSizes, numberOfSamples, 4096);
+    int64_t dictionarySize;
+    stCompressionDictionary_getData(dictionary, &dictionarySize);
+    CuAssertTrue(testCase, dictionarySize > 0 && dictionarySize <= 4096);
+
+    // New records compress much better with the dictionary than without.
+    int64_t levels[] = { -1, -4, 9 };
+    for (int64_t j = 0; j < 3; j++) {
+        int64_t totalSize = 0, totalCompressed = 0, totalWithDictionary = 0;
+        for (int64_t i = 1000; i < 1100; i++) {
+            int64_t size, compressedSize, size2;
+            char *record = getSimilarRecord(i, &size);
+            char *compressed = stCompression_compressWithDictionary(dictionary, record, size, &compressedSize, levels[j]);
+            char *record2 = stCompression_decompressWithDictionary(dictionary, compressed, compressedSize, &size2);
+            CuAssertIntEquals(testCase, size, size2);
+            CuAssertTrue(testCase, memcmp(record, record2, size) == 0);
+            totalSize += size;
+            totalWithDictionary += compressedSize;
+            free(compressed);
+            free(record2);
+            free(stCompression_compress(record, size, &compressedSize, levels[j]));
+            totalCompressed += compressedSize;
+            free(record);
+        }
+        st_logInfo("Level %" PRIi64 ": %" PRIi64 " bytes, %" PRIi64 " compressed, %" PRIi64 " with a dictionary\n",
+                   levels[j], totalSize, totalCompressed, totalWithDictionary);
+        CuAssertTrue(testCase, totalWithDictionary * 2 < totalCompressed);
+    }
+
+    // A dictionary rebuilt from its data decompresses the same records.
+    const void *data = stCompressionDictionary_getData(dictionary, &dictionarySize);
+    stCompressionDictionary *dictionary2 = stCompressionDictionary_construct(data, dictionarySize);
+    char *big = getStreamData(1000000);
+    int64_t sizes[] = { 0, 1, 13, 1000000 };
+    for (int64_t i = 0; i < 4; i++) {
+        int64_t compressedSize, size2;
+        char *compressed = stCompression_compressWithDictionary(dictionary, big, sizes[i], &compressedSize, -1);
+        char *big2 = stCompression_decompressWithDictionary(dictionary2, compressed, compressedSize, &size2);
+        CuAssertIntEquals(testCase, sizes[i], size2);
+        CuAssertTrue(testCase, memcmp(big, big2, size2) == 0);
+        free(big2);
+        free(compressed);
+    }
+    stTry {
+        stCompression_decompressWithDictionary(dictionary, "\xff\xff", 2, &dictionarySize);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_idEq(except, ST_COMPRESSION_EXCEPTION_ID));
+    } stTryEnd;
+    free(big);
+    stCompressionDictionary_destruct(dictionary2);
+    stCompressionDictionary_destruct(dictionary);
+    for (int64_t i = 0; i < numberOfSamples; i++) {
+        free((void *) samples[i]);
+    }
+    free(samples);
+    free(sampleSizes);
+}
+
 CuSuite* sonLib_stCompressionTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, test_stCompression_compressAndDecompress_Lots);
     SUITE_ADD_TEST(suite, test_stCompression_compressAndDecompress_Big);
     SUITE_ADD_TEST(suite, test_stCompression_compressAndDecompress_Lots_Zlib);
         SUITE_ADD_TEST(suite, test_stCompression_compressAndDecompress_Big_Zlib);
+    SUITE_ADD_TEST(suite, test_stCompression_compressAndDecompress_Lots_Frame);
+    SUITE_ADD_TEST(suite, test_stCompression_compressAndDecompress_Big_Frame);
+    SUITE_ADD_TEST(suite, test_stCompression_frameRange);
+    SUITE_ADD_TEST(suite, test_stCompression_frameEmpty);
+    SUITE_ADD_TEST(suite, test_stCompression_frameCorrupt);
+    SUITE_ADD_TEST(suite, test_stCompressionStream_file);
+    SUITE_ADD_TEST(suite, test_stCompressionStream_kv);
+    SUITE_ADD_TEST(suite, test_stCompressionStream_zlibCompatible);
+    SUITE_ADD_TEST(suite, test_stCompressionStream_errors);
+    SUITE_ADD_TEST(suite, test_stCompressionStream_gzip);
+    SUITE_ADD_TEST(suite, test_stCompression_levels);
+    SUITE_ADD_TEST(suite, test_stCompression_dictionary);
     return suite;
 }
@@ -12,6 +12,8 @@
 #include "sonLibCommon.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
 #include "stSafeC.h"
 
 /* test throwing through two levels */
@@ -112,6 +114,83 @@ static void testTryReturn(CuTest *testCase) {
     CuAssertTrue(testCase, val == 12);
 }
 
+/* test throwing and catching in many threads at once, each of which
+ * must only ever see its own exceptions */
+#define NUM_THREADS 8
+#define NUM_ITERATIONS 20000
+
+struct threadArgs {
+    int64_t threadIndex;
+    volatile int64_t caught;
+    volatile int64_t wrong;
+    bool stackEmptyAtEnd;
+};
+
+static void throwNested(int64_t threadIndex, int64_t iteration, int64_t depth) {
+    if (depth == 0) {
+        stThrowNew(ERR2, "%" PRIi64 " %" PRIi64, threadIndex, iteration);
+    }
+    stTry {
+        throwNested(threadIndex, iteration, depth - 1);
+    } stCatch(except) {
+        stThrow(stExcept_newCause(except, ERR1, "%" PRIi64 " %" PRIi64, threadIndex, iteration));
+    } stTryEnd;
+}
+
+static void *throwManyTimes(void *arg) {
+    struct threadArgs *args = arg;
+    char expected[64];
+    for (int64_t i = 0; i < NUM_ITERATIONS; i++) {
+        sprintf(expected, "%" PRIi64 " %" PRIi64, args->threadIndex, i);
+        stTry {
+            throwNested(args->threadIndex, i, i % 4);
+        } stCatch(except) {
+            // Check the whole chain of causes came from this thread.
+            for (stExcept *e = except; e != NULL; e = stExcept_getCause(e)) {
+                if (strcmp(stExcept_getMsg(e), expected) != 0) {
+                    args->wrong++;
+                }
+            }
+            args->caught++;
+        } stTryEnd; // Frees the exception.
+        if (i % 100 == 0) {
+            sched_yield();
+        }
+    }
+    args->stackEmptyAtEnd = _cexceptTOS == NULL;
+    return NULL;
+}
+
+static void testThreads(CuTest *testCase) {
+    pthread_t threads[NUM_THREADS];
+    struct threadArgs args[NUM_THREADS];
+    for (int64_t i = 0; i < NUM_THREADS; i++) {
+        args[i].threadIndex = i;
+        args[i].caught = 0;
+        args[i].wrong = 0;
+        args[i].stackEmptyAtEnd = 0;
+        pthread_create(&threads[i], NULL, throwManyTimes, &args[i]);
+    }
+    // Throw in this thread too, while the others are running.
+    volatile int64_t caught = 0;
+    for (int64_t i = 0; i < NUM_ITERATIONS; i++) {
+        stTry {
+            stThrowNew(ERR1, "main");
+        } stCatch(except) {
+            CuAssertStrEquals(testCase, "main", stExcept_getMsg(except));
+            caught++;
+        } stTryEnd;
+    }
+    for (int64_t i = 0; i < NUM_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        CuAssertIntEquals(testCase, NUM_ITERATIONS, args[i].caught);
+        CuAssertIntEquals(testCase, 0, args[i].wrong);
+        CuAssertTrue(testCase, args[i].stackEmptyAtEnd);
+    }
+    CuAssertIntEquals(testCase, NUM_ITERATIONS, caught);
+    CuAssertTrue(testCase, _cexceptTOS == NULL);
+}
+
 #if 0
 // FIXME: finish this once there are some functions to read in all of a file
 
@@ -151,6 +230,7 @@ CuSuite* sonLib_stExceptTestSuite(void) {
     SUITE_ADD_TEST(suite, testThrow);
     SUITE_ADD_TEST(suite, testOk);
     SUITE_ADD_TEST(suite, testTryReturn);
+    SUITE_ADD_TEST(suite, testThreads);
     return suite;
 }
 
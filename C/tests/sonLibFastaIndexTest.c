@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * Tests of stFastaIndex.
+ */
+
+#include "sonLibGlobalsTest.h"
+#include "commonC.h"
+
+static char *fastaFile = NULL;
+static char *indexFile = NULL;
+
+static void teardown(void) {
+    if (fastaFile != NULL) {
+        removeTempFile(fastaFile);
+        remove(indexFile);
+        free(indexFile);
+        fastaFile = NULL;
+    }
+}
+
+static void setup(const char *fasta) {
+    teardown();
+    fastaFile = getTempFile();
+    indexFile = stString_print("%s.fai", fastaFile);
+    FILE *file = st_fopen(fastaFile, "w");
+    fputs(fasta, file);
+    fclose(file);
+}
+
+static void testIndexFile(CuTest *testCase) {
+    setup("ignored\n>a desc\nACGT\nAC\n\n>b\n>c\r\nAAA\r\nCCC\r\nG");
+    stFastaIndex *index = stFastaIndex_construct(fastaFile);
+    stFastaIndex_destruct(index);
+    stList *lines = stFile_getLinesFromFile(indexFile);
+    CuAssertIntEquals(testCase, 3, stList_length(lines));
+    CuAssertStrEquals(testCase, "a\t6\t16\t4\t5", stList_get(lines, 0));
+    CuAssertStrEquals(testCase, "b\t0\t28\t0\t0", stList_get(lines, 1));
+    CuAssertStrEquals(testCase, "c\t7\t32\t3\t5", stList_get(lines, 2));
+    stList_destruct(lines);
+
+    // The same, read from the index file.
+    for (int64_t i = 0; i < 2; i++) {
+        index = stFastaIndex_construct(fastaFile);
+        CuAssertIntEquals(testCase, 3, stFastaIndex_getNumberOfSequences(index));
+        CuAssertStrEquals(testCase, "b", stFastaIndex_getName(index, 1));
+        CuAssertTrue(testCase, stFastaIndex_containsSequence(index, "c"));
+        CuAssertTrue(testCase, !stFastaIndex_containsSequence(index, "a desc"));
+        CuAssertIntEquals(testCase, 0, stFastaIndex_getLength(index, "b"));
+        char *seq = stFastaIndex_getSequence(index, "a");
+        CuAssertStrEquals(testCase, "ACGTAC", seq);
+        free(seq);
+        seq = stFastaIndex_getSequence(index, "b");
+        CuAssertStrEquals(testCase, "", seq);
+        free(seq);
+        seq = stFastaIndex_getSubsequence(index, "c", 2, 5);
+        CuAssertStrEquals(testCase, "ACCCG", seq);
+        free(seq);
+        stFastaIndex_destruct(index);
+    }
+    teardown();
+}
+
+static void testSubsequences(CuTest *testCase) {
+    for (int64_t test = 0; test < 20; test++) {
+        int64_t numberOfSequences = st_randomInt(1, 10), lineBases = st_randomInt(1, 80);
+        stList *seqs = stList_construct3(0, free);
+        char *fasta = stString_copy("");
+        for (int64_t i = 0; i < numberOfSequences; i++) {
+            int64_t length = st_randomInt(0, 1000);
+            char *seq = st_malloc(length + 1);
+            for (int64_t j = 0; j < length; j++) {
+                seq[j] = "ACGTNacgtn"[st_randomInt(0, 10)];
+            }
+            seq[length] = '\0';
+            stList_append(seqs, seq);
+            char *newFasta = stString_print("%s>seq%" PRIi64 " description\n", fasta, i);
+            free(fasta);
+            fasta = newFasta;
+            for (int64_t j = 0; j < length; j += lineBases) {
+                newFasta = stString_print("%s%.*s\n", fasta, (int) (length - j < lineBases ? length - j : lineBases),
+                                          seq + j);
+                free(fasta);
+                fasta = newFasta;
+            }
+        }
+        setup(fasta);
+        free(fasta);
+        stFastaIndex *index = stFastaIndex_construct(fastaFile);
+        CuAssertIntEquals(testCase, numberOfSequences, stFastaIndex_getNumberOfSequences(index));
+        for (int64_t i = 0; i < numberOfSequences; i++) {
+            char *name = stString_print("seq%" PRIi64, i), *seq = stList_get(seqs, i);
+            int64_t length = strlen(seq);
+            CuAssertStrEquals(testCase, name, stFastaIndex_getName(index, i));
+            CuAssertIntEquals(testCase, length, stFastaIndex_getLength(index, name));
+            for (int64_t j = 0; j < 10; j++) {
+                int64_t start = st_randomInt(0, length + 1);
+                int64_t subLength = st_randomInt(0, length - start + 1);
+                char *subsequence = stFastaIndex_getSubsequence(index, name, start, subLength);
+                CuAssertIntEquals(testCase, subLength, strlen(subsequence));
+                CuAssertTrue(testCase, memcmp(seq + start, subsequence, subLength) == 0);
+                free(subsequence);
+            }
+            free(name);
+        }
+        stFastaIndex_destruct(index);
+        stList_destruct(seqs);
+    }
+    teardown();
+}
+
+static void checkConstructFails(CuTest *testCase, const char *fasta) {
+    setup(fasta);
+    stTry {
+        stFastaIndex_construct(fastaFile);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_idEq(except, ST_FASTA_INDEX_EXCEPTION_ID));
+    } stTryEnd;
+}
+
+static void testErrors(CuTest *testCase) {
+    // Files that can't be indexed.
+    checkConstructFails(testCase, ">a\nACGT\nAC\nACGT\n");
+    checkConstructFails(testCase, ">a\nACGT\nACGTA\n");
+    checkConstructFails(testCase, ">a\nACGT\n\nACGT\n");
+    checkConstructFails(testCase, ">a\nACGT\n>a\nACGT\n");
+    teardown();
+    stTry {
+        stFastaIndex_construct("/nonexistent/file.fa");
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_idEq(except, ST_FASTA_INDEX_EXCEPTION_ID));
+    } stTryEnd;
+
+    // An index that doesn't fit the file.
+    setup(">a\nACGT\nAC\n");
+    FILE *file = st_fopen(indexFile, "w");
+    fprintf(file, "a\t100\t3\t4\t5\n");
+    fclose(file);
+    stTry {
+        stFastaIndex_construct(fastaFile);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_idEq(except, ST_FASTA_INDEX_EXCEPTION_ID));
+    } stTryEnd;
+    remove(indexFile);
+
+    // Ranges outside the sequences.
+    stFastaIndex *index = stFastaIndex_construct(fastaFile);
+    int64_t ranges[][2] = { { -1, 2 }, { 0, 7 }, { 6, 1 }, { 2, -1 }, { 1, INT64_MAX }, { 0, INT64_MAX } };
+    for (int64_t i = 0; i < 6; i++) {
+        stTry {
+            stFastaIndex_getSubsequence(index, "a", ranges[i][0], ranges[i][1]);
+            CuAssertTrue(testCase, 0);
+        } stCatch(except) {
+            CuAssertTrue(testCase, stExcept_idEq(except, ST_FASTA_INDEX_EXCEPTION_ID));
+        } stTryEnd;
+    }
+    stTry {
+        stFastaIndex_getLength(index, "b");
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_idEq(except, ST_FASTA_INDEX_EXCEPTION_ID));
+    } stTryEnd;
+    stFastaIndex_destruct(index);
+    teardown();
+}
+
+CuSuite* sonLib_stFastaIndexTestSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testIndexFile);
+    SUITE_ADD_TEST(suite, testSubsequences);
+    SUITE_ADD_TEST(suite, testErrors);
+    return suite;
+}
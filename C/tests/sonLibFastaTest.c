@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * Tests of the fasta reader in bioioC.c.
+ */
+
+#include "sonLibGlobalsTest.h"
+#include "bioioC.h"
+
+static struct List *seqs = NULL;
+static struct List *seqLengths = NULL;
+static struct List *seqNames = NULL;
+
+static void teardown(void) {
+    if (seqs != NULL) {
+        destructList(seqs);
+        destructList(seqLengths);
+        destructList(seqNames);
+        seqs = NULL;
+    }
+}
+
+static void readString(const char *string, int64_t length) {
+    teardown();
+    seqs = constructEmptyList(0, free);
+    seqLengths = constructEmptyList(0, (void (*)(void *)) destructInt);
+    seqNames = constructEmptyList(0, free);
+    FILE *file = tmpfile();
+    fwrite(string, sizeof(char), length, file);
+    rewind(file);
+    fastaRead(file, seqs, seqLengths, seqNames);
+    fclose(file);
+}
+
+static void checkSeq(CuTest *testCase, int64_t i, const char *name, const char *seq) {
+    CuAssertStrEquals(testCase, name, seqNames->list[i]);
+    CuAssertStrEquals(testCase, seq, seqs->list[i]);
+    CuAssertIntEquals(testCase, strlen(seq), *(int64_t *) seqLengths->list[i]);
+}
+
+static void testFastaRead(CuTest *testCase) {
+    const char *fasta = "ignored\n"
+            ">one two\nACGT\nacgt\n\nNN-N\n"
+            ">empty\n"
+            ">spaced\r\nAC GT\r\n\tTT\r\n"
+            ">inline\nAAA>next\nCC";
+    readString(fasta, strlen(fasta));
+    CuAssertIntEquals(testCase, 5, seqs->length);
+    checkSeq(testCase, 0, "one two", "ACGTacgtNN-N");
+    checkSeq(testCase, 1, "empty", "");
+    checkSeq(testCase, 2, "spaced", "ACGTTT");
+    checkSeq(testCase, 3, "inline", "AAA");
+    checkSeq(testCase, 4, "next", "CC");
+
+    // A header with no sequence, and files without any.
+    readString(">last", 5);
+    CuAssertIntEquals(testCase, 1, seqs->length);
+    checkSeq(testCase, 0, "last", "");
+    readString("", 0);
+    CuAssertIntEquals(testCase, 0, seqs->length);
+    readString("ACGT\n", 5);
+    CuAssertIntEquals(testCase, 0, seqs->length);
+    teardown();
+}
+
+static void testFastaReadLong(CuTest *testCase) {
+    // Headers and lines longer than the blocks the file is read in.
+    int64_t length = 3000000;
+    char *name = st_malloc(length + 1), *seq = st_malloc(length + 1);
+    for (int64_t i = 0; i < length; i++) {
+        name[i] = 'a' + i % 26;
+        seq[i] = "ACGT"[st_randomInt(0, 4)];
+    }
+    name[length] = seq[length] = '\0';
+    char *fasta = st_malloc(2 * length + length / 50 + 100), *c = fasta;
+    c += sprintf(c, ">%s\n", name);
+    for (int64_t i = 0; i < length; i += 61) {
+        int64_t lineLength = i + 61 > length ? length - i : 61;
+        memcpy(c, seq + i, lineLength);
+        c += lineLength;
+        *c++ = '\n';
+    }
+    c += sprintf(c, ">short\n%s\n", "ACGT");
+    readString(fasta, c - fasta);
+    CuAssertIntEquals(testCase, 2, seqs->length);
+    checkSeq(testCase, 0, name, seq);
+    checkSeq(testCase, 1, "short", "ACGT");
+
+    // One long line.
+    sprintf(fasta, ">%s\n%s", "long", seq);
+    readString(fasta, strlen(fasta));
+    checkSeq(testCase, 0, "long", seq);
+    free(fasta);
+    free(name);
+    free(seq);
+    teardown();
+}
+
+static void testFastaReadToMap(CuTest *testCase) {
+    const char *fasta = ">a\nAC\nGT\n>b\nTTTT\n";
+    FILE *file = tmpfile();
+    fputs(fasta, file);
+    rewind(file);
+    stHash *map = fastaReadToMap(file);
+    fclose(file);
+    CuAssertIntEquals(testCase, 2, stHash_size(map));
+    CuAssertStrEquals(testCase, "ACGT", stHash_search(map, "a"));
+    CuAssertStrEquals(testCase, "TTTT", stHash_search(map, "b"));
+    stHash_destruct(map);
+}
+
+static void testFastaReadGzip(CuTest *testCase) {
+    // Compressed files are read through stCompressionStream_openFile.
+    const char *fasta = ">a\nACGT\nAC\n>b\nTTTT\n";
+    char *fileName = getTempFile();
+    FILE *file = st_fopen(fileName, "wb");
+    stCompressionStream *stream = stCompressionStream_constructFileWriter(stCompressionGzip, -1, file);
+    stCompressionStream_write(stream, fasta, strlen(fasta));
+    stCompressionStream_finish(stream);
+    stCompressionStream_destruct(stream);
+    fclose(file);
+    teardown();
+    seqs = constructEmptyList(0, free);
+    seqLengths = constructEmptyList(0, (void (*)(void *)) destructInt);
+    seqNames = constructEmptyList(0, free);
+    file = stCompressionStream_openFile(fileName);
+    fastaRead(file, seqs, seqLengths, seqNames);
+    fclose(file);
+    CuAssertIntEquals(testCase, 2, seqs->length);
+    checkSeq(testCase, 0, "a", "ACGTAC");
+    checkSeq(testCase, 1, "b", "TTTT");
+    removeTempFile(fileName);
+    teardown();
+}
+
+CuSuite* sonLib_fastaTestSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testFastaRead);
+    SUITE_ADD_TEST(suite, testFastaReadLong);
+    SUITE_ADD_TEST(suite, testFastaReadToMap);
+    SUITE_ADD_TEST(suite, testFastaReadGzip);
+    return suite;
+}
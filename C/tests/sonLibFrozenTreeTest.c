@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * Tests of stFrozenTree.
+ */
+
+#include "sonLibGlobalsTest.h"
+
+static void testSmallTree(CuTest *testCase) {
+    stTree *tree = stTree_parseNewickString("((a:1,b:2)c:3,d:4,(e:5)f)g;");
+    stFrozenTree *frozenTree = stFrozenTree_construct(tree);
+    CuAssertIntEquals(testCase, 7, stFrozenTree_getNodeNumber(frozenTree));
+    CuAssertIntEquals(testCase, 4, stFrozenTree_getLeafNumber(frozenTree));
+
+    // Preorder: g c a b d f e
+    const char *labels[] = { "g", "c", "a", "b", "d", "f", "e" };
+    int64_t parents[] = { -1, 0, 1, 1, 0, 0, 5 };
+    int64_t firstChildren[] = { 1, 2, -1, -1, -1, 6, -1 };
+    int64_t nextSiblings[] = { -1, 4, 3, -1, 5, -1, -1 };
+    int64_t childNumbers[] = { 3, 2, 0, 0, 0, 1, 0 };
+    int64_t depths[] = { 0, 1, 2, 2, 1, 1, 2 };
+    int64_t subtreeSizes[] = { 7, 3, 1, 1, 1, 2, 1 };
+    int64_t subtreeLeafNumbers[] = { 4, 2, 1, 1, 1, 1, 1 };
+    double branchLengths[] = { INFINITY, 3, 1, 2, 4, INFINITY, 5 };
+    for (int64_t i = 0; i < 7; i++) {
+        CuAssertStrEquals(testCase, labels[i], stFrozenTree_getLabel(frozenTree, i));
+        CuAssertIntEquals(testCase, parents[i], stFrozenTree_getParent(frozenTree, i));
+        CuAssertIntEquals(testCase, firstChildren[i], stFrozenTree_getFirstChild(frozenTree, i));
+        CuAssertIntEquals(testCase, nextSiblings[i], stFrozenTree_getNextSibling(frozenTree, i));
+        CuAssertIntEquals(testCase, childNumbers[i], stFrozenTree_getChildNumber(frozenTree, i));
+        CuAssertIntEquals(testCase, childNumbers[i] == 0, stFrozenTree_isLeaf(frozenTree, i));
+        CuAssertIntEquals(testCase, depths[i], stFrozenTree_getDepth(frozenTree, i));
+        CuAssertIntEquals(testCase, subtreeSizes[i], stFrozenTree_getSubtreeSize(frozenTree, i));
+        CuAssertIntEquals(testCase, subtreeLeafNumbers[i], stFrozenTree_getSubtreeLeafNumber(frozenTree, i));
+        CuAssertTrue(testCase, branchLengths[i] == stFrozenTree_getBranchLength(frozenTree, i));
+        stTree *node = stFrozenTree_getStTree(frozenTree, i);
+        CuAssertStrEquals(testCase, labels[i], stTree_getLabel(node));
+        CuAssertIntEquals(testCase, i, stFrozenTree_getIndex(frozenTree, node));
+    }
+    CuAssertIntEquals(testCase, 1, stFrozenTree_getLCA(frozenTree, 2, 3));
+    CuAssertIntEquals(testCase, 1, stFrozenTree_getLCA(frozenTree, 1, 3));
+    CuAssertIntEquals(testCase, 0, stFrozenTree_getLCA(frozenTree, 6, 3));
+    CuAssertIntEquals(testCase, 4, stFrozenTree_getLCA(frozenTree, 4, 4));
+    CuAssertTrue(testCase, stFrozenTree_isAncestor(frozenTree, 0, 6));
+    CuAssertTrue(testCase, stFrozenTree_isAncestor(frozenTree, 5, 5));
+    CuAssertTrue(testCase, !stFrozenTree_isAncestor(frozenTree, 1, 4));
+    CuAssertTrue(testCase, !stFrozenTree_isAncestor(frozenTree, 3, 1));
+    CuAssertDblEquals(testCase, 3.0, stFrozenTree_getDistance(frozenTree, 2, 3), 0.0);
+    CuAssertDblEquals(testCase, 2.0, stFrozenTree_getDistance(frozenTree, 1, 3), 0.0);
+    CuAssertDblEquals(testCase, 5.0, stFrozenTree_getDistance(frozenTree, 3, 0), 0.0);
+
+    // A subtree can be frozen, and nodes outside it are not found.
+    stFrozenTree *frozenSubtree = stFrozenTree_construct(stTree_getChild(tree, 0));
+    CuAssertIntEquals(testCase, 3, stFrozenTree_getNodeNumber(frozenSubtree));
+    CuAssertIntEquals(testCase, -1, stFrozenTree_getParent(frozenSubtree, 0));
+    CuAssertIntEquals(testCase, 0, stFrozenTree_getDepth(frozenSubtree, 0));
+    CuAssertIntEquals(testCase, -1, stFrozenTree_getIndex(frozenSubtree, tree));
+    stFrozenTree_destruct(frozenSubtree);
+
+    stFrozenTree_destruct(frozenTree);
+    stTree_destruct(tree);
+
+    // A single unlabelled node.
+    tree = stTree_construct();
+    frozenTree = stFrozenTree_construct(tree);
+    CuAssertIntEquals(testCase, 1, stFrozenTree_getNodeNumber(frozenTree));
+    CuAssertIntEquals(testCase, 1, stFrozenTree_getLeafNumber(frozenTree));
+    CuAssertTrue(testCase, stFrozenTree_getLabel(frozenTree, 0) == NULL);
+    stFrozenTree_destruct(frozenTree);
+    stTree_destruct(tree);
+}
+
+/*
+ * Returns a random tree of the given number of nodes, each with a random branch length, built by
+ * attaching each node to a random earlier one.
+ */
+static stTree *getRandomTree(int64_t nodeNumber, stList *nodes) {
+    for (int64_t i = 0; i < nodeNumber; i++) {
+        stTree *node = stTree_construct();
+        stTree_setBranchLength(node, st_randomInt(0, 100));
+        if (i > 0) {
+            stTree_setParent(node, stList_get(nodes, st_randomInt(0, i)));
+        }
+        stList_append(nodes, node);
+    }
+    return stList_get(nodes, 0);
+}
+
+static double getDistanceToAncestor(stTree *node, stTree *ancestor) {
+    double distance = 0.0;
+    for (; node != ancestor; node = stTree_getParent(node)) {
+        distance += stTree_getBranchLength(node);
+    }
+    return distance;
+}
+
+static void testRandomTrees(CuTest *testCase) {
+    for (int64_t test = 0; test < 100; test++) {
+        stList *nodes = stList_construct();
+        stTree *tree = getRandomTree(st_randomInt(1, 200), nodes);
+        stFrozenTree *frozenTree = stFrozenTree_construct(tree);
+        stFrozenTree *indexedTree = stFrozenTree_construct2(tree, true);
+        CuAssertTrue(testCase, !stFrozenTree_hasLCAIndex(frozenTree));
+        CuAssertTrue(testCase, stFrozenTree_hasLCAIndex(indexedTree));
+        int64_t n = stList_length(nodes);
+        CuAssertIntEquals(testCase, n, stFrozenTree_getNodeNumber(frozenTree));
+        int64_t leafNumber = 0;
+        for (int64_t i = 0; i < n; i++) {
+            // The frozen tree has the same shape as the stTree.
+            stTree *node = stFrozenTree_getStTree(frozenTree, i);
+            CuAssertIntEquals(testCase, i, stFrozenTree_getIndex(frozenTree, node));
+            int64_t parent = stFrozenTree_getParent(frozenTree, i);
+            CuAssertTrue(testCase, parent == -1 ? node == tree : stFrozenTree_getStTree(frozenTree, parent) == stTree_getParent(node));
+            int64_t child = stFrozenTree_getFirstChild(frozenTree, i);
+            for (int64_t j = 0; j < stTree_getChildNumber(node); j++) {
+                CuAssertTrue(testCase, stFrozenTree_getStTree(frozenTree, child) == stTree_getChild(node, j));
+                child = stFrozenTree_getNextSibling(frozenTree, child);
+            }
+            CuAssertIntEquals(testCase, -1, child);
+            CuAssertIntEquals(testCase, stTree_getNumNodes(node), stFrozenTree_getSubtreeSize(frozenTree, i));
+            leafNumber += stFrozenTree_isLeaf(frozenTree, i);
+        }
+        CuAssertIntEquals(testCase, leafNumber, stFrozenTree_getLeafNumber(frozenTree));
+        for (int64_t k = 0; k < 100; k++) {
+            int64_t i = st_randomInt(0, n), j = st_randomInt(0, n);
+            stTree *node1 = stFrozenTree_getStTree(frozenTree, i), *node2 = stFrozenTree_getStTree(frozenTree, j);
+            stTree *mrca = stTree_getMRCA(node1, node2);
+            int64_t lca = stFrozenTree_getLCA(frozenTree, i, j);
+            CuAssertTrue(testCase, stFrozenTree_getStTree(frozenTree, lca) == mrca);
+            CuAssertIntEquals(testCase, lca == i, stFrozenTree_isAncestor(frozenTree, i, j));
+            CuAssertDblEquals(testCase, getDistanceToAncestor(node1, mrca) + getDistanceToAncestor(node2, mrca),
+                              stFrozenTree_getDistance(frozenTree, i, j), 0.0);
+            // The branch lengths are whole numbers, so the indexed distance is exact too.
+            CuAssertIntEquals(testCase, lca, stFrozenTree_getLCA(indexedTree, i, j));
+            CuAssertDblEquals(testCase, stFrozenTree_getDistance(frozenTree, i, j),
+                              stFrozenTree_getDistance(indexedTree, i, j), 0.0);
+        }
+        stFrozenTree_destruct(indexedTree);
+        stFrozenTree_destruct(frozenTree);
+        stTree_destruct(tree);
+        stList_destruct(nodes);
+    }
+}
+
+static void testDeepTree(CuTest *testCase) {
+    // A path, deep enough to overflow the stack if freezing recursed.
+    int64_t depth = 1000000;
+    stTree *tree = stTree_construct(), *node = tree;
+    for (int64_t i = 1; i < depth; i++) {
+        stTree *child = stTree_construct();
+        stTree_setParent(child, node);
+        node = child;
+    }
+    stFrozenTree *frozenTree = stFrozenTree_construct(tree);
+    CuAssertIntEquals(testCase, depth, stFrozenTree_getNodeNumber(frozenTree));
+    CuAssertIntEquals(testCase, 1, stFrozenTree_getLeafNumber(frozenTree));
+    CuAssertIntEquals(testCase, depth - 1, stFrozenTree_getDepth(frozenTree, depth - 1));
+    CuAssertIntEquals(testCase, depth - 1, stFrozenTree_getIndex(frozenTree, node));
+    CuAssertIntEquals(testCase, 10, stFrozenTree_getLCA(frozenTree, 10, depth - 1));
+    stFrozenTree_destruct(frozenTree);
+    frozenTree = stFrozenTree_construct2(tree, true);
+    CuAssertIntEquals(testCase, 10, stFrozenTree_getLCA(frozenTree, depth - 1, 10));
+    CuAssertIntEquals(testCase, depth - 1, stFrozenTree_getLCA(frozenTree, depth - 1, depth - 1));
+    stFrozenTree_destruct(frozenTree);
+    stTree_destruct(tree);
+}
+
+CuSuite* sonLib_stFrozenTreeTestSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testSmallTree);
+    SUITE_ADD_TEST(suite, testRandomTrees);
+    SUITE_ADD_TEST(suite, testDeepTree);
+    return suite;
+}
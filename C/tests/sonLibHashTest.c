@@ -191,6 +191,153 @@ static void test_stHash_testGetValues(CuTest *testCase) {
     testTeardown();
 }
 
+static void test_stHash_openAddressing(CuTest *testCase) {
+    /*
+     * Tests the basic operations on open addressing tables, keyed by memory address and by value.
+     */
+    stHash *byAddress = stHash_constructOpenAddressing();
+    stHash *byValue = stHash_construct4((uint64_t(*)(const void *)) stIntTuple_hashKey,
+            (int(*)(const void *, const void *)) stIntTuple_equalsFn, (void(*)(void *)) stIntTuple_destruct,
+            (void(*)(void *)) stIntTuple_destruct, stHashTypeOpenAddressing);
+    CuAssertTrue(testCase, stHash_getType(byAddress) == stHashTypeOpenAddressing);
+    CuAssertTrue(testCase, stHash_getType(byValue) == stHashTypeOpenAddressing);
+    one = stIntTuple_construct1(0);
+    two = stIntTuple_construct1(1);
+    three = stIntTuple_construct1(2);
+    four = stIntTuple_construct1(3);
+    stHash_insert(byAddress, one, two);
+    stHash_insert(byAddress, three, four);
+    stHash_insert(byValue, one, two);
+    stHash_insert(byValue, three, four);
+    CuAssertIntEquals(testCase, 2, stHash_size(byAddress));
+    CuAssertIntEquals(testCase, 2, stHash_size(byValue));
+
+    stIntTuple *i = stIntTuple_construct1(0);
+    CuAssertTrue(testCase, stHash_search(byAddress, one) == two);
+    CuAssertTrue(testCase, stHash_search(byAddress, i) == NULL);
+    CuAssertTrue(testCase, stHash_search(byValue, i) == two);
+    CuAssertTrue(testCase, stHash_search(byValue, four) == NULL);
+    stIntTuple_destruct(i);
+
+    stHash_insert(byAddress, one, three);
+    CuAssertTrue(testCase, stHash_search(byAddress, one) == three);
+    CuAssertIntEquals(testCase, 2, stHash_size(byAddress));
+    CuAssertTrue(testCase, stHash_remove(byAddress, one) == three);
+    CuAssertTrue(testCase, stHash_search(byAddress, one) == NULL);
+    CuAssertIntEquals(testCase, 1, stHash_size(byAddress));
+
+    stList *keys = stHash_getKeys(byValue);
+    CuAssertIntEquals(testCase, 2, stList_length(keys));
+    CuAssertTrue(testCase, stList_contains(keys, one) && stList_contains(keys, three));
+    stList_destruct(keys);
+    stList *values = stHash_getValues(byValue);
+    CuAssertIntEquals(testCase, 2, stList_length(values));
+    CuAssertTrue(testCase, stList_contains(values, two) && stList_contains(values, four));
+    stList_destruct(values);
+
+    stHashIterator *iterator = stHash_getIterator(byValue);
+    stHashIterator *iteratorCopy = stHash_copyIterator(iterator);
+    for (int64_t j = 0; j < 2; j++) {
+        void *o = stHash_getNext(iterator);
+        CuAssertTrue(testCase, o == one || o == three);
+        CuAssertTrue(testCase, stHash_getNext(iteratorCopy) == o);
+    }
+    CuAssertTrue(testCase, stHash_getNext(iterator) == NULL);
+    CuAssertTrue(testCase, stHash_getNext(iteratorCopy) == NULL);
+    stHash_destructIterator(iterator);
+    stHash_destructIterator(iteratorCopy);
+
+    stHash_destruct(byAddress);
+    stHash_destruct(byValue);
+}
+
+static void test_stHash_openAddressingRemoveAndFreeKey(CuTest *testCase) {
+    stHash *hash3 = stHash_construct4(stHash_pointer, stHash_equalKey, free, free, stHashTypeOpenAddressing);
+    stList *keys = stList_construct();
+    stList *values = stList_construct();
+    int64_t keyNumber = 100000;
+    for (int64_t i = 0; i < keyNumber; i++) {
+        int64_t *key = st_malloc(sizeof(int64_t));
+        int64_t *value = st_malloc(sizeof(int64_t));
+        stList_append(keys, key);
+        stList_append(values, value);
+        stHash_insert(hash3, key, value);
+    }
+    CuAssertIntEquals(testCase, keyNumber, stHash_size(hash3));
+
+    for (int64_t i = 0; i < keyNumber; i++) {
+        int64_t *key = stList_get(keys, i);
+        int64_t *value = stList_get(values, i);
+        CuAssertPtrEquals(testCase, value, stHash_removeAndFreeKey(hash3, key));
+        free(value);
+    }
+    CuAssertIntEquals(testCase, 0, stHash_size(hash3));
+
+    stHash_destruct(hash3);
+    stList_destruct(keys);
+    stList_destruct(values);
+}
+
+static void test_stHash_openAddressingRandom(CuTest *testCase) {
+    /*
+     * Compares random inserts and removes against the chained table, and checks that the most
+     * recently returned key may be removed while iterating.
+     */
+    for (int64_t test = 0; test < 10; test++) {
+        stHash *chained = stHash_construct3((uint64_t(*)(const void *)) stIntTuple_hashKey,
+                (int(*)(const void *, const void *)) stIntTuple_equalsFn, (void(*)(void *)) stIntTuple_destruct, NULL);
+        stHash *open = stHash_construct4((uint64_t(*)(const void *)) stIntTuple_hashKey,
+                (int(*)(const void *, const void *)) stIntTuple_equalsFn, (void(*)(void *)) stIntTuple_destruct, NULL,
+                stHashTypeOpenAddressing);
+        if (test % 2 == 0) {
+            stHash_reserve(open, st_randomInt(0, 10000));
+        }
+        int64_t operations = st_randomInt(0, 100000);
+        for (int64_t i = 0; i < operations; i++) {
+            int64_t k = st_randomInt(0, 1000);
+            stIntTuple *key = stIntTuple_construct1(k);
+            if (st_random() > 0.4) {
+                if (stHash_search(chained, key) != NULL) { // Replacing a key would leak the old one.
+                    stHash_removeAndFreeKey(chained, key);
+                    stHash_removeAndFreeKey(open, key);
+                }
+                stHash_insert(chained, stIntTuple_construct1(k), (void *) (k + 1));
+                stHash_insert(open, key, (void *) (k + 1));
+                key = NULL;
+            } else {
+                CuAssertPtrEquals(testCase, stHash_search(chained, key), stHash_search(open, key));
+                if (stHash_search(chained, key) != NULL) {
+                    stHash_removeAndFreeKey(chained, key);
+                    stHash_removeAndFreeKey(open, key);
+                }
+            }
+            if (key != NULL) {
+                stIntTuple_destruct(key);
+            }
+            CuAssertIntEquals(testCase, stHash_size(chained), stHash_size(open));
+        }
+        for (int64_t k = 0; k < 1000; k++) {
+            stIntTuple *key = stIntTuple_construct1(k);
+            CuAssertPtrEquals(testCase, stHash_search(chained, key), stHash_search(open, key));
+            stIntTuple_destruct(key);
+        }
+        stHashIterator *it = stHash_getIterator(open);
+        stIntTuple *key;
+        int64_t seen = 0, size = stHash_size(open);
+        while ((key = stHash_getNext(it)) != NULL) {
+            void *value = stHash_search(chained, key);
+            CuAssertTrue(testCase, value != NULL);
+            CuAssertPtrEquals(testCase, value, stHash_removeAndFreeKey(open, key));
+            seen++;
+        }
+        stHash_destructIterator(it);
+        CuAssertIntEquals(testCase, size, seen);
+        CuAssertIntEquals(testCase, 0, stHash_size(open));
+        stHash_destruct(chained);
+        stHash_destruct(open);
+    }
+}
+
 CuSuite* sonLib_stHashTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, test_stHash_search);
@@ -202,5 +349,8 @@ CuSuite* sonLib_stHashTestSuite(void) {
     SUITE_ADD_TEST(suite, test_stHash_construct);
     SUITE_ADD_TEST(suite, test_stHash_testGetKeys);
     SUITE_ADD_TEST(suite, test_stHash_testGetValues);
+    SUITE_ADD_TEST(suite, test_stHash_openAddressing);
+    SUITE_ADD_TEST(suite, test_stHash_openAddressingRemoveAndFreeKey);
+    SUITE_ADD_TEST(suite, test_stHash_openAddressingRandom);
     return suite;
 }
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "sonLibGlobalsTest.h"
+
+static void test_stIntHash_basic(CuTest *testCase) {
+    stIntHash *hash = stIntHash_construct();
+    char a, b, c;
+    stIntHash_insert(hash, 0, &a);
+    stIntHash_insert(hash, -5, &b);
+    stIntHash_insert(hash, INT64_MAX, &c);
+    stIntHash_insert(hash, INT64_MIN, NULL);
+    CuAssertIntEquals(testCase, 4, stIntHash_size(hash));
+    CuAssertPtrEquals(testCase, &a, stIntHash_search(hash, 0));
+    CuAssertPtrEquals(testCase, &b, stIntHash_search(hash, -5));
+    CuAssertPtrEquals(testCase, &c, stIntHash_search(hash, INT64_MAX));
+    CuAssertPtrEquals(testCase, NULL, stIntHash_search(hash, INT64_MIN));
+    CuAssertTrue(testCase, stIntHash_contains(hash, INT64_MIN));
+    CuAssertTrue(testCase, !stIntHash_contains(hash, 1));
+    CuAssertPtrEquals(testCase, NULL, stIntHash_search(hash, 1));
+
+    // Overriding an existing key.
+    stIntHash_insert(hash, 0, &c);
+    CuAssertIntEquals(testCase, 4, stIntHash_size(hash));
+    CuAssertPtrEquals(testCase, &c, stIntHash_search(hash, 0));
+
+    CuAssertPtrEquals(testCase, &b, stIntHash_remove(hash, -5));
+    CuAssertPtrEquals(testCase, NULL, stIntHash_remove(hash, -5));
+    CuAssertTrue(testCase, !stIntHash_contains(hash, -5));
+    CuAssertIntEquals(testCase, 3, stIntHash_size(hash));
+    stIntHash_destruct(hash);
+}
+
+static void test_stIntHash_destructValues(CuTest *testCase) {
+    stIntHash *hash = stIntHash_construct2(free);
+    int64_t keys[100];
+    void *values[100];
+    for (int64_t i = 0; i < 100; i++) {
+        keys[i] = i * 1000;
+        values[i] = st_malloc(1);
+    }
+    stIntHash_insertAll(hash, keys, values, 100);
+    CuAssertIntEquals(testCase, 100, stIntHash_size(hash));
+    free(stIntHash_remove(hash, 0));
+    stList *remaining = stIntHash_getValues(hash);
+    CuAssertIntEquals(testCase, 99, stList_length(remaining));
+    CuAssertTrue(testCase, !stList_contains(remaining, values[0]));
+    stList_destruct(remaining);
+    stIntHash_destruct(hash); // Frees the other values.
+}
+
+static void test_stIntHash_random(CuTest *testCase) {
+    /*
+     * Compares against an stHash keyed by stIntTuples, and checks iteration.
+     */
+    for (int64_t test = 0; test < 10; test++) {
+        stHash *expected = stHash_construct3((uint64_t(*)(const void *)) stIntTuple_hashKey,
+                (int(*)(const void *, const void *)) stIntTuple_equalsFn, (void(*)(void *)) stIntTuple_destruct, NULL);
+        stIntHash *hash = stIntHash_construct();
+        if (test % 2 == 0) {
+            stIntHash_reserve(hash, st_randomInt(0, 10000));
+        }
+        int64_t operations = st_randomInt(0, 100000);
+        for (int64_t i = 0; i < operations; i++) {
+            int64_t k = st_randomInt(-500, 500);
+            stIntTuple *key = stIntTuple_construct1(k);
+            if (st_random() > 0.4) {
+                if (stHash_search(expected, key) != NULL) {
+                    stHash_removeAndFreeKey(expected, key);
+                }
+                stHash_insert(expected, stIntTuple_construct1(k), (void *) (size_t) (k + 1000));
+                stIntHash_insert(hash, k, (void *) (size_t) (k + 1000));
+            } else {
+                CuAssertPtrEquals(testCase, stHash_search(expected, key), stIntHash_search(hash, k));
+                if (stHash_search(expected, key) != NULL) {
+                    stHash_removeAndFreeKey(expected, key);
+                    stIntHash_remove(hash, k);
+                }
+            }
+            stIntTuple_destruct(key);
+            CuAssertIntEquals(testCase, stHash_size(expected), stIntHash_size(hash));
+        }
+        stIntHashIterator *it = stIntHash_getIterator(hash);
+        stIntHashIterator *itCopy = stIntHash_copyIterator(it);
+        int64_t key, keyCopy, seen = 0, size = stIntHash_size(hash);
+        void *value;
+        while (stIntHash_getNext(it, &key, &value)) {
+            CuAssertTrue(testCase, stIntHash_getNext(itCopy, &keyCopy, NULL));
+            CuAssertIntEquals(testCase, key, keyCopy);
+            stIntTuple *query = stIntTuple_construct1(key);
+            CuAssertPtrEquals(testCase, stHash_search(expected, query), value);
+            stIntTuple_destruct(query);
+            CuAssertPtrEquals(testCase, value, stIntHash_remove(hash, key));
+            seen++;
+        }
+        CuAssertTrue(testCase, !stIntHash_getNext(itCopy, &keyCopy, NULL));
+        stIntHash_destructIterator(it);
+        stIntHash_destructIterator(itCopy);
+        CuAssertIntEquals(testCase, size, seen);
+        CuAssertIntEquals(testCase, 0, stIntHash_size(hash));
+        stHash_destruct(expected);
+        stIntHash_destruct(hash);
+    }
+}
+
+static void test_stIntSet(CuTest *testCase) {
+    stIntSet *set = stIntSet_construct();
+    int64_t keys[] = { 3, 1, 4, 1, 5, 9, 2, 6, 5, 3, 5 };
+    stIntSet_insertAll(set, keys, 11);
+    CuAssertIntEquals(testCase, 7, stIntSet_size(set));
+    for (int64_t i = 0; i < 11; i++) {
+        CuAssertTrue(testCase, stIntSet_contains(set, keys[i]));
+    }
+    CuAssertTrue(testCase, !stIntSet_contains(set, 7));
+    stIntSet_insert(set, 7);
+    CuAssertTrue(testCase, stIntSet_contains(set, 7));
+    CuAssertTrue(testCase, stIntSet_remove(set, 7));
+    CuAssertTrue(testCase, !stIntSet_remove(set, 7));
+    CuAssertIntEquals(testCase, 7, stIntSet_size(set));
+
+    stIntSetIterator *it = stIntSet_getIterator(set);
+    int64_t key, total = 0, seen = 0;
+    while (stIntSet_getNext(it, &key)) {
+        total += key;
+        seen++;
+    }
+    stIntSet_destructIterator(it);
+    CuAssertIntEquals(testCase, 7, seen);
+    CuAssertIntEquals(testCase, 1 + 2 + 3 + 4 + 5 + 6 + 9, total);
+    stIntSet_destruct(set);
+}
+
+CuSuite* sonLib_stIntHashTestSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, test_stIntHash_basic);
+    SUITE_ADD_TEST(suite, test_stIntHash_destructValues);
+    SUITE_ADD_TEST(suite, test_stIntHash_random);
+    SUITE_ADD_TEST(suite, test_stIntSet);
+    return suite;
+}
@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * Tests of the stKVDatabase caching layer, run in front of an in memory
+ * database that counts the requests that reach it.
+ */
+
+#include "sonLibGlobalsTest.h"
+#include "sonLibKVDatabasePrivate.h"
+#include "sonLibKVDatabaseTestMemory.h"
+
+static MemoryDatabase *memory;
+
+static stKVDatabase *constructDatabase(int64_t cacheSize, int64_t writeBackSize) {
+    stKVDatabase *database = memoryDatabase_construct();
+    memory = memoryDatabase;
+    stKVDatabase_initialise_cache(database, cacheSize, writeBackSize);
+    return database;
+}
+
+static void testReadThrough(CuTest *testCase) {
+    stKVDatabase *database = constructDatabase(1000, 0);
+    stKVDatabase_insertRecord(database, 1, "hello", 6);
+    stKVDatabase_setRecord(database, 2, "world", 6);
+    CuAssertIntEquals(testCase, 2, memory->writes);
+
+    // Written records are cached, so reading them doesn't reach the database.
+    int64_t size;
+    char *record = stKVDatabase_getRecord2(database, 1, &size);
+    CuAssertStrEquals(testCase, "hello", record);
+    CuAssertIntEquals(testCase, 6, size);
+    free(record);
+    record = stKVDatabase_getPartialRecord(database, 2, 1, 5, 6);
+    CuAssertStrEquals(testCase, "orld", record);
+    free(record);
+    CuAssertTrue(testCase, stKVDatabase_containsRecord(database, 2));
+    CuAssertIntEquals(testCase, 0, memory->reads);
+
+    // A record only in the database is read once, then cached.
+    memoryDatabase_setRecord(memory, 3, "cached", 7);
+    for (int64_t i = 0; i < 3; i++) {
+        record = stKVDatabase_getRecord(database, 3);
+        CuAssertStrEquals(testCase, "cached", record);
+        free(record);
+    }
+    CuAssertIntEquals(testCase, 1, memory->reads);
+    int64_t hits, misses;
+    stKVDatabase_getCacheStats(database, &hits, &misses);
+    CuAssertIntEquals(testCase, 4, hits);
+    CuAssertIntEquals(testCase, 1, misses);
+
+    // Missing records are not cached.
+    CuAssertPtrEquals(testCase, NULL, stKVDatabase_getRecord(database, 4));
+    CuAssertPtrEquals(testCase, NULL, stKVDatabase_getRecord(database, 4));
+    CuAssertIntEquals(testCase, 3, memory->reads);
+
+    // Overwriting a record with a shorter one replaces the cached copy.
+    stKVDatabase_updateRecord(database, 3, "new", 4);
+    record = stKVDatabase_getRecord2(database, 3, &size);
+    CuAssertStrEquals(testCase, "new", record);
+    CuAssertIntEquals(testCase, 4, size);
+    free(record);
+
+    // Bulk gets only fetch the records that miss the cache.
+    memoryDatabase_setRecord(memory, 5, "five", 5);
+    stList *keys = stList_construct3(0, free);
+    int64_t keyValues[] = { 1, 5, 4, 2 };
+    for (int64_t i = 0; i < 4; i++) {
+        stList_append(keys, memcpy(st_malloc(sizeof(int64_t)), &keyValues[i], sizeof(int64_t)));
+    }
+    int64_t readsBefore = memory->reads;
+    stList *results = stKVDatabase_bulkGetRecords(database, keys);
+    CuAssertIntEquals(testCase, readsBefore + 2, memory->reads);
+    CuAssertIntEquals(testCase, 4, stList_length(results));
+    CuAssertStrEquals(testCase, "hello", stKVDatabaseBulkResult_getRecord(stList_get(results, 0), &size));
+    CuAssertStrEquals(testCase, "five", stKVDatabaseBulkResult_getRecord(stList_get(results, 1), &size));
+    CuAssertPtrEquals(testCase, NULL, stKVDatabaseBulkResult_getRecord(stList_get(results, 2), &size));
+    CuAssertStrEquals(testCase, "world", stKVDatabaseBulkResult_getRecord(stList_get(results, 3), &size));
+    stList_destruct(results);
+    stList_destruct(keys);
+
+    // Borrowed records are copies, as the cache has nothing to lend.
+    const char *borrowed = stKVDatabase_borrowRecord(database, 1, &size);
+    CuAssertStrEquals(testCase, "hello", borrowed);
+    stKVDatabase_releaseRecord(database, borrowed);
+
+    stKVDatabase_destruct(database);
+}
+
+static void testEviction(CuTest *testCase) {
+    stKVDatabase *database = constructDatabase(100, 0);
+    char value[10];
+    for (int64_t i = 0; i < 100; i++) {
+        memset(value, (char) i, 10);
+        memoryDatabase_setRecord(memory, i, value, 10);
+    }
+    // Only the ten most recently read records fit in the cache.
+    for (int64_t j = 0; j < 2; j++) {
+        for (int64_t i = 0; i < 100; i++) {
+            char *record = stKVDatabase_getRecord(database, i);
+            CuAssertIntEquals(testCase, (char) i, record[9]);
+            free(record);
+        }
+    }
+    CuAssertIntEquals(testCase, 200, memory->reads);
+    for (int64_t i = 90; i < 100; i++) {
+        free(stKVDatabase_getRecord(database, i));
+    }
+    CuAssertIntEquals(testCase, 200, memory->reads);
+    stKVDatabase_destruct(database);
+}
+
+static void testWriteBack(CuTest *testCase) {
+    stKVDatabase *database = constructDatabase(1000, 100);
+    char value[10];
+    for (int64_t i = 0; i < 5; i++) {
+        memset(value, (char) i, 10);
+        stKVDatabase_setRecord(database, i, value, 10);
+        stKVDatabase_setRecord(database, i, value, 10); // Replaces the held back write.
+    }
+    stKVDatabase_updateRecord(database, 0, "updated", 8);
+    CuAssertIntEquals(testCase, 0, memory->writes);
+    CuAssertIntEquals(testCase, 0, memory->reads);
+    char *record = stKVDatabase_getRecord(database, 0);
+    CuAssertStrEquals(testCase, "updated", record);
+    free(record);
+
+    // Updating a record that is nowhere is an error.
+    stTry {
+        stKVDatabase_updateRecord(database, 10, "missing", 8);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_idEq(except, ST_KV_DATABASE_EXCEPTION_ID));
+    } stTryEnd;
+
+    stKVDatabase_flush(database);
+    CuAssertIntEquals(testCase, 1, memory->bulkSets);
+    CuAssertIntEquals(testCase, 5, memory->writes);
+    CuAssertIntEquals(testCase, 5, stKVDatabase_getNumberOfRecords(database));
+
+    // Writes go back by themselves once enough bytes are waiting.
+    for (int64_t i = 0; i < 20; i++) {
+        memset(value, (char) i, 10);
+        stKVDatabase_setRecord(database, i, value, 10);
+    }
+    CuAssertIntEquals(testCase, 3, memory->bulkSets);
+    CuAssertIntEquals(testCase, 20, stKVDatabase_getNumberOfRecords(database));
+
+    // The rest are written when the database is destructed.
+    stKVDatabase_setRecord(database, 30, "last", 5);
+    stKVDatabase_destruct(database);
+    CuAssertIntEquals(testCase, 21, memoryDatabaseRecordsAtDestruct);
+}
+
+static void testRemove(CuTest *testCase) {
+    stKVDatabase *database = constructDatabase(1000, 100);
+    stKVDatabase_setRecord(database, 1, "one", 4);
+    stKVDatabase_setRecord(database, 2, "two", 4);
+    CuAssertTrue(testCase, stKVDatabase_containsRecord(database, 1));
+    stKVDatabase_removeRecord(database, 1);
+    CuAssertTrue(testCase, !stKVDatabase_containsRecord(database, 1));
+    CuAssertPtrEquals(testCase, NULL, stKVDatabase_getRecord(database, 1));
+    CuAssertIntEquals(testCase, 1, stKVDatabase_getNumberOfRecords(database));
+
+    stList *keys = stList_construct3(0, (void (*)(void *)) stIntTuple_destruct);
+    stList_append(keys, stIntTuple_construct1(2));
+    stKVDatabase_bulkRemoveRecords(database, keys);
+    stList_destruct(keys);
+    CuAssertPtrEquals(testCase, NULL, stKVDatabase_getRecord(database, 2));
+    CuAssertIntEquals(testCase, 0, stKVDatabase_getNumberOfRecords(database));
+    stKVDatabase_destruct(database);
+}
+
+static void testConfFromString(CuTest *testCase) {
+    stKVDatabaseConf *conf = stKVDatabaseConf_constructFromString(
+            "<st_kv_database_conf type='tokyo_cabinet'><tokyo_cabinet database_dir='dir' "
+            "cache_size='1000000' cache_write_back_size='1000'/></st_kv_database_conf>");
+    CuAssertIntEquals(testCase, 1000000, stKVDatabaseConf_getCacheSize(conf));
+    CuAssertIntEquals(testCase, 1000, stKVDatabaseConf_getCacheWriteBackSize(conf));
+    stKVDatabaseConf *clone = stKVDatabaseConf_constructClone(conf);
+    CuAssertIntEquals(testCase, 1000000, stKVDatabaseConf_getCacheSize(clone));
+    stKVDatabaseConf_destruct(clone);
+    stKVDatabaseConf_destruct(conf);
+
+    conf = stKVDatabaseConf_constructFromString(
+            "<st_kv_database_conf type='tokyo_cabinet'><tokyo_cabinet database_dir='dir'/></st_kv_database_conf>");
+    CuAssertIntEquals(testCase, 0, stKVDatabaseConf_getCacheSize(conf));
+    stKVDatabaseConf_destruct(conf);
+}
+
+CuSuite* sonLib_stKVDatabaseCacheTestSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testReadThrough);
+    SUITE_ADD_TEST(suite, testEviction);
+    SUITE_ADD_TEST(suite, testWriteBack);
+    SUITE_ADD_TEST(suite, testRemove);
+    SUITE_ADD_TEST(suite, testConfFromString);
+    return suite;
+}
@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * Tests of compressed databases (see stKVDatabaseConf_setCompression), over
+ * log file databases.
+ */
+
+#include "sonLibGlobalsTest.h"
+
+static const char *databaseDir = "sonLibKVDatabaseCompressionTestDir";
+static stKVDatabaseConf *conf = NULL;
+static stKVDatabase *database = NULL;
+
+static void teardown(void) {
+    if (database != NULL) {
+        stKVDatabase_deleteFromDisk(database);
+        stKVDatabase_destruct(database);
+        database = NULL;
+    }
+    if (conf != NULL) {
+        stKVDatabaseConf_destruct(conf);
+        conf = NULL;
+    }
+}
+
+static void setup(int64_t chunkSize) {
+    teardown();
+    conf = stKVDatabaseConf_constructLogFile(databaseDir);
+    stKVDatabaseConf_setCompression(conf, chunkSize);
+    database = stKVDatabase_construct(conf, true);
+}
+
+// A record that compresses well, as most genomic records do.
+static char *getCompressibleRecord(int64_t size) {
+    char *record = st_malloc(size + 1);
+    for (int64_t i = 0; i < size; i++) {
+        record[i] = "ACGT"[(i / 7) % 4];
+    }
+    return record;
+}
+
+static void checkRecord(CuTest *testCase, int64_t key, const char *expected, int64_t expectedSize) {
+    int64_t size;
+    char *record = stKVDatabase_getRecord2(database, key, &size);
+    CuAssertIntEquals(testCase, expectedSize, size);
+    CuAssertTrue(testCase, memcmp(expected, record, size) == 0);
+    free(record);
+}
+
+static void testRecords(CuTest *testCase) {
+    setup(1000);
+    int64_t sizes[] = { 0, 1, 999, 1000, 1001, 100000 };
+    for (int64_t i = 0; i < 6; i++) {
+        char *record = getCompressibleRecord(sizes[i]);
+        stKVDatabase_insertRecord(database, i, record, sizes[i]);
+        checkRecord(testCase, i, record, sizes[i]);
+        free(record);
+    }
+    // Records that don't compress are stored as they are.
+    char random[5000];
+    for (int64_t i = 0; i < 5000; i++) {
+        random[i] = (char) st_randomInt(0, 256);
+    }
+    stKVDatabase_setRecord(database, 10, random, 5000);
+    stKVDatabase_updateRecord(database, 5, random, 5000);
+    checkRecord(testCase, 10, random, 5000);
+    checkRecord(testCase, 5, random, 5000);
+    CuAssertPtrEquals(testCase, NULL, stKVDatabase_getRecord(database, 11));
+
+    // Int64 records are passed through.
+    stKVDatabase_insertInt64(database, 20, 7);
+    CuAssertIntEquals(testCase, 10, stKVDatabase_incrementInt64(database, 20, 3));
+    CuAssertIntEquals(testCase, 10, stKVDatabase_getInt64(database, 20));
+
+    stList *requests = stList_construct3(0, (void (*)(void *)) stKVDatabaseBulkRequest_destruct);
+    char *record = getCompressibleRecord(3000);
+    for (int64_t i = 30; i < 40; i++) {
+        stList_append(requests, stKVDatabaseBulkRequest_constructSetRequest(i, record, 3000));
+    }
+    stKVDatabase_bulkSetRecords(database, requests);
+    stList_destruct(requests);
+    stList *results = stKVDatabase_bulkGetRecordsRange(database, 29, 12);
+    for (int64_t i = 0; i < 12; i++) {
+        int64_t size;
+        char *value = stKVDatabaseBulkResult_getRecord(stList_get(results, i), &size);
+        if (i == 0 || i == 11) {
+            CuAssertPtrEquals(testCase, NULL, value);
+        } else {
+            CuAssertIntEquals(testCase, 3000, size);
+            CuAssertTrue(testCase, memcmp(record, value, size) == 0);
+        }
+    }
+    stList_destruct(results);
+    free(record);
+
+    // The records are still readable after reopening.
+    stKVDatabase_destruct(database);
+    database = stKVDatabase_construct(conf, false);
+    checkRecord(testCase, 10, random, 5000);
+    CuAssertIntEquals(testCase, 18, stKVDatabase_getNumberOfRecords(database));
+    teardown();
+}
+
+static void testPartialRecord(CuTest *testCase) {
+    setup(1000);
+    int64_t size = 100000;
+    char *record = getCompressibleRecord(size);
+    stKVDatabase_setRecord(database, 1, record, size);
+    int64_t ranges[][2] = { { 0, 0 }, { 0, 1 }, { 999, 2 }, { 1000, 1000 }, { 1500, 3000 }, { 99999, 1 }, { 0, 100000 } };
+    for (int64_t i = 0; i < 7; i++) {
+        char *part = stKVDatabase_getPartialRecord(database, 1, ranges[i][0], ranges[i][1], size);
+        CuAssertTrue(testCase, memcmp(record + ranges[i][0], part, ranges[i][1]) == 0);
+        free(part);
+    }
+
+    // Garble the last chunk, by opening the log file without compression. Reads of the other
+    // chunks still succeed, as only the chunks needed are decompressed.
+    stKVDatabase_destruct(database);
+    stKVDatabaseConf_setCompression(conf, 0);
+    database = stKVDatabase_construct(conf, false);
+    int64_t storedSize;
+    char *stored = stKVDatabase_getRecord2(database, 1, &storedSize);
+    CuAssertTrue(testCase, storedSize < size / 10);
+    memset(stored + storedSize - 20, 0xff, 20); // LZ4 can't decode this.
+    stKVDatabase_setRecord(database, 1, stored, storedSize);
+    free(stored);
+    stKVDatabase_destruct(database);
+    stKVDatabaseConf_setCompression(conf, 1000);
+    database = stKVDatabase_construct(conf, false);
+    char *part = stKVDatabase_getPartialRecord(database, 1, 50000, 1000, size);
+    CuAssertTrue(testCase, memcmp(record + 50000, part, 1000) == 0);
+    free(part);
+    stTry {
+        free(stKVDatabase_getRecord(database, 1));
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_idEq(except, ST_KV_DATABASE_EXCEPTION_ID));
+    } stTryEnd;
+    stTry {
+        free(stKVDatabase_getPartialRecord(database, 1, 0, 10, size + 1));
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_idEq(except, ST_KV_DATABASE_EXCEPTION_ID));
+    } stTryEnd;
+    free(record);
+    teardown();
+}
+
+static void testStats(CuTest *testCase) {
+    setup(65536);
+    int64_t uncompressedBytes, compressedBytes;
+    double compressSeconds, decompressSeconds;
+    char *record = getCompressibleRecord(1000000);
+    stKVDatabase_setRecord(database, 1, record, 1000000);
+    free(stKVDatabase_getRecord(database, 1));
+    stKVDatabase_getCompressionStats(database, &uncompressedBytes, &compressedBytes, &compressSeconds,
+                                     &decompressSeconds);
+    CuAssertIntEquals(testCase, 1000000, uncompressedBytes);
+    CuAssertTrue(testCase, compressedBytes > 0 && compressedBytes < uncompressedBytes / 10);
+    CuAssertTrue(testCase, compressSeconds > 0.0 && decompressSeconds > 0.0);
+    teardown();
+
+    // Stats come through a cache, and are zero without compression.
+    conf = stKVDatabaseConf_constructLogFile(databaseDir);
+    stKVDatabaseConf_setCache(conf, 1000000, 0);
+    database = stKVDatabase_construct(conf, true);
+    stKVDatabase_setRecord(database, 1, record, 1000);
+    stKVDatabase_getCompressionStats(database, &uncompressedBytes, &compressedBytes, &compressSeconds,
+                                     &decompressSeconds);
+    CuAssertIntEquals(testCase, 0, uncompressedBytes);
+    teardown();
+    conf = stKVDatabaseConf_constructLogFile(databaseDir);
+    stKVDatabaseConf_setCache(conf, 1000000, 0);
+    stKVDatabaseConf_setCompression(conf, 1000);
+    database = stKVDatabase_construct(conf, true);
+    stKVDatabase_setRecord(database, 1, record, 1000);
+    stKVDatabase_getCompressionStats(database, &uncompressedBytes, &compressedBytes, &compressSeconds,
+                                     &decompressSeconds);
+    CuAssertIntEquals(testCase, 1000, uncompressedBytes);
+    free(record);
+    teardown();
+}
+
+static void testConfFromString(CuTest *testCase) {
+    stKVDatabaseConf *conf = stKVDatabaseConf_constructFromString(
+            "<st_kv_database_conf type='log_file'><log_file database_dir='foo' compression_chunk_size='65536'/>"
+            "</st_kv_database_conf>");
+    CuAssertIntEquals(testCase, 65536, stKVDatabaseConf_getCompressionChunkSize(conf));
+    stKVDatabaseConf *clone = stKVDatabaseConf_constructClone(conf);
+    CuAssertIntEquals(testCase, 65536, stKVDatabaseConf_getCompressionChunkSize(clone));
+    stKVDatabaseConf_destruct(clone);
+    stKVDatabaseConf_destruct(conf);
+    conf = stKVDatabaseConf_constructLogFile("foo");
+    CuAssertIntEquals(testCase, 0, stKVDatabaseConf_getCompressionChunkSize(conf));
+    stTry {
+        stKVDatabaseConf_setCompression(conf, -1);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_idEq(except, ST_KV_DATABASE_EXCEPTION_ID));
+    } stTryEnd;
+    stKVDatabaseConf_destruct(conf);
+}
+
+CuSuite* sonLib_stKVDatabaseCompressionTestSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testRecords);
+    SUITE_ADD_TEST(suite, testPartialRecord);
+    SUITE_ADD_TEST(suite, testStats);
+    SUITE_ADD_TEST(suite, testConfFromString);
+    return suite;
+}
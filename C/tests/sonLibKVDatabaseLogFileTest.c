@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * Tests of the log file database that the general database tests
+ * (kvDatabaseTest.c, run with --type=LogFile) don't cover: reopening,
+ * recovering from a crash part way through an operation, and compaction.
+ */
+
+#define _XOPEN_SOURCE 700 // needed for truncate()
+
+#include <unistd.h>
+#include <sys/stat.h>
+#include "sonLibGlobalsTest.h"
+
+static const char *databaseDir = "sonLibKVDatabaseLogFileTestDir";
+static const char *logPath = "sonLibKVDatabaseLogFileTestDir/data.log";
+static stKVDatabaseConf *conf = NULL;
+static stKVDatabase *database = NULL;
+
+static void teardown(void) {
+    if (database != NULL) {
+        stKVDatabase_deleteFromDisk(database);
+        stKVDatabase_destruct(database);
+        database = NULL;
+    }
+    if (conf != NULL) {
+        stKVDatabaseConf_destruct(conf);
+        conf = NULL;
+    }
+}
+
+static void setup(void) {
+    teardown();
+    conf = stKVDatabaseConf_constructLogFile(databaseDir);
+    database = stKVDatabase_construct(conf, true);
+}
+
+static void reopen(void) {
+    stKVDatabase_destruct(database);
+    database = stKVDatabase_construct(conf, false);
+}
+
+static int64_t getFileLength(void) {
+    struct stat info;
+    stat(logPath, &info);
+    return info.st_size;
+}
+
+// Simulates a crash part way through writing the end of the log.
+static void truncateLog(CuTest *testCase, int64_t length) {
+    stKVDatabase_destruct(database);
+    CuAssertTrue(testCase, truncate(logPath, length) == 0);
+    database = stKVDatabase_construct(conf, false);
+}
+
+static void testReopen(CuTest *testCase) {
+    setup();
+    stKVDatabase_insertRecord(database, 1, "one", 4);
+    stKVDatabase_insertRecord(database, 2, "two", 4);
+    stKVDatabase_insertInt64(database, 3, 33);
+    stKVDatabase_updateRecord(database, 1, "uno", 4);
+    stKVDatabase_removeRecord(database, 2);
+    reopen();
+    CuAssertIntEquals(testCase, 2, stKVDatabase_getNumberOfRecords(database));
+    char *record = stKVDatabase_getRecord(database, 1);
+    CuAssertStrEquals(testCase, "uno", record);
+    free(record);
+    CuAssertTrue(testCase, !stKVDatabase_containsRecord(database, 2));
+    CuAssertIntEquals(testCase, 33, stKVDatabase_getInt64(database, 3));
+    CuAssertIntEquals(testCase, 34, stKVDatabase_incrementInt64(database, 3, 1));
+
+    // A created database starts empty.
+    stKVDatabase_destruct(database);
+    database = stKVDatabase_construct(conf, true);
+    CuAssertIntEquals(testCase, 0, stKVDatabase_getNumberOfRecords(database));
+    teardown();
+}
+
+static void testPartialRecord(CuTest *testCase) {
+    setup();
+    char value[1000];
+    for (int64_t i = 0; i < 1000; i++) {
+        value[i] = (char) i;
+    }
+    stKVDatabase_setRecord(database, 7, value, 1000);
+    char *record = stKVDatabase_getPartialRecord(database, 7, 500, 100, 1000);
+    CuAssertTrue(testCase, memcmp(value + 500, record, 100) == 0);
+    free(record);
+    stTry {
+        stKVDatabase_getPartialRecord(database, 7, 950, 100, 1000);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_idEq(except, ST_KV_DATABASE_EXCEPTION_ID));
+    } stTryEnd;
+    teardown();
+}
+
+static void testCrashRecovery(CuTest *testCase) {
+    setup();
+    stKVDatabase_setRecord(database, 1, "before", 7);
+    stKVDatabase_flush(database);
+    int64_t committedLength = getFileLength();
+
+    // A bulk set cut off part way through is lost completely.
+    stList *requests = stList_construct3(0, (void (*)(void *)) stKVDatabaseBulkRequest_destruct);
+    for (int64_t i = 10; i < 20; i++) {
+        stList_append(requests, stKVDatabaseBulkRequest_constructSetRequest(i, "bulk", 5));
+    }
+    stKVDatabase_bulkSetRecords(database, requests);
+    stList_destruct(requests);
+    int64_t bulkLength = getFileLength();
+    truncateLog(testCase, bulkLength - 1); // All but the commit is intact.
+    CuAssertIntEquals(testCase, 1, stKVDatabase_getNumberOfRecords(database));
+    CuAssertIntEquals(testCase, committedLength, getFileLength());
+    char *record = stKVDatabase_getRecord(database, 1);
+    CuAssertStrEquals(testCase, "before", record);
+    free(record);
+
+    // A corrupted entry is cut off too, with everything after it.
+    stKVDatabase_setRecord(database, 2, "lost", 5);
+    stKVDatabase_setRecord(database, 3, "lost", 5);
+    stKVDatabase_destruct(database);
+    FILE *fileHandle = fopen(logPath, "r+b");
+    fseek(fileHandle, committedLength + 26, SEEK_SET); // In the value of record 2.
+    fputc('X', fileHandle);
+    fclose(fileHandle);
+    database = stKVDatabase_construct(conf, false);
+    CuAssertIntEquals(testCase, 1, stKVDatabase_getNumberOfRecords(database));
+    CuAssertTrue(testCase, !stKVDatabase_containsRecord(database, 2));
+    CuAssertTrue(testCase, !stKVDatabase_containsRecord(database, 3));
+
+    // The database carries on from the last commit.
+    stKVDatabase_setRecord(database, 4, "after", 6);
+    reopen();
+    CuAssertIntEquals(testCase, 2, stKVDatabase_getNumberOfRecords(database));
+    record = stKVDatabase_getRecord(database, 4);
+    CuAssertStrEquals(testCase, "after", record);
+    free(record);
+    teardown();
+}
+
+static void testFailedBulkOperations(CuTest *testCase) {
+    setup();
+    stKVDatabase_insertRecord(database, 1, "one", 4);
+    stList *requests = stList_construct3(0, (void (*)(void *)) stKVDatabaseBulkRequest_destruct);
+    stList_append(requests, stKVDatabaseBulkRequest_constructInsertRequest(2, "two", 4));
+    stList_append(requests, stKVDatabaseBulkRequest_constructInsertRequest(1, "one", 4));
+    stTry {
+        stKVDatabase_bulkSetRecords(database, requests);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_idEq(except, ST_KV_DATABASE_EXCEPTION_ID));
+    } stTryEnd;
+    stList_destruct(requests);
+    CuAssertTrue(testCase, !stKVDatabase_containsRecord(database, 2));
+
+    stList *keys = stList_construct3(0, (void (*)(void *)) stIntTuple_destruct);
+    stList_append(keys, stIntTuple_construct1(1));
+    stList_append(keys, stIntTuple_construct1(5));
+    stTry {
+        stKVDatabase_bulkRemoveRecords(database, keys);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_idEq(except, ST_KV_DATABASE_EXCEPTION_ID));
+    } stTryEnd;
+    stList_destruct(keys);
+    reopen();
+    CuAssertIntEquals(testCase, 1, stKVDatabase_getNumberOfRecords(database));
+    CuAssertTrue(testCase, stKVDatabase_containsRecord(database, 1));
+    teardown();
+}
+
+static void testCompaction(CuTest *testCase) {
+    setup();
+    int64_t size = 1 << 20;
+    char *value = st_malloc(size);
+    // Overwriting the same few records makes most of the log superseded entries.
+    for (int64_t i = 0; i < 40; i++) {
+        memset(value, 'a' + i % 26, size);
+        stKVDatabase_setRecord(database, i % 4, value, size);
+    }
+    CuAssertTrue(testCase, getFileLength() < 20 * size);
+    reopen();
+    CuAssertIntEquals(testCase, 4, stKVDatabase_getNumberOfRecords(database));
+    for (int64_t i = 36; i < 40; i++) {
+        int64_t recordSize;
+        char *record = stKVDatabase_getRecord2(database, i % 4, &recordSize);
+        CuAssertIntEquals(testCase, size, recordSize);
+        CuAssertIntEquals(testCase, 'a' + i % 26, record[size - 1]);
+        free(record);
+    }
+    free(value);
+    teardown();
+}
+
+static void testBorrowRecord(CuTest *testCase) {
+    setup();
+    int64_t size = 1 << 20;
+    char *value = st_malloc(size);
+    memset(value, 'a', size);
+    stKVDatabase_setRecord(database, 0, value, size);
+    int64_t recordSize;
+    const char *record = stKVDatabase_borrowRecord(database, 0, &recordSize);
+    CuAssertIntEquals(testCase, size, recordSize);
+    CuAssertPtrEquals(testCase, NULL, (void *) stKVDatabase_borrowRecord(database, 1, &recordSize));
+
+    // The view is unchanged by overwriting the record, growing the file and compaction.
+    for (int64_t i = 0; i < 40; i++) {
+        memset(value, 'b' + i % 20, size);
+        stKVDatabase_setRecord(database, i % 4, value, size);
+    }
+    CuAssertTrue(testCase, getFileLength() < 20 * size);
+    CuAssertIntEquals(testCase, 'a', record[0]);
+    CuAssertIntEquals(testCase, 'a', record[size - 1]);
+    const char *record2 = stKVDatabase_borrowRecord(database, 0, &recordSize);
+    CuAssertIntEquals(testCase, 'b' + 36 % 20, record2[size - 1]);
+    stKVDatabase_releaseRecord(database, record);
+    stKVDatabase_releaseRecord(database, record2);
+    stKVDatabase_releaseRecord(database, NULL);
+    free(value);
+    teardown();
+}
+
+static void testConfFromString(CuTest *testCase) {
+    stKVDatabaseConf *conf = stKVDatabaseConf_constructFromString(
+            "<st_kv_database_conf type='log_file'><log_file database_dir='foo'/></st_kv_database_conf>");
+    CuAssertTrue(testCase, stKVDatabaseConf_getType(conf) == stKVDatabaseTypeLogFile);
+    CuAssertStrEquals(testCase, "foo", stKVDatabaseConf_getDir(conf));
+    stKVDatabaseConf_destruct(conf);
+}
+
+CuSuite* sonLib_stKVDatabaseLogFileTestSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testReopen);
+    SUITE_ADD_TEST(suite, testPartialRecord);
+    SUITE_ADD_TEST(suite, testCrashRecovery);
+    SUITE_ADD_TEST(suite, testFailedBulkOperations);
+    SUITE_ADD_TEST(suite, testCompaction);
+    SUITE_ADD_TEST(suite, testBorrowRecord);
+    SUITE_ADD_TEST(suite, testConfFromString);
+    return suite;
+}
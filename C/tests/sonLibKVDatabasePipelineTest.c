@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * Tests of the asynchronous stKVDatabase pipeline, run in front of an in
+ * memory database that counts the requests that reach it.
+ */
+
+#include <pthread.h>
+#include "sonLibGlobalsTest.h"
+#include "sonLibKVDatabasePrivate.h"
+#include "sonLibKVDatabaseTestMemory.h"
+
+static stKVDatabase *database;
+static MemoryDatabase *memory;
+
+static void setup(void) {
+    database = memoryDatabase_construct();
+    memory = memoryDatabase;
+}
+
+static void teardown(void) {
+    stKVDatabase_destruct(database);
+}
+
+static void testRequests(CuTest *testCase) {
+    setup();
+    stKVDatabasePipeline *pipeline = stKVDatabasePipeline_construct(database, 10);
+    int64_t size;
+    stList *requests = stList_construct3(0, (void (*)(void *)) stKVDatabaseRequest_destruct);
+    for (int64_t i = 0; i < 100; i++) {
+        stList_append(requests, stKVDatabasePipeline_setRecord(pipeline, i, &i, sizeof(int64_t)));
+    }
+    // Requests are sent in order, so gets see the sets before them.
+    stList *gets = stList_construct3(0, (void (*)(void *)) stKVDatabaseRequest_destruct);
+    for (int64_t i = 0; i < 101; i++) {
+        stList_append(gets, stKVDatabasePipeline_getRecord(pipeline, i));
+    }
+    for (int64_t i = 0; i < 100; i++) {
+        stKVDatabaseRequest_wait(stList_get(requests, i));
+        CuAssertTrue(testCase, stKVDatabaseRequest_done(stList_get(requests, i)));
+        CuAssertPtrEquals(testCase, NULL, stKVDatabaseRequest_getRecord(stList_get(requests, i), &size));
+    }
+    for (int64_t i = 0; i < 100; i++) {
+        int64_t *record = stKVDatabaseRequest_getRecord(stList_get(gets, i), &size);
+        CuAssertIntEquals(testCase, sizeof(int64_t), size);
+        CuAssertIntEquals(testCase, i, *record);
+        free(record);
+        // The record is only returned once.
+        CuAssertPtrEquals(testCase, NULL, stKVDatabaseRequest_getRecord(stList_get(gets, i), &size));
+    }
+    CuAssertPtrEquals(testCase, NULL, stKVDatabaseRequest_getRecord(stList_get(gets, 100), &size));
+
+    // The requests went as bulk requests of at most ten.
+    CuAssertTrue(testCase, memory->bulkSets >= 10);
+    CuAssertTrue(testCase, memory->bulkGets >= 11);
+    CuAssertIntEquals(testCase, 100, memory->writes);
+
+    // Removes, then gets of the removed records.
+    for (int64_t i = 0; i < 50; i++) {
+        stKVDatabaseRequest_destruct(stKVDatabasePipeline_removeRecord(pipeline, i));
+    }
+    stKVDatabaseRequest *request = stKVDatabasePipeline_getRecord(pipeline, 10);
+    stKVDatabasePipeline_wait(pipeline);
+    CuAssertTrue(testCase, stKVDatabaseRequest_done(request));
+    CuAssertPtrEquals(testCase, NULL, stKVDatabaseRequest_getRecord(request, &size));
+    stKVDatabaseRequest_destruct(request);
+    CuAssertIntEquals(testCase, 50, stIntHash_size(memory->records));
+
+    stList_destruct(requests);
+    stList_destruct(gets);
+    stKVDatabasePipeline_destruct(pipeline);
+    teardown();
+}
+
+static void testFailures(CuTest *testCase) {
+    setup();
+    memory->failKey = 5;
+    stKVDatabasePipeline *pipeline = stKVDatabasePipeline_construct(database, 100);
+    stList *requests = stList_construct3(0, (void (*)(void *)) stKVDatabaseRequest_destruct);
+    for (int64_t i = 0; i < 10; i++) {
+        stList_append(requests, stKVDatabasePipeline_setRecord(pipeline, i, "value", 6));
+    }
+    stList_append(requests, stKVDatabasePipeline_removeRecord(pipeline, 20)); // Doesn't exist.
+    stList_append(requests, stKVDatabasePipeline_getRecord(pipeline, 5));
+    stList_append(requests, stKVDatabasePipeline_getRecord(pipeline, 6));
+
+    // Only the requests that fail throw, the rest of the batch succeeds.
+    for (int64_t i = 0; i < stList_length(requests); i++) {
+        volatile bool failed = 0;
+        stTry {
+            stKVDatabaseRequest_wait(stList_get(requests, i));
+        } stCatch(except) {
+            CuAssertTrue(testCase, stExcept_idEq(except, ST_KV_DATABASE_EXCEPTION_ID));
+            failed = 1;
+        } stTryEnd;
+        CuAssertIntEquals(testCase, i == 5 || i == 10 || i == 11, failed);
+    }
+    int64_t size;
+    char *record = stKVDatabaseRequest_getRecord(stList_get(requests, 12), &size);
+    CuAssertStrEquals(testCase, "value", record);
+    free(record);
+    CuAssertIntEquals(testCase, 9, stIntHash_size(memory->records));
+
+    // Destructing a request ignores its failure.
+    stKVDatabaseRequest_destruct(stKVDatabasePipeline_getRecord(pipeline, 5));
+
+    stList_destruct(requests);
+    stKVDatabasePipeline_destruct(pipeline);
+    stTry {
+        stKVDatabasePipeline_construct(database, 0);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_idEq(except, ST_KV_DATABASE_EXCEPTION_ID));
+    } stTryEnd;
+    teardown();
+}
+
+static void testDestructSendsQueued(CuTest *testCase) {
+    setup();
+    memory->latency = 100;
+    stKVDatabasePipeline *pipeline = stKVDatabasePipeline_construct(database, 3);
+    stList *requests = stList_construct3(0, (void (*)(void *)) stKVDatabaseRequest_destruct);
+    for (int64_t i = 0; i < 100; i++) {
+        stList_append(requests, stKVDatabasePipeline_setRecord(pipeline, i, "value", 6));
+    }
+    stKVDatabasePipeline_destruct(pipeline);
+    CuAssertIntEquals(testCase, 100, stIntHash_size(memory->records));
+    for (int64_t i = 0; i < 100; i++) {
+        CuAssertTrue(testCase, stKVDatabaseRequest_done(stList_get(requests, i)));
+        stKVDatabaseRequest_wait(stList_get(requests, i));
+    }
+    stList_destruct(requests);
+    teardown();
+}
+
+struct submitter {
+    stKVDatabasePipeline *pipeline;
+    int64_t firstKey;
+};
+
+static void *submitRequests(void *arg) {
+    struct submitter *submitter = arg;
+    for (int64_t i = submitter->firstKey; i < submitter->firstKey + 200; i++) {
+        stKVDatabaseRequest_destruct(stKVDatabasePipeline_setRecord(submitter->pipeline, i, &i, sizeof(int64_t)));
+        stKVDatabaseRequest *request = stKVDatabasePipeline_getRecord(submitter->pipeline, i);
+        int64_t size;
+        int64_t *record = stKVDatabaseRequest_getRecord(request, &size);
+        if (record == NULL || *record != i) {
+            st_errAbort("pipelined get returned the wrong record");
+        }
+        free(record);
+        stKVDatabaseRequest_destruct(request);
+    }
+    return NULL;
+}
+
+static void testThreads(CuTest *testCase) {
+    setup();
+    stKVDatabasePipeline *pipeline = stKVDatabasePipeline_construct(database, 16);
+    pthread_t threads[4];
+    struct submitter submitters[4];
+    for (int64_t i = 0; i < 4; i++) {
+        submitters[i].pipeline = pipeline;
+        submitters[i].firstKey = i * 1000;
+        pthread_create(&threads[i], NULL, submitRequests, &submitters[i]);
+    }
+    for (int64_t i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    stKVDatabasePipeline_destruct(pipeline);
+    CuAssertIntEquals(testCase, 800, stIntHash_size(memory->records));
+    teardown();
+}
+
+CuSuite* sonLib_stKVDatabasePipelineTestSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testRequests);
+    SUITE_ADD_TEST(suite, testFailures);
+    SUITE_ADD_TEST(suite, testDestructSendsQueued);
+    SUITE_ADD_TEST(suite, testThreads);
+    return suite;
+}
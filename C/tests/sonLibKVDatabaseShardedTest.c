@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * Tests of the sharded database, over log file databases, that the general
+ * database tests (kvDatabaseTest.c, run with --shards=n) don't cover: how the
+ * keys are spread over the shards, and adding a shard.
+ */
+
+#include "sonLibGlobalsTest.h"
+
+static stKVDatabaseConf *conf = NULL;
+static stKVDatabase *database = NULL;
+
+static stKVDatabaseConf *constructShardConf(int64_t shard) {
+    char *dir = stString_print("sonLibKVDatabaseShardedTestDir_%" PRIi64, shard);
+    stKVDatabaseConf *shardConf = stKVDatabaseConf_constructLogFile(dir);
+    free(dir);
+    return shardConf;
+}
+
+static stKVDatabaseConf *constructConf(int64_t numShards) {
+    stList *shardConfs = stList_construct3(0, (void (*)(void *)) stKVDatabaseConf_destruct);
+    for (int64_t i = 0; i < numShards; i++) {
+        stList_append(shardConfs, constructShardConf(i));
+    }
+    stKVDatabaseConf *conf = stKVDatabaseConf_constructSharded(shardConfs);
+    stList_destruct(shardConfs);
+    return conf;
+}
+
+static void teardown(void) {
+    if (database != NULL) {
+        stKVDatabase_deleteFromDisk(database);
+        stKVDatabase_destruct(database);
+        database = NULL;
+    }
+    if (conf != NULL) {
+        stKVDatabaseConf_destruct(conf);
+        conf = NULL;
+    }
+}
+
+static void setup(int64_t numShards) {
+    teardown();
+    conf = constructConf(numShards);
+    database = stKVDatabase_construct(conf, true);
+}
+
+static void setRecords(int64_t numRecords) {
+    stList *requests = stList_construct3(0, (void (*)(void *)) stKVDatabaseBulkRequest_destruct);
+    for (int64_t i = 0; i < numRecords; i++) {
+        stList_append(requests, stKVDatabaseBulkRequest_constructSetRequest(i, &i, sizeof(int64_t)));
+    }
+    stKVDatabase_bulkSetRecords(database, requests);
+    stList_destruct(requests);
+}
+
+static int64_t countFound(int64_t numRecords) {
+    int64_t found = 0;
+    for (int64_t i = 0; i < numRecords; i++) {
+        found += stKVDatabase_containsRecord(database, i);
+    }
+    return found;
+}
+
+static void testSpread(CuTest *testCase) {
+    setup(4);
+    setRecords(1000);
+    CuAssertIntEquals(testCase, 1000, stKVDatabase_getNumberOfRecords(database));
+    stKVDatabase_destruct(database);
+    database = NULL;
+
+    // Every shard has roughly a quarter of the records.
+    for (int64_t i = 0; i < 4; i++) {
+        stKVDatabase *shard = stKVDatabase_construct(stKVDatabaseConf_getShard(conf, i), false);
+        int64_t numRecords = stKVDatabase_getNumberOfRecords(shard);
+        CuAssertTrue(testCase, numRecords > 150 && numRecords < 350);
+        stKVDatabase_destruct(shard);
+    }
+    database = stKVDatabase_construct(conf, false);
+    CuAssertIntEquals(testCase, 1000, countFound(1000));
+    teardown();
+}
+
+static void testBulkRequests(CuTest *testCase) {
+    setup(3);
+    setRecords(1000);
+
+    // Results come back in the order of the keys, whatever shards they came from.
+    stList *keys = stList_construct3(0, free);
+    for (int64_t i = 1100; i >= 0; i -= 3) {
+        int64_t *key = st_malloc(sizeof(int64_t));
+        *key = i;
+        stList_append(keys, key);
+    }
+    stList *results = stKVDatabase_bulkGetRecords(database, keys);
+    CuAssertIntEquals(testCase, stList_length(keys), stList_length(results));
+    for (int64_t i = 0; i < stList_length(keys); i++) {
+        int64_t key = *(int64_t *) stList_get(keys, i), size;
+        int64_t *record = stKVDatabaseBulkResult_getRecord(stList_get(results, i), &size);
+        if (key < 1000) {
+            CuAssertIntEquals(testCase, sizeof(int64_t), size);
+            CuAssertIntEquals(testCase, key, *record);
+        } else {
+            CuAssertPtrEquals(testCase, NULL, record);
+        }
+    }
+    stList_destruct(results);
+    stList_destruct(keys);
+
+    results = stKVDatabase_bulkGetRecordsRange(database, 500, 10);
+    for (int64_t i = 0; i < 10; i++) {
+        int64_t size;
+        int64_t *record = stKVDatabaseBulkResult_getRecord(stList_get(results, i), &size);
+        CuAssertIntEquals(testCase, 500 + i, *record);
+    }
+    stList_destruct(results);
+
+    stList *tuples = stList_construct3(0, (void (*)(void *)) stIntTuple_destruct);
+    for (int64_t i = 0; i < 1000; i += 2) {
+        stList_append(tuples, stIntTuple_construct1(i));
+    }
+    stKVDatabase_bulkRemoveRecords(database, tuples);
+    stList_destruct(tuples);
+    CuAssertIntEquals(testCase, 500, stKVDatabase_getNumberOfRecords(database));
+    CuAssertIntEquals(testCase, 500, countFound(1000));
+
+    // A shard failing fails the bulk request.
+    stList *requests = stList_construct3(0, (void (*)(void *)) stKVDatabaseBulkRequest_destruct);
+    stList_append(requests, stKVDatabaseBulkRequest_constructInsertRequest(1, "one", 4));
+    stTry {
+        stKVDatabase_bulkSetRecords(database, requests);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_idEq(except, ST_KV_DATABASE_EXCEPTION_ID));
+    } stTryEnd;
+    stList_destruct(requests);
+    teardown();
+}
+
+static void testRecords(CuTest *testCase) {
+    setup(2);
+    stKVDatabase_insertRecord(database, 1, "one", 4);
+    stKVDatabase_insertInt64(database, 2, 20);
+    CuAssertIntEquals(testCase, 25, stKVDatabase_incrementInt64(database, 2, 5));
+    stKVDatabase_updateRecord(database, 1, "uno", 4);
+    char *record = stKVDatabase_getRecord(database, 1);
+    CuAssertStrEquals(testCase, "uno", record);
+    free(record);
+    record = stKVDatabase_getPartialRecord(database, 1, 1, 2, 4);
+    CuAssertTrue(testCase, memcmp(record, "no", 2) == 0);
+    free(record);
+
+    int64_t size;
+    const char *view = stKVDatabase_borrowRecord(database, 1, &size);
+    CuAssertIntEquals(testCase, 4, size);
+    CuAssertStrEquals(testCase, "uno", view);
+    stKVDatabase_releaseRecord(database, view);
+
+    // The shards give the same view each time the key is borrowed, so it must be released as often.
+    const char *view1 = stKVDatabase_borrowRecord(database, 1, &size);
+    const char *view2 = stKVDatabase_borrowRecord(database, 1, &size);
+    CuAssertTrue(testCase, view1 == view2);
+    stKVDatabase_releaseRecord(database, view1);
+    CuAssertStrEquals(testCase, "uno", view2);
+    stKVDatabase_releaseRecord(database, view2);
+    stTry {
+        stKVDatabase_releaseRecord(database, view2);
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_idEq(except, ST_KV_DATABASE_EXCEPTION_ID));
+    } stTryEnd;
+
+    stKVDatabase_removeRecord(database, 1);
+    CuAssertTrue(testCase, !stKVDatabase_containsRecord(database, 1));
+    CuAssertIntEquals(testCase, 1, stKVDatabase_getNumberOfRecords(database));
+    stKVDatabase_flush(database);
+    teardown();
+}
+
+static void testAddShard(CuTest *testCase) {
+    setup(4);
+    setRecords(1000);
+    stKVDatabase_destruct(database);
+    stKVDatabaseConf_destruct(conf);
+    conf = constructShardConf(4);
+    stKVDatabase_destruct(stKVDatabase_construct(conf, true));
+    stKVDatabaseConf_destruct(conf);
+
+    // With a fifth shard about a fifth of the keys belong to it, and the rest are found where they were.
+    conf = constructConf(5);
+    database = stKVDatabase_construct(conf, false);
+    int64_t found = countFound(1000);
+    CuAssertTrue(testCase, found > 700 && found < 900);
+    CuAssertIntEquals(testCase, 1000, stKVDatabase_getNumberOfRecords(database));
+    teardown();
+}
+
+static void testConfFromString(CuTest *testCase) {
+    stKVDatabaseConf *conf = stKVDatabaseConf_constructFromString(
+            "<st_kv_database_conf type='sharded'><sharded cache_size='1000'>"
+            "<st_kv_database_conf type='log_file'><log_file database_dir='foo'/></st_kv_database_conf>"
+            "<st_kv_database_conf type='redis'><redis host='localhost' port='6380'/></st_kv_database_conf>"
+            "</sharded></st_kv_database_conf>");
+    CuAssertTrue(testCase, stKVDatabaseConf_getType(conf) == stKVDatabaseTypeSharded);
+    CuAssertIntEquals(testCase, 1000, stKVDatabaseConf_getCacheSize(conf));
+    stKVDatabaseConf *clone = stKVDatabaseConf_constructClone(conf);
+    stKVDatabaseConf_destruct(conf);
+    CuAssertIntEquals(testCase, 2, stKVDatabaseConf_getNumberOfShards(clone));
+    CuAssertTrue(testCase, stKVDatabaseConf_getType(stKVDatabaseConf_getShard(clone, 0)) == stKVDatabaseTypeLogFile);
+    CuAssertStrEquals(testCase, "foo", stKVDatabaseConf_getDir(stKVDatabaseConf_getShard(clone, 0)));
+    CuAssertIntEquals(testCase, 6380, stKVDatabaseConf_getPort(stKVDatabaseConf_getShard(clone, 1)));
+    stKVDatabaseConf_destruct(clone);
+
+    // Only sharded databases contain other database confs.
+    stTry {
+        stKVDatabaseConf_constructFromString(
+                "<st_kv_database_conf type='log_file'><log_file database_dir='foo'/>"
+                "<st_kv_database_conf type='log_file'><log_file database_dir='bar'/></st_kv_database_conf>"
+                "</st_kv_database_conf>");
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_idEq(except, ST_KV_DATABASE_EXCEPTION_ID));
+    } stTryEnd;
+}
+
+CuSuite* sonLib_stKVDatabaseShardedTestSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testSpread);
+    SUITE_ADD_TEST(suite, testBulkRequests);
+    SUITE_ADD_TEST(suite, testRecords);
+    SUITE_ADD_TEST(suite, testAddShard);
+    SUITE_ADD_TEST(suite, testConfFromString);
+    return suite;
+}
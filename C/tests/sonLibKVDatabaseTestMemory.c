@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * A simple in memory database for testing the layers that sit in front of a
+ * database, see sonLibKVDatabaseTestMemory.h.
+ */
+
+#define _POSIX_C_SOURCE 199309L // needed for nanosleep()
+
+#include <time.h>
+#include "sonLibGlobalsTest.h"
+#include "sonLibKVDatabasePrivate.h"
+#include "sonLibKVDatabaseTestMemory.h"
+
+MemoryDatabase *memoryDatabase;
+int64_t memoryDatabaseRecordsAtDestruct;
+
+// Simulates the round trip to a server.
+static void roundTrip(MemoryDatabase *memory) {
+    if (memory->latency > 0) {
+        struct timespec t = { memory->latency / 1000000, memory->latency % 1000000 * 1000 };
+        nanosleep(&t, NULL);
+    }
+}
+
+// Fails requests involving the fail key.
+static void checkKey(MemoryDatabase *memory, int64_t key) {
+    if (key == memory->failKey && key != INT64_MIN) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "request for the fail key %" PRIi64, key);
+    }
+}
+
+static void request(MemoryDatabase *memory, int64_t key) {
+    roundTrip(memory);
+    checkKey(memory, key);
+}
+
+static void memory_destruct(stKVDatabase *database) {
+    MemoryDatabase *memory = database->dbImpl;
+    memoryDatabaseRecordsAtDestruct = stIntHash_size(memory->records);
+    stIntHash_destruct(memory->records);
+    if (memoryDatabase == memory) {
+        memoryDatabase = NULL;
+    }
+    free(memory);
+}
+
+static bool memory_containsRecord(stKVDatabase *database, int64_t key) {
+    MemoryDatabase *memory = database->dbImpl;
+    request(memory, key);
+    memory->reads++;
+    return stIntHash_contains(memory->records, key);
+}
+
+static void setRecord(MemoryDatabase *memory, int64_t key, const void *value, int64_t sizeOfRecord) {
+    memory->writes++;
+    stKVDatabaseBulkResult *record = stIntHash_remove(memory->records, key);
+    if (record != NULL) {
+        stKVDatabaseBulkResult_destruct(record);
+    }
+    stIntHash_insert(memory->records, key, stKVDatabaseBulkResult_construct(
+            memcpy(st_malloc(sizeOfRecord), value, sizeOfRecord), sizeOfRecord));
+}
+
+static void memory_setRecord(stKVDatabase *database, int64_t key, const void *value, int64_t sizeOfRecord) {
+    request(database->dbImpl, key);
+    setRecord(database->dbImpl, key, value, sizeOfRecord);
+}
+
+static void memory_insertRecord(stKVDatabase *database, int64_t key, const void *value, int64_t sizeOfRecord) {
+    MemoryDatabase *memory = database->dbImpl;
+    request(memory, key);
+    if (stIntHash_contains(memory->records, key)) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "key already exists %" PRIi64, key);
+    }
+    setRecord(memory, key, value, sizeOfRecord);
+}
+
+static void memory_updateRecord(stKVDatabase *database, int64_t key, const void *value, int64_t sizeOfRecord) {
+    MemoryDatabase *memory = database->dbImpl;
+    request(memory, key);
+    if (!stIntHash_contains(memory->records, key)) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "key does not exist %" PRIi64, key);
+    }
+    setRecord(memory, key, value, sizeOfRecord);
+}
+
+// Bulk requests are one round trip, and fail as a whole.
+static void memory_bulkSetRecords(stKVDatabase *database, stList *records) {
+    MemoryDatabase *memory = database->dbImpl;
+    roundTrip(memory);
+    for (int64_t i = 0; i < stList_length(records); i++) {
+        checkKey(memory, ((stKVDatabaseBulkRequest *) stList_get(records, i))->key);
+    }
+    memory->bulkSets++;
+    for (int64_t i = 0; i < stList_length(records); i++) {
+        stKVDatabaseBulkRequest *request = stList_get(records, i);
+        setRecord(memory, request->key, request->value, request->size);
+    }
+}
+
+static void *getRecord2(MemoryDatabase *memory, int64_t key, int64_t *recordSize) {
+    memory->reads++;
+    stKVDatabaseBulkResult *record = stIntHash_search(memory->records, key);
+    if (record == NULL) {
+        return NULL;
+    }
+    *recordSize = record->size;
+    return memcpy(st_malloc(record->size), record->value, record->size);
+}
+
+static void *memory_getRecord2(stKVDatabase *database, int64_t key, int64_t *recordSize) {
+    request(database->dbImpl, key);
+    return getRecord2(database->dbImpl, key, recordSize);
+}
+
+static void *memory_getRecord(stKVDatabase *database, int64_t key) {
+    int64_t recordSize;
+    return memory_getRecord2(database, key, &recordSize);
+}
+
+static void *memory_getPartialRecord(stKVDatabase *database, int64_t key, int64_t zeroBasedByteOffset,
+                                     int64_t sizeInBytes, int64_t recordSize) {
+    MemoryDatabase *memory = database->dbImpl;
+    request(memory, key);
+    memory->reads++;
+    stKVDatabaseBulkResult *record = stIntHash_search(memory->records, key);
+    if (record == NULL) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "key does not exist %" PRIi64, key);
+    }
+    return memcpy(st_malloc(sizeInBytes), (char *) record->value + zeroBasedByteOffset, sizeInBytes);
+}
+
+static stList *memory_bulkGetRecords(stKVDatabase *database, stList *keys) {
+    MemoryDatabase *memory = database->dbImpl;
+    roundTrip(memory);
+    memory->bulkGets++;
+    for (int64_t i = 0; i < stList_length(keys); i++) {
+        checkKey(memory, *(int64_t *) stList_get(keys, i));
+    }
+    stList *results = stList_construct3(0, (void (*)(void *)) stKVDatabaseBulkResult_destruct);
+    for (int64_t i = 0; i < stList_length(keys); i++) {
+        int64_t recordSize = 0;
+        void *record = getRecord2(memory, *(int64_t *) stList_get(keys, i), &recordSize);
+        stList_append(results, stKVDatabaseBulkResult_construct(record, recordSize));
+    }
+    return results;
+}
+
+static stList *memory_bulkGetRecordsRange(stKVDatabase *database, int64_t firstKey, int64_t numRecords) {
+    stList *keys = stList_construct3(0, free);
+    for (int64_t i = 0; i < numRecords; i++) {
+        int64_t *key = st_malloc(sizeof(int64_t));
+        *key = firstKey + i;
+        stList_append(keys, key);
+    }
+    stList *results = memory_bulkGetRecords(database, keys);
+    stList_destruct(keys);
+    return results;
+}
+
+static int64_t memory_numberOfRecords(stKVDatabase *database) {
+    MemoryDatabase *memory = database->dbImpl;
+    roundTrip(memory);
+    return stIntHash_size(memory->records);
+}
+
+static void removeRecord(MemoryDatabase *memory, int64_t key) {
+    stKVDatabaseBulkResult *record = stIntHash_remove(memory->records, key);
+    if (record == NULL) {
+        stThrowNew(ST_KV_DATABASE_EXCEPTION_ID, "key does not exist %" PRIi64, key);
+    }
+    memory->writes++;
+    stKVDatabaseBulkResult_destruct(record);
+}
+
+static void memory_removeRecord(stKVDatabase *database, int64_t key) {
+    request(database->dbImpl, key);
+    removeRecord(database->dbImpl, key);
+}
+
+static void memory_bulkRemoveRecords(stKVDatabase *database, stList *records) {
+    MemoryDatabase *memory = database->dbImpl;
+    roundTrip(memory);
+    for (int64_t i = 0; i < stList_length(records); i++) {
+        removeRecord(memory, stIntTuple_get(stList_get(records, i), 0));
+    }
+}
+
+stKVDatabase *memoryDatabase_construct(void) {
+    MemoryDatabase *memory = st_calloc(1, sizeof(MemoryDatabase));
+    memory->records = stIntHash_construct2((void (*)(void *)) stKVDatabaseBulkResult_destruct);
+    memory->failKey = INT64_MIN;
+    memoryDatabase = memory;
+    stKVDatabase *database = st_calloc(1, sizeof(struct stKVDatabase));
+    database->conf = stKVDatabaseConf_constructTokyoCabinet("unused");
+    database->dbImpl = memory;
+    database->destruct = memory_destruct;
+    database->containsRecord = memory_containsRecord;
+    database->insertRecord = memory_insertRecord;
+    database->updateRecord = memory_updateRecord;
+    database->setRecord = memory_setRecord;
+    database->bulkSetRecords = memory_bulkSetRecords;
+    database->getRecord = memory_getRecord;
+    database->getRecord2 = memory_getRecord2;
+    database->getPartialRecord = memory_getPartialRecord;
+    database->bulkGetRecords = memory_bulkGetRecords;
+    database->bulkGetRecordsRange = memory_bulkGetRecordsRange;
+    database->numberOfRecords = memory_numberOfRecords;
+    database->removeRecord = memory_removeRecord;
+    database->bulkRemoveRecords = memory_bulkRemoveRecords;
+    return database;
+}
+
+void memoryDatabase_setRecord(MemoryDatabase *memory, int64_t key, const void *value, int64_t sizeOfRecord) {
+    setRecord(memory, key, value, sizeOfRecord);
+}
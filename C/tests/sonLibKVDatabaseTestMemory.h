@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * A simple in memory database for testing the layers that sit in front of a
+ * database (caching, pipelining), with counts of the requests that reach it.
+ * Int64 records are not supported.
+ */
+
+#ifndef SONLIB_KV_DATABASE_TEST_MEMORY_H_
+#define SONLIB_KV_DATABASE_TEST_MEMORY_H_
+
+typedef struct _memoryDatabase {
+    stIntHash *records; // Keys to stKVDatabaseBulkResults.
+    int64_t reads;
+    int64_t writes;
+    int64_t bulkGets;
+    int64_t bulkSets;
+    int64_t latency; // Microseconds each request takes, zero by default.
+    int64_t failKey; // Requests involving this key throw an exception, INT64_MIN by default.
+} MemoryDatabase;
+
+// The backend of the most recently constructed memory database, NULL once it is destructed.
+extern MemoryDatabase *memoryDatabase;
+
+// The number of records in the last memory database destructed.
+extern int64_t memoryDatabaseRecordsAtDestruct;
+
+/*
+ * Constructs an empty database held in memory.
+ */
+stKVDatabase *memoryDatabase_construct(void);
+
+/*
+ * Sets a record directly in the backend, without counting as a request.
+ */
+void memoryDatabase_setRecord(MemoryDatabase *memory, int64_t key, const void *value, int64_t sizeOfRecord);
+
+#endif
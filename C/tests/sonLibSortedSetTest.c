@@ -12,6 +12,7 @@ static int64_t size = 7;
 static int64_t input[] = { 1, 5, -1, 10, 12, 3, -10 };
 static int64_t sortedInput[] = { -10, -1, 1, 3, 5, 10, 12 };
 static int64_t sortedSize = 7;
+static stSortedSetType sortedSetType = stSortedSetTypeAVL; // Type of tree the tests are run on.
 
 
 static void sonLibSortedSetTestTeardown() {
@@ -24,10 +25,10 @@ static void sonLibSortedSetTestTeardown() {
 
 static void sonLibSortedSetTestSetup() {
     sonLibSortedSetTestTeardown();
-    sortedSet = stSortedSet_construct3((int (*)(const void *, const void *))stIntTuple_cmpFn,
-            (void (*)(void *))stIntTuple_destruct);
-    sortedSet2 = stSortedSet_construct3((int (*)(const void *, const void *))stIntTuple_cmpFn,
-                (void (*)(void *))stIntTuple_destruct);
+    sortedSet = stSortedSet_construct4((int (*)(const void *, const void *))stIntTuple_cmpFn,
+            (void (*)(void *))stIntTuple_destruct, sortedSetType);
+    sortedSet2 = stSortedSet_construct4((int (*)(const void *, const void *))stIntTuple_cmpFn,
+                (void (*)(void *))stIntTuple_destruct, sortedSetType);
 }
 
 static void test_stSortedSet_construct(CuTest* testCase) {
@@ -497,6 +498,142 @@ static void test_stSortedSet_searchGreaterThan(CuTest* testCase) {
     sonLibSortedSetTestTeardown();
 }
 
+static void test_stSortedSet_bTree(CuTest* testCase) {
+    /*
+     * Reruns the tests above against the B-tree.
+     */
+    sortedSetType = stSortedSetTypeBTree;
+    test_stSortedSet_construct(testCase);
+    test_stSortedSet_copyConstruct(testCase);
+    test_stSortedSet(testCase);
+    test_stSortedSetIterator(testCase);
+    test_stSortedSetIterator_getIteratorFrom(testCase);
+    test_stSortedSetIterator_getReverseIterator(testCase);
+    test_stSortedSetEquals(testCase);
+    test_stSortedSetIntersection(testCase);
+    test_stSortedSetUnion(testCase);
+    test_stSortedSetDifference(testCase);
+    test_stSortedSet_searchLessThanOrEqual(testCase);
+    test_stSortedSet_searchLessThan(testCase);
+    test_stSortedSet_searchGreaterThanOrEqual(testCase);
+    test_stSortedSet_searchGreaterThan(testCase);
+    sortedSetType = stSortedSetTypeAVL;
+}
+
+static void test_stSortedSet_bTreeReplace(CuTest* testCase) {
+    /*
+     * Replaces every element of a multi-level B-tree with an equal copy and frees the original,
+     * so any separator still pointing at an original would be read after being freed.
+     */
+    int64_t n = 10000;
+    stSortedSet *bTree = stSortedSet_construct4((int (*)(const void *, const void *))stIntTuple_cmpFn,
+            (void (*)(void *))stIntTuple_destruct, stSortedSetTypeBTree);
+    for (int64_t i = 0; i < n; i++) {
+        stSortedSet_insert(bTree, stIntTuple_construct1(i));
+    }
+    for (int64_t i = 0; i < n; i++) {
+        stIntTuple *key = stIntTuple_construct1(i);
+        stIntTuple *original = stSortedSet_search(bTree, key);
+        stSortedSet_insert(bTree, key);
+        CuAssertTrue(testCase, stSortedSet_search(bTree, original) == key);
+        stIntTuple_destruct(original);
+    }
+    CuAssertIntEquals(testCase, n, stSortedSet_size(bTree));
+    for (int64_t i = 0; i < n; i++) {
+        stIntTuple *key = stIntTuple_construct1(i);
+        CuAssertTrue(testCase, stSortedSet_search(bTree, key) != NULL);
+        CuAssertTrue(testCase, stSortedSet_searchGreaterThan(bTree, key) != NULL || i == n - 1);
+        stIntTuple_destruct(key);
+    }
+    stSortedSet_destruct(bTree);
+}
+
+static void test_stSortedSet_bTreeRandom(CuTest* testCase) {
+    /*
+     * Compares the B-tree against the AVL tree under random inserts and removes, on sets large
+     * enough for the B-tree to have several levels, and checks that iterators survive
+     * modification of the set.
+     */
+    for (int64_t test = 0; test < 5; test++) {
+        stSortedSet *avl = stSortedSet_construct3((int (*)(const void *, const void *))stIntTuple_cmpFn,
+                (void (*)(void *))stIntTuple_destruct);
+        stSortedSet *bTree = stSortedSet_construct4((int (*)(const void *, const void *))stIntTuple_cmpFn,
+                (void (*)(void *))stIntTuple_destruct, stSortedSetTypeBTree);
+        CuAssertTrue(testCase, stSortedSet_getType(bTree) == stSortedSetTypeBTree);
+        int64_t maxKey = st_randomInt(1, 100000);
+        int64_t operations = st_randomInt(0, 200000);
+        for (int64_t i = 0; i < operations; i++) {
+            stIntTuple *key = stIntTuple_construct1(st_randomInt(0, maxKey));
+            if (st_random() > 0.5 - 0.1 * (test % 2)) {
+                if (stSortedSet_search(avl, key) == NULL) {
+                    stSortedSet_insert(avl, stIntTuple_construct1(stIntTuple_get(key, 0)));
+                    stSortedSet_insert(bTree, stIntTuple_construct1(stIntTuple_get(key, 0)));
+                }
+            } else {
+                stIntTuple *removed = stSortedSet_remove(avl, key);
+                CuAssertTrue(testCase, (removed == NULL) == (stSortedSet_search(bTree, key) == NULL));
+                if (removed != NULL) {
+                    stIntTuple_destruct(removed);
+                    stIntTuple_destruct(stSortedSet_remove(bTree, key));
+                }
+            }
+            CuAssertIntEquals(testCase, stSortedSet_size(avl), stSortedSet_size(bTree));
+            stIntTuple_destruct(key);
+        }
+        CuAssertTrue(testCase, stSortedSet_equals(avl, bTree));
+        CuAssertTrue(testCase, stIntTuple_equalsFn(stSortedSet_getFirst(avl), stSortedSet_getFirst(bTree)) ||
+                     stSortedSet_size(avl) == 0);
+        CuAssertTrue(testCase, stIntTuple_equalsFn(stSortedSet_getLast(avl), stSortedSet_getLast(bTree)) ||
+                     stSortedSet_size(avl) == 0);
+
+        for (int64_t i = -1; i <= maxKey + 1; i += st_randomInt(1, 100)) {
+            stIntTuple *key = stIntTuple_construct1(i);
+            void *(*searches[])(stSortedSet *, void *) = { stSortedSet_searchLessThan,
+                    stSortedSet_searchLessThanOrEqual, stSortedSet_searchGreaterThan,
+                    stSortedSet_searchGreaterThanOrEqual };
+            for (int64_t j = 0; j < 4; j++) {
+                stIntTuple *expected = searches[j](avl, key), *found = searches[j](bTree, key);
+                CuAssertTrue(testCase, expected == NULL ? found == NULL : (found != NULL && stIntTuple_equalsFn(expected, found)));
+            }
+            stIntTuple_destruct(key);
+        }
+
+        // Remove every other element while iterating, then iterate backwards. A removed element
+        // is freed only after the iterator has moved past it.
+        stSortedSetIterator *it = stSortedSet_getIterator(bTree);
+        stIntTuple *o, *p = NULL, *removed = NULL;
+        int64_t i = 0;
+        while ((o = stSortedSet_getNext(it)) != NULL) {
+            CuAssertTrue(testCase, p == NULL || stIntTuple_cmpFn(p, o) < 0);
+            if (removed != NULL) {
+                stIntTuple_destruct(removed);
+                removed = NULL;
+            }
+            if (i++ % 2 == 0) {
+                stIntTuple_destruct(stSortedSet_remove(avl, o));
+                removed = stSortedSet_remove(bTree, o);
+            }
+            p = o;
+        }
+        if (removed != NULL) {
+            stIntTuple_destruct(removed);
+        }
+        stSortedSet_destructIterator(it);
+        CuAssertTrue(testCase, stSortedSet_equals(avl, bTree));
+        it = stSortedSet_getReverseIterator(bTree);
+        stSortedSetIterator *avlIt = stSortedSet_getReverseIterator(avl);
+        while ((o = stSortedSet_getPrevious(it)) != NULL) {
+            CuAssertTrue(testCase, stIntTuple_equalsFn(o, stSortedSet_getPrevious(avlIt)));
+        }
+        CuAssertPtrEquals(testCase, NULL, stSortedSet_getPrevious(avlIt));
+        stSortedSet_destructIterator(it);
+        stSortedSet_destructIterator(avlIt);
+
+        stSortedSet_destruct(avl);
+        stSortedSet_destruct(bTree);
+    }
+}
+
 CuSuite* sonLib_stSortedSetTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, test_stSortedSet_construct);
@@ -513,5 +650,8 @@ CuSuite* sonLib_stSortedSetTestSuite(void) {
     SUITE_ADD_TEST(suite, test_stSortedSet_searchLessThan);
     SUITE_ADD_TEST(suite, test_stSortedSet_searchGreaterThanOrEqual);
     SUITE_ADD_TEST(suite, test_stSortedSet_searchGreaterThan);
+    SUITE_ADD_TEST(suite, test_stSortedSet_bTree);
+    SUITE_ADD_TEST(suite, test_stSortedSet_bTreeReplace);
+    SUITE_ADD_TEST(suite, test_stSortedSet_bTreeRandom);
     return suite;
 }
@@ -12,6 +12,7 @@
  */
 
 #include "sonLibGlobalsTest.h"
+#include "bioioC.h"
 
 static stTree *root = NULL;
 static stTree *internal;
@@ -137,6 +138,98 @@ static void test_stTree_newickTreeParser(CuTest *testCase) {
     teardown();
 }
 
+static void test_stTree_newickTreeParserLax(CuTest *testCase) {
+    // White space is allowed between the tokens.
+    stTree *tree = stTree_parseNewickString(" ( a : 1.5 ,\n\tb:2e-1 , (c) ) d : 3 ; ignored");
+    char *newString = stTree_getNewickTreeString(tree);
+    CuAssertStrEquals(testCase, "(a:1.5,b:0.2,(c))d:3;", newString);
+    free(newString);
+    stTree_destruct(tree);
+}
+
+/*
+ * Returns a caterpillar tree of the given depth, as a newick string.
+ */
+static char *getDeepNewickString(int64_t depth) {
+    char *string = st_malloc(depth * 20 + 10), *c = string;
+    for (int64_t i = 0; i < depth; i++) {
+        *c++ = '(';
+    }
+    c += sprintf(c, "x");
+    for (int64_t i = 0; i < depth; i++) {
+        c += sprintf(c, ",l%" PRIi64 ")n%" PRIi64 ":%" PRIi64, i, i, i % 7);
+    }
+    sprintf(c, ";");
+    return string;
+}
+
+static void test_stTree_newickTreeParserDeep(CuTest *testCase) {
+    // Deep enough to overflow the stack if parsing, writing or destructing recursed.
+    char *string = getDeepNewickString(1000000);
+    stTree *tree = stTree_parseNewickString(string);
+    char *newString = stTree_getNewickTreeString(tree);
+    CuAssertStrEquals(testCase, string, newString);
+    free(newString);
+    stTree_destruct(tree);
+
+    // And in an arena.
+    stArena *arena = stArena_construct();
+    tree = stTree_parseNewickStringInArena(string, arena);
+    newString = stTree_getNewickTreeString(tree);
+    CuAssertStrEquals(testCase, string, newString);
+    free(newString);
+    stTree_destruct(tree);
+    stArena_destruct(arena);
+    free(string);
+}
+
+static void test_stTree_arena(CuTest *testCase) {
+    const char *string = "((C:1,D:1)B:2,(F:3,G:3,(I:3,(K:4)J:5)H:5)E:6)A:9;";
+    stArena *arena = stArena_construct();
+    stTree *tree = stTree_parseNewickStringInArena(string, arena);
+    stTree *tree2 = stTree_parseNewickString(string);
+    CuAssertTrue(testCase, stTree_equals(tree, tree2));
+    stTree_setLabel(stTree_findChild(tree, "K"), "L");
+    CuAssertTrue(testCase, stTree_findChild(tree, "L") != NULL);
+    CuAssertTrue(testCase, !stTree_equals(tree, tree2));
+
+    // Nodes in and out of the arena can be mixed.
+    stTree *node = stTree_constructInArena(arena);
+    stTree_setParent(node, tree2);
+    stTree_setParent(stTree_construct(), node);
+    stTree_setLabel(node, "M");
+    CuAssertTrue(testCase, stTree_findChild(tree2, "M") == node);
+
+    stTree_destruct(tree);
+    stTree_destruct(tree2);
+    stArena_destruct(arena);
+}
+
+static void test_newickTreeParser(CuTest *testCase) {
+    // The BinaryTree parser, with and without the closing ';'.
+    for (int64_t i = 0; i < 2; i++) {
+        struct BinaryTree *binaryTree = newickTreeParser(i == 0 ? "((a:1,b:2,c)d:3,(e))f;" : "((a:1,b:2,c)d:3,(e))f",
+                                                         0.5, 1);
+        CuAssertStrEquals(testCase, "f", binaryTree->label);
+        CuAssertDblEquals(testCase, 0.5, binaryTree->distance, 0.0);
+        struct BinaryTree *d = binaryTree->left, *e = binaryTree->right;
+        CuAssertStrEquals(testCase, "d", d->label);
+        CuAssertDblEquals(testCase, 3.0, d->distance, 0.0);
+        CuAssertTrue(testCase, d->internal);
+        CuAssertStrEquals(testCase, "", d->left->label); // The node merging a and b.
+        CuAssertStrEquals(testCase, "a", d->left->left->label);
+        CuAssertDblEquals(testCase, 1.0, d->left->left->distance, 0.0);
+        CuAssertStrEquals(testCase, "b", d->left->right->label);
+        CuAssertStrEquals(testCase, "c", d->right->label);
+        CuAssertDblEquals(testCase, 0.5, d->right->distance, 0.0);
+        CuAssertTrue(testCase, !d->right->internal);
+        CuAssertTrue(testCase, e->internal); // A unary node.
+        CuAssertTrue(testCase, e->right == NULL);
+        CuAssertStrEquals(testCase, "e", e->left->label);
+        destructBinaryTree(binaryTree);
+    }
+}
+
 static void test_stTree_getNumNodes(CuTest* testCase) {
     setup();
     CuAssertTrue(testCase, stTree_getNumNodes(root) == 4);
@@ -266,6 +359,10 @@ CuSuite* sonLib_ETreeTestSuite(void) {
     SUITE_ADD_TEST(suite, test_stTree_getSetBranchLength);
     SUITE_ADD_TEST(suite, test_stTree_getSetClientData);
     SUITE_ADD_TEST(suite, test_stTree_newickTreeParser);
+    SUITE_ADD_TEST(suite, test_stTree_newickTreeParserLax);
+    SUITE_ADD_TEST(suite, test_stTree_newickTreeParserDeep);
+    SUITE_ADD_TEST(suite, test_stTree_arena);
+    SUITE_ADD_TEST(suite, test_newickTreeParser);
     SUITE_ADD_TEST(suite, test_stTree_label);
     SUITE_ADD_TEST(suite, test_stTree_getNumNodes);
     SUITE_ADD_TEST(suite, test_stTree_equals);
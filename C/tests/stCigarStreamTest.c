@@ -0,0 +1,293 @@
+/*
+ * Copyright (C) 2006-2012 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * Tests of stCigarReader and stCigarWriter, and of FlatPairwiseAlignment.
+ */
+
+#include "sonLibGlobalsTest.h"
+#include "stCigarStream.h"
+
+static struct PairwiseAlignment *getRandomPairwiseAlignment(bool withScores) {
+    struct List *operationList = constructEmptyList(0, (void (*)(void *)) destructAlignmentOperation);
+    int64_t length1 = 0, length2 = 0, operationNumber = st_randomInt(0, 100);
+    for (int64_t i = 0; i < operationNumber; i++) {
+        int64_t type = st_randomInt(0, 3), length = st_randomInt(0, i % 10 == 0 ? 100000 : 100);
+        length1 += type != PAIRWISE_INDEL_Y ? length : 0;
+        length2 += type != PAIRWISE_INDEL_X ? length : 0;
+        listAppend(operationList, constructAlignmentOperation(type, length, withScores ? st_random() : 0.0));
+    }
+    int64_t strand1 = st_randomInt(0, 2), strand2 = st_randomInt(0, 2);
+    int64_t start1 = st_randomInt(0, 1000000) + (strand1 ? 0 : length1);
+    int64_t start2 = st_randomInt(0, 1000000) + (strand2 ? 0 : length2);
+    char contig1[20], contig2[20];
+    sprintf(contig1, "chr%" PRIi64, st_randomInt(0, 5));
+    sprintf(contig2, "scaffold%" PRIi64, st_randomInt(0, 5));
+    return constructPairwiseAlignment(contig1, start1, strand1 ? start1 + length1 : start1 - length1, strand1,
+                                      contig2, start2, strand2 ? start2 + length2 : start2 - length2, strand2,
+                                      st_random() * 1000, operationList);
+}
+
+static void checkCigar(CuTest *testCase, struct PairwiseAlignment *pA, const stCigar *cigar, stCigarFormat format,
+                       bool withScores, float tolerance) {
+    CuAssertPtrNotNull(testCase, cigar);
+    CuAssertStrEquals(testCase, pA->contig1, cigar->contig1);
+    CuAssertIntEquals(testCase, pA->start1, cigar->start1);
+    CuAssertIntEquals(testCase, pA->end1, cigar->end1);
+    CuAssertIntEquals(testCase, pA->strand1, cigar->strand1);
+    CuAssertStrEquals(testCase, pA->contig2, cigar->contig2);
+    CuAssertIntEquals(testCase, pA->start2, cigar->start2);
+    CuAssertIntEquals(testCase, pA->end2, cigar->end2);
+    CuAssertIntEquals(testCase, pA->strand2, cigar->strand2);
+    CuAssertDblEquals(testCase, pA->score, cigar->score, tolerance);
+    // Text only shows the scores are there if there are operations.
+    CuAssertIntEquals(testCase, withScores && (format == stCigarBinary || pA->operationList->length > 0),
+                      cigar->hasScores);
+    CuAssertIntEquals(testCase, pA->operationList->length, cigar->operationNumber);
+    for (int64_t i = 0; i < cigar->operationNumber; i++) {
+        struct AlignmentOperation *op = pA->operationList->list[i];
+        CuAssertIntEquals(testCase, op->opType, cigar->operations[i].opType);
+        CuAssertIntEquals(testCase, op->length, cigar->operations[i].length);
+        CuAssertDblEquals(testCase, withScores ? op->score : 0.0, cigar->operations[i].score, tolerance);
+    }
+}
+
+static void testRoundTrip(CuTest *testCase) {
+    for (int64_t test = 0; test < 20; test++) {
+        bool withScores = st_random() > 0.5;
+        struct List *pAs = constructEmptyList(0, (void (*)(void *)) destructPairwiseAlignment);
+        for (int64_t i = st_randomInt(0, 50); i > 0; i--) {
+            listAppend(pAs, getRandomPairwiseAlignment(withScores));
+        }
+        for (stCigarFormat format = stCigarText; format <= stCigarBinary; format++) {
+            FILE *file = tmpfile();
+            stCigarWriter *writer = stCigarWriter_construct(file, format);
+            for (int64_t i = 0; i < pAs->length; i++) {
+                stCigarWriter_writePairwiseAlignment(writer, pAs->list[i], withScores);
+            }
+            stCigarWriter_destruct(writer);
+            rewind(file);
+            stCigarReader *reader = stCigarReader_construct(file);
+            CuAssertIntEquals(testCase, format, stCigarReader_getFormat(reader));
+            // Text holds scores to six decimal places, binary exactly.
+            float tolerance = format == stCigarText ? 0.000001 : 0.0;
+            for (int64_t i = 0; i < pAs->length; i++) {
+                checkCigar(testCase, pAs->list[i], stCigarReader_next(reader), format, withScores,
+                           tolerance * ((struct PairwiseAlignment *) pAs->list[i])->score + tolerance);
+            }
+            CuAssertPtrEquals(testCase, NULL, (void *) stCigarReader_next(reader));
+            stCigarReader_destruct(reader);
+            fclose(file);
+        }
+        destructList(pAs);
+    }
+}
+
+static void testTextMatchesCigarWrite(CuTest *testCase) {
+    for (int64_t test = 0; test < 20; test++) {
+        bool withScores = st_random() > 0.5;
+        struct PairwiseAlignment *pA = getRandomPairwiseAlignment(withScores);
+        FILE *file = tmpfile(), *file2 = tmpfile();
+        cigarWrite(file, pA, withScores);
+        stCigarWriter *writer = stCigarWriter_construct(file2, stCigarText);
+        stCigarWriter_writePairwiseAlignment(writer, pA, withScores);
+        stCigarWriter_destruct(writer);
+        int64_t length = ftell(file), length2 = ftell(file2);
+        CuAssertIntEquals(testCase, length, length2);
+        char *text = st_malloc(length), *text2 = st_malloc(length);
+        rewind(file);
+        rewind(file2);
+        CuAssertIntEquals(testCase, length, fread(text, 1, length, file));
+        CuAssertIntEquals(testCase, length, fread(text2, 1, length, file2));
+        CuAssertTrue(testCase, memcmp(text, text2, length) == 0);
+
+        // And cigarRead reads what the writer wrote.
+        rewind(file2);
+        struct PairwiseAlignment *pA2 = cigarRead(file2);
+        rewind(file2);
+        stCigarReader *reader = stCigarReader_construct(file2);
+        struct PairwiseAlignment *pA3 = stCigarReader_nextPairwiseAlignment(reader);
+        CuAssertPtrEquals(testCase, NULL, stCigarReader_nextPairwiseAlignment(reader));
+        stCigarReader_destruct(reader);
+        CuAssertStrEquals(testCase, pA2->contig1, pA3->contig1);
+        CuAssertStrEquals(testCase, pA2->contig2, pA3->contig2);
+        CuAssertIntEquals(testCase, pA2->end1, pA3->end1);
+        CuAssertIntEquals(testCase, pA2->operationList->length, pA3->operationList->length);
+        for (int64_t i = 0; i < pA2->operationList->length; i++) {
+            struct AlignmentOperation *op = pA2->operationList->list[i], *op3 = pA3->operationList->list[i];
+            CuAssertIntEquals(testCase, op->opType, op3->opType);
+            CuAssertIntEquals(testCase, op->length, op3->length);
+            CuAssertDblEquals(testCase, op->score, op3->score, 0.0);
+        }
+        destructPairwiseAlignment(pA);
+        destructPairwiseAlignment(pA2);
+        destructPairwiseAlignment(pA3);
+        free(text);
+        free(text2);
+        fclose(file);
+        fclose(file2);
+    }
+}
+
+static void testTextParsing(CuTest *testCase) {
+    // Blank lines, mixed operations, and a long last line without a line ending.
+    FILE *file = tmpfile();
+    fprintf(file, "\ncigar: b 10 0 - a 0 5 + 1.5 M 3 Z 5 0.25 Y 2 0.5\n  \ncigar: b 0 0 + a 0 2000000 + 0");
+    for (int64_t i = 0; i < 1000000; i++) {
+        fprintf(file, " D 2");
+    }
+    rewind(file);
+    stCigarReader *reader = stCigarReader_construct(file);
+    const stCigar *cigar = stCigarReader_next(reader);
+    CuAssertStrEquals(testCase, "a", cigar->contig1);
+    CuAssertIntEquals(testCase, 5, cigar->end1);
+    CuAssertStrEquals(testCase, "b", cigar->contig2);
+    CuAssertIntEquals(testCase, 10, cigar->start2);
+    CuAssertIntEquals(testCase, 0, cigar->strand2);
+    CuAssertDblEquals(testCase, 1.5, cigar->score, 0.0);
+    CuAssertTrue(testCase, cigar->hasScores);
+    CuAssertIntEquals(testCase, 3, cigar->operationNumber);
+    CuAssertIntEquals(testCase, PAIRWISE_MATCH, cigar->operations[0].opType);
+    CuAssertDblEquals(testCase, 0.0, cigar->operations[0].score, 0.0);
+    CuAssertIntEquals(testCase, PAIRWISE_INDEL_Y, cigar->operations[1].opType);
+    CuAssertDblEquals(testCase, 0.25, cigar->operations[1].score, 0.0);
+    CuAssertIntEquals(testCase, PAIRWISE_INDEL_X, cigar->operations[2].opType);
+    const char *contig1 = cigar->contig1;
+    cigar = stCigarReader_next(reader);
+    CuAssertPtrEquals(testCase, (void *) contig1, (void *) cigar->contig1); // The names are shared.
+    CuAssertTrue(testCase, !cigar->hasScores);
+    CuAssertIntEquals(testCase, 1000000, cigar->operationNumber);
+    CuAssertIntEquals(testCase, 2, cigar->operations[999999].length);
+    CuAssertPtrEquals(testCase, NULL, (void *) stCigarReader_next(reader));
+    stCigarReader_destruct(reader);
+    fclose(file);
+}
+
+static char *readFile(FILE *file, int64_t *length) {
+    *length = ftell(file);
+    char *text = st_malloc(*length + 1);
+    rewind(file);
+    *length = fread(text, 1, *length, file);
+    text[*length] = '\0';
+    return text;
+}
+
+static void testFlatPairwiseAlignment(CuTest *testCase) {
+    struct StringTable *contigNames = constructStringTable();
+    struct List *pAs = constructEmptyList(0, (void (*)(void *)) destructPairwiseAlignment);
+    struct List *fPAs = constructEmptyList(0, (void (*)(void *)) destructFlatPairwiseAlignment);
+    FILE *file = tmpfile(), *file2 = tmpfile(), *file3 = tmpfile();
+    stCigarWriter *writer = stCigarWriter_construct(file3, stCigarBinary);
+    for (int64_t i = 0; i < 100; i++) {
+        struct PairwiseAlignment *pA = getRandomPairwiseAlignment(true);
+        struct FlatPairwiseAlignment *fPA = flattenPairwiseAlignment(pA, contigNames);
+        listAppend(pAs, pA);
+        listAppend(fPAs, fPA);
+        CuAssertPtrEquals(testCase, (void *) stringTableIntern(contigNames, pA->contig1), (void *) fPA->contig1);
+        checkFlatPairwiseAlignment(fPA);
+        cigarWrite(file, pA, i % 2);
+        cigarWriteFlat(file2, fPA, i % 2);
+        stCigarWriter_writeFlatPairwiseAlignment(writer, fPA, true);
+
+        struct PairwiseAlignment *pA2 = unflattenPairwiseAlignment(fPA);
+        stCigar cigar = { fPA->contig1, fPA->start1, fPA->end1, fPA->strand1, fPA->contig2, fPA->start2, fPA->end2,
+                          fPA->strand2, fPA->score, true, fPA->operationNumber, fPA->operations };
+        checkCigar(testCase, pA2, &cigar, stCigarBinary, true, 0.0);
+        checkCigar(testCase, pA, &cigar, stCigarBinary, true, 0.0);
+        destructPairwiseAlignment(pA2);
+    }
+    stCigarWriter_destruct(writer);
+    CuAssertTrue(testCase, stringTableSize(contigNames) <= 10);
+
+    // cigarWriteFlat writes the same as cigarWrite.
+    int64_t length, length2;
+    char *text = readFile(file, &length), *text2 = readFile(file2, &length2);
+    CuAssertStrEquals(testCase, text, text2);
+    free(text);
+    free(text2);
+
+    // And the alignments can be read back as flat alignments.
+    rewind(file3);
+    stCigarReader *reader = stCigarReader_construct(file3);
+    struct StringTable *contigNames2 = constructStringTable();
+    for (int64_t i = 0; i < 100; i++) {
+        struct FlatPairwiseAlignment *fPA = stCigarReader_nextFlatPairwiseAlignment(reader, contigNames2);
+        struct FlatPairwiseAlignment *fPA2 = fPAs->list[i];
+        CuAssertStrEquals(testCase, fPA2->contig2, fPA->contig2);
+        CuAssertPtrEquals(testCase, (void *) stringTableIntern(contigNames2, fPA2->contig2), (void *) fPA->contig2);
+        CuAssertIntEquals(testCase, fPA2->operationNumber, fPA->operationNumber);
+        for (int64_t j = 0; j < fPA->operationNumber; j++) {
+            CuAssertIntEquals(testCase, fPA2->operations[j].opType, fPA->operations[j].opType);
+            CuAssertIntEquals(testCase, fPA2->operations[j].length, fPA->operations[j].length);
+            CuAssertDblEquals(testCase, fPA2->operations[j].score, fPA->operations[j].score, 0.0);
+        }
+        destructFlatPairwiseAlignment(fPA);
+    }
+    CuAssertPtrEquals(testCase, NULL, stCigarReader_nextFlatPairwiseAlignment(reader, contigNames2));
+    stCigarReader_destruct(reader);
+
+    fclose(file);
+    fclose(file2);
+    fclose(file3);
+    destructList(pAs);
+    destructList(fPAs);
+    destructStringTable(contigNames);
+    destructStringTable(contigNames2);
+}
+
+static void checkReadFails(CuTest *testCase, const char *bytes, int64_t length) {
+    FILE *file = tmpfile();
+    fwrite(bytes, 1, length, file);
+    rewind(file);
+    stCigarReader *reader = stCigarReader_construct(file);
+    stTry {
+        while (stCigarReader_next(reader) != NULL) {
+            continue;
+        }
+        CuAssertTrue(testCase, 0);
+    } stCatch(except) {
+        CuAssertTrue(testCase, stExcept_idEq(except, ST_CIGAR_EXCEPTION_ID));
+    } stTryEnd;
+    stCigarReader_destruct(reader);
+    fclose(file);
+}
+
+static void testErrors(CuTest *testCase) {
+    checkReadFails(testCase, "cigar: a 0 1 + b 0 1 + 0 M 1\nnot a cigar\n", 42);
+    checkReadFails(testCase, "cigar: a 0 1 + b 0 1 + 0 Q 1\n", 29);
+    checkReadFails(testCase, "cigar: a 0 1 * b 0 1 + 0 M 1\n", 29);
+    checkReadFails(testCase, "cigar: a 0 1 + b 0 1 + 0 M\n", 27);
+
+    // A binary file, truncated at each byte.
+    FILE *file = tmpfile();
+    stCigarWriter *writer = stCigarWriter_construct(file, stCigarBinary);
+    struct PairwiseAlignment *pA = getRandomPairwiseAlignment(true);
+    stCigarWriter_writePairwiseAlignment(writer, pA, true);
+    destructPairwiseAlignment(pA);
+    stCigarWriter_destruct(writer);
+    int64_t length = ftell(file);
+    char *bytes = st_malloc(length);
+    rewind(file);
+    CuAssertIntEquals(testCase, length, fread(bytes, 1, length, file));
+    fclose(file);
+    for (int64_t i = 9; i < length; i++) {
+        checkReadFails(testCase, bytes, i);
+    }
+    bytes[8] = 8; // Unknown flags.
+    checkReadFails(testCase, bytes, length);
+    free(bytes);
+    checkReadFails(testCase, "stCigar1\x00\x01", 10); // A name before any have been given.
+}
+
+CuSuite* sonLib_stCigarStreamTestSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testRoundTrip);
+    SUITE_ADD_TEST(suite, testTextMatchesCigarWrite);
+    SUITE_ADD_TEST(suite, testTextParsing);
+    SUITE_ADD_TEST(suite, testFlatPairwiseAlignment);
+    SUITE_ADD_TEST(suite, testErrors);
+    return suite;
+}
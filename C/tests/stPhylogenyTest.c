@@ -424,6 +424,18 @@ static void checkDistanceFunctions(stTree *tree, CuTest *testCase) {
     }
 
     CuAssertDblEquals(testCase, stPhylogeny_distanceBetweenNodes(tree, tree), 0.0, 0.0);
+
+    // Check distanceBetweenNodes on all pairs of nodes, internal ones
+    // included, against the LCA index of a frozen tree.
+    stFrozenTree *frozenTree = stFrozenTree_construct2(tree, true);
+    for (i = 0; i < stFrozenTree_getNodeNumber(frozenTree); i++) {
+        for (j = 0; j < stFrozenTree_getNodeNumber(frozenTree); j++) {
+            CuAssertDblEquals(testCase, stFrozenTree_getDistance(frozenTree, i, j),
+                              stPhylogeny_distanceBetweenNodes(stFrozenTree_getStTree(frozenTree, i),
+                                                               stFrozenTree_getStTree(frozenTree, j)), 1e-9);
+        }
+    }
+    stFrozenTree_destruct(frozenTree);
 }
 
 // Test neighbor-joining on random distance matrices, and test several
@@ -639,6 +651,38 @@ static stTree *getRandomBinaryTree(int64_t maxDepth, int64_t *numLeaves) {
     return ret;
 }
 
+// Test that the MRCA matrix gives the MRCA of every pair of species.
+static void testGetMRCAMatrix(CuTest *testCase) {
+    for (int64_t testNum = 0; testNum < 20; testNum++) {
+        int64_t numLeaves = 0;
+        stTree *speciesTree = getRandomBinaryTree(st_randomInt64(2, 6), &numLeaves);
+        stHash *speciesToIndex = stHash_construct2(NULL, (void (*)(void *)) stIntTuple_destruct);
+        // Computing the join costs is the only way to fill in speciesToIndex.
+        stMatrix *joinCosts = stPhylogeny_computeJoinCosts(speciesTree, speciesToIndex, 1.0, 1.0);
+        int64_t **mrcaMatrix = stPhylogeny_getMRCAMatrix(speciesTree, speciesToIndex);
+        int64_t numSpecies = stHash_size(speciesToIndex);
+        stTree **indexToSpecies = st_malloc(numSpecies * sizeof(stTree *));
+        stHashIterator *it = stHash_getIterator(speciesToIndex);
+        stTree *species;
+        while ((species = stHash_getNext(it)) != NULL) {
+            indexToSpecies[stIntTuple_get(stHash_search(speciesToIndex, species), 0)] = species;
+        }
+        stHash_destructIterator(it);
+        for (int64_t i = 0; i < numSpecies; i++) {
+            for (int64_t j = 0; j < numSpecies; j++) {
+                stTree *mrca = stTree_getMRCA(indexToSpecies[i], indexToSpecies[j]);
+                CuAssertTrue(testCase, indexToSpecies[mrcaMatrix[i][j]] == mrca);
+            }
+            free(mrcaMatrix[i]);
+        }
+        free(mrcaMatrix);
+        free(indexToSpecies);
+        stMatrix_destruct(joinCosts);
+        stHash_destruct(speciesToIndex);
+        stTree_destruct(speciesTree);
+    }
+}
+
 // Test that the join costs are equal to what the reconciliation cost
 // functions would suggest.
 static void testJoinCosts_random(CuTest *testCase) {
@@ -1420,6 +1464,86 @@ static void testStPhylogeny_applyJukesCantorCorrection(CuTest *testCase) {
     stMatrix_destruct(distanceMatrix);
 }
 
+// Appends the species each node of a reconciled tree maps to, in preorder.
+static void getReconciledSpecies(stTree *tree, stList *species) {
+    stPhylogenyInfo *info = stTree_getClientData(tree);
+    stList_append(species, info->recon->species);
+    for (int64_t i = 0; i < stTree_getChildNumber(tree); i++) {
+        getReconciledSpecies(stTree_getChild(tree, i), species);
+    }
+}
+
+// Test that reconciling many gene trees with one shared species index
+// gives the same results as building the index on each call.
+static void testStPhylogeny_reconcileWithSpeciesIndex(CuTest *testCase) {
+    int64_t numSpecies = st_randomInt64(3, 30);
+    stMatrix *matrix = getRandomDistanceMatrix(numSpecies);
+    stTree *speciesTree = stPhylogeny_neighborJoin(matrix, NULL);
+    stMatrix_destruct(matrix);
+    stSpeciesIndex *speciesIndex = stSpeciesIndex_construct(speciesTree);
+    for (int64_t testNum = 0; testNum < 20; testNum++) {
+        int64_t numGenes = st_randomInt64(3, 50);
+        matrix = getRandomDistanceMatrix(numGenes);
+        stTree *geneTree = stPhylogeny_neighborJoin(matrix, NULL);
+        stMatrix_destruct(matrix);
+        stHash *leafToSpecies = stHash_construct();
+        for (int64_t i = 0; i < numGenes; i++) {
+            stTree *gene = stPhylogeny_getLeafByIndex(geneTree, i);
+            stTree *species = stPhylogeny_getLeafByIndex(speciesTree, st_randomInt64(0, numSpecies));
+            stHash_insert(leafToSpecies, gene, species);
+        }
+
+        for (int64_t nonBinary = 0; nonBinary < 2; nonBinary++) {
+            stList *species = stList_construct();
+            stList *indexedSpecies = stList_construct();
+            if (nonBinary) {
+                stPhylogeny_reconcileNonBinary(geneTree, leafToSpecies, false);
+            } else {
+                stPhylogeny_reconcileAtMostBinary(geneTree, leafToSpecies, false);
+            }
+            getReconciledSpecies(geneTree, species);
+            int64_t dups = 0, losses = 0;
+            stPhylogeny_reconciliationCostAtMostBinary(geneTree, &dups, &losses);
+            stPhylogenyInfo_destructOnTree(geneTree);
+            stPhylogeny_addStIndexedTreeInfo(geneTree);
+
+            if (nonBinary) {
+                stPhylogeny_reconcileNonBinary2(geneTree, leafToSpecies, speciesIndex, false);
+            } else {
+                stPhylogeny_reconcileAtMostBinary2(geneTree, leafToSpecies, speciesIndex, false);
+            }
+            getReconciledSpecies(geneTree, indexedSpecies);
+            int64_t indexedDups = 0, indexedLosses = 0;
+            stPhylogeny_reconciliationCostAtMostBinary2(geneTree, speciesIndex, &indexedDups, &indexedLosses);
+            CuAssertIntEquals(testCase, stList_length(species), stList_length(indexedSpecies));
+            for (int64_t i = 0; i < stList_length(species); i++) {
+                CuAssertPtrEquals(testCase, stList_get(species, i), stList_get(indexedSpecies, i));
+            }
+            CuAssertIntEquals(testCase, dups, indexedDups);
+            CuAssertIntEquals(testCase, losses, indexedLosses);
+            stList_destruct(species);
+            stList_destruct(indexedSpecies);
+        }
+
+        stTree *rooted = stPhylogeny_rootByReconciliationAtMostBinary(geneTree, leafToSpecies);
+        stTree *indexedRooted = stPhylogeny_rootByReconciliationAtMostBinary2(geneTree, leafToSpecies, speciesIndex);
+        char *newick = stTree_getNewickTreeString(rooted);
+        char *indexedNewick = stTree_getNewickTreeString(indexedRooted);
+        CuAssertStrEquals(testCase, newick, indexedNewick);
+        free(newick);
+        free(indexedNewick);
+        stTree_destruct(rooted);
+        stTree_destruct(indexedRooted);
+
+        stPhylogenyInfo_destructOnTree(geneTree);
+        stTree_destruct(geneTree);
+        stHash_destruct(leafToSpecies);
+    }
+    stSpeciesIndex_destruct(speciesIndex);
+    stPhylogenyInfo_destructOnTree(speciesTree);
+    stTree_destruct(speciesTree);
+}
+
 // Large tree that takes forever if the reconciliation algorithm isn't
 // linear time. This is sort of a hacky way to test that the
 // reconciliation algorithm stays linear. The test won't fail if it is
@@ -1454,6 +1578,7 @@ CuSuite* sonLib_stPhylogenyTestSuite(void) {
     SUITE_ADD_TEST(suite, testStPhylogeny_getSplits);
     SUITE_ADD_TEST(suite, testStPhylogeny_nni);
     SUITE_ADD_TEST(suite, testJoinCosts_random);
+    SUITE_ADD_TEST(suite, testGetMRCAMatrix);
     SUITE_ADD_TEST(suite, testStPhylogeny_reconcileAtMostBinary_degree2Nodes);
     SUITE_ADD_TEST(suite, testSimpleNeighborJoin);
     SUITE_ADD_TEST(suite, testSimpleBootstrapPartitionScoring);
@@ -1468,6 +1593,7 @@ CuSuite* sonLib_stPhylogenyTestSuite(void) {
     SUITE_ADD_TEST(suite, testStPhylogeny_reconcileNonBinary);
     SUITE_ADD_TEST(suite, testStPhylogeny_applyJukesCantorCorrection);
     SUITE_ADD_TEST(suite, testStPhylogeny_reconcileLargeTree_shouldBeFast);
+    SUITE_ADD_TEST(suite, testStPhylogeny_reconcileWithSpeciesIndex);
 
     (void) testStPhylogeny_reconciliationCostAtMostBinary_polytomies;
     (void) testStPhylogeny_getLinkedSpeciesTree;
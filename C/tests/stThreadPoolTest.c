@@ -79,8 +79,215 @@ static void testStThreadPoolSort(CuTest *testCase) {
     }
 }
 
+static void *square(void *x) {
+    return (void *) ((intptr_t) x * (intptr_t) x);
+}
+
+static void testStThreadPoolSubmit(CuTest *testCase) {
+    stThreadPool *threadPool = stThreadPool_construct2(st_randomInt64(1, 6), NULL, NULL, stThreadPoolFIFO);
+    stList *tasks = stList_construct();
+    for (intptr_t i = 0; i < 10000; i++) {
+        stList_append(tasks, stThreadPool_submit(threadPool, square, (void *) i));
+    }
+    for (intptr_t i = stList_length(tasks) - 1; i >= 0; i--) {
+        stThreadPoolTask *task = stList_get(tasks, i);
+        CuAssertIntEquals(testCase, i * i, (intptr_t) stThreadPoolTask_wait(task));
+        CuAssertTrue(testCase, stThreadPoolTask_done(task));
+        stThreadPoolTask_destruct(task);
+    }
+    stThreadPool_wait(threadPool);
+    stList_destruct(tasks);
+    stThreadPool_destruct(threadPool);
+}
+
+// Naive parallel fibonacci, where each task submits and waits on
+// subtasks, so every worker ends up waiting inside a task.
+static stThreadPool *fibPool;
+
+static void *fib(void *n) {
+    intptr_t i = (intptr_t) n;
+    if (i < 2) {
+        return n;
+    }
+    stThreadPoolTask *task = stThreadPool_submit(fibPool, fib, (void *) (i - 1));
+    intptr_t f = (intptr_t) fib((void *) (i - 2));
+    f += (intptr_t) stThreadPoolTask_wait(task);
+    stThreadPoolTask_destruct(task);
+    return (void *) f;
+}
+
+static void testStThreadPoolNestedSubmit(CuTest *testCase) {
+    for (int64_t testNum = 0; testNum < 3; testNum++) {
+        fibPool = stThreadPool_construct2(st_randomInt64(1, 6), NULL, NULL,
+                                          testNum % 2 ? stThreadPoolFIFO : stThreadPoolLIFO);
+        stThreadPoolTask *task = stThreadPool_submit(fibPool, fib, (void *) 20);
+        CuAssertIntEquals(testCase, 6765, (intptr_t) stThreadPoolTask_wait(task));
+        stThreadPoolTask_destruct(task);
+        stThreadPool_destruct(fibPool);
+    }
+}
+
+// Work units that push further work units from inside the work
+// function, counted in the finish function.
+static stThreadPool *treePool;
+static int64_t treeNodesFinished;
+
+static void *expandTree(void *depth) {
+    if ((intptr_t) depth > 0) {
+        for (int64_t i = 0; i < 4; i++) {
+            stThreadPool_push(treePool, (void *) ((intptr_t) depth - 1));
+        }
+    }
+    return NULL;
+}
+
+static void countTreeNode(void *result) {
+    treeNodesFinished++;
+}
+
+static void testStThreadPoolNestedPush(CuTest *testCase) {
+    treePool = stThreadPool_construct(st_randomInt64(1, 6), expandTree, countTreeNode);
+    treeNodesFinished = 0;
+    stThreadPool_push(treePool, (void *) 6);
+    stThreadPool_wait(treePool);
+    CuAssertTrue(testCase, stThreadPool_done(treePool));
+    CuAssertIntEquals(testCase, (4 * 4 * 4 * 4 * 4 * 4 * 4 - 1) / 3, treeNodesFinished);
+    stThreadPool_destruct(treePool);
+}
+
+// With a single thread a FIFO pool runs work in the order it was
+// pushed.
+static stList *finishOrder;
+
+static void *identity(void *x) {
+    return x;
+}
+
+static void recordFinish(void *x) {
+    stList_append(finishOrder, x);
+}
+
+static void testStThreadPoolFIFO(CuTest *testCase) {
+    finishOrder = stList_construct();
+    stThreadPool *threadPool = stThreadPool_construct2(1, identity, recordFinish, stThreadPoolFIFO);
+    CuAssertIntEquals(testCase, 1, stThreadPool_getNumThreads(threadPool));
+    for (intptr_t i = 0; i < 1000; i++) {
+        stThreadPool_push(threadPool, (void *) i);
+    }
+    stThreadPool_wait(threadPool);
+    CuAssertIntEquals(testCase, 1000, stList_length(finishOrder));
+    for (intptr_t i = 0; i < 1000; i++) {
+        CuAssertIntEquals(testCase, i, (intptr_t) stList_get(finishOrder, i));
+    }
+    stThreadPool_destruct(threadPool);
+    stList_destruct(finishOrder);
+}
+
+// stParallel_for covers every index in the range exactly once.
+static void fillSquares(int64_t start, int64_t end, void *ctx) {
+    int64_t *array = ctx;
+    for (int64_t i = start; i < end; i++) {
+        array[i] += i * i;
+    }
+}
+
+static void testStParallelFor(CuTest *testCase) {
+    int64_t length = 10007;
+    int64_t grains[] = { 0, 1, 100, 20000 };
+    for (int64_t g = 0; g < 4; g++) {
+        int64_t *array = st_calloc(length, sizeof(int64_t));
+        stParallel_for(0, length, grains[g], fillSquares, array);
+        for (int64_t i = 0; i < length; i++) {
+            CuAssertIntEquals(testCase, i * i, array[i]);
+        }
+        free(array);
+    }
+    // An empty range does nothing.
+    stParallel_for(5, 5, 0, fillSquares, NULL);
+    stParallel_for(5, 2, 0, fillSquares, NULL);
+}
+
+static void *sumSquares(int64_t start, int64_t end, void *ctx) {
+    int64_t *sum = st_malloc(sizeof(int64_t));
+    *sum = 0;
+    for (int64_t i = start; i < end; i++) {
+        *sum += i * i;
+    }
+    return sum;
+}
+
+static void *addSums(void *sum1, void *sum2, void *ctx) {
+    *(int64_t *) sum1 += *(int64_t *) sum2;
+    free(sum2);
+    return sum1;
+}
+
+// Concatenates the ranges, to check the results are combined in order.
+static void *rangeList(int64_t start, int64_t end, void *ctx) {
+    stList *list = stList_construct();
+    for (intptr_t i = start; i < end; i++) {
+        stList_append(list, (void *) i);
+    }
+    return list;
+}
+
+static void *appendLists(void *list1, void *list2, void *ctx) {
+    stList_appendAll(list1, list2);
+    stList_destruct(list2);
+    return list1;
+}
+
+static void testStParallelReduce(CuTest *testCase) {
+    int64_t *sum = stParallel_reduce(-50, 1000, 0, sumSquares, addSums, NULL);
+    int64_t expected = 0;
+    for (int64_t i = -50; i < 1000; i++) {
+        expected += i * i;
+    }
+    CuAssertIntEquals(testCase, expected, *sum);
+    free(sum);
+
+    stList *list = stParallel_reduce(0, 1000, 7, rangeList, appendLists, NULL);
+    CuAssertIntEquals(testCase, 1000, stList_length(list));
+    for (intptr_t i = 0; i < 1000; i++) {
+        CuAssertIntEquals(testCase, i, (intptr_t) stList_get(list, i));
+    }
+    stList_destruct(list);
+
+    CuAssertPtrEquals(testCase, NULL, stParallel_reduce(3, 3, 0, sumSquares, addSums, NULL));
+}
+
+// Parallel loops can be nested, as the inner loops run in tasks on
+// the default pool.
+static void fillRows(int64_t start, int64_t end, void *ctx) {
+    int64_t **rows = ctx;
+    for (int64_t i = start; i < end; i++) {
+        stParallel_for(0, 100, 10, fillSquares, rows[i]);
+    }
+}
+
+static void testStParallelForNested(CuTest *testCase) {
+    int64_t *rows[50];
+    for (int64_t i = 0; i < 50; i++) {
+        rows[i] = st_calloc(100, sizeof(int64_t));
+    }
+    stParallel_for(0, 50, 1, fillRows, rows);
+    for (int64_t i = 0; i < 50; i++) {
+        for (int64_t j = 0; j < 100; j++) {
+            CuAssertIntEquals(testCase, j * j, rows[i][j]);
+        }
+        free(rows[i]);
+    }
+}
+
 CuSuite *sonLib_stThreadPoolTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, testStThreadPoolSort);
+    SUITE_ADD_TEST(suite, testStThreadPoolSubmit);
+    SUITE_ADD_TEST(suite, testStThreadPoolNestedSubmit);
+    SUITE_ADD_TEST(suite, testStThreadPoolNestedPush);
+    SUITE_ADD_TEST(suite, testStThreadPoolFIFO);
+    SUITE_ADD_TEST(suite, testStParallelFor);
+    SUITE_ADD_TEST(suite, testStParallelReduce);
+    SUITE_ADD_TEST(suite, testStParallelForNested);
     return suite;
 }
@@ -21,6 +21,8 @@ from sonLib.bioio import fastaRead
 from sonLib.bioio import fastaWrite
 from sonLib.bioio import fastqRead
 from sonLib.bioio import fastqWrite
+from sonLib.bioio import fastaIndex
+from sonLib.bioio import FastaIndex
 from sonLib.bioio import getRandomSequence
 
 from sonLib.bioio import pWMRead
@@ -199,6 +201,42 @@ class TestCase(unittest.TestCase):
             outFh.close()
             fileHandle.close()
 
+    def testFastaIndex(self):
+        """Tests random access to fasta files through their index, and that the index
+        is in the format of samtools faidx (and the C stFastaIndex).
+        """
+        tempFile = os.path.join(self.tempDir, "test.fa")
+        fileHandle = open(tempFile, 'w')
+        fileHandle.write("ignored\n>a desc\nACGT\nAC\n\n>b\n>c\r\nAAA\r\nCCC\r\nG")
+        fileHandle.close()
+        assert fastaIndex(tempFile) == [ ("a", 6, 16, 4, 5), ("b", 0, 28, 0, 0), ("c", 7, 32, 3, 5) ]
+        fileHandle = open(tempFile + ".fai", 'r')
+        assert fileHandle.read() == "a\t6\t16\t4\t5\nb\t0\t28\t0\t0\nc\t7\t32\t3\t5\n"
+        fileHandle.close()
+        with FastaIndex(tempFile) as index:
+            assert index.names() == [ "a", "b", "c" ]
+            assert index.fetch("a") == "ACGTAC"
+            assert index.fetch("b") == ""
+            assert index.fetch("c", 2, 5) == "ACCCG"
+            self.assertRaises(RuntimeError, index.fetch, "c", 5, 3)
+            self.assertRaises(RuntimeError, index.length, "d")
+
+        for test in range(0, self.testNo):
+            seqs = [ ("seq%s" % i, getRandomSequence()[1]) for i in range(random.choice(range(1, 10))) ]
+            fileHandle = open(tempFile, 'w')
+            for name, seq in seqs:
+                fastaWrite(fileHandle, name, seq)
+            fileHandle.close()
+            os.remove(tempFile + ".fai")
+            with FastaIndex(tempFile) as index:
+                assert len(index) == len(seqs)
+                for name, seq in seqs:
+                    assert index.length(name) == len(seq)
+                    assert index.fetch(name) == seq
+                    start = random.choice(range(len(seq) + 1))
+                    length = random.choice(range(len(seq) - start + 1))
+                    assert index.fetch(name, start, length) == seq[start:start + length]
+
     #########################################################
     #########################################################
     #########################################################
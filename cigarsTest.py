@@ -68,5 +68,26 @@ class TestCase(unittest.TestCase):
             assert len(l) == 0
             fileHandle.close()
 
+    def testCigarBinaryConversion(self):
+        """Tests converting cigars to the binary format and back with sonLib_cigarConvert.
+        """
+        tempFile = getTempFile()
+        binaryFile = getTempFile()
+        self.tempFiles += [ tempFile, binaryFile ]
+        for test in range(0, self.testNo):
+            l = [ getRandomPairwiseAlignment() for i in range(random.choice(range(10))) ]
+            fileHandle = open(tempFile, 'w')
+            for pairwiseAlignment in l:
+                cigarWrite(fileHandle, pairwiseAlignment, True)
+            fileHandle.close()
+
+            system("sonLib_cigarConvert binary %s %s" % (tempFile, binaryFile))
+            system("sonLib_cigarConvert text %s %s" % (binaryFile, tempFile))
+
+            fileHandle = open(tempFile, 'r')
+            l2 = list(cigarRead(fileHandle))
+            fileHandle.close()
+            assert l == l2
+
 if __name__ == '__main__':
     unittest.main()
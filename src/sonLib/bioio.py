@@ -14,6 +14,7 @@ import logging.handlers
 import tempfile
 import random
 import math
+import mmap
 import shutil
 import resource
 import unittest
@@ -847,6 +848,131 @@ def fastaWrite(fileHandleOrFile, name, seq, mode="w"):
     if isinstance(fileHandleOrFile, "".__class__):
         fileHandle.close()
 
+def _buildFastaIndex(fasta):
+    """Builds the samtools faidx style index of a fasta file, as a list of
+    (name, length, offset, lineBases, lineWidth) tuples in the order of the file.
+    """
+    index = []
+    names = set()
+    entry = None
+    offset = 0
+    fileHandle = open(fasta, 'rb')
+    for line in fileHandle:
+        if line.startswith(b'>'):
+            if entry is not None:
+                index.append(tuple(entry[:5]))
+            fields = line[1:].split()
+            name = fields[0].decode("ascii") if len(fields) > 0 else ""
+            if name in names:
+                raise RuntimeError("The sequence name %s is used twice in %s" % (name, fasta))
+            names.add(name)
+            # name, length, offset, line bases, line width, ended by a short or blank line
+            entry = [ name, 0, offset + len(line), 0, 0, False ]
+        elif entry is not None:
+            bases = len(line.rstrip(b'\r\n'))
+            if bases > 0 and entry[3] == 0 and not entry[5]:
+                entry[3], entry[4] = bases, len(line)
+            elif bases > 0 and (entry[5] or bases > entry[3] or
+                                (bases == entry[3] and line.endswith(b'\n') and len(line) != entry[4])):
+                raise RuntimeError("The lines of sequence %s in %s differ in length" % (entry[0], fasta))
+            entry[5] = entry[5] or bases < entry[3] or bases == 0
+            entry[1] += bases
+        offset += len(line)
+    if entry is not None:
+        index.append(tuple(entry[:5]))
+    fileHandle.close()
+    return index
+
+def fastaIndex(fasta):
+    """Returns the samtools faidx style index of a fasta file, as a list of
+    (name, length, offset, lineBases, lineWidth) tuples in the order of the file.
+    The index is read from fasta.fai if that is at least as new as the fasta file,
+    otherwise it is built and written there if possible.
+    """
+    indexFile = fasta + ".fai"
+    if os.path.exists(indexFile) and os.path.getmtime(indexFile) >= os.path.getmtime(fasta):
+        index = []
+        fileHandle = open(indexFile, 'r')
+        for line in fileHandle:
+            fields = line.rstrip("\n").split("\t")
+            index.append((fields[0],) + tuple(int(i) for i in fields[1:5]))
+        fileHandle.close()
+        return index
+    index = _buildFastaIndex(fasta)
+    try:
+        fileHandle = open(indexFile, 'w')
+    except IOError:
+        return index
+    for entry in index:
+        fileHandle.write("%s\t%s\t%s\t%s\t%s\n" % entry)
+    fileHandle.close()
+    return index
+
+class FastaIndex:
+    """Random access to the sequences of a fasta file, through its index (see fastaIndex,
+    which is compatible with samtools faidx and the C stFastaIndex) and a memory mapping
+    of the file, so only the lines holding the bases asked for are read.
+    """
+    def __init__(self, fasta):
+        self.fasta = fasta
+        self.index = fastaIndex(fasta)
+        self.entries = dict((entry[0], entry) for entry in self.index)
+        self.fileHandle = open(fasta, 'rb')
+        self.map = None
+        if os.path.getsize(fasta) > 0: #Empty files can't be mapped
+            self.map = mmap.mmap(self.fileHandle.fileno(), 0, access=mmap.ACCESS_READ)
+
+    def names(self):
+        """Returns the names of the sequences, in the order of the file.
+        """
+        return [ entry[0] for entry in self.index ]
+
+    def length(self, name):
+        """Returns the length of the named sequence.
+        """
+        return self._getEntry(name)[1]
+
+    def fetch(self, name, start=0, length=None):
+        """Returns length bases of the named sequence from start (counting from zero),
+        or the rest of the sequence if length is None.
+        """
+        name, seqLength, offset, lineBases, lineWidth = self._getEntry(name)
+        if length is None:
+            length = seqLength - start
+        if start < 0 or length < 0 or start + length > seqLength:
+            raise RuntimeError("The range %s to %s is outside sequence %s, of length %s" % (start, start + length, name, seqLength))
+        seq = []
+        while length > 0:
+            column = start % lineBases
+            bases = min(lineBases - column, length)
+            position = offset + (start // lineBases) * lineWidth + column
+            seq.append(self.map[position:position + bases])
+            start += bases
+            length -= bases
+        return b"".join(seq).decode("ascii")
+
+    def close(self):
+        if self.map is not None:
+            self.map.close()
+        self.fileHandle.close()
+
+    def _getEntry(self, name):
+        if name not in self.entries:
+            raise RuntimeError("There is no sequence %s in %s" % (name, self.fasta))
+        return self.entries[name]
+
+    def __contains__(self, name):
+        return name in self.entries
+
+    def __len__(self):
+        return len(self.index)
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
 def fastqRead(fileHandleOrFile):
     """Reads a fastq file iteratively
     """